@@ -39,6 +39,10 @@ int main()
 		NULL, //data
 		NULL, //get_socket()
 		0, // connect timeout
+		0, // keepalive idle time
+		0, // keepalive interval
+		0, // keepalive probes
+		0, // user timeout
 	};
 	tr_tcp_init(&tcp_config, &tr_tcp);
 
@@ -112,7 +112,7 @@ cp %{_topdir}/BUILD/LICENSE %{buildroot}/%{_docdir}/rtrlib/
 %postun -p /sbin/ldconfig
 
 %files
-%{_libdir}/lib*.so.0
+%{_libdir}/lib*.so.1
 %attr(755,root,root) %{_libdir}/lib*.so.0.*
 %doc CHANGELOG
 %doc LICENSE
@@ -9,11 +9,17 @@
 
 #include "rtrlib/bgpsec/bgpsec.h"
 
+#include "rtrlib/bgpsec/bgpsec_key_cache_private.h"
 #include "rtrlib/bgpsec/bgpsec_private.h"
 #include "rtrlib/bgpsec/bgpsec_utils_private.h"
 #include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/lib/executor_private.h"
 #include "rtrlib/rtrlib_export_private.h"
-#include "rtrlib/spki/spkitable_private.h"
+#include "rtrlib/spki/hashtable/ht-spkitable_private.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 #define SEC_PATH_LEN(seg, idx)                 \
 	struct rtr_secure_path_seg *tmp = seg; \
@@ -65,32 +71,14 @@ static const uint8_t algorithm_suites[] = {RTR_BGPSEC_ALGORITHM_SUITE_1};
  * position of the array.
  */
 
-int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table *table)
+int rtr_bgpsec_resolve_as_path(const struct rtr_bgpsec *data, struct spki_table *table,
+			       struct bgpsec_key_set *key_set)
 {
-	/* The AS path validation result. */
-	enum rtr_bgpsec_rtvals retval = 0;
-
-	/* The resulting hash. */
-	unsigned char *hash_result = NULL;
-
-	/* A temporare spki record */
-	struct spki_record *tmp_key = NULL;
-
-	/* A stream that holds the data that is hashed */
-	struct stream *s = NULL;
-
-	/* Total size of required space for the stream */
-	unsigned int stream_size = 0;
-
-	/* Use a temp variable in the validation loop since we don't want to
-	 * alter data->sigs.
-	 */
-	struct rtr_signature_seg *tmp_sig = NULL;
-
-	/* Temp variable that holds the signature length of the of the
-	 * next signature segment.
-	 */
-	int tmp_sig_len = 0;
+	/* key_set is freed by the caller in any case */
+	key_set->keys = key_set->inline_keys;
+	key_set->ends = key_set->inline_ends;
+	key_set->skis = key_set->inline_skis;
+	key_set->segs_len = 0;
 
 	/* Check, if the parameters are not NULL */
 	if (!data || !data->path || !data->sigs || !table)
@@ -110,11 +98,35 @@ int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table
 	if ((data->nlri->afi != BGPSEC_IPV4) && (data->nlri->afi != BGPSEC_IPV6))
 		return RTR_BGPSEC_UNSUPPORTED_AFI;
 
-	/* Make sure that all router keys are available. */
-	retval = check_router_keys(data->sigs, table);
+	/* Resolve the router keys of all segments at once and make sure that
+	 * all of them are available.
+	 */
+	return resolve_router_keys(data->sigs, table, key_set);
+}
 
-	if (retval != RTR_BGPSEC_SUCCESS)
-		goto err;
+int rtr_bgpsec_verify_as_path(const struct rtr_bgpsec *data, struct spki_table *table, struct bgpsec_key_set *key_set)
+{
+	/* The AS path validation result. */
+	enum rtr_bgpsec_rtvals retval = 0;
+
+	/* The hashes of the byte sequences signed by the signature segments. */
+	unsigned char inline_hash_results[BGPSEC_KEY_SET_INLINE_SIZE * SHA256_DIGEST_LENGTH];
+	unsigned char *hash_results = inline_hash_results;
+	unsigned int hash_results_len = 0;
+
+	/* A stream that holds the data that is hashed */
+	struct stream *s = NULL;
+
+	/* Total size of required space for the stream */
+	unsigned int stream_size = 0;
+
+	/* Use a temp variable in the validation loop since we don't want to
+	 * alter data->sigs.
+	 */
+	struct rtr_signature_seg *tmp_sig = NULL;
+
+	/* The router key cache of the table, NULL if the signatures are verified without it. */
+	struct bgpsec_key_cache *key_cache;
 
 	/* Calculate the required stream size and initialize the stream */
 	stream_size = req_stream_size(data, VALIDATION);
@@ -160,62 +172,52 @@ int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table
 	 * |------------------------o++++++++++++++++| bytes
 	 *
 	 *
+	 * The hashes of all iterations are computed at once before the first
+	 * signature is verified, several of them in parallel if possible.
+	 *
 	 * A more detailed view can be found at
 	 *https://mailarchive.ietf.org/arch/msg/sidr/8B_e4CNxQCUKeZ_AUzsdnn2f5Mu
 	 **/
 
+	if (key_set->segs_len > BGPSEC_KEY_SET_INLINE_SIZE) {
+		hash_results = lrtr_malloc(SHA256_DIGEST_LENGTH * key_set->segs_len);
+		if (!hash_results) {
+			retval = RTR_BGPSEC_ERROR;
+			goto err;
+		}
+	}
+
+	retval = hash_signed_sequences(data->sigs, s, data->alg, hash_results, &hash_results_len);
+
+	if (retval != RTR_BGPSEC_SUCCESS)
+		goto err;
+
 	/* Set retval to RTR_BGPSEC_VALID so the for-condition does not
 	 * fail on the first for loop check.
 	 */
 	retval = RTR_BGPSEC_VALID;
 	tmp_sig = data->sigs;
 
-	for (unsigned int offset = 0, next_offset = 0; offset <= get_stream_size(s) && retval == RTR_BGPSEC_VALID;
-	     offset += next_offset) {
-		if (tmp_sig->next)
-			tmp_sig_len = tmp_sig->next->sig_len;
-		else
-			tmp_sig_len = tmp_sig->sig_len;
-
-		next_offset = tmp_sig_len + SKI_SIZE + sizeof(tmp_sig->sig_len) + SECURE_PATH_SEG_SIZE;
-
-		/*
-		 * From a certain position on, read until the end of the stream.
-		 * The starting position is determined by the offset. The end
-		 * of the stream is the total length minus the offset.
-		 * The curr pointer points to the resulting "sub-stream".
-		 * Hacky, could be improved.
-		 */
-		size_t len = get_stream_size(s) - offset;
-
-		uint8_t *curr = lrtr_malloc(len);
+	/* The cache is published without the table lock, a budget of 0 bypasses it */
+	key_cache = __atomic_load_n(&table->key_cache, __ATOMIC_ACQUIRE);
+	if (key_cache && bgpsec_key_cache_get_budget(key_cache) == 0)
+		key_cache = NULL;
 
-		read_stream_at(curr, s, offset, len);
-
-		retval = hash_byte_sequence(curr, len, data->alg, &hash_result);
-
-		lrtr_free(curr);
-
-		if (retval != RTR_BGPSEC_SUCCESS)
-			goto err;
-
-		/* Store all router keys for the given SKI in tmp_key. */
-		unsigned int router_keys_len = 0;
-		enum spki_rtvals spki_retval =
-			spki_table_search_by_ski(table, tmp_sig->ski, &tmp_key, &router_keys_len);
-		if (spki_retval == SPKI_ERROR) {
-			retval = RTR_BGPSEC_ERROR;
-			goto err;
-		}
+	for (unsigned int seg = 0; seg < hash_results_len && retval == RTR_BGPSEC_VALID; seg++) {
+		const unsigned char *hash_result = &hash_results[seg * SHA256_DIGEST_LENGTH];
 
 		/* Loop in case there are multiple router keys for one SKI. */
-		for (unsigned int j = 0; j < router_keys_len; j++) {
+		for (unsigned int j = seg > 0 ? key_set->ends[seg - 1] : 0; j < key_set->ends[seg]; j++) {
 			/* Validate the siganture depending on the algorithm
 			 * suite. More if-cases are added with new algorithm
 			 * suites.
 			 */
 			if (data->alg == RTR_BGPSEC_ALGORITHM_SUITE_1) {
-				retval = validate_signature(hash_result, tmp_sig, &tmp_key[j]);
+				if (key_cache)
+					retval = bgpsec_key_cache_verify(key_cache, hash_result, tmp_sig,
+									 key_set->keys[j].key);
+				else
+					retval = validate_signature(hash_result, tmp_sig, key_set->keys[j].key);
 			} else {
 				retval = RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
 				goto err;
@@ -226,18 +228,13 @@ int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table
 			if (retval == RTR_BGPSEC_VALID)
 				break;
 		}
-		lrtr_free(hash_result);
-		lrtr_free(tmp_key);
-		hash_result = NULL;
-		tmp_key = NULL;
 		tmp_sig = tmp_sig->next;
 	}
 
 err:
-	if (hash_result)
-		lrtr_free(hash_result);
-	if (tmp_key)
-		lrtr_free(tmp_key);
+	if (hash_results != inline_hash_results)
+		lrtr_free(hash_results);
+	free_router_keys(key_set);
 	if (s)
 		free_stream(s);
 
@@ -249,17 +246,108 @@ err:
 	return retval;
 }
 
+int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table *table)
+{
+	struct bgpsec_key_set key_set;
+	int retval = rtr_bgpsec_resolve_as_path(data, table, &key_set);
+
+	if (retval != RTR_BGPSEC_SUCCESS) {
+		free_router_keys(&key_set);
+		return retval;
+	}
+
+	return rtr_bgpsec_verify_as_path(data, table, &key_set);
+}
+
+/**
+ * @brief Signs the aligned byte sequence of a BGPsec_PATH for a subset of the target ASes.
+ * @param bytes Aligned byte sequence, starting with the target AS that is replaced for every target.
+ * @param bytes_len Length of bytes.
+ * @param alg Algorithm suite of the path.
+ * @param priv_key Private key, only read by the workers.
+ * @param target_as All target ASes.
+ * @param new_signatures Generated signatures, one per target AS.
+ * @param first Index of the first target AS the worker signs for.
+ * @param step Distance between two target ASes the worker signs for.
+ * @param targets_len Number of target ASes.
+ * @param retval Result of the worker.
+ * @param thread Thread of the worker.
+ * @param started True if the worker runs in its own thread.
+ */
+struct bgpsec_sign_worker {
+	const uint8_t *bytes;
+	size_t bytes_len;
+	uint8_t alg;
+	EC_KEY *priv_key;
+	const uint32_t *target_as;
+	struct rtr_signature_seg **new_signatures;
+	unsigned int first;
+	unsigned int step;
+	unsigned int targets_len;
+	int retval;
+};
+
+static void bgpsec_sign_targets(void *arg)
+{
+	struct bgpsec_sign_worker *worker = arg;
+	int req_sig_size = ECDSA_size(worker->priv_key);
+
+	/* Every worker patches the target AS in its own copy of the byte sequence. */
+	uint8_t *bytes = lrtr_malloc(worker->bytes_len);
+
+	worker->retval = RTR_BGPSEC_SUCCESS;
+	if (!bytes) {
+		worker->retval = RTR_BGPSEC_ERROR;
+		return;
+	}
+	memcpy(bytes, worker->bytes, worker->bytes_len);
+
+	for (unsigned int i = worker->first; i < worker->targets_len; i += worker->step) {
+		uint32_t asn = htonl(worker->target_as[i]);
+		unsigned char *hash_result = NULL;
+		struct rtr_signature_seg *new_signature;
+
+		memcpy(bytes, &asn, sizeof(asn));
+
+		/* Same workaround as in rtr_bgpsec_generate_signature(), the
+		 * maximum signature size is allocated and the length is set
+		 * after signing.
+		 */
+		new_signature = rtr_bgpsec_new_signature_seg(NULL, req_sig_size, NULL);
+		if (!new_signature) {
+			worker->retval = RTR_BGPSEC_ERROR;
+			break;
+		}
+		new_signature->sig_len = 0;
+		worker->new_signatures[i] = new_signature;
+
+		worker->retval = hash_byte_sequence(bytes, worker->bytes_len, worker->alg, &hash_result);
+		if (worker->retval == RTR_BGPSEC_SUCCESS)
+			worker->retval = sign_byte_sequence(hash_result, worker->priv_key, worker->alg, new_signature);
+		if (hash_result)
+			lrtr_free(hash_result);
+		if (worker->retval != RTR_BGPSEC_SUCCESS)
+			break;
+	}
+
+	lrtr_free(bytes);
+}
+
 int rtr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *private_key,
 				  struct rtr_signature_seg **new_signature)
 {
-	/* The signature generation result. */
-	enum rtr_bgpsec_rtvals retval = 0;
+	if (!data || !new_signature)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
 
-	/* The resulting hash. */
-	unsigned char *hash_result = NULL;
+	return rtr_bgpsec_generate_signatures(data, private_key, &data->target_as, 1, 1, new_signature);
+}
 
-	/* The required size for the signature */
-	int req_sig_size = 0;
+int rtr_bgpsec_generate_signatures(const struct rtr_bgpsec *data, uint8_t *private_key, const uint32_t *target_as,
+				   const unsigned int targets_len, unsigned int threads,
+				   struct rtr_signature_seg **new_signatures)
+{
+	/* The signature generation result. */
+	enum rtr_bgpsec_rtvals retval = 0;
 
 	/* A stream that holds the data that is hashed */
 	struct stream *s = NULL;
@@ -270,12 +358,19 @@ int rtr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *privat
 	/* OpenSSL private key structure. */
 	EC_KEY *priv_key = NULL;
 
-	/* Check, if the parameters are not NULL except for *new_signature,
-	 * which must be NULL.
-	 */
-	if (!data || !data->path || !private_key || *new_signature)
+	/* One worker per thread, the first one runs in the calling thread. */
+	struct bgpsec_sign_worker *workers = NULL;
+	struct lrtr_wait_group group;
+
+	/* Check, if the parameters are not NULL and all signatures are NULL. */
+	if (!data || !data->path || !private_key || !target_as || !new_signatures || targets_len == 0)
 		return RTR_BGPSEC_INVALID_ARGUMENTS;
 
+	for (unsigned int i = 0; i < targets_len; i++) {
+		if (new_signatures[i])
+			return RTR_BGPSEC_INVALID_ARGUMENTS;
+	}
+
 	/* Make sure the algorithm suite is supported. */
 	if (rtr_bgpsec_has_algorithm_suite(data->alg) == RTR_BGPSEC_ERROR)
 		return RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
@@ -292,7 +387,16 @@ int rtr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *privat
 	if (data->path_len != (data->sigs_len + 1))
 		return RTR_BGPSEC_WRONG_SEGMENT_COUNT;
 
-	/* Load the private key from buffer into OpenSSL structure. */
+	if (threads == 0)
+		threads = 1;
+	if (threads > lrtr_executor_parallelism())
+		threads = lrtr_executor_parallelism();
+	if (threads > targets_len)
+		threads = targets_len;
+
+	/* Load the private key from buffer into OpenSSL structure once for
+	 * all targets.
+	 */
 	retval = load_private_key(&priv_key, private_key);
 
 	if (retval != RTR_BGPSEC_SUCCESS) {
@@ -300,54 +404,68 @@ int rtr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *privat
 		goto err;
 	}
 
-	/* Allocate the needed space for the signature */
-	req_sig_size = ECDSA_size(priv_key);
-	if (req_sig_size == 0) {
+	if (ECDSA_size(priv_key) == 0) {
 		retval = RTR_BGPSEC_LOAD_PRIV_KEY_ERROR;
 		goto err;
 	}
 
-	*new_signature = rtr_bgpsec_new_signature_seg(NULL, req_sig_size, NULL);
-	if (!(*new_signature)) {
+	/* Calculate the required stream size and initialize the stream */
+	stream_size = req_stream_size(data, SIGNING);
+	s = init_stream(stream_size);
+	if (!s) {
 		retval = RTR_BGPSEC_ERROR;
 		goto err;
 	}
 
-	/* The function call above expects the exact size of the signature.
-	 * Because the signature was not generated yet, we pass the maximum
-	 * possible length to it so enough space is allocated. Then, the
-	 * sig_len field is set to 0, since the signature does not exist yet.
-	 * This is a rather hacky workaround and might get changed in the
-	 * future.
+	/* Align the bytes once, only the target AS differs between the
+	 * signatures.
 	 */
-	(*new_signature)->sig_len = 0;
-
-	/* Calculate the required stream size and initialize the stream */
-	stream_size = req_stream_size(data, SIGNING);
-	s = init_stream(stream_size);
-
-	/* Align the bytes to prepare them for hashing. */
 	retval = align_byte_sequence(data, s, SIGNING);
 
 	if (retval != RTR_BGPSEC_SUCCESS)
 		goto err;
 
-	/* Hash the aligned bytes. */
-	uint8_t *curr = get_stream_start(s);
+	workers = lrtr_calloc(threads, sizeof(*workers));
+	if (!workers) {
+		retval = RTR_BGPSEC_ERROR;
+		goto err;
+	}
 
-	retval = hash_byte_sequence(curr, get_stream_size(s), data->alg, &hash_result);
+	for (unsigned int i = 0; i < threads; i++) {
+		workers[i].bytes = get_stream_start(s);
+		workers[i].bytes_len = get_stream_size(s);
+		workers[i].alg = data->alg;
+		workers[i].priv_key = priv_key;
+		workers[i].target_as = target_as;
+		workers[i].new_signatures = new_signatures;
+		workers[i].first = i;
+		workers[i].step = threads;
+		workers[i].targets_len = targets_len;
+		workers[i].retval = RTR_BGPSEC_SUCCESS;
+	}
 
-	if (retval != RTR_BGPSEC_SUCCESS)
-		goto err;
+	/* Workers that can not be scheduled by the executor are run by the
+	 * calling thread.
+	 */
+	lrtr_wait_group_init(&group);
+	for (unsigned int i = 1; i < threads; i++)
+		lrtr_executor_submit(&group, bgpsec_sign_targets, &workers[i]);
 
-	/* Sign the hash depending on the algorithm suite. */
-	retval = sign_byte_sequence(hash_result, priv_key, data->alg, *new_signature);
+	bgpsec_sign_targets(&workers[0]);
+	lrtr_wait_group_wait(&group);
+	lrtr_wait_group_destroy(&group);
+
+	for (unsigned int i = 0; i < threads && retval == RTR_BGPSEC_SUCCESS; i++)
+		retval = workers[i].retval;
 
 err:
-	if (hash_result)
-		lrtr_free(hash_result);
-	if (*new_signature && (retval == RTR_BGPSEC_SIGNING_ERROR))
-		rtr_bgpsec_free_signatures(*new_signature);
+	if (retval != RTR_BGPSEC_SUCCESS) {
+		for (unsigned int i = 0; i < targets_len; i++) {
+			rtr_bgpsec_free_signatures(new_signatures[i]);
+			new_signatures[i] = NULL;
+		}
+	}
+	lrtr_free(workers);
 	if (s)
 		free_stream(s);
 	if (priv_key) {
@@ -358,10 +476,134 @@ err:
 	return retval;
 }
 
+/* Write a two byte length field in network byte order. */
+static void bgpsec_write_length(uint8_t *bytes, size_t len)
+{
+	uint16_t tmp = htons(len);
+
+	memcpy(bytes, &tmp, sizeof(tmp));
+}
+
+int rtr_bgpsec_build_path(const struct rtr_bgpsec *data, const uint8_t *attr, const size_t attr_len,
+			  const struct rtr_secure_path_seg *own_seg, const uint8_t *ski, uint8_t *private_key,
+			  uint8_t *buffer, const size_t buffer_len, size_t *new_attr_len)
+{
+	struct bgpsec_path_attr received;
+	struct rtr_signature_seg new_sig;
+	unsigned char hash_result[SHA256_DIGEST_LENGTH];
+	uint8_t own[SECURE_PATH_SEG_SIZE];
+	uint32_t asn;
+	EC_KEY *priv_key = NULL;
+	size_t path_size;
+	size_t max_size;
+	uint8_t *block;
+	uint8_t *pos;
+	int retval;
+
+	if (!data || !data->nlri || !own_seg || !ski || !private_key || !buffer || !new_attr_len)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+	if (rtr_bgpsec_has_algorithm_suite(data->alg) == RTR_BGPSEC_ERROR)
+		return RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
+
+	if ((data->nlri->afi != BGPSEC_IPV4) && (data->nlri->afi != BGPSEC_IPV6))
+		return RTR_BGPSEC_UNSUPPORTED_AFI;
+
+	retval = parse_path_attr(attr, attr_len, data->alg, &received);
+	if (retval != RTR_BGPSEC_SUCCESS)
+		return retval;
+
+	if (load_private_key(&priv_key, private_key) != RTR_BGPSEC_SUCCESS || ECDSA_size(priv_key) == 0) {
+		retval = RTR_BGPSEC_LOAD_PRIV_KEY_ERROR;
+		goto err;
+	}
+
+	/* The length of the signature is only known after signing, the buffer must hold the largest one. */
+	path_size = 2 + SECURE_PATH_SEG_SIZE * (received.path_len + 1);
+	max_size = BGPSEC_PATH_ATTR_HEADER_SIZE + path_size + 3 + SKI_SIZE + 2 + ECDSA_size(priv_key) +
+		   received.sigs_size;
+	if (max_size - BGPSEC_PATH_ATTR_HEADER_SIZE > UINT16_MAX) {
+		retval = RTR_BGPSEC_INVALID_ARGUMENTS;
+		goto err;
+	}
+	if (buffer_len < max_size) {
+		*new_attr_len = max_size;
+		retval = RTR_BGPSEC_BUFFER_TOO_SMALL;
+		goto err;
+	}
+
+	own[0] = own_seg->pcount;
+	own[1] = own_seg->flags;
+	asn = htonl(own_seg->asn);
+	memcpy(own + 2, &asn, sizeof(asn));
+
+	retval = hash_path_attr(data, &received, own, hash_result);
+	if (retval != RTR_BGPSEC_SUCCESS)
+		goto err;
+
+	/* Secure_Path: the segment of this AS precedes the received ones */
+	pos = buffer + BGPSEC_PATH_ATTR_HEADER_SIZE;
+	bgpsec_write_length(pos, path_size);
+	memcpy(pos + 2, own, SECURE_PATH_SEG_SIZE);
+	if (received.path_len > 0)
+		memcpy(pos + 2 + SECURE_PATH_SEG_SIZE, received.path, SECURE_PATH_SEG_SIZE * received.path_len);
+	pos += path_size;
+
+	/* Signature_Block: the signature is written to its final position, the received segments follow it */
+	block = pos;
+	block[2] = data->alg;
+	memcpy(block + 3, ski, SKI_SIZE);
+	new_sig.signature = block + 3 + SKI_SIZE + 2;
+	retval = sign_byte_sequence(hash_result, priv_key, data->alg, &new_sig);
+	if (retval != RTR_BGPSEC_SUCCESS)
+		goto err;
+
+	bgpsec_write_length(block + 3 + SKI_SIZE, new_sig.sig_len);
+	pos = new_sig.signature + new_sig.sig_len;
+	if (received.sigs_size > 0)
+		memcpy(pos, received.sigs, received.sigs_size);
+	pos += received.sigs_size;
+	bgpsec_write_length(block, pos - block);
+
+	buffer[0] = BGPSEC_PATH_ATTR_FLAGS;
+	buffer[1] = BGPSEC_PATH_ATTR_TYPE;
+	bgpsec_write_length(buffer + 2, pos - buffer - BGPSEC_PATH_ATTR_HEADER_SIZE);
+	*new_attr_len = pos - buffer;
+
+err:
+	if (priv_key)
+		EC_KEY_free(priv_key);
+
+	return retval;
+}
+
 /*************************************************
  **** Functions for versions and algo suites *****
  ************************************************/
 
+int rtr_bgpsec_set_key_cache_budget(struct spki_table *table, size_t budget)
+{
+	int retval = RTR_BGPSEC_SUCCESS;
+
+	if (!table)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+	pthread_rwlock_wrlock(&table->lock);
+	if (table->key_cache) {
+		bgpsec_key_cache_set_budget(table->key_cache, budget);
+	} else if (budget > 0) {
+		struct bgpsec_key_cache *key_cache = bgpsec_key_cache_new(budget);
+
+		if (key_cache)
+			__atomic_store_n(&table->key_cache, key_cache, __ATOMIC_RELEASE);
+		else
+			retval = RTR_BGPSEC_ERROR;
+	}
+	pthread_rwlock_unlock(&table->lock);
+
+	return retval;
+}
+
 int rtr_bgpsec_get_version(void)
 {
 	return BGPSEC_VERSION;
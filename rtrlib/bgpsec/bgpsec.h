@@ -61,6 +61,8 @@ enum rtr_bgpsec_rtvals {
 	RTR_BGPSEC_WRONG_SEGMENT_COUNT = -8,
 	/** There is data missing for validation or signing. */
 	RTR_BGPSEC_INVALID_ARGUMENTS = -9,
+	/** The buffer for a BGPsec_PATH attribute is too small. */
+	RTR_BGPSEC_BUFFER_TOO_SMALL = -10,
 };
 
 /**
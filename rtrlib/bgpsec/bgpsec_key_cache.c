@@ -0,0 +1,449 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "bgpsec_key_cache_private.h"
+
+#include "rtrlib/bgpsec/bgpsec_utils_private.h"
+#include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
+
+#include "third-party/tommyds/tommyhash.h"
+#include "third-party/tommyds/tommyhashlin.h"
+#include "third-party/tommyds/tommylist.h"
+
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/opensslv.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* The precomputation uses accessors that were introduced with OpenSSL 1.1.0 */
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+#define BGPSEC_KEY_CACHE_PRECOMP
+#endif
+
+/**
+ * @brief A cached router key.
+ * @param key The interned router key the entry was parsed from, used as key.
+ *	      The entry holds a reference to it.
+ * @param pub_key The parsed and checked public key.
+ * @param precomp_group Copy of the curve with the public key as generator and
+ *			precomputed multiples of it, NULL if the key is not hot.
+ * @param hits Number of verifications done with this entry.
+ * @param refs Number of verifications currently using this entry.
+ * @param building True while a thread builds precomp_group.
+ * @param evicted True if the entry is not part of the cache anymore and must
+ *		  be freed by the last user.
+ * @param size Memory accounted for this entry.
+ */
+struct cached_key {
+	struct spki_key *key;
+	EC_KEY *pub_key;
+	EC_GROUP *precomp_group;
+	unsigned int hits;
+	unsigned int refs;
+	bool building;
+	bool evicted;
+	size_t size;
+	tommy_node hash_node;
+	tommy_node lru_node;
+};
+
+/**
+ * @brief bgpsec_key_cache.
+ * @param lock Mutex that protects all members and the bookkeeping of the entries
+ * @param hashtable Entries, addressed by their interned router key
+ * @param lru Entries, most recently used first
+ * @param budget Maximum memory that may be accounted, written with the lock held and read
+ *		 atomically by bgpsec_key_cache_get_budget() without it
+ * @param usage Currently accounted memory
+ */
+struct bgpsec_key_cache {
+	pthread_mutex_t lock;
+	tommy_hashlin hashtable;
+	tommy_list lru;
+	size_t budget;
+	size_t usage;
+};
+
+static int cached_key_cmp(const void *arg, const void *obj)
+{
+	const struct spki_key *key = arg;
+	const struct cached_key *entry = obj;
+
+	return key != entry->key;
+}
+
+// interned keys with the same content are the same object, so the address identifies the key
+static uint32_t cached_key_hash(const struct spki_key *key)
+{
+	return (uint32_t)tommy_inthash_u64((uintptr_t)key);
+}
+
+static void cached_key_free(struct cached_key *entry)
+{
+	EC_KEY_free(entry->pub_key);
+	if (entry->precomp_group)
+		EC_GROUP_free(entry->precomp_group);
+	spki_key_release(entry->key);
+	lrtr_free(entry);
+}
+
+/* The caller must hold the lock of the cache. */
+static void key_cache_evict(struct bgpsec_key_cache *cache, struct cached_key *entry)
+{
+	tommy_hashlin_remove_existing(&cache->hashtable, &entry->hash_node);
+	tommy_list_remove_existing(&cache->lru, &entry->lru_node);
+	cache->usage -= entry->size;
+
+	if (entry->refs == 0)
+		cached_key_free(entry);
+	else
+		entry->evicted = true;
+}
+
+/**
+ * @brief Evicts least recently used entries until @p needed more bytes fit
+ * into the budget. The caller must hold the lock of the cache.
+ * @param[in] cache The key cache.
+ * @param[in] needed Number of bytes that are about to be accounted.
+ * @param[in] keep Entry that must not be evicted, may be NULL.
+ * @return true if the bytes fit into the budget.
+ */
+static bool key_cache_make_room(struct bgpsec_key_cache *cache, size_t needed, struct cached_key *keep)
+{
+	tommy_node *node = tommy_list_tail(&cache->lru);
+
+	while (node && cache->usage + needed > cache->budget) {
+		struct cached_key *entry = node->data;
+
+		node = node != tommy_list_head(&cache->lru) ? node->prev : NULL;
+		if (entry != keep)
+			key_cache_evict(cache, entry);
+	}
+
+	return cache->usage + needed <= cache->budget;
+}
+
+struct bgpsec_key_cache *bgpsec_key_cache_new(size_t budget)
+{
+	struct bgpsec_key_cache *cache = lrtr_malloc(sizeof(*cache));
+
+	if (!cache)
+		return NULL;
+
+	pthread_mutex_init(&cache->lock, NULL);
+	tommy_hashlin_init(&cache->hashtable);
+	tommy_list_init(&cache->lru);
+	cache->budget = budget;
+	cache->usage = 0;
+	return cache;
+}
+
+void bgpsec_key_cache_set_budget(struct bgpsec_key_cache *cache, size_t budget)
+{
+	pthread_mutex_lock(&cache->lock);
+	__atomic_store_n(&cache->budget, budget, __ATOMIC_RELAXED);
+	key_cache_make_room(cache, 0, NULL);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+size_t bgpsec_key_cache_get_budget(struct bgpsec_key_cache *cache)
+{
+	return __atomic_load_n(&cache->budget, __ATOMIC_RELAXED);
+}
+
+size_t bgpsec_key_cache_get_usage(struct bgpsec_key_cache *cache)
+{
+	size_t usage;
+
+	pthread_mutex_lock(&cache->lock);
+	usage = cache->usage;
+	pthread_mutex_unlock(&cache->lock);
+	return usage;
+}
+
+void bgpsec_key_cache_free(struct bgpsec_key_cache *cache)
+{
+	if (!cache)
+		return;
+
+	tommy_list_foreach(&cache->lru, (tommy_foreach_func *)cached_key_free);
+	tommy_hashlin_done(&cache->hashtable);
+	pthread_mutex_destroy(&cache->lock);
+	lrtr_free(cache);
+}
+
+#ifdef BGPSEC_KEY_CACHE_PRECOMP
+/**
+ * @brief Builds a copy of the curve of @p pub_key that uses the public key as
+ * generator and precomputes the multiples of it.
+ * @return The group, NULL if the key is not a P-256 key or on error.
+ */
+static EC_GROUP *key_cache_build_precomp(const EC_KEY *pub_key)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(pub_key);
+	EC_GROUP *precomp_group;
+
+	if (EC_GROUP_get_curve_name(group) != NID_X9_62_prime256v1)
+		return NULL;
+
+	precomp_group = EC_GROUP_dup(group);
+	if (!precomp_group)
+		return NULL;
+
+	if (!EC_GROUP_set_generator(precomp_group, EC_KEY_get0_public_key(pub_key), EC_GROUP_get0_order(group),
+				    EC_GROUP_get0_cofactor(group)) ||
+	    !EC_GROUP_precompute_mult(precomp_group, NULL)) {
+		EC_GROUP_free(precomp_group);
+		return NULL;
+	}
+
+	return precomp_group;
+}
+
+/**
+ * @brief ECDSA verification that computes Q * u2 with the precomputed
+ * multiples of the public key Q.
+ * @return 1 if the signature is valid, 0 if it is not valid, -1 on error,
+ * just like ECDSA_verify().
+ */
+static int key_cache_ecdsa_verify(const EC_KEY *pub_key, const EC_GROUP *precomp_group, const unsigned char *hash,
+				  const struct rtr_signature_seg *sig)
+{
+	const BIGNUM *order;
+	const BIGNUM *r;
+	const BIGNUM *s;
+	const unsigned char *p = sig->signature;
+	const EC_GROUP *group = EC_KEY_get0_group(pub_key);
+	ECDSA_SIG *ecdsa_sig = NULL;
+	EC_POINT *point = NULL;
+	EC_POINT *q_point = NULL;
+	BN_CTX *ctx = NULL;
+	BIGNUM *e;
+	BIGNUM *w;
+	BIGNUM *u1;
+	BIGNUM *u2;
+	BIGNUM *x;
+	unsigned char *der = NULL;
+	int der_len;
+	int status = -1;
+
+	order = EC_GROUP_get0_order(group);
+	ecdsa_sig = d2i_ECDSA_SIG(NULL, &p, sig->sig_len);
+	if (!ecdsa_sig)
+		return -1;
+
+	/* Only accept the DER encoding, like ECDSA_verify() */
+	der_len = i2d_ECDSA_SIG(ecdsa_sig, &der);
+	if (der_len != sig->sig_len || memcmp(sig->signature, der, der_len) != 0)
+		goto err;
+
+	ctx = BN_CTX_new();
+	if (!ctx)
+		goto err;
+
+	BN_CTX_start(ctx);
+	e = BN_CTX_get(ctx);
+	w = BN_CTX_get(ctx);
+	u1 = BN_CTX_get(ctx);
+	u2 = BN_CTX_get(ctx);
+	x = BN_CTX_get(ctx);
+	if (!x)
+		goto err;
+
+	ECDSA_SIG_get0(ecdsa_sig, &r, &s);
+	if (BN_is_zero(r) || BN_is_negative(r) || BN_ucmp(r, order) >= 0 || BN_is_zero(s) || BN_is_negative(s) ||
+	    BN_ucmp(s, order) >= 0) {
+		status = 0;
+		goto err;
+	}
+
+	/* The digest and the order of P-256 both have 256 bit, no truncation is required */
+	if (!BN_bin2bn(hash, SHA256_DIGEST_LENGTH, e) || !BN_mod_inverse(w, s, order, ctx) ||
+	    !BN_mod_mul(u1, e, w, order, ctx) || !BN_mod_mul(u2, r, w, order, ctx))
+		goto err;
+
+	point = EC_POINT_new(group);
+	q_point = EC_POINT_new(precomp_group);
+	if (!point || !q_point)
+		goto err;
+
+	/* G * u1 and Q * u2 both use precomputed multiples of their generator */
+	if (!EC_POINT_mul(group, point, u1, NULL, NULL, ctx) ||
+	    !EC_POINT_mul(precomp_group, q_point, u2, NULL, NULL, ctx) ||
+	    !EC_POINT_add(group, point, point, q_point, ctx))
+		goto err;
+
+	if (EC_POINT_is_at_infinity(group, point)) {
+		status = 0;
+		goto err;
+	}
+
+	if (!EC_POINT_get_affine_coordinates_GFp(group, point, x, NULL, ctx) || !BN_nnmod(x, x, order, ctx))
+		goto err;
+
+	status = BN_ucmp(x, r) == 0;
+
+err:
+	if (ctx) {
+		BN_CTX_end(ctx);
+		BN_CTX_free(ctx);
+	}
+	EC_POINT_free(point);
+	EC_POINT_free(q_point);
+	OPENSSL_free(der);
+	ECDSA_SIG_free(ecdsa_sig);
+	return status;
+}
+#endif
+
+/**
+ * @brief Returns the entry for @p key with an increased reference count.
+ * Parses the key if it is not cached yet.
+ * @param[in] cache The key cache.
+ * @param[in] key The interned router key.
+ * @param[out] precomp_group The precomputed group of the entry, may be NULL.
+ * @return The entry, NULL if the key could not be loaded.
+ */
+static struct cached_key *key_cache_acquire(struct bgpsec_key_cache *cache, struct spki_key *key,
+					    EC_GROUP **precomp_group)
+{
+	uint32_t hash = cached_key_hash(key);
+	struct cached_key *entry;
+	struct cached_key *new_entry = NULL;
+	bool build = false;
+
+	pthread_mutex_lock(&cache->lock);
+	entry = tommy_hashlin_search(&cache->hashtable, cached_key_cmp, key, hash);
+	if (!entry) {
+		/* Parsing and checking the key is expensive, do not block other validations */
+		pthread_mutex_unlock(&cache->lock);
+
+		new_entry = lrtr_calloc(1, sizeof(*new_entry));
+		if (!new_entry)
+			return NULL;
+
+		new_entry->size = BGPSEC_KEY_CACHE_KEY_SIZE;
+		if (load_public_key(&new_entry->pub_key, key->spki) != RTR_BGPSEC_SUCCESS) {
+			lrtr_free(new_entry);
+			return NULL;
+		}
+		spki_key_acquire(key);
+		new_entry->key = key;
+
+		pthread_mutex_lock(&cache->lock);
+		entry = tommy_hashlin_search(&cache->hashtable, cached_key_cmp, key, hash);
+		if (entry) {
+			cached_key_free(new_entry);
+		} else if (key_cache_make_room(cache, new_entry->size, NULL)) {
+			entry = new_entry;
+			tommy_hashlin_insert(&cache->hashtable, &entry->hash_node, entry, hash);
+			tommy_list_insert_head(&cache->lru, &entry->lru_node, entry);
+			cache->usage += entry->size;
+		} else {
+			/* The budget does not even fit the key, only this caller uses it */
+			entry = new_entry;
+			entry->evicted = true;
+		}
+	}
+
+	if (!entry->evicted && tommy_list_head(&cache->lru) != &entry->lru_node) {
+		tommy_list_remove_existing(&cache->lru, &entry->lru_node);
+		tommy_list_insert_head(&cache->lru, &entry->lru_node, entry);
+	}
+
+	entry->refs++;
+	entry->hits++;
+
+#ifdef BGPSEC_KEY_CACHE_PRECOMP
+	if (!entry->evicted && !entry->precomp_group && !entry->building &&
+	    entry->hits >= BGPSEC_KEY_CACHE_HOT_THRESHOLD &&
+	    entry->size + BGPSEC_KEY_CACHE_TABLE_SIZE <= cache->budget) {
+		entry->building = true;
+		build = true;
+	}
+#endif
+	*precomp_group = entry->precomp_group;
+	pthread_mutex_unlock(&cache->lock);
+
+#ifdef BGPSEC_KEY_CACHE_PRECOMP
+	if (build) {
+		EC_GROUP *group = key_cache_build_precomp(entry->pub_key);
+
+		pthread_mutex_lock(&cache->lock);
+		entry->building = false;
+		if (group && !entry->evicted && key_cache_make_room(cache, BGPSEC_KEY_CACHE_TABLE_SIZE, entry)) {
+			entry->precomp_group = group;
+			entry->size += BGPSEC_KEY_CACHE_TABLE_SIZE;
+			cache->usage += BGPSEC_KEY_CACHE_TABLE_SIZE;
+			*precomp_group = group;
+		} else if (group) {
+			EC_GROUP_free(group);
+		}
+		pthread_mutex_unlock(&cache->lock);
+	}
+#endif
+
+	return entry;
+}
+
+static void key_cache_release(struct bgpsec_key_cache *cache, struct cached_key *entry)
+{
+	bool free_entry;
+
+	pthread_mutex_lock(&cache->lock);
+	entry->refs--;
+	free_entry = entry->evicted && entry->refs == 0;
+	pthread_mutex_unlock(&cache->lock);
+
+	if (free_entry)
+		cached_key_free(entry);
+}
+
+int bgpsec_key_cache_verify(struct bgpsec_key_cache *cache, const unsigned char *hash,
+			    const struct rtr_signature_seg *sig, struct spki_key *key)
+{
+	EC_GROUP *precomp_group = NULL;
+	struct cached_key *entry;
+	int status;
+
+	entry = key_cache_acquire(cache, key, &precomp_group);
+	if (!entry) {
+		char ski_str[(SKI_SIZE * 3) + 1] = {'\0'};
+
+		ski_to_char(ski_str, key->ski);
+		BGPSEC_DBG("WARNING: Invalid public key for SKI: %s", ski_str);
+		return RTR_BGPSEC_ERROR;
+	}
+
+#ifdef BGPSEC_KEY_CACHE_PRECOMP
+	if (precomp_group)
+		status = key_cache_ecdsa_verify(entry->pub_key, precomp_group, hash, sig);
+	else
+#endif
+		status = ECDSA_verify(0, hash, SHA256_DIGEST_LENGTH, sig->signature, sig->sig_len, entry->pub_key);
+
+	key_cache_release(cache, entry);
+
+	switch (status) {
+	case 1:
+		BGPSEC_DBG1("Validation result of signature: valid");
+		return RTR_BGPSEC_VALID;
+	case 0:
+		BGPSEC_DBG1("Validation result of signature: invalid");
+		return RTR_BGPSEC_NOT_VALID;
+	default:
+		BGPSEC_DBG1("ERROR: Failed to verify EC Signature");
+		return RTR_BGPSEC_ERROR;
+	}
+}
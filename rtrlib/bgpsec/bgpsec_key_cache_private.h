@@ -0,0 +1,91 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#ifndef RTR_BGPSEC_KEY_CACHE_PRIVATE_H
+#define RTR_BGPSEC_KEY_CACHE_PRIVATE_H
+
+#include "rtrlib/bgpsec/bgpsec.h"
+#include "rtrlib/spki/spkitable_private.h"
+
+#include <stddef.h>
+
+/**
+ * Number of verifications with a router key after which the cache builds
+ * the precomputed multiples of the public key.
+ */
+#define BGPSEC_KEY_CACHE_HOT_THRESHOLD 128
+
+/**
+ * Approximate memory that is accounted for a parsed public key.
+ */
+#define BGPSEC_KEY_CACHE_KEY_SIZE 1024
+
+/**
+ * Approximate memory that is accounted for the precomputed multiples of a
+ * public key (37 * 64 affine P-256 points plus bookkeeping).
+ */
+#define BGPSEC_KEY_CACHE_TABLE_SIZE (160 * 1024)
+
+/**
+ * @brief Cache of parsed router keys and their precomputed verification tables.
+ * @details Entries are addressed by the interned router key, whose content
+ * never changes, so they never become invalid. Least recently used entries are evicted as soon as the
+ * accounted memory exceeds the budget of the cache.
+ */
+struct bgpsec_key_cache;
+
+/**
+ * @brief Allocates a new key cache.
+ * @param[in] budget Maximum memory in bytes the cache may account for.
+ * @return Pointer to the cache, NULL on error.
+ */
+struct bgpsec_key_cache *bgpsec_key_cache_new(size_t budget);
+
+/**
+ * @brief Changes the memory budget of a key cache and evicts entries if necessary.
+ * @param[in] cache The key cache.
+ * @param[in] budget Maximum memory in bytes the cache may account for.
+ */
+void bgpsec_key_cache_set_budget(struct bgpsec_key_cache *cache, size_t budget);
+
+/**
+ * @brief Returns the memory budget of a key cache without taking its lock.
+ * @param[in] cache The key cache.
+ */
+size_t bgpsec_key_cache_get_budget(struct bgpsec_key_cache *cache);
+
+/**
+ * @brief Returns the memory in bytes currently accounted by the cache.
+ * @param[in] cache The key cache.
+ */
+size_t bgpsec_key_cache_get_usage(struct bgpsec_key_cache *cache);
+
+/**
+ * @brief Frees a key cache and all of its entries.
+ * @param[in] cache The key cache, may be NULL.
+ */
+void bgpsec_key_cache_free(struct bgpsec_key_cache *cache);
+
+/**
+ * @brief Validates a signature like validate_signature(), but uses the cached
+ * public key of @p key. For hot keys, the Q * u2 half of the ECDSA
+ * verification uses the precomputed multiples of the public key.
+ * @param[in] cache The key cache.
+ * @param[in] hash SHA-256 digest of the signed data.
+ * @param[in] sig The signature segment.
+ * @param[in] key The interned router key that is used for validation, the
+ *		  caller must hold a reference to it.
+ * @return RTR_BGPSEC_VALID If the signature is valid.
+ * @return RTR_BGPSEC_NOT_VALID If the signature is not valid.
+ * @return RTR_BGPSEC_ERROR If an error occurred.
+ */
+int bgpsec_key_cache_verify(struct bgpsec_key_cache *cache, const unsigned char *hash,
+			    const struct rtr_signature_seg *sig, struct spki_key *key);
+
+#endif
@@ -30,6 +30,35 @@
  */
 int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table *table);
 
+/**
+ * @brief First step of rtr_bgpsec_validate_as_path(), checks the data and resolves the router keys of all
+ * Signature Segments.
+ * @details The resolved keys are held by @p key_set, so the signatures can be verified after the spki_table
+ * changed. @p key_set must be passed to rtr_bgpsec_verify_as_path() or free_router_keys() in any case.
+ * @param[in] data Data required for AS path validation. See @ref rtr_bgpsec.
+ * @param[in] table The SPKI table that contains the router keys.
+ * @param[out] key_set Receives the router keys.
+ * @return RTR_BGPSEC_SUCCESS If a router key was found for every Signature Segment.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			more details.
+ */
+int rtr_bgpsec_resolve_as_path(const struct rtr_bgpsec *data, struct spki_table *table,
+			       struct bgpsec_key_set *key_set);
+
+/**
+ * @brief Second step of rtr_bgpsec_validate_as_path(), verifies the signatures with the router keys that
+ * rtr_bgpsec_resolve_as_path() resolved.
+ * @param[in] data Data required for AS path validation. See @ref rtr_bgpsec.
+ * @param[in] table The SPKI table, only its key cache is used. The table is not locked, it must not be freed
+ *		    before all verifications that use it returned.
+ * @param[in] key_set The router keys of all Signature Segments, freed by the function.
+ * @return RTR_BGPSEC_VALID If the AS path was valid.
+ * @return RTR_BGPSEC_NOT_VALID If the AS path was not valid.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			more details.
+ */
+int rtr_bgpsec_verify_as_path(const struct rtr_bgpsec *data, struct spki_table *table, struct bgpsec_key_set *key_set);
+
 /**
  * @brief Signing function for a BGPsec_PATH.
  * @param[in] data Data required for AS path validation. See @ref rtr_bgpsec.
@@ -43,6 +72,72 @@ int rtr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct spki_table
 int rtr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *private_key,
 				  struct rtr_signature_seg **new_signature);
 
+/**
+ * @brief Signing function for a BGPsec_PATH that is sent to several peers.
+ * @details The byte sequence is aligned and the private key is loaded only
+ * once, the signatures differ in the target AS only. The target_as field
+ * of @p data is ignored.
+ * @param[in] data Data required for AS path validation. See @ref rtr_bgpsec.
+ * @param[in] private_key The raw bytes of the private key that is used for signing.
+ * @param[in] target_as The ASes the update is sent to.
+ * @param[in] targets_len Number of elements in @p target_as.
+ * @param[in] threads Maximum number of workers that generate signatures,
+ *		      0 and 1 sign in the calling thread only. The
+ *		      workers are run by the executor, which may allow
+ *		      fewer.
+ * @param[out] new_signatures Array of @p targets_len elements that receives
+ *			      the signature for each target AS. All elements
+ *			      must be NULL. No signature is returned on error.
+ * @return RTR_BGPSEC_SUCCESS If all signatures were successfully generated.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			    more details.
+ */
+int rtr_bgpsec_generate_signatures(const struct rtr_bgpsec *data, uint8_t *private_key, const uint32_t *target_as,
+				   const unsigned int targets_len, unsigned int threads,
+				   struct rtr_signature_seg **new_signatures);
+
+/**
+ * @brief Signs a received BGPsec_PATH attribute and writes the attribute that is sent to a peer into a buffer.
+ * @details The Secure_Path Segment and the Signature Segment of this AS are prepended to the segments of the
+ * received attribute, which are copied without being decoded into segment lists. Signature_Blocks of other
+ * algorithm suites are removed. Nothing is allocated by RTRlib, so the function suits the generation of
+ * UPDATEs for many prefixes.
+ * @param[in] data Algorithm suite, AFI, SAFI, target AS and NLRI of the update. The Secure_Path and Signature
+ *		   Segments of @p data are ignored. See @ref rtr_bgpsec.
+ * @param[in] attr The received BGPsec_PATH attribute including its attribute header, NULL to originate a path.
+ * @param[in] attr_len Length of @p attr in bytes, 0 to originate a path.
+ * @param[in] own_seg The Secure_Path Segment of this AS.
+ * @param[in] ski The SKI of the router key that belongs to @p private_key.
+ * @param[in] private_key The raw bytes of the private key that is used for signing.
+ * @param[out] buffer Receives the new BGPsec_PATH attribute including its attribute header. Must not overlap
+ *		      @p attr.
+ * @param[in] buffer_len Size of @p buffer in bytes.
+ * @param[out] new_attr_len Length of the new attribute. If @p buffer is too small, the size that is required.
+ * @return RTR_BGPSEC_SUCCESS If the attribute was written to @p buffer.
+ * @return RTR_BGPSEC_BUFFER_TOO_SMALL If @p buffer can not hold the attribute with a signature of maximum size.
+ * @return RTR_BGPSEC_INVALID_ARGUMENTS If @p attr is malformed or an argument is missing.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			    more details.
+ */
+int rtr_bgpsec_build_path(const struct rtr_bgpsec *data, const uint8_t *attr, const size_t attr_len,
+			  const struct rtr_secure_path_seg *own_seg, const uint8_t *ski, uint8_t *private_key,
+			  uint8_t *buffer, const size_t buffer_len, size_t *new_attr_len);
+
+/**
+ * @brief Sets the memory budget of the router key cache of a SPKI table.
+ * @details The cache keeps parsed router keys and, for frequently used keys,
+ * precomputed multiples of the public key that speed up the signature
+ * verification. A budget of 0 evicts all cached keys and verifies the
+ * signatures without the cache. The cache is created on the first call and
+ * may be enabled while validations are running, it is freed together with
+ * the table.
+ * @param[in] table The SPKI table.
+ * @param[in] budget Maximum memory in bytes used by the cache.
+ * @return RTR_BGPSEC_SUCCESS If the budget was set.
+ * @return RTR_BGPSEC_ERROR If the cache could not be allocated.
+ */
+int rtr_bgpsec_set_key_cache_budget(struct spki_table *table, size_t budget);
+
 /**
  * @brief Returns the highest supported BGPsec version.
  * @return RTR_BGPSEC_VERSION The currently supported BGPsec version.
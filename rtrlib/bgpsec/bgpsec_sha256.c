@@ -0,0 +1,210 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "bgpsec_sha256_private.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* ifunc based function multiversioning, the default version is the portable one. Only glibc resolves ifuncs,
+ * musl and uClibc do not support them.
+ */
+#if defined(__x86_64__) && defined(__GLIBC__) && !defined(__UCLIBC__) && \
+	((defined(__clang__) && __clang_major__ >= 14) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 6))
+#define BGPSEC_SHA256_X86_DISPATCH
+#define BGPSEC_SHA256_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define BGPSEC_SHA256_TARGETS
+#endif
+
+#define SHA256_BLOCK_SIZE 64
+
+/* A macro rather than a function, vectors must not be passed between the AVX2 and the default version */
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t sha256_h0[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/* One 32 bit word of every lane, operations on it are lowered to the vector instructions of the target */
+typedef uint32_t sha256_vec __attribute__((vector_size(4 * BGPSEC_SHA256_LANES)));
+
+/**
+ * @brief State of a group of messages that are hashed together.
+ * @param state Hash state, one element per lane.
+ * @param w Message schedule of the current block, one element per lane.
+ * @param active All bits set for lanes that process a block of their message in the current round.
+ */
+struct sha256_lanes {
+	sha256_vec state[8];
+	sha256_vec w[16];
+	sha256_vec active;
+};
+
+static uint32_t sha256_load_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Compresses one block of every lane, lanes that are not active keep their state */
+BGPSEC_SHA256_TARGETS static void sha256_lanes_compress(struct sha256_lanes *lanes)
+{
+	sha256_vec w[16];
+	sha256_vec a = lanes->state[0], b = lanes->state[1], c = lanes->state[2], d = lanes->state[3];
+	sha256_vec e = lanes->state[4], f = lanes->state[5], g = lanes->state[6], h = lanes->state[7];
+
+	memcpy(w, lanes->w, sizeof(w));
+
+	for (unsigned int t = 0; t < 64; t++) {
+		sha256_vec t1;
+		sha256_vec t2;
+
+		if (t >= 16) {
+			sha256_vec w2 = w[(t - 2) & 15];
+			sha256_vec w15 = w[(t - 15) & 15];
+
+			w[t & 15] += (SHA256_ROTR(w2, 17) ^ SHA256_ROTR(w2, 19) ^ (w2 >> 10)) + w[(t - 7) & 15] +
+				     (SHA256_ROTR(w15, 7) ^ SHA256_ROTR(w15, 18) ^ (w15 >> 3));
+		}
+
+		t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+		     sha256_k[t] + w[t & 15];
+		t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	lanes->state[0] += a & lanes->active;
+	lanes->state[1] += b & lanes->active;
+	lanes->state[2] += c & lanes->active;
+	lanes->state[3] += d & lanes->active;
+	lanes->state[4] += e & lanes->active;
+	lanes->state[5] += f & lanes->active;
+	lanes->state[6] += g & lanes->active;
+	lanes->state[7] += h & lanes->active;
+}
+
+void bgpsec_sha256_lanes(const uint8_t **msgs, const size_t *lens, unsigned int count, unsigned char *digests)
+{
+	struct sha256_lanes lanes;
+	/* The last partial block of every message with the padding, one or two blocks */
+	uint8_t tails[BGPSEC_SHA256_LANES][2 * SHA256_BLOCK_SIZE];
+
+	for (unsigned int first = 0; first < count; first += BGPSEC_SHA256_LANES) {
+		unsigned int group_len = count - first < BGPSEC_SHA256_LANES ? count - first : BGPSEC_SHA256_LANES;
+		size_t full_blocks[BGPSEC_SHA256_LANES] = {0};
+		size_t blocks[BGPSEC_SHA256_LANES] = {0};
+		size_t max_blocks = 0;
+
+		for (unsigned int l = 0; l < group_len; l++) {
+			size_t len = lens[first + l];
+			size_t rest = len % SHA256_BLOCK_SIZE;
+			size_t tail_len = rest + 9 <= SHA256_BLOCK_SIZE ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+			uint64_t bits = (uint64_t)len * 8;
+
+			full_blocks[l] = len / SHA256_BLOCK_SIZE;
+			blocks[l] = full_blocks[l] + tail_len / SHA256_BLOCK_SIZE;
+			if (blocks[l] > max_blocks)
+				max_blocks = blocks[l];
+
+			memset(tails[l], 0, tail_len);
+			memcpy(tails[l], msgs[first + l] + full_blocks[l] * SHA256_BLOCK_SIZE, rest);
+			tails[l][rest] = 0x80;
+			for (unsigned int i = 0; i < 8; i++)
+				tails[l][tail_len - 1 - i] = bits >> (8 * i);
+		}
+
+		for (unsigned int i = 0; i < 8; i++) {
+			for (unsigned int l = 0; l < BGPSEC_SHA256_LANES; l++)
+				lanes.state[i][l] = sha256_h0[i];
+		}
+
+		for (size_t block = 0; block < max_blocks; block++) {
+			for (unsigned int l = 0; l < BGPSEC_SHA256_LANES; l++) {
+				const uint8_t *data;
+
+				if (l >= group_len || block >= blocks[l]) {
+					lanes.active[l] = 0;
+					for (unsigned int t = 0; t < 16; t++)
+						lanes.w[t][l] = 0;
+					continue;
+				}
+
+				if (block < full_blocks[l])
+					data = msgs[first + l] + block * SHA256_BLOCK_SIZE;
+				else
+					data = tails[l] + (block - full_blocks[l]) * SHA256_BLOCK_SIZE;
+
+				lanes.active[l] = UINT32_MAX;
+				for (unsigned int t = 0; t < 16; t++)
+					lanes.w[t][l] = sha256_load_be32(data + 4 * t);
+			}
+
+			sha256_lanes_compress(&lanes);
+		}
+
+		for (unsigned int l = 0; l < group_len; l++) {
+			unsigned char *digest = digests + (first + l) * SHA256_DIGEST_LENGTH;
+
+			for (unsigned int i = 0; i < 8; i++) {
+				digest[4 * i] = lanes.state[i][l] >> 24;
+				digest[4 * i + 1] = lanes.state[i][l] >> 16;
+				digest[4 * i + 2] = lanes.state[i][l] >> 8;
+				digest[4 * i + 3] = lanes.state[i][l];
+			}
+		}
+	}
+}
+
+/*
+ * The kernel only pays off against OpenSSL, which uses the SHA extensions
+ * when the CPU has them, if it runs in AVX2 registers.
+ */
+static bool bgpsec_sha256_lanes_are_faster(void)
+{
+#ifdef BGPSEC_SHA256_X86_DISPATCH
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && !__builtin_cpu_supports("sha");
+#else
+	return false;
+#endif
+}
+
+void bgpsec_sha256_multi(const uint8_t **msgs, const size_t *lens, unsigned int count, unsigned char *digests)
+{
+	if (count > 1 && bgpsec_sha256_lanes_are_faster()) {
+		bgpsec_sha256_lanes(msgs, lens, count, digests);
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		SHA256_CTX ctx;
+
+		SHA256_Init(&ctx);
+		SHA256_Update(&ctx, msgs[i], lens[i]);
+		SHA256_Final(digests + i * SHA256_DIGEST_LENGTH, &ctx);
+	}
+}
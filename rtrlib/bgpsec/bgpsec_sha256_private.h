@@ -0,0 +1,48 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#ifndef RTR_BGPSEC_SHA256_PRIVATE_H
+#define RTR_BGPSEC_SHA256_PRIVATE_H
+
+#include <openssl/sha.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Number of messages that are hashed at once by the multi-buffer kernel.
+ */
+#define BGPSEC_SHA256_LANES 8
+
+/**
+ * @brief Computes the SHA-256 digests of several messages.
+ * @details Uses the multi-buffer kernel if it is faster than the OpenSSL
+ * digests on this CPU, i.e. on x86-64 CPUs with AVX2 but without the SHA
+ * extensions, and OpenSSL otherwise.
+ * @param[in] msgs The messages.
+ * @param[in] lens Length of every message in bytes.
+ * @param[in] count Number of messages.
+ * @param[out] digests SHA256_DIGEST_LENGTH bytes per message for the digests.
+ */
+void bgpsec_sha256_multi(const uint8_t **msgs, const size_t *lens, unsigned int count, unsigned char *digests);
+
+/**
+ * @brief Computes the SHA-256 digests of several messages with the
+ * multi-buffer kernel, regardless of the CPU.
+ * @details The messages are hashed in groups of BGPSEC_SHA256_LANES. The
+ * words of all lanes are stored in one vector, so every step of the
+ * compression function works on all lanes with one vector instruction. On
+ * x86-64 an AVX2 version of the compression function is selected at runtime.
+ * @param[in] msgs The messages.
+ * @param[in] lens Length of every message in bytes.
+ * @param[in] count Number of messages.
+ * @param[out] digests SHA256_DIGEST_LENGTH bytes per message for the digests.
+ */
+void bgpsec_sha256_lanes(const uint8_t **msgs, const size_t *lens, unsigned int count, unsigned char *digests);
+
+#endif
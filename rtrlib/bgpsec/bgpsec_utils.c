@@ -7,7 +7,9 @@
  * Website: http://rtrlib.realmv6.org/
  */
 
+#include "rtrlib/bgpsec/bgpsec_sha256_private.h"
 #include "rtrlib/bgpsec/bgpsec_utils_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
 #include "rtrlib/spki/spkitable_private.h"
 
 #include <stdio.h>
@@ -125,33 +127,63 @@ int get_sig_seg_size(const struct rtr_signature_seg *sig_segs, enum align_type t
 	return sig_segs_size;
 }
 
-int check_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table)
+int resolve_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table,
+			struct bgpsec_key_set *key_set)
 {
-	struct spki_record *tmp_key = NULL;
-	const struct rtr_signature_seg *curr = sig_segs;
-
-	while (curr) {
-		unsigned int router_keys_len = 0;
-		enum spki_rtvals spki_retval =
-			spki_table_search_by_ski(table, (uint8_t *)curr->ski, &tmp_key, &router_keys_len);
-		if (spki_retval == SPKI_ERROR)
+	unsigned int keys_len = BGPSEC_KEY_SET_INLINE_SIZE;
+	unsigned int segs_len = 0;
+	unsigned int i = 0;
+
+	key_set->keys = key_set->inline_keys;
+	key_set->ends = key_set->inline_ends;
+	key_set->skis = key_set->inline_skis;
+	key_set->segs_len = 0;
+
+	for (const struct rtr_signature_seg *curr = sig_segs; curr; curr = curr->next)
+		segs_len++;
+
+	if (segs_len > BGPSEC_KEY_SET_INLINE_SIZE) {
+		key_set->ends = lrtr_malloc(sizeof(*key_set->ends) * segs_len);
+		key_set->skis = lrtr_malloc(sizeof(*key_set->skis) * segs_len);
+		if (!key_set->ends || !key_set->skis)
 			return RTR_BGPSEC_ERROR;
+	}
+
+	for (const struct rtr_signature_seg *curr = sig_segs; curr; curr = curr->next)
+		key_set->skis[i++] = curr->ski;
 
-		/* Return an error, if a router key was not found. */
-		if (router_keys_len == 0) {
+	if (spki_table_search_by_skis(table, key_set->skis, segs_len, &key_set->keys, &keys_len, key_set->ends) ==
+	    SPKI_ERROR)
+		return RTR_BGPSEC_ERROR;
+
+	key_set->segs_len = segs_len;
+
+	/* Return an error, if a router key was not found. */
+	for (i = 0; i < segs_len; i++) {
+		if (key_set->ends[i] == (i > 0 ? key_set->ends[i - 1] : 0)) {
 			char ski_str[SKI_STR_LEN] = {0};
 
-			ski_to_char(ski_str, (uint8_t *)curr->ski);
+			ski_to_char(ski_str, (uint8_t *)key_set->skis[i]);
 			BGPSEC_DBG("ERROR: Could not find router key for SKI: %s", ski_str);
 			return RTR_BGPSEC_ROUTER_KEY_NOT_FOUND;
 		}
-		lrtr_free(tmp_key);
-		curr = curr->next;
 	}
 
 	return RTR_BGPSEC_SUCCESS;
 }
 
+void free_router_keys(struct bgpsec_key_set *key_set)
+{
+	if (key_set->segs_len > 0)
+		spki_key_refs_release(key_set->keys, key_set->ends[key_set->segs_len - 1]);
+	if (key_set->keys != key_set->inline_keys)
+		lrtr_free(key_set->keys);
+	if (key_set->ends != key_set->inline_ends)
+		lrtr_free(key_set->ends);
+	if (key_set->skis != key_set->inline_skis)
+		lrtr_free(key_set->skis);
+}
+
 int byte_sequence_to_str(char *buffer, uint8_t *bytes, unsigned int bytes_len, unsigned int tabstops)
 {
 	unsigned int bytes_printed = 1;
@@ -288,7 +320,7 @@ int align_byte_sequence(const struct rtr_bgpsec *data, struct stream *s, enum al
 	return RTR_BGPSEC_SUCCESS;
 }
 
-int validate_signature(const unsigned char *hash, const struct rtr_signature_seg *sig, struct spki_record *record)
+int validate_signature(const unsigned char *hash, const struct rtr_signature_seg *sig, const struct spki_key *key)
 {
 	int status = 0;
 	enum rtr_bgpsec_rtvals retval;
@@ -298,7 +330,7 @@ int validate_signature(const unsigned char *hash, const struct rtr_signature_seg
 	/* Load the contents of the spki buffer into the
 	 * OpenSSL public key.
 	 */
-	retval = load_public_key(&pub_key, record->spki);
+	retval = load_public_key(&pub_key, (uint8_t *)key->spki);
 
 	if (retval != RTR_BGPSEC_SUCCESS) {
 		/*The output string looks like this: "XX XX XX XX"*/
@@ -307,7 +339,7 @@ int validate_signature(const unsigned char *hash, const struct rtr_signature_seg
 		/*terminator.*/
 		char ski_str[(SKI_SIZE * 3) + 1] = {'\0'};
 
-		ski_to_char(ski_str, record->ski);
+		ski_to_char(ski_str, (uint8_t *)key->ski);
 		BGPSEC_DBG("WARNING: Invalid public key for SKI: %s", ski_str);
 		retval = RTR_BGPSEC_ERROR;
 		goto err;
@@ -412,6 +444,171 @@ int hash_byte_sequence(uint8_t *bytes, size_t bytes_len, uint8_t alg_suite_id, u
 	return RTR_BGPSEC_SUCCESS;
 }
 
+int hash_signed_sequences(const struct rtr_signature_seg *sig_segs, struct stream *s, uint8_t alg_suite_id,
+			  unsigned char *hash_results, unsigned int *hash_results_len)
+{
+	const uint8_t *msgs[BGPSEC_SHA256_LANES];
+	size_t lens[BGPSEC_SHA256_LANES];
+	unsigned char *digests = hash_results;
+	unsigned int batch_len = 0;
+	size_t offset = 0;
+
+	*hash_results_len = 0;
+
+	if (alg_suite_id != RTR_BGPSEC_ALGORITHM_SUITE_1)
+		return RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
+
+	/* Every signature covers the byte sequence from its offset to the
+	 * end. The offset of the next signature is behind the signature
+	 * segment of the next AS and the secure path segment of this AS.
+	 */
+	for (const struct rtr_signature_seg *curr = sig_segs; curr && offset <= s->size; curr = curr->next) {
+		uint16_t sig_len = curr->next ? curr->next->sig_len : curr->sig_len;
+
+		msgs[batch_len] = s->start + offset;
+		lens[batch_len] = s->size - offset;
+		batch_len++;
+
+		offset += sig_len + SKI_SIZE + sizeof(curr->sig_len) + SECURE_PATH_SEG_SIZE;
+
+		if (batch_len == BGPSEC_SHA256_LANES) {
+			bgpsec_sha256_multi(msgs, lens, batch_len, digests);
+			digests += batch_len * SHA256_DIGEST_LENGTH;
+			*hash_results_len += batch_len;
+			batch_len = 0;
+		}
+	}
+
+	bgpsec_sha256_multi(msgs, lens, batch_len, digests);
+	*hash_results_len += batch_len;
+
+	return RTR_BGPSEC_SUCCESS;
+}
+
+/* Read a two byte length field in network byte order. */
+static size_t read_length(const uint8_t *bytes)
+{
+	uint16_t len;
+
+	memcpy(&len, bytes, sizeof(len));
+	return ntohs(len);
+}
+
+int parse_path_attr(const uint8_t *attr, size_t attr_len, uint8_t alg, struct bgpsec_path_attr *parsed)
+{
+	unsigned int sigs_len = 0;
+	size_t value_len;
+	size_t path_size;
+	size_t offset;
+
+	memset(parsed, 0, sizeof(*parsed));
+	if (attr_len == 0)
+		return RTR_BGPSEC_SUCCESS;
+
+	/* Attribute header: flags, type code and a length of one or two bytes */
+	if (!attr || attr_len < 3 || attr[1] != BGPSEC_PATH_ATTR_TYPE)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+	if (attr[0] & BGPSEC_ATTR_FLAG_EXTENDED_LENGTH) {
+		if (attr_len < BGPSEC_PATH_ATTR_HEADER_SIZE)
+			return RTR_BGPSEC_INVALID_ARGUMENTS;
+		value_len = read_length(attr + 2);
+		offset = BGPSEC_PATH_ATTR_HEADER_SIZE;
+	} else {
+		value_len = attr[2];
+		offset = 3;
+	}
+
+	if (offset + value_len != attr_len || value_len < 2)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
+	attr += offset;
+
+	/* The length of the Secure_Path and of a Signature_Block include their length field */
+	path_size = read_length(attr);
+	if (path_size < 2 + SECURE_PATH_SEG_SIZE || path_size > value_len ||
+	    (path_size - 2) % SECURE_PATH_SEG_SIZE != 0)
+		return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+	parsed->path = attr + 2;
+	parsed->path_len = (path_size - 2) / SECURE_PATH_SEG_SIZE;
+
+	for (offset = path_size; offset < value_len;) {
+		size_t block_size;
+
+		if (value_len - offset < 3)
+			return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+		block_size = read_length(attr + offset);
+		if (block_size < 3 || block_size > value_len - offset)
+			return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+		/* Signature_Blocks of other algorithm suites are skipped */
+		if (attr[offset + 2] == alg) {
+			if (parsed->sigs)
+				return RTR_BGPSEC_INVALID_ARGUMENTS;
+
+			parsed->sigs = attr + offset + 3;
+			parsed->sigs_size = block_size - 3;
+
+			for (size_t pos = 0; pos < parsed->sigs_size; sigs_len++) {
+				if (parsed->sigs_size - pos < SKI_SIZE + 2)
+					return RTR_BGPSEC_INVALID_ARGUMENTS;
+				pos += SKI_SIZE + 2 + read_length(parsed->sigs + pos + SKI_SIZE);
+				if (pos > parsed->sigs_size)
+					return RTR_BGPSEC_INVALID_ARGUMENTS;
+			}
+		}
+		offset += block_size;
+	}
+
+	if (!parsed->sigs)
+		return RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
+
+	if (sigs_len != parsed->path_len)
+		return RTR_BGPSEC_WRONG_SEGMENT_COUNT;
+
+	return RTR_BGPSEC_SUCCESS;
+}
+
+int hash_path_attr(const struct rtr_bgpsec *data, const struct bgpsec_path_attr *received, const uint8_t *own_seg,
+		   unsigned char *hash_result)
+{
+	const uint8_t *sig = received->sigs;
+	uint32_t asn = htonl(data->target_as);
+	uint16_t afi = htons(data->afi);
+	SHA256_CTX ctx;
+
+	if (data->alg != RTR_BGPSEC_ALGORITHM_SUITE_1)
+		return RTR_BGPSEC_UNSUPPORTED_ALGORITHM_SUITE;
+
+	SHA256_Init(&ctx);
+	SHA256_Update(&ctx, &asn, sizeof(asn));
+
+	/* The Signature Segment of an AS precedes the Secure_Path Segment of the next AS, see align_byte_sequence() */
+	for (unsigned int i = 0; i <= received->path_len; i++) {
+		if (i < received->path_len) {
+			size_t sig_size = SKI_SIZE + 2 + read_length(sig + SKI_SIZE);
+
+			SHA256_Update(&ctx, sig, sig_size);
+			sig += sig_size;
+		}
+
+		if (i == 0)
+			SHA256_Update(&ctx, own_seg, SECURE_PATH_SEG_SIZE);
+		else
+			SHA256_Update(&ctx, received->path + (i - 1) * SECURE_PATH_SEG_SIZE, SECURE_PATH_SEG_SIZE);
+	}
+
+	SHA256_Update(&ctx, &data->alg, 1);
+	SHA256_Update(&ctx, &afi, sizeof(afi));
+	SHA256_Update(&ctx, &data->safi, 1);
+	SHA256_Update(&ctx, &data->nlri->nlri_len, 1);
+	SHA256_Update(&ctx, data->nlri->nlri, NLRI_BYTE_LEN(data));
+	SHA256_Final(hash_result, &ctx);
+
+	return RTR_BGPSEC_SUCCESS;
+}
+
 int sign_byte_sequence(uint8_t *hash_result, EC_KEY *priv_key, uint8_t alg, struct rtr_signature_seg *new_signature)
 {
 	enum rtr_bgpsec_rtvals retval = RTR_BGPSEC_SUCCESS;
@@ -14,8 +14,10 @@
 #include "rtrlib/lib/alloc_utils_private.h"
 #include "rtrlib/lib/log_private.h"
 #include "rtrlib/rtrlib_export_private.h"
+#include "rtrlib/spki/spkitable_private.h"
 
 #include <arpa/inet.h>
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 #include <string.h>
 
@@ -33,6 +35,52 @@
 /** The total length of a private key in bytes. */
 #define PRIVATE_KEY_LENGTH 121L
 
+/** Attribute type code of the BGPsec_PATH attribute. */
+#define BGPSEC_PATH_ATTR_TYPE 33
+
+/** Flags of a BGPsec_PATH attribute: optional, non-transitive, extended length. */
+#define BGPSEC_PATH_ATTR_FLAGS 0x90
+
+/** Extended length flag of a path attribute, the length field has two bytes if it is set. */
+#define BGPSEC_ATTR_FLAG_EXTENDED_LENGTH 0x10
+
+/** Size of the header of a BGPsec_PATH attribute with extended length. */
+#define BGPSEC_PATH_ATTR_HEADER_SIZE 4
+
+/** Number of Signature Segments and router keys a bgpsec_key_set stores without allocating memory. */
+#define BGPSEC_KEY_SET_INLINE_SIZE 16
+
+/**
+ * @brief The router keys of all Signature Segments of a BGPsec_PATH, resolved from one state of the spki_table.
+ * @param keys Handles of the router keys of all segments, the keys of a segment are stored consecutively.
+ * @param ends Index behind the last key of every segment in keys.
+ * @param skis SKIs of the segments.
+ * @param segs_len Number of segments.
+ */
+struct bgpsec_key_set {
+	struct spki_key_ref *keys;
+	unsigned int *ends;
+	const uint8_t **skis;
+	unsigned int segs_len;
+	struct spki_key_ref inline_keys[BGPSEC_KEY_SET_INLINE_SIZE];
+	unsigned int inline_ends[BGPSEC_KEY_SET_INLINE_SIZE];
+	const uint8_t *inline_skis[BGPSEC_KEY_SET_INLINE_SIZE];
+};
+
+/**
+ * @brief A received BGPsec_PATH attribute, all pointers refer to the attribute bytes.
+ * @param path Secure_Path Segments in wire format, most recent first.
+ * @param path_len Number of Secure_Path Segments.
+ * @param sigs Signature Segments of the Signature_Block of one algorithm suite in wire format, most recent first.
+ * @param sigs_size Size of all Signature Segments in bytes.
+ */
+struct bgpsec_path_attr {
+	const uint8_t *path;
+	unsigned int path_len;
+	const uint8_t *sigs;
+	size_t sigs_size;
+};
+
 /** Control flag, validation and signing procedures for aligning data differs.
  */
 enum align_type {
@@ -80,8 +128,15 @@ size_t req_stream_size(const struct rtr_bgpsec *data, enum align_type type);
 /* Get the length in bytes for a all signature segments */
 int get_sig_seg_size(const struct rtr_signature_seg *sig_segs, enum align_type type);
 
-/* Check, if there is at least one router key for each SKI from sig_segs. */
-int check_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table);
+/* Store the router keys for the SKIs of all sig_segs in key_set, holding the spki_table lock only once.
+ * Fails, if there is not at least one router key for each SKI. key_set must be freed with
+ * free_router_keys() in any case.
+ */
+int resolve_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table,
+			struct bgpsec_key_set *key_set);
+
+/* Release the router keys of key_set and free the memory that was allocated by resolve_router_keys(). */
+void free_router_keys(struct bgpsec_key_set *key_set);
 
 /* Store the string representation of a BGPsec_PATH segment in buffer. */
 int bgpsec_segment_to_str(char *buffer, struct rtr_signature_seg *sig_seg, struct rtr_secure_path_seg *sec_path);
@@ -102,8 +157,28 @@ int align_byte_sequence(const struct rtr_bgpsec *data, struct stream *s, enum al
 /* Hash a byte sequence and store it in result_buffer. */
 int hash_byte_sequence(uint8_t *bytes, size_t bytes_len, uint8_t alg_suite_id, unsigned char **result_buffer);
 
+/* Hash the parts of the aligned byte sequence in s that are signed by each of sig_segs at once. hash_results
+ * must have room for SHA256_DIGEST_LENGTH bytes per signature segment, hash_results_len returns the number of
+ * computed hashes.
+ */
+int hash_signed_sequences(const struct rtr_signature_seg *sig_segs, struct stream *s, uint8_t alg_suite_id,
+			  unsigned char *hash_results, unsigned int *hash_results_len);
+
+/* Parse a BGPsec_PATH attribute, including its attribute header, and locate the Signature_Block of alg in it.
+ * An empty attribute (attr_len 0) is parsed as a path without segments. Fails, if the attribute is malformed,
+ * has no Signature_Block for alg or if its segment counts differ.
+ */
+int parse_path_attr(const uint8_t *attr, size_t attr_len, uint8_t alg, struct bgpsec_path_attr *parsed);
+
+/* Hash the data that is signed by a BGPsec speaker that prepends own_seg, a Secure_Path Segment in wire format,
+ * to the received attribute. Like align_byte_sequence() for signing, but the segments are read from the wire
+ * format and nothing is copied or allocated. hash_result must have room for SHA256_DIGEST_LENGTH bytes.
+ */
+int hash_path_attr(const struct rtr_bgpsec *data, const struct bgpsec_path_attr *received, const uint8_t *own_seg,
+		   unsigned char *hash_result);
+
 /* Validate a signature sig. */
-int validate_signature(const unsigned char *hash, const struct rtr_signature_seg *sig, struct spki_record *record);
+int validate_signature(const unsigned char *hash, const struct rtr_signature_seg *sig, const struct spki_key *key);
 
 /* Load a binary private key bytes_key and store it in the openssl EC_KEY
  * priv_key.
@@ -15,6 +15,7 @@ extern "C" {
 #define RTR_CONFIG_H
 
 #cmakedefine RTRLIB_BGPSEC_ENABLED
+#cmakedefine RTRLIB_PFX_SUCCINCT
 
 #endif
 
@@ -0,0 +1,326 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "executor_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/rtrlib_export_private.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LRTR_POOL_MAX_WORKERS 64
+#define LRTR_POOL_QUEUE_SIZE 16
+
+struct lrtr_pool_task {
+	lrtr_task_fp task;
+	void *arg;
+	struct lrtr_wait_group *group;
+};
+
+/**
+ * @brief Tasks of a worker of the built-in thread pool.
+ * @details The worker takes the task that was submitted last, so tasks submitted by its own tasks are run while
+ * their data is still cached. Other threads steal the task that was submitted first.
+ */
+struct lrtr_pool_queue {
+	pthread_mutex_t mutex;
+	struct lrtr_pool_task *tasks;
+	unsigned int first;
+	unsigned int len;
+	unsigned int size;
+};
+
+static struct {
+	struct lrtr_pool_queue *queues;
+	unsigned int workers;
+	unsigned int next;
+	unsigned int queued;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_once_t once;
+} pool = {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER, .once = PTHREAD_ONCE_INIT};
+
+// index of the queue of the calling thread, -1 if it is not a worker of the pool
+static __thread int pool_worker = -1;
+
+static struct lrtr_executor executor;
+static bool executor_set;
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT void lrtr_set_executor(const struct lrtr_executor *new_executor)
+{
+	if (new_executor) {
+		executor = *new_executor;
+		executor_set = true;
+	} else {
+		executor_set = false;
+	}
+}
+
+void lrtr_wait_group_init(struct lrtr_wait_group *group)
+{
+	pthread_mutex_init(&group->mutex, NULL);
+	pthread_cond_init(&group->cond, NULL);
+	group->pending = 0;
+}
+
+void lrtr_wait_group_destroy(struct lrtr_wait_group *group)
+{
+	pthread_mutex_destroy(&group->mutex);
+	pthread_cond_destroy(&group->cond);
+}
+
+static void lrtr_wait_group_done(struct lrtr_wait_group *group)
+{
+	// the waiting thread can destroy the group as soon as the mutex is released
+	pthread_mutex_lock(&group->mutex);
+	if (--group->pending == 0)
+		pthread_cond_broadcast(&group->cond);
+	pthread_mutex_unlock(&group->mutex);
+}
+
+static int lrtr_pool_queue_push(struct lrtr_pool_queue *queue, const struct lrtr_pool_task *task)
+{
+	if (queue->len == queue->size) {
+		unsigned int size = queue->size ? queue->size * 2 : LRTR_POOL_QUEUE_SIZE;
+		struct lrtr_pool_task *tasks = lrtr_malloc(sizeof(*tasks) * size);
+
+		if (!tasks)
+			return -1;
+		for (unsigned int i = 0; i < queue->len; i++)
+			tasks[i] = queue->tasks[(queue->first + i) % queue->size];
+		lrtr_free(queue->tasks);
+		queue->tasks = tasks;
+		queue->first = 0;
+		queue->size = size;
+	}
+	queue->tasks[(queue->first + queue->len) % queue->size] = *task;
+	queue->len++;
+	return 0;
+}
+
+/**
+ * @brief Removes a task from a queue.
+ * @param[in] queue Queue to use, the caller must hold its mutex.
+ * @param[in] group Only a task of this group is taken, the last one, NULL to take any task.
+ * @param[in] last True to take the last task if @p group is NULL, false to take the first one.
+ * @param[out] task Removed task.
+ * @return true If a task was removed.
+ */
+static bool lrtr_pool_queue_take(struct lrtr_pool_queue *queue, const struct lrtr_wait_group *group, const bool last,
+				 struct lrtr_pool_task *task)
+{
+	unsigned int i = queue->len;
+
+	if (queue->len == 0)
+		return false;
+
+	if (!group) {
+		i = last ? queue->len - 1 : 0;
+	} else {
+		while (i > 0 && queue->tasks[(queue->first + i - 1) % queue->size].group != group)
+			i--;
+		if (i == 0)
+			return false;
+		i--;
+	}
+
+	*task = queue->tasks[(queue->first + i) % queue->size];
+	if (i == 0) {
+		queue->first = (queue->first + 1) % queue->size;
+	} else {
+		for (; i + 1 < queue->len; i++) {
+			unsigned int pos = (queue->first + i) % queue->size;
+
+			queue->tasks[pos] = queue->tasks[(pos + 1) % queue->size];
+		}
+	}
+	queue->len--;
+	return true;
+}
+
+/**
+ * @brief Takes a queued task, from the queue of the calling thread first.
+ * @param[in] group Only a task of this group is taken, NULL to take any task.
+ * @param[out] task Taken task.
+ * @return true If a task was taken.
+ */
+static bool lrtr_pool_take(const struct lrtr_wait_group *group, struct lrtr_pool_task *task)
+{
+	unsigned int start = pool_worker >= 0 ? (unsigned int)pool_worker : 0;
+
+	if (__atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0)
+		return false;
+
+	for (unsigned int i = 0; i < pool.workers; i++) {
+		struct lrtr_pool_queue *queue = &pool.queues[(start + i) % pool.workers];
+		bool taken;
+
+		pthread_mutex_lock(&queue->mutex);
+		taken = lrtr_pool_queue_take(queue, group, pool_worker >= 0 && i == 0, task);
+		pthread_mutex_unlock(&queue->mutex);
+		if (taken) {
+			__atomic_sub_fetch(&pool.queued, 1, __ATOMIC_RELEASE);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void lrtr_pool_run(const struct lrtr_pool_task *task)
+{
+	task->task(task->arg);
+	lrtr_wait_group_done(task->group);
+}
+
+static void *lrtr_pool_worker(void *arg)
+{
+	struct lrtr_pool_task task;
+
+	pool_worker = (int)(intptr_t)arg;
+	while (true) {
+		if (lrtr_pool_take(NULL, &task)) {
+			lrtr_pool_run(&task);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool.mutex);
+		while (__atomic_load_n(&pool.queued, __ATOMIC_ACQUIRE) == 0)
+			pthread_cond_wait(&pool.cond, &pool.mutex);
+		pthread_mutex_unlock(&pool.mutex);
+	}
+	return NULL;
+}
+
+static void lrtr_pool_start(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int workers = cpus > 1 ? cpus - 1 : 0;
+	pthread_attr_t attr;
+	sigset_t signals;
+	sigset_t old_signals;
+
+	if (workers > LRTR_POOL_MAX_WORKERS)
+		workers = LRTR_POOL_MAX_WORKERS;
+	if (workers == 0)
+		return;
+
+	pool.queues = lrtr_calloc(workers, sizeof(*pool.queues));
+	if (!pool.queues)
+		return;
+	for (unsigned int i = 0; i < workers; i++)
+		pthread_mutex_init(&pool.queues[i].mutex, NULL);
+	pool.workers = workers;
+
+	// signals of the application are not delivered to the workers
+	sigfillset(&signals);
+	pthread_sigmask(SIG_SETMASK, &signals, &old_signals);
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (unsigned int i = 0; i < workers; i++) {
+		pthread_t thread;
+
+		// the queues of workers that could not be started are emptied by the others
+		if (pthread_create(&thread, &attr, lrtr_pool_worker, (void *)(intptr_t)i) != 0) {
+			if (i == 0)
+				pool.workers = 0;
+			break;
+		}
+	}
+	pthread_attr_destroy(&attr);
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+}
+
+static int lrtr_pool_submit(const struct lrtr_pool_task *task)
+{
+	struct lrtr_pool_queue *queue;
+	int rtval;
+
+	pthread_once(&pool.once, lrtr_pool_start);
+	if (pool.workers == 0)
+		return -1;
+
+	if (pool_worker >= 0)
+		queue = &pool.queues[pool_worker];
+	else
+		queue = &pool.queues[__atomic_fetch_add(&pool.next, 1, __ATOMIC_RELAXED) % pool.workers];
+
+	pthread_mutex_lock(&queue->mutex);
+	rtval = lrtr_pool_queue_push(queue, task);
+	pthread_mutex_unlock(&queue->mutex);
+	if (rtval != 0)
+		return rtval;
+
+	pthread_mutex_lock(&pool.mutex);
+	__atomic_add_fetch(&pool.queued, 1, __ATOMIC_RELEASE);
+	pthread_cond_signal(&pool.cond);
+	pthread_mutex_unlock(&pool.mutex);
+	return 0;
+}
+
+/* Runs a task of the executor that was installed by the application, used as lrtr_task_fp */
+static void lrtr_executor_run(void *arg)
+{
+	struct lrtr_pool_task task = *(struct lrtr_pool_task *)arg;
+
+	lrtr_free(arg);
+	lrtr_pool_run(&task);
+}
+
+void lrtr_executor_submit(struct lrtr_wait_group *group, lrtr_task_fp task, void *arg)
+{
+	struct lrtr_pool_task pool_task = {task, arg, group};
+
+	pthread_mutex_lock(&group->mutex);
+	group->pending++;
+	pthread_mutex_unlock(&group->mutex);
+
+	if (executor_set) {
+		struct lrtr_pool_task *copy = executor.parallelism > 1 ? lrtr_malloc(sizeof(*copy)) : NULL;
+
+		if (copy) {
+			*copy = pool_task;
+			if (executor.submit(executor.data, lrtr_executor_run, copy) == 0)
+				return;
+			lrtr_free(copy);
+		}
+	} else if (lrtr_pool_submit(&pool_task) == 0) {
+		return;
+	}
+
+	lrtr_pool_run(&pool_task);
+}
+
+void lrtr_wait_group_wait(struct lrtr_wait_group *group)
+{
+	struct lrtr_pool_task task;
+
+	// only tasks of the group are run, others could need locks that the calling thread holds
+	while (!executor_set && __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0 &&
+	       lrtr_pool_take(group, &task))
+		lrtr_pool_run(&task);
+
+	pthread_mutex_lock(&group->mutex);
+	while (group->pending > 0)
+		pthread_cond_wait(&group->cond, &group->mutex);
+	pthread_mutex_unlock(&group->mutex);
+}
+
+unsigned int lrtr_executor_parallelism(void)
+{
+	if (executor_set)
+		return executor.parallelism > 1 ? executor.parallelism : 1;
+
+	pthread_once(&pool.once, lrtr_pool_start);
+	return pool.workers + 1;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_executor_h Executor
+ * @brief Schedules the parallel work of rtrlib.
+ * @details Operations that are split into tasks, like the traversal of large pfx_tables, signing a BGPsec path
+ * for several peers and the background rebuild of the frozen validation index, submit their tasks to an executor.
+ * By default a work-stealing thread pool with one thread per additional CPU is used, it is started on the first
+ * submitted task. Applications that run their own thread pool can install it with lrtr_set_executor(), rtrlib
+ * then starts no threads for these operations.\n
+ * The threads of the rtr_sockets are not affected, they block on their transport for most of their lifetime.
+ * @{
+ */
+
+#ifndef LRTR_EXECUTOR_H
+#define LRTR_EXECUTOR_H
+
+/**
+ * @brief A task that is run by an executor.
+ * @param arg Argument passed to lrtr_executor.submit.
+ */
+typedef void (*lrtr_task_fp)(void *arg);
+
+/**
+ * @brief An executor that runs the tasks of rtrlib.
+ * @param submit Schedules @p task to be called with @p arg by another thread and returns 0, or returns any other
+ *		 value if the task can not be scheduled, rtrlib then runs it in the calling thread. A task may submit
+ *		 further tasks and waits for them to be finished. The executor must run them even if all of its
+ *		 threads are waiting, e.g. by running tasks in the waiting threads or by growing the pool.
+ * @param data Passed to @p submit.
+ * @param parallelism Maximum number of tasks of one operation that are run at the same time, the thread that
+ *		      submits them counts as well. 0 and 1 run every operation in the calling thread.
+ */
+struct lrtr_executor {
+	int (*submit)(void *data, lrtr_task_fp task, void *arg);
+	void *data;
+	unsigned int parallelism;
+};
+
+/**
+ * @brief Sets the executor that is used throughout rtrlib.
+ * @details Must be called before rtrlib is used, like lrtr_set_alloc_functions(). The executor is copied.
+ * @param[in] executor Executor to use, NULL to use the built-in thread pool.
+ */
+void lrtr_set_executor(const struct lrtr_executor *executor);
+
+#endif
+/** @} */
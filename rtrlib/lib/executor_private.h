@@ -0,0 +1,58 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#ifndef LRTR_EXECUTOR_PRIVATE_H
+#define LRTR_EXECUTOR_PRIVATE_H
+
+#include "executor.h"
+
+#include <pthread.h>
+
+/**
+ * @brief Tasks that were submitted together and are waited for together.
+ * @param pending Number of submitted tasks that are not finished.
+ */
+struct lrtr_wait_group {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int pending;
+};
+
+/**
+ * @brief Initializes an empty wait group.
+ */
+void lrtr_wait_group_init(struct lrtr_wait_group *group);
+
+/**
+ * @brief Frees the resources of a wait group without pending tasks.
+ */
+void lrtr_wait_group_destroy(struct lrtr_wait_group *group);
+
+/**
+ * @brief Waits until all tasks of a wait group are finished.
+ * @details With the built-in thread pool the calling thread runs queued tasks while it waits.
+ */
+void lrtr_wait_group_wait(struct lrtr_wait_group *group);
+
+/**
+ * @brief Submits a task to the executor.
+ * @details A task that can not be scheduled is run by the calling thread before the function returns.
+ * @param[in] group Wait group the task is added to.
+ * @param[in] task Task to run.
+ * @param[in] arg Passed to @p task.
+ */
+void lrtr_executor_submit(struct lrtr_wait_group *group, lrtr_task_fp task, void *arg);
+
+/**
+ * @brief Returns the maximum number of tasks of one operation that should run at the same time.
+ * @details The calling thread is included, 1 means that the operation should not be split.
+ */
+unsigned int lrtr_executor_parallelism(void);
+
+#endif
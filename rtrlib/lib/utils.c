@@ -39,6 +39,25 @@ int lrtr_get_monotonic_time(time_t *seconds)
 	return 0;
 }
 
+int lrtr_get_monotonic_time_ms(uint64_t *milliseconds)
+{
+#if defined(__MACH__) && defined(__APPLE__)
+	if (timeconvert == 0.0) {
+		mach_timebase_info_data_t time_base;
+		(void)mach_timebase_info(&time_base);
+		timeconvert = (double)time_base.numer / (double)time_base.denom / 1000000000.0;
+	}
+	*milliseconds = (uint64_t)(mach_absolute_time() * timeconvert * 1000.0);
+#else
+	struct timespec time;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &time) == -1)
+		return -1;
+	*milliseconds = (uint64_t)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+#endif
+	return 0;
+}
+
 uint32_t lrtr_get_bits(const uint32_t val, const uint8_t from, const uint8_t number)
 {
 	assert(number < 33);
@@ -21,6 +21,14 @@
  */
 int lrtr_get_monotonic_time(time_t *seconds);
 
+/**
+ * @brief Returns the current time of the CLOCK_MONOTONIC clock in milliseconds.
+ * @param[in] milliseconds Time in milliseconds since some unspecified starting point.
+ * @return 0 on successs
+ * @return -1 on error
+ */
+int lrtr_get_monotonic_time_ms(uint64_t *milliseconds);
+
 /**
  * @brief Extracts number bits from the passed uint32_t, starting at bit number from. The bit with the highest
  * significance is bit 0. All bits that aren't in the specified range will be 0.
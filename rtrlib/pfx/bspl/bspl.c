@@ -0,0 +1,307 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "bspl_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+
+#include "third-party/tommyds/tommyhash.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Upper bound of the number of markers of a prefix, the binary search over at most 129 lengths has 8 levels */
+#define BSPL_MAX_MARKERS 8
+
+struct bspl_build_elem {
+	struct lrtr_ip_addr prefix;
+	uint8_t len;
+	bool marker;
+	void *data;
+};
+
+static struct lrtr_ip_addr bspl_mask(const struct lrtr_ip_addr *prefix, const uint8_t len)
+{
+	struct lrtr_ip_addr result;
+
+	memset(&result, 0, sizeof(result));
+	result.ver = prefix->ver;
+
+	if (prefix->ver == LRTR_IPV4) {
+		if (len > 0)
+			result.u.addr4.addr = prefix->u.addr4.addr & (UINT32_MAX << (32 - len));
+		return result;
+	}
+
+	for (unsigned int i = 0; i < 4; i++) {
+		unsigned int bits = len > 32 * i ? len - 32 * i : 0;
+
+		if (bits >= 32)
+			result.u.addr6.addr[i] = prefix->u.addr6.addr[i];
+		else if (bits > 0)
+			result.u.addr6.addr[i] = prefix->u.addr6.addr[i] & (UINT32_MAX << (32 - bits));
+	}
+	return result;
+}
+
+static int bspl_addr_cmp(const struct lrtr_ip_addr *a, const struct lrtr_ip_addr *b)
+{
+	if (a->ver == LRTR_IPV4) {
+		if (a->u.addr4.addr != b->u.addr4.addr)
+			return a->u.addr4.addr < b->u.addr4.addr ? -1 : 1;
+		return 0;
+	}
+
+	for (unsigned int i = 0; i < 4; i++) {
+		if (a->u.addr6.addr[i] != b->u.addr6.addr[i])
+			return a->u.addr6.addr[i] < b->u.addr6.addr[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static tommy_uint32_t bspl_hash(const struct lrtr_ip_addr *prefix, const uint8_t len)
+{
+	if (prefix->ver == LRTR_IPV4)
+		return tommy_hash_u32(len, &prefix->u.addr4.addr, sizeof(prefix->u.addr4.addr));
+	return tommy_hash_u32(len, prefix->u.addr6.addr, sizeof(prefix->u.addr6.addr));
+}
+
+static int bspl_entry_cmp(const void *arg, const void *obj)
+{
+	const struct bspl_entry *key = arg;
+	const struct bspl_entry *entry = obj;
+
+	if (key->len != entry->len)
+		return 1;
+	return bspl_addr_cmp(&key->prefix, &entry->prefix) != 0;
+}
+
+/* Orders the elements in preorder of the binary prefix tree, every prefix is followed by the prefixes it covers */
+static int bspl_build_elem_cmp(const void *a, const void *b)
+{
+	const struct bspl_build_elem *x = a;
+	const struct bspl_build_elem *y = b;
+	int cmp = bspl_addr_cmp(&x->prefix, &y->prefix);
+
+	if (cmp != 0)
+		return cmp;
+	if (x->len != y->len)
+		return x->len < y->len ? -1 : 1;
+	return 0;
+}
+
+static bool bspl_entry_covers(const struct bspl_entry *a, const struct bspl_entry *b)
+{
+	struct lrtr_ip_addr masked;
+
+	if (a->len > b->len)
+		return false;
+
+	masked = bspl_mask(&b->prefix, a->len);
+	return bspl_addr_cmp(&a->prefix, &masked) == 0;
+}
+
+/**
+ * @brief Returns the lengths at which the binary search for a prefix of length @p len hits a marker.
+ * @param[in] bspl Structure with initialized lens.
+ * @param[in] len Length of the prefix, must be part of lens.
+ * @param[out] markers Array with at least BSPL_MAX_MARKERS elements.
+ * @return Number of marker lengths.
+ */
+static unsigned int bspl_marker_lens(const struct bspl *bspl, const uint8_t len, uint8_t *markers)
+{
+	int lo = 0;
+	int hi = bspl->lens_len - 1;
+	unsigned int count = 0;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+
+		if (bspl->lens[mid] == len)
+			break;
+
+		if (bspl->lens[mid] < len) {
+			markers[count++] = bspl->lens[mid];
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Merges sorted elements with the same prefix and length into entries.
+ * @return 0 On success, -1 on error.
+ */
+static int bspl_create_entries(struct bspl *bspl, const struct bspl_build_elem *elems, const unsigned int elems_len,
+			       const unsigned int data_len)
+{
+	unsigned int data_pos = 0;
+
+	bspl->entries = lrtr_malloc(sizeof(*bspl->entries) * (elems_len > 0 ? elems_len : 1));
+	bspl->data = lrtr_malloc(sizeof(*bspl->data) * (data_len > 0 ? data_len : 1));
+	if (!bspl->entries || !bspl->data)
+		return -1;
+
+	for (unsigned int i = 0; i < elems_len; i++) {
+		struct bspl_entry *entry;
+
+		if (i == 0 || bspl_build_elem_cmp(&elems[i - 1], &elems[i]) != 0) {
+			entry = &bspl->entries[bspl->entries_len++];
+			entry->prefix = elems[i].prefix;
+			entry->len = elems[i].len;
+			entry->data = &bspl->data[data_pos];
+			entry->data_len = 0;
+		} else {
+			entry = &bspl->entries[bspl->entries_len - 1];
+		}
+
+		if (!elems[i].marker) {
+			bspl->data[data_pos++] = elems[i].data;
+			entry->data_len++;
+		}
+	}
+
+	for (unsigned int i = 0; i < bspl->entries_len; i++) {
+		if (bspl->entries[i].data_len == 0)
+			bspl->entries[i].data = NULL;
+	}
+	return 0;
+}
+
+/* Sets bmp and parent of all entries with a single pass over the entries in preorder */
+static void bspl_link_entries(struct bspl *bspl)
+{
+	const struct bspl_entry *stack[129];
+	unsigned int depth = 0;
+
+	for (unsigned int i = 0; i < bspl->entries_len; i++) {
+		struct bspl_entry *entry = &bspl->entries[i];
+
+		while (depth > 0 && !bspl_entry_covers(stack[depth - 1], entry))
+			depth--;
+
+		entry->parent = depth > 0 ? stack[depth - 1] : NULL;
+		if (entry->data_len > 0) {
+			entry->bmp = entry;
+			stack[depth++] = entry;
+		} else {
+			entry->bmp = entry->parent;
+		}
+	}
+}
+
+struct bspl *bspl_build(const struct bspl_prefix *prefixes, const unsigned int prefixes_len)
+{
+	bool seen[129] = {false};
+	struct bspl_build_elem *elems;
+	unsigned int elems_len = 0;
+	struct bspl *bspl = lrtr_calloc(1, sizeof(*bspl));
+
+	if (!bspl)
+		return NULL;
+	tommy_hashlin_init(&bspl->hashtable);
+
+	for (unsigned int i = 0; i < prefixes_len; i++)
+		seen[prefixes[i].len] = true;
+	for (unsigned int len = 0; len < 129; len++) {
+		if (seen[len])
+			bspl->lens[bspl->lens_len++] = len;
+	}
+
+	elems = lrtr_malloc(sizeof(*elems) * (prefixes_len * (BSPL_MAX_MARKERS + 1) + 1));
+	if (!elems)
+		goto err;
+
+	for (unsigned int i = 0; i < prefixes_len; i++) {
+		uint8_t markers[BSPL_MAX_MARKERS];
+		unsigned int markers_len = bspl_marker_lens(bspl, prefixes[i].len, markers);
+
+		elems[elems_len].prefix = bspl_mask(&prefixes[i].prefix, prefixes[i].len);
+		elems[elems_len].len = prefixes[i].len;
+		elems[elems_len].marker = false;
+		elems[elems_len].data = prefixes[i].data;
+		elems_len++;
+
+		for (unsigned int j = 0; j < markers_len; j++) {
+			elems[elems_len].prefix = bspl_mask(&prefixes[i].prefix, markers[j]);
+			elems[elems_len].len = markers[j];
+			elems[elems_len].marker = true;
+			elems[elems_len].data = NULL;
+			elems_len++;
+		}
+	}
+
+	qsort(elems, elems_len, sizeof(*elems), bspl_build_elem_cmp);
+	if (bspl_create_entries(bspl, elems, elems_len, prefixes_len) != 0) {
+		lrtr_free(elems);
+		goto err;
+	}
+	lrtr_free(elems);
+
+	bspl_link_entries(bspl);
+
+	for (unsigned int i = 0; i < bspl->entries_len; i++) {
+		struct bspl_entry *entry = &bspl->entries[i];
+
+		tommy_hashlin_insert(&bspl->hashtable, &entry->hash_node, entry, bspl_hash(&entry->prefix, entry->len));
+	}
+	return bspl;
+
+err:
+	bspl_free(bspl);
+	return NULL;
+}
+
+void bspl_free(struct bspl *bspl)
+{
+	if (!bspl)
+		return;
+
+	tommy_hashlin_done(&bspl->hashtable);
+	lrtr_free(bspl->entries);
+	lrtr_free(bspl->data);
+	lrtr_free(bspl);
+}
+
+const struct bspl_entry *bspl_lookup(const struct bspl *bspl, const struct lrtr_ip_addr *prefix,
+				     const uint8_t prefix_len)
+{
+	const struct bspl_entry *best = NULL;
+	int lo = 0;
+	int hi = bspl->lens_len - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		struct bspl_entry key;
+		const struct bspl_entry *entry;
+
+		// entries longer than the looked up prefix never cover it, the search continues with shorter lengths
+		if (bspl->lens[mid] > prefix_len) {
+			hi = mid - 1;
+			continue;
+		}
+
+		key.prefix = bspl_mask(prefix, bspl->lens[mid]);
+		key.len = bspl->lens[mid];
+		entry = tommy_hashlin_search((tommy_hashlin *)&bspl->hashtable, bspl_entry_cmp, &key,
+					     bspl_hash(&key.prefix, key.len));
+		if (entry) {
+			best = entry;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	// a marker leads the search to longer lengths, its bmp is the longest prefix that covers it
+	return best ? best->bmp : NULL;
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_bspl_h Binary search on prefix lengths
+ * @ingroup mod_pfx_h
+ * @brief Longest prefix lookup by binary search over the distinct prefix lengths of a set of prefixes.
+ * @details Every prefix is stored in a hash table keyed by the masked prefix and its length. Markers are added
+ * for the shorter lengths that the binary search visits on its way to a prefix, and every entry knows the longest
+ * prefix covering it. A lookup needs at most log2(number of distinct lengths) + 1 hash probes.\n
+ * The structure is immutable, it is built at once from a list of prefixes.
+ * @{
+ */
+
+#ifndef RTR_BSPL_PRIVATE_H
+#define RTR_BSPL_PRIVATE_H
+
+#include "rtrlib/lib/ip.h"
+
+#include "third-party/tommyds/tommyhashlin.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Prefix that is passed to bspl_build().
+ * @param prefix Prefix, the bits behind len are ignored.
+ * @param len Prefix length.
+ * @param data Pointer that is returned by lookups covered by the prefix.
+ */
+struct bspl_prefix {
+	struct lrtr_ip_addr prefix;
+	uint8_t len;
+	void *data;
+};
+
+/**
+ * @brief Entry of a bspl.
+ * @param prefix Masked prefix of the entry.
+ * @param len Prefix length of the entry.
+ * @param data Data pointers of all prefixes passed to bspl_build() with this masked prefix and length, NULL for
+ * markers.
+ * @param data_len Number of elements in data, 0 for markers.
+ * @param bmp Longest entry with data that covers this entry, the entry itself if it has data.
+ * @param parent Longest entry with data that covers this entry and is shorter than this entry.
+ */
+struct bspl_entry {
+	struct lrtr_ip_addr prefix;
+	uint8_t len;
+	void **data;
+	unsigned int data_len;
+	const struct bspl_entry *bmp;
+	const struct bspl_entry *parent;
+	tommy_node hash_node;
+};
+
+/**
+ * @brief Lookup structure for the prefixes of one IP version.
+ * @param entries Prefixes and markers, sorted in preorder of the binary prefix tree.
+ * @param entries_len Number of elements in entries.
+ * @param data Storage of the data pointers of the entries.
+ * @param lens Distinct prefix lengths in ascending order.
+ * @param lens_len Number of elements in lens.
+ * @param hashtable Hash table over the entries.
+ */
+struct bspl {
+	struct bspl_entry *entries;
+	unsigned int entries_len;
+	void **data;
+	uint8_t lens[129];
+	unsigned int lens_len;
+	tommy_hashlin hashtable;
+};
+
+/**
+ * @brief Builds the lookup structure for a set of prefixes of the same IP version.
+ * @param[in] prefixes Prefixes, the array is not referenced after the function returns.
+ * @param[in] prefixes_len Number of elements in @p prefixes.
+ * @return Pointer to the structure, NULL on error.
+ */
+struct bspl *bspl_build(const struct bspl_prefix *prefixes, const unsigned int prefixes_len);
+
+/**
+ * @brief Frees a structure created by bspl_build().
+ * @param[in] bspl Structure to free, may be NULL.
+ */
+void bspl_free(struct bspl *bspl);
+
+/**
+ * @brief Returns the longest entry with data that covers @p prefix and is not longer than @p prefix_len.
+ * @details All shorter covering entries with data are reachable through the parent pointers of the result.
+ * @param[in] bspl Structure to search.
+ * @param[in] prefix Prefix to look up, must have the IP version of the structure.
+ * @param[in] prefix_len Length of @p prefix.
+ * @return Pointer to the entry, NULL if no prefix covers @p prefix.
+ */
+const struct bspl_entry *bspl_lookup(const struct bspl *bspl, const struct lrtr_ip_addr *prefix,
+				     const uint8_t prefix_len);
+
+#endif
+/** @} */
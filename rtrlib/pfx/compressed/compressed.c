@@ -0,0 +1,238 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "compressed_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/lib/ip_private.h"
+
+#include <string.h>
+
+/* Entries of one IP version that are passed to a pfx_for_each_fp, used by pfx_compressed_for_each() */
+struct pfx_compressed_visit {
+	enum lrtr_ip_version ver;
+	pfx_for_each_fp fp;
+	void *data;
+};
+
+// the digest clears the host bits and ignores the socket, it serves as hash of original and effective records
+static tommy_uint32_t pfx_compressed_hash(const struct pfx_record *record)
+{
+	return (tommy_uint32_t)pfx_record_digest(record);
+}
+
+static int pfx_compressed_cmp(const void *arg, const void *obj)
+{
+	const struct pfx_record *record = arg;
+	const struct pfx_compressed_entry *entry = obj;
+
+	return !pfx_compressed_equal(record, &entry->record) || record->socket != entry->record.socket;
+}
+
+struct pfx_compressed *pfx_compressed_new(void)
+{
+	struct pfx_compressed *compressed = lrtr_malloc(sizeof(*compressed));
+
+	if (!compressed)
+		return NULL;
+
+	tommy_hashlin_init(&compressed->records);
+	tommy_hashlin_init(&compressed->effective);
+	return compressed;
+}
+
+static void pfx_compressed_free_entry(void *obj)
+{
+	lrtr_free(obj);
+}
+
+void pfx_compressed_free(struct pfx_compressed *compressed)
+{
+	if (!compressed)
+		return;
+
+	tommy_hashlin_foreach(&compressed->records, pfx_compressed_free_entry);
+	tommy_hashlin_done(&compressed->records);
+	tommy_hashlin_done(&compressed->effective);
+	lrtr_free(compressed);
+}
+
+size_t pfx_compressed_count(struct pfx_compressed *compressed)
+{
+	return tommy_hashlin_count(&compressed->records);
+}
+
+struct pfx_compressed_entry *pfx_compressed_find(struct pfx_compressed *compressed, const struct pfx_record *record)
+{
+	return tommy_hashlin_search(&compressed->records, pfx_compressed_cmp, record, pfx_compressed_hash(record));
+}
+
+struct pfx_compressed_entry *pfx_compressed_add(struct pfx_compressed *compressed, const struct pfx_record *record)
+{
+	struct pfx_compressed_entry *entry = lrtr_calloc(1, sizeof(*entry));
+
+	if (!entry)
+		return NULL;
+
+	entry->record = *record;
+	tommy_hashlin_insert(&compressed->records, &entry->record_node, entry, pfx_compressed_hash(record));
+	return entry;
+}
+
+void pfx_compressed_remove(struct pfx_compressed *compressed, struct pfx_compressed_entry *entry)
+{
+	if (entry->attached)
+		tommy_hashlin_remove_existing(&compressed->effective, &entry->effective_node);
+	tommy_hashlin_remove_existing(&compressed->records, &entry->record_node);
+	lrtr_free(entry);
+}
+
+void pfx_compressed_attach(struct pfx_compressed *compressed, struct pfx_compressed_entry *entry,
+			   const struct pfx_record *effective, const bool structural)
+{
+	entry->effective = *effective;
+	entry->structural = structural;
+	entry->attached = true;
+	entry->next = NULL;
+	tommy_hashlin_insert(&compressed->effective, &entry->effective_node, entry, pfx_compressed_hash(effective));
+}
+
+struct pfx_compressed_entry *pfx_compressed_detach(struct pfx_compressed *compressed,
+						   const struct pfx_record *effective)
+{
+	const tommy_uint32_t hash = pfx_compressed_hash(effective);
+	struct pfx_compressed_entry *detached = NULL;
+
+	// a removal can move the nodes between buckets, so they are removed after the bucket was searched
+	for (tommy_node *node = tommy_hashlin_bucket(&compressed->effective, hash); node; node = node->next) {
+		struct pfx_compressed_entry *entry = node->data;
+
+		if (node->key == hash && pfx_compressed_equal(&entry->effective, effective)) {
+			entry->next = detached;
+			detached = entry;
+		}
+	}
+
+	for (struct pfx_compressed_entry *entry = detached; entry; entry = entry->next) {
+		tommy_hashlin_remove_existing(&compressed->effective, &entry->effective_node);
+		entry->attached = false;
+	}
+	return detached;
+}
+
+void pfx_compressed_move(struct pfx_compressed *compressed, const struct pfx_record *from,
+			 const struct pfx_record *to, const bool structural)
+{
+	struct pfx_compressed_entry *entry = pfx_compressed_detach(compressed, from);
+
+	while (entry) {
+		struct pfx_compressed_entry *next = entry->next;
+
+		pfx_compressed_attach(compressed, entry, to, structural && entry->structural);
+		entry = next;
+	}
+}
+
+void pfx_compressed_for_each_original(struct pfx_compressed *compressed, const struct pfx_record *effective,
+				      pfx_for_each_fp fp, void *data)
+{
+	const tommy_uint32_t hash = pfx_compressed_hash(effective);
+
+	for (tommy_node *node = tommy_hashlin_bucket(&compressed->effective, hash); node; node = node->next) {
+		const struct pfx_compressed_entry *entry = node->data;
+
+		if (node->key == hash && pfx_compressed_equal(&entry->effective, effective))
+			fp(&entry->record, data);
+	}
+}
+
+void pfx_compressed_for_each_socket(struct pfx_compressed *compressed, const struct pfx_record *record,
+				    pfx_for_each_fp fp, void *data)
+{
+	const tommy_uint32_t hash = pfx_compressed_hash(record);
+
+	for (tommy_node *node = tommy_hashlin_bucket(&compressed->records, hash); node; node = node->next) {
+		const struct pfx_compressed_entry *entry = node->data;
+
+		if (node->key == hash && pfx_compressed_equal(&entry->record, record))
+			fp(&entry->record, data);
+	}
+}
+
+static void pfx_compressed_visit(void *arg, void *obj)
+{
+	const struct pfx_compressed_visit *visit = arg;
+	const struct pfx_compressed_entry *entry = obj;
+
+	if (entry->record.prefix.ver == visit->ver)
+		visit->fp(&entry->record, visit->data);
+}
+
+void pfx_compressed_for_each(struct pfx_compressed *compressed, const enum lrtr_ip_version ver, pfx_for_each_fp fp,
+			     void *data)
+{
+	struct pfx_compressed_visit visit = {ver, fp, data};
+
+	tommy_hashlin_foreach_arg(&compressed->records, pfx_compressed_visit, &visit);
+}
+
+struct lrtr_ip_addr pfx_compressed_mask(const struct lrtr_ip_addr *prefix, const uint8_t len)
+{
+	struct lrtr_ip_addr masked;
+
+	// lrtr_ip_addr_get_bits() needs at least one bit
+	if (len > 0)
+		return lrtr_ip_addr_get_bits(prefix, 0, len);
+
+	memset(&masked, 0, sizeof(masked));
+	masked.ver = prefix->ver;
+	return masked;
+}
+
+struct lrtr_ip_addr pfx_compressed_flip(const struct lrtr_ip_addr *prefix, const uint8_t bit)
+{
+	struct lrtr_ip_addr flipped = *prefix;
+
+	if (flipped.ver == LRTR_IPV4)
+		flipped.u.addr4.addr ^= UINT32_C(1) << (31 - bit);
+	else
+		flipped.u.addr6.addr[bit / 32] ^= UINT32_C(1) << (31 - bit % 32);
+	return flipped;
+}
+
+struct pfx_record pfx_compressed_effective(const struct pfx_record *record)
+{
+	struct pfx_record effective = *record;
+
+	effective.prefix = pfx_compressed_mask(&record->prefix, record->min_len);
+	effective.socket = NULL;
+	return effective;
+}
+
+bool pfx_compressed_covers(const struct lrtr_ip_addr *prefix, const uint8_t prefix_len,
+			   const struct lrtr_ip_addr *inner, const uint8_t inner_len)
+{
+	return prefix->ver == inner->ver && prefix_len <= inner_len &&
+	       lrtr_ip_addr_equal(pfx_compressed_mask(prefix, prefix_len), pfx_compressed_mask(inner, prefix_len));
+}
+
+bool pfx_compressed_subsumes(const struct pfx_record *outer, const struct pfx_record *inner)
+{
+	if (!pfx_compressed_covers(&outer->prefix, outer->min_len, &inner->prefix, inner->min_len))
+		return false;
+
+	// a record of AS 0 only makes the routes it covers invalid
+	return inner->asn == 0 || (outer->asn == inner->asn && outer->max_len >= inner->max_len);
+}
+
+bool pfx_compressed_equal(const struct pfx_record *a, const struct pfx_record *b)
+{
+	return a->asn == b->asn && a->min_len == b->min_len && a->max_len == b->max_len &&
+	       lrtr_ip_addr_equal(a->prefix, b->prefix);
+}
@@ -0,0 +1,182 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_compressed_h Compressed record storage
+ * @ingroup mod_pfx_h
+ * @brief Original records of a pfx_table whose tries hold a smaller, equivalent set of records.
+ * @details With PFX_STORAGE_COMPRESSED, the tries hold effective records without a socket. Every original record
+ * is assigned to the effective record that represents it. The originals of an effective record that it was
+ * derived from are structural, together they give the same validation results as the effective record. All other
+ * originals of an effective record are subsumed by it, removing them does not change the effective record.
+ * @{
+ */
+
+#ifndef RTR_COMPRESSED_PRIVATE_H
+#define RTR_COMPRESSED_PRIVATE_H
+
+#include "rtrlib/pfx/pfx.h"
+
+#include "third-party/tommyds/tommyhashlin.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief An original record and the effective record it is assigned to.
+ * @param record Original record.
+ * @param effective Effective record of the tries, only valid if attached is true.
+ * @param structural True if the effective record was derived from this record.
+ * @param attached True if the record is assigned to an effective record.
+ * @param next Next record of a list returned by pfx_compressed_detach().
+ */
+struct pfx_compressed_entry {
+	struct pfx_record record;
+	struct pfx_record effective;
+	bool structural;
+	bool attached;
+	struct pfx_compressed_entry *next;
+	tommy_node record_node;
+	tommy_node effective_node;
+};
+
+/**
+ * @brief Original records of a pfx_table.
+ * @param records Entries by their original record, the socket is not part of the hash.
+ * @param effective Attached entries by their effective record.
+ */
+struct pfx_compressed {
+	tommy_hashlin records;
+	tommy_hashlin effective;
+};
+
+/**
+ * @brief Allocates an empty store.
+ * @return Pointer to the store, NULL on error.
+ */
+struct pfx_compressed *pfx_compressed_new(void);
+
+/**
+ * @brief Frees a store and all of its entries.
+ * @param[in] compressed Store, may be NULL.
+ */
+void pfx_compressed_free(struct pfx_compressed *compressed);
+
+/**
+ * @brief Returns the number of original records of a store.
+ */
+size_t pfx_compressed_count(struct pfx_compressed *compressed);
+
+/**
+ * @brief Searches the entry of an original record, including its socket.
+ * @return Pointer to the entry, NULL if the store does not hold the record.
+ */
+struct pfx_compressed_entry *pfx_compressed_find(struct pfx_compressed *compressed, const struct pfx_record *record);
+
+/**
+ * @brief Adds an original record that is not attached to an effective record yet.
+ * @return Pointer to the new entry, NULL on error.
+ */
+struct pfx_compressed_entry *pfx_compressed_add(struct pfx_compressed *compressed, const struct pfx_record *record);
+
+/**
+ * @brief Removes an entry from the store and frees it.
+ * @param[in] compressed Store to use.
+ * @param[in] entry Entry to remove, attached or not.
+ */
+void pfx_compressed_remove(struct pfx_compressed *compressed, struct pfx_compressed_entry *entry);
+
+/**
+ * @brief Assigns a detached entry to an effective record.
+ * @param[in] compressed Store to use.
+ * @param[in] entry Entry to attach.
+ * @param[in] effective Effective record of the tries.
+ * @param[in] structural True if @p effective was derived from the record of @p entry.
+ */
+void pfx_compressed_attach(struct pfx_compressed *compressed, struct pfx_compressed_entry *entry,
+			   const struct pfx_record *effective, const bool structural);
+
+/**
+ * @brief Detaches all entries of an effective record.
+ * @param[in] compressed Store to use.
+ * @param[in] effective Effective record.
+ * @return List of the detached entries linked by their next pointer, NULL if no entry was attached.
+ */
+struct pfx_compressed_entry *pfx_compressed_detach(struct pfx_compressed *compressed,
+						   const struct pfx_record *effective);
+
+/**
+ * @brief Assigns all entries of an effective record to another one.
+ * @param[in] compressed Store to use.
+ * @param[in] from Effective record whose entries are moved.
+ * @param[in] to Effective record the entries are attached to.
+ * @param[in] structural False if the entries become subsumed records of @p to, true to keep their state.
+ */
+void pfx_compressed_move(struct pfx_compressed *compressed, const struct pfx_record *from,
+			 const struct pfx_record *to, const bool structural);
+
+/**
+ * @brief Calls @p fp for every original record of an effective record.
+ */
+void pfx_compressed_for_each_original(struct pfx_compressed *compressed, const struct pfx_record *effective,
+				      pfx_for_each_fp fp, void *data);
+
+/**
+ * @brief Calls @p fp for every original record with the prefix, prefix lengths and origin AS of @p record,
+ * regardless of its socket.
+ */
+void pfx_compressed_for_each_socket(struct pfx_compressed *compressed, const struct pfx_record *record,
+				    pfx_for_each_fp fp, void *data);
+
+/**
+ * @brief Calls @p fp for every original record of an IP version, the order is unspecified.
+ */
+void pfx_compressed_for_each(struct pfx_compressed *compressed, const enum lrtr_ip_version ver,
+			     pfx_for_each_fp fp, void *data);
+
+/**
+ * @brief Returns the effective record that represents a record on its own.
+ * @details The host bits of the prefix are cleared and the socket is removed.
+ */
+struct pfx_record pfx_compressed_effective(const struct pfx_record *record);
+
+/**
+ * @brief Checks if a record does not change any validation result of a set that holds another record.
+ * @details This is the case if @p outer covers the prefix of @p inner and either matches every route @p inner
+ * matches, or @p inner has origin AS 0 and never matches.
+ * @param[in] outer Record that is part of the set.
+ * @param[in] inner Record to check.
+ * @return true If @p outer subsumes @p inner.
+ */
+bool pfx_compressed_subsumes(const struct pfx_record *outer, const struct pfx_record *inner);
+
+/**
+ * @brief Checks if a prefix covers another one.
+ * @return true If @p prefix_len is at most @p inner_len and the first @p prefix_len bits of both are equal.
+ */
+bool pfx_compressed_covers(const struct lrtr_ip_addr *prefix, const uint8_t prefix_len,
+			   const struct lrtr_ip_addr *inner, const uint8_t inner_len);
+
+/**
+ * @brief Returns the prefix with all bits after the first @p len bits cleared.
+ */
+struct lrtr_ip_addr pfx_compressed_mask(const struct lrtr_ip_addr *prefix, const uint8_t len);
+
+/**
+ * @brief Returns the prefix with bit @p bit inverted, e.g. the sibling of a prefix of length bit + 1.
+ */
+struct lrtr_ip_addr pfx_compressed_flip(const struct lrtr_ip_addr *prefix, const uint8_t bit);
+
+/**
+ * @brief Checks if two records have the same prefix, prefix lengths and origin AS, the sockets are ignored.
+ */
+bool pfx_compressed_equal(const struct pfx_record *a, const struct pfx_record *b);
+
+#endif
+/** @} */
@@ -0,0 +1,433 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "frozen_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PFX_FROZEN_NONE UINT32_MAX
+
+/* IPv4 addresses are stored in lo, IPv6 addresses use both halves */
+struct pfx_frozen_key {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+struct pfx_frozen_vrp {
+	uint32_t asn;
+	uint8_t max_len;
+	const struct rtr_socket *socket;
+};
+
+struct pfx_frozen_prefix {
+	struct lrtr_ip_addr prefix;
+	struct pfx_frozen_key start;
+	uint32_t parent;
+	uint32_t vrps;
+	uint32_t vrps_len;
+	uint8_t len;
+};
+
+/**
+ * @brief Frozen index of one IP version.
+ * @param ends Inclusive upper ends of the intervals in Eytzinger order, starting at index 1.
+ * @param deepest Index of the longest prefix covering the interval with the same position in ends.
+ * @param intervals_len Number of intervals.
+ * @param prefixes Prefixes in preorder of the binary prefix tree.
+ * @param prefixes_len Number of prefixes.
+ */
+struct pfx_frozen_af {
+	struct pfx_frozen_key *ends;
+	uint32_t *deepest;
+	unsigned int intervals_len;
+	struct pfx_frozen_prefix *prefixes;
+	unsigned int prefixes_len;
+};
+
+struct pfx_frozen {
+	struct pfx_frozen_af ipv4;
+	struct pfx_frozen_af ipv6;
+	struct pfx_frozen_vrp *vrps;
+};
+
+struct pfx_frozen_boundary {
+	struct pfx_frozen_key start;
+	uint32_t deepest;
+};
+
+static struct pfx_frozen_key pfx_frozen_addr_to_key(const struct lrtr_ip_addr *addr)
+{
+	struct pfx_frozen_key key;
+
+	if (addr->ver == LRTR_IPV4) {
+		key.hi = 0;
+		key.lo = addr->u.addr4.addr;
+	} else {
+		key.hi = (uint64_t)addr->u.addr6.addr[0] << 32 | addr->u.addr6.addr[1];
+		key.lo = (uint64_t)addr->u.addr6.addr[2] << 32 | addr->u.addr6.addr[3];
+	}
+	return key;
+}
+
+static int pfx_frozen_key_cmp(const struct pfx_frozen_key *a, const struct pfx_frozen_key *b)
+{
+	if (a->hi != b->hi)
+		return a->hi < b->hi ? -1 : 1;
+	if (a->lo != b->lo)
+		return a->lo < b->lo ? -1 : 1;
+	return 0;
+}
+
+/* Returns the mask of the network bits of a prefix length */
+static struct pfx_frozen_key pfx_frozen_netmask(const enum lrtr_ip_version ver, const uint8_t len)
+{
+	struct pfx_frozen_key mask;
+
+	if (ver == LRTR_IPV4) {
+		mask.hi = 0;
+		mask.lo = len == 0 ? 0 : (UINT32_MAX << (32 - len)) & UINT32_MAX;
+	} else if (len <= 64) {
+		mask.hi = len == 0 ? 0 : UINT64_MAX << (64 - len);
+		mask.lo = 0;
+	} else {
+		mask.hi = UINT64_MAX;
+		mask.lo = UINT64_MAX << (128 - len);
+	}
+	return mask;
+}
+
+static struct pfx_frozen_key pfx_frozen_first(const struct pfx_frozen_key *key, const enum lrtr_ip_version ver,
+					      const uint8_t len)
+{
+	struct pfx_frozen_key mask = pfx_frozen_netmask(ver, len);
+	struct pfx_frozen_key first = {key->hi & mask.hi, key->lo & mask.lo};
+
+	return first;
+}
+
+static struct pfx_frozen_key pfx_frozen_last(const struct pfx_frozen_key *key, const enum lrtr_ip_version ver,
+					     const uint8_t len)
+{
+	struct pfx_frozen_key mask = pfx_frozen_netmask(ver, len);
+	struct pfx_frozen_key last = {key->hi | ~mask.hi, key->lo | ~mask.lo};
+
+	if (ver == LRTR_IPV4) {
+		last.hi = 0;
+		last.lo &= UINT32_MAX;
+	}
+	return last;
+}
+
+/* Increments a key, returns false if the key is the last address of the IP version */
+static bool pfx_frozen_key_inc(struct pfx_frozen_key *key, const enum lrtr_ip_version ver)
+{
+	if (ver == LRTR_IPV4) {
+		if (key->lo == UINT32_MAX)
+			return false;
+		key->lo++;
+		return true;
+	}
+
+	if (key->lo != UINT64_MAX) {
+		key->lo++;
+		return true;
+	}
+	if (key->hi == UINT64_MAX)
+		return false;
+	key->hi++;
+	key->lo = 0;
+	return true;
+}
+
+static bool pfx_frozen_covers(const struct pfx_frozen_prefix *a, const struct pfx_frozen_prefix *b)
+{
+	struct pfx_frozen_key first;
+
+	if (a->len > b->len)
+		return false;
+
+	first = pfx_frozen_first(&b->start, b->prefix.ver, a->len);
+	return pfx_frozen_key_cmp(&first, &a->start) == 0;
+}
+
+/* Orders prefixes in preorder of the binary prefix tree, prefixes with the same network keep their order */
+static int pfx_frozen_prefix_cmp(const void *a, const void *b)
+{
+	const struct pfx_frozen_prefix *x = a;
+	const struct pfx_frozen_prefix *y = b;
+	int cmp = pfx_frozen_key_cmp(&x->start, &y->start);
+
+	if (cmp != 0)
+		return cmp;
+	if (x->len != y->len)
+		return x->len < y->len ? -1 : 1;
+	if (x->vrps != y->vrps)
+		return x->vrps < y->vrps ? -1 : 1;
+	return 0;
+}
+
+static void pfx_frozen_add_boundary(struct pfx_frozen_boundary *boundaries, unsigned int *boundaries_len,
+				    const struct pfx_frozen_key *start, const uint32_t deepest)
+{
+	// a later boundary with the same start describes the interval more precisely
+	if (*boundaries_len > 0 && pfx_frozen_key_cmp(&boundaries[*boundaries_len - 1].start, start) == 0) {
+		boundaries[*boundaries_len - 1].deepest = deepest;
+		return;
+	}
+
+	boundaries[*boundaries_len].start = *start;
+	boundaries[*boundaries_len].deepest = deepest;
+	(*boundaries_len)++;
+}
+
+static unsigned int pfx_frozen_eytzinger(struct pfx_frozen_af *af, const struct pfx_frozen_key *ends,
+					 const uint32_t *deepest, unsigned int i, const unsigned int k)
+{
+	if (k <= af->intervals_len) {
+		i = pfx_frozen_eytzinger(af, ends, deepest, i, 2 * k);
+		af->ends[k] = ends[i];
+		af->deepest[k] = deepest[i];
+		i++;
+		i = pfx_frozen_eytzinger(af, ends, deepest, i, 2 * k + 1);
+	}
+	return i;
+}
+
+/**
+ * @brief Sorts the prefixes of an IP version, links them to their covering prefixes and creates the intervals.
+ * @return 0 On success, -1 on error.
+ */
+static int pfx_frozen_af_build(struct pfx_frozen_af *af, const enum lrtr_ip_version ver)
+{
+	struct pfx_frozen_boundary *boundaries = NULL;
+	unsigned int boundaries_len = 0;
+	uint32_t *stack = NULL;
+	unsigned int depth = 0;
+	struct pfx_frozen_key *ends = NULL;
+	uint32_t *deepest = NULL;
+	struct pfx_frozen_key zero = {0, 0};
+	int rtval = -1;
+
+	qsort(af->prefixes, af->prefixes_len, sizeof(*af->prefixes), pfx_frozen_prefix_cmp);
+
+	boundaries = lrtr_malloc(sizeof(*boundaries) * (2 * af->prefixes_len + 1));
+	stack = lrtr_malloc(sizeof(*stack) * (af->prefixes_len + 1));
+	if (!boundaries || !stack)
+		goto out;
+
+	pfx_frozen_add_boundary(boundaries, &boundaries_len, &zero, PFX_FROZEN_NONE);
+	for (unsigned int i = 0; i <= af->prefixes_len; i++) {
+		// all prefixes that do not cover the next prefix end before it, after the last prefix all end
+		while (depth > 0) {
+			struct pfx_frozen_prefix *ended = &af->prefixes[stack[depth - 1]];
+			struct pfx_frozen_key next;
+
+			if (i < af->prefixes_len && pfx_frozen_covers(ended, &af->prefixes[i]))
+				break;
+
+			depth--;
+			next = pfx_frozen_last(&ended->start, ver, ended->len);
+
+			if (pfx_frozen_key_inc(&next, ver))
+				pfx_frozen_add_boundary(boundaries, &boundaries_len, &next,
+							depth > 0 ? stack[depth - 1] : PFX_FROZEN_NONE);
+		}
+		if (i == af->prefixes_len)
+			break;
+
+		af->prefixes[i].parent = depth > 0 ? stack[depth - 1] : PFX_FROZEN_NONE;
+		pfx_frozen_add_boundary(boundaries, &boundaries_len, &af->prefixes[i].start, i);
+		stack[depth++] = i;
+	}
+
+	af->intervals_len = boundaries_len;
+	ends = lrtr_malloc(sizeof(*ends) * boundaries_len);
+	deepest = lrtr_malloc(sizeof(*deepest) * boundaries_len);
+	af->ends = lrtr_malloc(sizeof(*af->ends) * (boundaries_len + 1));
+	af->deepest = lrtr_malloc(sizeof(*af->deepest) * (boundaries_len + 1));
+	if (!ends || !deepest || !af->ends || !af->deepest)
+		goto out;
+
+	for (unsigned int i = 0; i < boundaries_len; i++) {
+		if (i + 1 < boundaries_len) {
+			ends[i] = boundaries[i + 1].start;
+			if (ends[i].lo-- == 0)
+				ends[i].hi--;
+		} else {
+			ends[i] = pfx_frozen_last(&zero, ver, 0);
+		}
+		deepest[i] = boundaries[i].deepest;
+	}
+	pfx_frozen_eytzinger(af, ends, deepest, 0, 1);
+	rtval = 0;
+
+out:
+	lrtr_free(boundaries);
+	lrtr_free(stack);
+	lrtr_free(ends);
+	lrtr_free(deepest);
+	return rtval;
+}
+
+struct pfx_frozen *pfx_frozen_build(const struct pfx_record *records, const unsigned int records_len)
+{
+	struct pfx_frozen *frozen = lrtr_calloc(1, sizeof(*frozen));
+
+	if (!frozen)
+		return NULL;
+
+	frozen->vrps = lrtr_malloc(sizeof(*frozen->vrps) * (records_len + 1));
+	frozen->ipv4.prefixes = lrtr_malloc(sizeof(*frozen->ipv4.prefixes) * (records_len + 1));
+	frozen->ipv6.prefixes = lrtr_malloc(sizeof(*frozen->ipv6.prefixes) * (records_len + 1));
+	if (!frozen->vrps || !frozen->ipv4.prefixes || !frozen->ipv6.prefixes)
+		goto err;
+
+	for (unsigned int i = 0; i < records_len; i++) {
+		const struct pfx_record *record = &records[i];
+		struct pfx_frozen_af *af = record->prefix.ver == LRTR_IPV4 ? &frozen->ipv4 : &frozen->ipv6;
+
+		if (i == 0 || records[i - 1].min_len != record->min_len ||
+		    !lrtr_ip_addr_equal(records[i - 1].prefix, record->prefix)) {
+			struct pfx_frozen_prefix *prefix = &af->prefixes[af->prefixes_len++];
+			struct pfx_frozen_key key = pfx_frozen_addr_to_key(&record->prefix);
+
+			prefix->prefix = record->prefix;
+			prefix->start = pfx_frozen_first(&key, record->prefix.ver, record->min_len);
+			prefix->len = record->min_len;
+			prefix->vrps = i;
+			prefix->vrps_len = 0;
+		}
+
+		af->prefixes[af->prefixes_len - 1].vrps_len++;
+		frozen->vrps[i].asn = record->asn;
+		frozen->vrps[i].max_len = record->max_len;
+		frozen->vrps[i].socket = record->socket;
+	}
+
+	if (pfx_frozen_af_build(&frozen->ipv4, LRTR_IPV4) != 0 || pfx_frozen_af_build(&frozen->ipv6, LRTR_IPV6) != 0)
+		goto err;
+
+	return frozen;
+
+err:
+	pfx_frozen_free(frozen);
+	return NULL;
+}
+
+void pfx_frozen_free(struct pfx_frozen *frozen)
+{
+	if (!frozen)
+		return;
+
+	for (unsigned int i = 0; i < 2; i++) {
+		struct pfx_frozen_af *af = i == 0 ? &frozen->ipv4 : &frozen->ipv6;
+
+		lrtr_free(af->ends);
+		lrtr_free(af->deepest);
+		lrtr_free(af->prefixes);
+	}
+	lrtr_free(frozen->vrps);
+	lrtr_free(frozen);
+}
+
+static int pfx_frozen_append_reason(const struct pfx_frozen *frozen, const struct pfx_frozen_prefix *prefix,
+				    struct pfx_record **reason, unsigned int *reason_len)
+{
+	struct pfx_record *tmp = lrtr_realloc(*reason, (*reason_len + prefix->vrps_len) * sizeof(struct pfx_record));
+
+	if (!tmp)
+		return PFX_ERROR;
+
+	*reason = tmp;
+	for (unsigned int i = 0; i < prefix->vrps_len; i++) {
+		const struct pfx_frozen_vrp *vrp = &frozen->vrps[prefix->vrps + i];
+		struct pfx_record *record = &(*reason)[*reason_len + i];
+
+		record->asn = vrp->asn;
+		record->prefix = prefix->prefix;
+		record->min_len = prefix->len;
+		record->max_len = vrp->max_len;
+		record->socket = vrp->socket;
+	}
+	*reason_len += prefix->vrps_len;
+	return PFX_SUCCESS;
+}
+
+int pfx_frozen_validate(const struct pfx_frozen *frozen, struct pfx_record **reason, unsigned int *reason_len,
+			const uint32_t asn, const struct lrtr_ip_addr *prefix, const uint8_t prefix_len,
+			enum pfxv_state *result)
+{
+	const struct pfx_frozen_af *af = prefix->ver == LRTR_IPV4 ? &frozen->ipv4 : &frozen->ipv6;
+	struct pfx_frozen_key key = pfx_frozen_addr_to_key(prefix);
+	unsigned int covering_len = 0;
+	unsigned int k = 1;
+	uint32_t deepest;
+
+	// Eytzinger lower bound, the interval with the first end that is not smaller than the address
+	while (k <= af->intervals_len)
+		k = 2 * k + (pfx_frozen_key_cmp(&af->ends[k], &key) < 0);
+	k >>= __builtin_ffs(~k);
+
+	deepest = k > 0 ? af->deepest[k] : PFX_FROZEN_NONE;
+	while (deepest != PFX_FROZEN_NONE && af->prefixes[deepest].len > prefix_len)
+		deepest = af->prefixes[deepest].parent;
+
+	for (uint32_t i = deepest; i != PFX_FROZEN_NONE; i = af->prefixes[i].parent)
+		covering_len++;
+
+	if (covering_len == 0) {
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		if (reason) {
+			lrtr_free(*reason);
+			*reason = NULL;
+		}
+		if (reason_len)
+			*reason_len = 0;
+		return PFX_SUCCESS;
+	}
+
+	if (reason_len && reason)
+		*reason_len = 0;
+
+	// the covering prefixes are checked from the shortest to the longest one, like the trie does
+	while (covering_len > 0) {
+		uint32_t current = deepest;
+		const struct pfx_frozen_prefix *covering;
+
+		covering_len--;
+		for (unsigned int i = 0; i < covering_len; i++)
+			current = af->prefixes[current].parent;
+		covering = &af->prefixes[current];
+
+		if (reason_len && reason) {
+			if (pfx_frozen_append_reason(frozen, covering, reason, reason_len) != PFX_SUCCESS) {
+				lrtr_free(*reason);
+				*reason = NULL;
+				*reason_len = 0;
+				return PFX_ERROR;
+			}
+		}
+
+		for (unsigned int i = 0; i < covering->vrps_len; i++) {
+			const struct pfx_frozen_vrp *vrp = &frozen->vrps[covering->vrps + i];
+
+			if (vrp->asn != 0 && vrp->asn == asn && prefix_len <= vrp->max_len) {
+				*result = BGP_PFXV_STATE_VALID;
+				return PFX_SUCCESS;
+			}
+		}
+	}
+
+	*result = BGP_PFXV_STATE_INVALID;
+	return PFX_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_frozen_h Frozen validation index
+ * @ingroup mod_pfx_h
+ * @brief Immutable copy of the records of a pfx_table that is optimized for validation.
+ * @details The address space of each IP version is split into intervals in which the set of covering prefixes
+ * does not change. The ends of the intervals are stored in Eytzinger (breadth first) order, so the binary search
+ * that finds the interval of an address touches the same few cache lines at the top of the array for every
+ * lookup. Every interval references the longest prefix that covers it, prefixes reference their next shorter
+ * covering prefix and a range of the packed VRP array. The structure does not contain pointers besides the
+ * origin socket of the records and is never modified after it was built.
+ * @{
+ */
+
+#ifndef RTR_FROZEN_PRIVATE_H
+#define RTR_FROZEN_PRIVATE_H
+
+#include "rtrlib/pfx/pfx.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Frozen copy of the records of a pfx_table.
+ */
+struct pfx_frozen;
+
+/**
+ * @brief Builds a frozen index from a list of records.
+ * @param[in] records Records of a pfx_table, records of the same trie node must be stored consecutively.
+ * @param[in] records_len Number of elements in @p records.
+ * @return Pointer to the frozen index, NULL on error.
+ */
+struct pfx_frozen *pfx_frozen_build(const struct pfx_record *records, const unsigned int records_len);
+
+/**
+ * @brief Frees a frozen index.
+ * @param[in] frozen Frozen index, may be NULL.
+ */
+void pfx_frozen_free(struct pfx_frozen *frozen);
+
+/**
+ * @brief Validates the origin of a route like pfx_table_validate_r().
+ * @param[in] frozen Frozen index to use.
+ * @param[out] reason Pointer to a memory area that will be used as array of pfx_records, may be NULL.
+ * @param[out] reason_len Size of the array reason, may be NULL.
+ * @param[in] asn Autonomous system number of the Origin-AS of the route.
+ * @param[in] prefix Announced network Prefix.
+ * @param[in] prefix_len Length of the network mask of the announced prefix.
+ * @param[out] result Result of the validation.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_frozen_validate(const struct pfx_frozen *frozen, struct pfx_record **reason, unsigned int *reason_len,
+			const uint32_t asn, const struct lrtr_ip_addr *prefix, const uint8_t prefix_len,
+			enum pfxv_state *result);
+
+#endif
+/** @} */
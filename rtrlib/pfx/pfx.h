@@ -56,6 +56,62 @@ enum pfxv_state {
 	BGP_PFXV_STATE_INVALID
 };
 
+/**
+ * @brief Lookup engines that can be used for validation in a pfx_table.
+ */
+enum pfx_engine {
+	/** Shortest prefix first trie, the default engine. */
+	PFX_ENGINE_TRIE = 0,
+
+	/** @brief Binary search on the distinct prefix lengths over hash tables with markers.
+	 * @details Needs at most 6 hash probes for an IPv4 and 8 for an IPv6 validation. The structure is rebuilt
+	 * after prefixes were added or removed, until then validations are answered by the trie.
+	 */
+	PFX_ENGINE_BSPL
+};
+
+/**
+ * @brief Strategies to handle a trie node whose last record was removed.
+ */
+enum pfx_removal {
+	/** The node is removed from the trie right away, the default. */
+	PFX_REMOVAL_IMMEDIATE = 0,
+
+	/** @brief The node stays in the trie as a tombstone that lookups and iterations skip.
+	 * @details Removing a record costs a constant amount of work and a record that is added again reuses the
+	 * node. The tombstones are removed together by pfx_table_compact(), which runs after a synchronisation
+	 * once they make up an eighth of the nodes, and when a removal lets them make up half of the nodes.
+	 */
+	PFX_REMOVAL_DEFERRED
+};
+
+/**
+ * @brief Representations of the records of a pfx_table.
+ */
+enum pfx_storage {
+	/** Every prefix is a trie node with a heap allocated array of records, the default. */
+	PFX_STORAGE_TRIE = 0,
+
+	/** @brief Read optimized bit-packed encoding for devices with little memory.
+	 * @details The prefixes are stored grouped by length as their network bits, the records as indexes into
+	 * dictionaries of the origin ASes and sockets, which takes a few bytes per record. Records that are added
+	 * are held in the trie and removed records are marked, until they are merged into a new encoding after a
+	 * synchronisation or once they make up a quarter of the encoded records. Validations search every prefix
+	 * length that can cover the route, iterations pass the encoded records after the ones of the trie.
+	 */
+	PFX_STORAGE_SUCCINCT,
+
+	/** @brief The trie holds a reduced set of records that gives the same validation results.
+	 * @details Records that another record of the table makes redundant are not added to the trie, e.g. a
+	 * more specific prefix of the same origin AS that a maximum length already covers or any covered record of
+	 * AS 0. Two sibling prefixes of an origin AS with the same maximum length are merged with their parent
+	 * prefix. The original records are kept in a hash table, so iterations, socket removals and notifications
+	 * still see every record, and the reason of a validation lists the original records. Adding or removing a
+	 * record can restructure the trie and costs more than with PFX_STORAGE_TRIE.
+	 */
+	PFX_STORAGE_COMPRESSED
+};
+
 /**
  * @brief A function pointer that is called for each record in the pfx_table.
  * @param pfx_record
@@ -77,6 +133,91 @@ void pfx_table_init(struct pfx_table *pfx_table, pfx_update_fp update_fp);
  */
 void pfx_table_free(struct pfx_table *pfx_table);
 
+/**
+ * @brief Selects the lookup engine that is used to validate routes.
+ * @details Should be called right after pfx_table_init(). The records, their iteration order and the result
+ * of all operations are the same for all engines.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] engine Lookup engine.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_set_engine(struct pfx_table *pfx_table, enum pfx_engine engine);
+
+/**
+ * @brief Selects how trie nodes whose last record was removed are handled.
+ * @details Switching to PFX_REMOVAL_IMMEDIATE removes all tombstones. The records and the result of all
+ * operations are the same for all strategies.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] removal Removal strategy.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_set_removal(struct pfx_table *pfx_table, enum pfx_removal removal);
+
+/**
+ * @brief Selects how the records of a pfx_table are stored.
+ * @details Should be called right after pfx_table_init(). Switching to PFX_STORAGE_SUCCINCT encodes the records
+ * of the table. A table can only be switched back to PFX_STORAGE_TRIE while the encoding is empty. The succinct
+ * storage can not be combined with the PFX_ENGINE_BSPL engine or the frozen validation index. Libraries that
+ * were built with RTRLIB_PFX_SUCCINCT initialize tables with PFX_STORAGE_SUCCINCT. A table can only be switched
+ * to or from PFX_STORAGE_COMPRESSED while it is empty, it has the same restrictions as the succinct storage.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] storage Storage of the records.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error or if the storage can not be selected.
+ */
+int pfx_table_set_storage(struct pfx_table *pfx_table, enum pfx_storage storage);
+
+/**
+ * @brief Removes all tombstones that were left by the PFX_REMOVAL_DEFERRED strategy from the tries.
+ * @param[in] pfx_table pfx_table to use.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_compact(struct pfx_table *pfx_table);
+
+/**
+ * @brief Enables the frozen validation index of a pfx_table.
+ * @details The frozen index is an immutable copy of the records in a dense layout that validations read without
+ * taking the lock of the pfx_table. It is rebuilt after every successful synchronisation of a rtr_socket that
+ * uses the pfx_table, and by pfx_table_freeze(). Until the index matches the records again, validations are
+ * answered by the selected engine. Should be called right after pfx_table_init().
+ * @param[in] pfx_table pfx_table to use.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_enable_frozen_index(struct pfx_table *pfx_table);
+
+/**
+ * @brief Rebuilds the frozen validation index from the current records.
+ * @param[in] pfx_table pfx_table to use, the frozen index must be enabled.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error or if the frozen index is not enabled.
+ */
+int pfx_table_freeze(struct pfx_table *pfx_table);
+
+/**
+ * @brief Returns the digest of a pfx_record.
+ * @details The digest is computed over a canonical encoding of the record: the prefix masked to its minimum
+ * length, the minimum and maximum length and the origin AS. The socket of the record is not part of it, so
+ * digests can be compared between processes.
+ * @param[in] record pfx_record to use.
+ * @return Digest of the record.
+ */
+uint64_t pfx_record_digest(const struct pfx_record *record);
+
+/**
+ * @brief Returns the order independent digest of all records of one IP version in a pfx_table.
+ * @details The digest is the sum of pfx_record_digest() over all records modulo 2^64. It is updated on every
+ * change of the table, so comparing a table with a replica or a persisted snapshot costs O(1). A record that is
+ * stored for several sockets is counted once per socket.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] ver IP version of the records.
+ * @return Digest of the records, 0 for an empty table.
+ */
+uint64_t pfx_table_digest(struct pfx_table *pfx_table, const enum lrtr_ip_version ver);
+
 /**
  * @brief Adds a pfx_record to a pfx_table.
  * @param[in] pfx_table pfx_table to use.
@@ -156,5 +297,21 @@ void pfx_table_for_each_ipv4_record(struct pfx_table *pfx_table, pfx_for_each_fp
  */
 void pfx_table_for_each_ipv6_record(struct pfx_table *pfx_table, pfx_for_each_fp fp, void *data);
 
+/**
+ * @brief Returns a copy of all records of one IP version in the pfx_table.
+ * @details The records are in the order in which pfx_table_for_each_ipv4_record() and
+ * pfx_table_for_each_ipv6_record() pass them to the callback. Large tables are traversed by several threads, the
+ * table is locked only while the records are copied.
+ * @param[in] pfx_table
+ * @param[in] ver IP version of the records.
+ * @param[out] records Array of the records, NULL if the table holds no such record. It must be freed with free() or
+ * the function passed to lrtr_set_alloc_functions().
+ * @param[out] records_len Number of elements in @p records.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_get_records(struct pfx_table *pfx_table, const enum lrtr_ip_version ver, struct pfx_record **records,
+			  unsigned int *records_len);
+
 #endif
 /** @} */
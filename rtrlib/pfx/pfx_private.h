@@ -30,6 +30,94 @@
  */
 void pfx_table_free_without_notify(struct pfx_table *pfx_table);
 
+/**
+ * @brief Removes all records of a set of sockets while holding the write lock only once.
+ * @details Used when the sockets are replaced by other sources that already added their records to the table.
+ * The update callback is only called for VRPs that disappear from the table. No remove notification is issued
+ * for a record if a socket that is not part of @p sockets holds the same prefix, prefix lengths and origin AS.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] sockets Origin sockets whose records are removed.
+ * @param[in] sockets_len Number of elements in @p sockets.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_src_handover(struct pfx_table *pfx_table, const struct rtr_socket **sockets,
+			   const unsigned int sockets_len);
+
+/**
+ * @brief Rebuilds the frozen validation index after a synchronisation, does nothing if it is not enabled.
+ * @details Small changes are rebuilt by the calling thread, larger ones by a task of the executor.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] changes Number of records that were received during the synchronisation.
+ */
+void pfx_table_frozen_refresh(struct pfx_table *pfx_table, const unsigned int changes);
+
+/**
+ * @brief Compacts a pfx_table after a synchronisation.
+ * @details Removes the tombstones of the PFX_REMOVAL_DEFERRED strategy if they make up enough of the trie nodes.
+ * With PFX_STORAGE_SUCCINCT, the records of the trie are merged into a new encoding if enough records were added
+ * or removed since the encoding was built.
+ * @param[in] pfx_table pfx_table to use.
+ */
+void pfx_table_compact_after_sync(struct pfx_table *pfx_table);
+
+/**
+ * @brief Marks the start of an update of the records of a socket.
+ * @details The update covers the pfx_table and the spki_table of the socket. Until pfx_table_sync_end() is
+ * called, pfx_table_snapshot_begin() waits, so a reader finds the records of both tables either before or after
+ * the update. Equals pfx_table_update_begin() followed by pfx_table_commit_begin(). Must not be called twice by
+ * the same thread without calling pfx_table_sync_end().
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_sync_begin(struct pfx_table *pfx_table);
+
+/**
+ * @brief Marks the end of an update that was started with pfx_table_sync_begin().
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_sync_end(struct pfx_table *pfx_table);
+
+/**
+ * @brief Starts an update of the records of a socket without blocking the readers.
+ * @details Waits for the updates of the other sockets, so a copy of the records of the other sockets stays
+ * current until pfx_table_update_end() is called. The tables may only be changed between pfx_table_commit_begin()
+ * and pfx_table_commit_end().
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_update_begin(struct pfx_table *pfx_table);
+
+/**
+ * @brief Ends an update that was started with pfx_table_update_begin().
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_update_end(struct pfx_table *pfx_table);
+
+/**
+ * @brief Blocks the readers while an update started with pfx_table_update_begin() changes the tables.
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_commit_begin(struct pfx_table *pfx_table);
+
+/**
+ * @brief Ends the changes that were started with pfx_table_commit_begin().
+ * @param[in] pfx_table pfx_table of the socket.
+ */
+void pfx_table_commit_end(struct pfx_table *pfx_table);
+
+/**
+ * @brief Starts a series of lookups in the pfx_table and the spki_table that see a single state of both.
+ * @details Updates of sockets wait until pfx_table_snapshot_end() is called. The update callbacks run during an
+ * update, so a snapshot must not be started from within them.
+ * @param[in] pfx_table pfx_table to use.
+ */
+void pfx_table_snapshot_begin(struct pfx_table *pfx_table);
+
+/**
+ * @brief Ends a series of lookups that was started with pfx_table_snapshot_begin().
+ * @param[in] pfx_table pfx_table to use.
+ */
+void pfx_table_snapshot_end(struct pfx_table *pfx_table);
+
 /**
  * @brief Swap root nodes of the argument tables
  * @param[in,out] a First table
@@ -49,7 +137,7 @@ int pfx_table_copy_except_socket(struct pfx_table *src_table, struct pfx_table *
 
 /**
  * @brief Notify client about changes between to pfx tables regarding one specific socket
- * @details old_table will be modified it should be freed after calling this function
+ * @details None of the tables is modified, the clients of @p new_table are notified.
  * @param[in] new_table
  * @param[in] old_table
  * @param[in] socket socket which prefixes should be diffed
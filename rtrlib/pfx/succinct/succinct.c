@@ -0,0 +1,802 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "succinct_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Every PFX_SUCCINCT_SAMPLE-th first record of a prefix is sampled to select the records of a prefix */
+#define PFX_SUCCINCT_SAMPLE 64
+
+/* Network bits of a prefix, IPv4 prefixes and IPv6 prefixes up to /64 only use lo */
+struct pfx_succinct_key {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+/**
+ * @brief Succinct encoding of the records of one IP version.
+ * @param keys Network bits of the prefixes, ordered by length and value.
+ * @param key_pos Bit position of the first prefix of each length in keys.
+ * @param groups Index of the first prefix of each length, groups[l + 1] - groups[l] prefixes have length l.
+ * @param starts Bit vector over the records, set for the first record of each prefix.
+ * @param samples Index of the first record of every PFX_SUCCINCT_SAMPLE-th prefix.
+ * @param vrps Bit-packed records.
+ * @param removed Bit vector over the records, set for records that are marked as removed.
+ * @param vrps_len Number of records.
+ * @param removed_len Number of records that are marked as removed.
+ * @param max_len Number of bits of an address.
+ */
+struct pfx_succinct_af {
+	uint64_t *keys;
+	uint64_t key_pos[129];
+	uint32_t groups[130];
+	uint64_t *starts;
+	uint32_t *samples;
+	uint64_t *vrps;
+	uint64_t *removed;
+	uint32_t vrps_len;
+	uint32_t removed_len;
+	uint8_t max_len;
+};
+
+/**
+ * @brief Succinct encoding of the records of a pfx_table.
+ * @param asns Sorted origin AS numbers of the records.
+ * @param sockets Sockets of the records.
+ * @param asn_bits Bits of the index in asns of a record.
+ * @param delta_bits Bits of max_len - min_len of a record.
+ * @param socket_bits Bits of the index in sockets of a record.
+ * @param vrp_bits Bits of a record.
+ */
+struct pfx_succinct {
+	struct pfx_succinct_af ipv4;
+	struct pfx_succinct_af ipv6;
+	uint32_t *asns;
+	uint32_t asns_len;
+	const struct rtr_socket **sockets;
+	uint32_t sockets_len;
+	uint8_t asn_bits;
+	uint8_t delta_bits;
+	uint8_t socket_bits;
+	uint8_t vrp_bits;
+};
+
+/* Record of an encoding or a list of records while merging them */
+struct pfx_succinct_entry {
+	struct pfx_succinct_key key;
+	uint8_t len;
+	uint32_t asn;
+	uint8_t max_len;
+	const struct rtr_socket *socket;
+};
+
+/**
+ * @brief Reads the records of one IP version of an encoding and a sorted list in order.
+ * @param base Encoding of the IP version, NULL if it has no records.
+ * @param succinct Encoding base belongs to.
+ * @param vrp Index of the next record of base.
+ * @param prefix Index of the prefix of the next record of base.
+ * @param len Length of the prefix of the next record of base.
+ * @param key Network bits of the prefix of the next record of base.
+ * @param end Index behind the last record of the prefix of the next record of base.
+ * @param records Sorted records of the IP version that are merged with base.
+ * @param records_len Number of elements in records.
+ * @param pos Index of the next element of records.
+ */
+struct pfx_succinct_cursor {
+	const struct pfx_succinct_af *base;
+	const struct pfx_succinct *succinct;
+	uint32_t vrp;
+	uint32_t prefix;
+	uint8_t len;
+	struct pfx_succinct_key key;
+	uint32_t end;
+	const struct pfx_record *records;
+	unsigned int records_len;
+	unsigned int pos;
+};
+
+static uint64_t pfx_succinct_words(const uint64_t bits)
+{
+	return bits / 64 + 1;
+}
+
+static uint64_t pfx_succinct_get_bits(const uint64_t *words, const uint64_t pos, const unsigned int width)
+{
+	const uint64_t word = pos / 64;
+	const unsigned int shift = pos % 64;
+	uint64_t value;
+
+	if (width == 0)
+		return 0;
+
+	value = words[word] >> shift;
+	if (shift + width > 64)
+		value |= words[word + 1] << (64 - shift);
+	if (width < 64)
+		value &= (UINT64_C(1) << width) - 1;
+	return value;
+}
+
+/* The bits have to be zero before they are written */
+static void pfx_succinct_set_bits(uint64_t *words, const uint64_t pos, const unsigned int width, const uint64_t value)
+{
+	const uint64_t word = pos / 64;
+	const unsigned int shift = pos % 64;
+
+	if (width == 0)
+		return;
+
+	words[word] |= value << shift;
+	if (shift + width > 64)
+		words[word + 1] |= value >> (64 - shift);
+}
+
+static bool pfx_succinct_bit(const uint64_t *words, const uint64_t pos)
+{
+	return words[pos / 64] & (UINT64_C(1) << (pos % 64));
+}
+
+/* Returns the number of bits that are needed to store the values 0 to values - 1 */
+static uint8_t pfx_succinct_bits_for(const uint64_t values)
+{
+	if (values <= 1)
+		return 0;
+	return 64 - __builtin_clzll(values - 1);
+}
+
+static uint64_t pfx_succinct_field(const uint64_t value, const unsigned int shift, const unsigned int width)
+{
+	if (width == 0)
+		return 0;
+	return (value >> shift) & ((UINT64_C(1) << width) - 1);
+}
+
+static struct pfx_succinct_key pfx_succinct_key(const struct lrtr_ip_addr *addr, const uint8_t len)
+{
+	struct pfx_succinct_key key = {0, 0};
+	unsigned int shift;
+
+	if (addr->ver == LRTR_IPV4) {
+		if (len >= 32)
+			key.lo = addr->u.addr4.addr;
+		else if (len > 0)
+			key.lo = addr->u.addr4.addr >> (32 - len);
+		return key;
+	}
+
+	key.hi = (uint64_t)addr->u.addr6.addr[0] << 32 | addr->u.addr6.addr[1];
+	key.lo = (uint64_t)addr->u.addr6.addr[2] << 32 | addr->u.addr6.addr[3];
+	shift = 128 - len;
+	if (shift >= 128) {
+		key.hi = 0;
+		key.lo = 0;
+	} else if (shift >= 64) {
+		key.lo = key.hi >> (shift - 64);
+		key.hi = 0;
+	} else if (shift > 0) {
+		key.lo = key.lo >> shift | key.hi << (64 - shift);
+		key.hi >>= shift;
+	}
+	return key;
+}
+
+static struct lrtr_ip_addr pfx_succinct_addr(const enum lrtr_ip_version ver, struct pfx_succinct_key key,
+					     const uint8_t len)
+{
+	struct lrtr_ip_addr addr;
+	unsigned int shift;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.ver = ver;
+	if (ver == LRTR_IPV4) {
+		if (len > 0)
+			addr.u.addr4.addr = (uint32_t)(key.lo << (32 - len));
+		return addr;
+	}
+
+	shift = 128 - len;
+	if (shift >= 128) {
+		key.hi = 0;
+		key.lo = 0;
+	} else if (shift >= 64) {
+		key.hi = key.lo << (shift - 64);
+		key.lo = 0;
+	} else if (shift > 0) {
+		key.hi = key.hi << shift | key.lo >> (64 - shift);
+		key.lo <<= shift;
+	}
+	addr.u.addr6.addr[0] = key.hi >> 32;
+	addr.u.addr6.addr[1] = (uint32_t)key.hi;
+	addr.u.addr6.addr[2] = key.lo >> 32;
+	addr.u.addr6.addr[3] = (uint32_t)key.lo;
+	return addr;
+}
+
+static int pfx_succinct_key_cmp(const struct pfx_succinct_key *a, const struct pfx_succinct_key *b)
+{
+	if (a->hi != b->hi)
+		return a->hi < b->hi ? -1 : 1;
+	if (a->lo != b->lo)
+		return a->lo < b->lo ? -1 : 1;
+	return 0;
+}
+
+static struct pfx_succinct_key pfx_succinct_read_key(const uint64_t *keys, const uint64_t pos, const uint8_t len)
+{
+	struct pfx_succinct_key key = {0, 0};
+
+	if (len <= 64) {
+		key.lo = pfx_succinct_get_bits(keys, pos, len);
+	} else {
+		key.hi = pfx_succinct_get_bits(keys, pos, len - 64);
+		key.lo = pfx_succinct_get_bits(keys, pos + len - 64, 64);
+	}
+	return key;
+}
+
+static void pfx_succinct_write_key(uint64_t *keys, const uint64_t pos, const uint8_t len,
+				   const struct pfx_succinct_key *key)
+{
+	if (len <= 64) {
+		pfx_succinct_set_bits(keys, pos, len, key->lo);
+	} else {
+		pfx_succinct_set_bits(keys, pos, len - 64, key->hi);
+		pfx_succinct_set_bits(keys, pos + len - 64, 64, key->lo);
+	}
+}
+
+static const struct pfx_succinct_af *pfx_succinct_get_af(const struct pfx_succinct *succinct,
+							 const enum lrtr_ip_version ver)
+{
+	return ver == LRTR_IPV4 ? &succinct->ipv4 : &succinct->ipv6;
+}
+
+static uint32_t pfx_succinct_prefixes(const struct pfx_succinct_af *af)
+{
+	return af->groups[af->max_len + 1];
+}
+
+/* Returns the bit position of the key of a prefix with the given length and index */
+static uint64_t pfx_succinct_key_offset(const struct pfx_succinct_af *af, const uint8_t len, const uint32_t prefix)
+{
+	return af->key_pos[len] + (uint64_t)(prefix - af->groups[len]) * len;
+}
+
+/* Returns the index of the first record of a prefix */
+static uint32_t pfx_succinct_select(const struct pfx_succinct_af *af, const uint32_t prefix)
+{
+	uint32_t pos = af->samples[prefix / PFX_SUCCINCT_SAMPLE];
+	unsigned int rank = prefix % PFX_SUCCINCT_SAMPLE;
+	uint64_t word = pos / 64;
+	uint64_t bits = af->starts[word] & (UINT64_MAX << (pos % 64));
+
+	while ((unsigned int)__builtin_popcountll(bits) <= rank) {
+		rank -= __builtin_popcountll(bits);
+		bits = af->starts[++word];
+	}
+	while (rank-- > 0)
+		bits &= bits - 1;
+	return word * 64 + __builtin_ctzll(bits);
+}
+
+/* Returns the index behind the last record of the prefix whose first record is at vrp */
+static uint32_t pfx_succinct_prefix_end(const struct pfx_succinct_af *af, const uint32_t vrp)
+{
+	uint64_t pos = (uint64_t)vrp + 1;
+	uint64_t word = pos / 64;
+	uint64_t bits;
+
+	if (pos >= af->vrps_len)
+		return af->vrps_len;
+
+	bits = af->starts[word] & (UINT64_MAX << (pos % 64));
+	while (!bits) {
+		if (++word * 64 >= af->vrps_len)
+			return af->vrps_len;
+		bits = af->starts[word];
+	}
+	return word * 64 + __builtin_ctzll(bits);
+}
+
+static void pfx_succinct_read_vrp(const struct pfx_succinct *succinct, const struct pfx_succinct_af *af,
+				  const uint32_t index, const uint8_t len, struct pfx_succinct_entry *entry)
+{
+	uint64_t value = pfx_succinct_get_bits(af->vrps, (uint64_t)index * succinct->vrp_bits, succinct->vrp_bits);
+
+	entry->asn = succinct->asns[pfx_succinct_field(value, 0, succinct->asn_bits)];
+	entry->max_len = len + pfx_succinct_field(value, succinct->asn_bits, succinct->delta_bits);
+	entry->socket = succinct->sockets[pfx_succinct_field(value, succinct->asn_bits + succinct->delta_bits,
+							     succinct->socket_bits)];
+}
+
+static int pfx_succinct_entry_cmp(const struct pfx_succinct_entry *a, const struct pfx_succinct_entry *b)
+{
+	if (a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	return pfx_succinct_key_cmp(&a->key, &b->key);
+}
+
+static int pfx_succinct_record_cmp(const void *a, const void *b)
+{
+	const struct pfx_record *ra = a;
+	const struct pfx_record *rb = b;
+	struct pfx_succinct_key ka;
+	struct pfx_succinct_key kb;
+
+	if (ra->prefix.ver != rb->prefix.ver)
+		return ra->prefix.ver == LRTR_IPV4 ? -1 : 1;
+	if (ra->min_len != rb->min_len)
+		return ra->min_len < rb->min_len ? -1 : 1;
+
+	ka = pfx_succinct_key(&ra->prefix, ra->min_len);
+	kb = pfx_succinct_key(&rb->prefix, rb->min_len);
+	return pfx_succinct_key_cmp(&ka, &kb);
+}
+
+static void pfx_succinct_record_entry(const struct pfx_record *record, struct pfx_succinct_entry *entry)
+{
+	entry->key = pfx_succinct_key(&record->prefix, record->min_len);
+	entry->len = record->min_len;
+	entry->asn = record->asn;
+	entry->max_len = record->max_len;
+	entry->socket = record->socket;
+}
+
+/* Moves the cursor to the next record of its encoding that is not marked as removed */
+static void pfx_succinct_cursor_skip(struct pfx_succinct_cursor *cursor)
+{
+	const struct pfx_succinct_af *af = cursor->base;
+
+	if (!af)
+		return;
+
+	while (cursor->vrp < af->vrps_len && pfx_succinct_bit(af->removed, cursor->vrp))
+		cursor->vrp++;
+	if (cursor->vrp == af->vrps_len) {
+		cursor->base = NULL;
+		return;
+	}
+
+	// the records are stored in the order of their prefixes, the first record of a prefix follows the last one
+	// of the previous prefix
+	while (cursor->vrp >= cursor->end) {
+		if (cursor->end > 0)
+			cursor->prefix++;
+		while (af->groups[cursor->len + 1] <= cursor->prefix)
+			cursor->len++;
+		cursor->key = pfx_succinct_read_key(af->keys, pfx_succinct_key_offset(af, cursor->len, cursor->prefix),
+						    cursor->len);
+		cursor->end = pfx_succinct_prefix_end(af, cursor->end);
+	}
+}
+
+static void pfx_succinct_cursor_init(struct pfx_succinct_cursor *cursor, const struct pfx_succinct *succinct,
+				     const enum lrtr_ip_version ver, const struct pfx_record *records,
+				     const unsigned int records_len)
+{
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->succinct = succinct;
+	if (succinct && pfx_succinct_get_af(succinct, ver)->vrps_len > 0)
+		cursor->base = pfx_succinct_get_af(succinct, ver);
+	cursor->records = records;
+	cursor->records_len = records_len;
+	pfx_succinct_cursor_skip(cursor);
+}
+
+/* Returns the next record, records of the encoding come first if both have the same prefix */
+static bool pfx_succinct_cursor_next(struct pfx_succinct_cursor *cursor, struct pfx_succinct_entry *entry)
+{
+	struct pfx_succinct_entry base;
+	struct pfx_succinct_entry record;
+	bool has_record = cursor->pos < cursor->records_len;
+
+	if (has_record)
+		pfx_succinct_record_entry(&cursor->records[cursor->pos], &record);
+
+	if (cursor->base) {
+		base.key = cursor->key;
+		base.len = cursor->len;
+		if (!has_record || pfx_succinct_entry_cmp(&base, &record) <= 0) {
+			pfx_succinct_read_vrp(cursor->succinct, cursor->base, cursor->vrp, cursor->len, &base);
+			*entry = base;
+			cursor->vrp++;
+			pfx_succinct_cursor_skip(cursor);
+			return true;
+		}
+	}
+
+	if (!has_record)
+		return false;
+
+	*entry = record;
+	cursor->pos++;
+	return true;
+}
+
+static int pfx_succinct_asn_cmp(const void *a, const void *b)
+{
+	const uint32_t *asn_a = a;
+	const uint32_t *asn_b = b;
+
+	if (*asn_a != *asn_b)
+		return *asn_a < *asn_b ? -1 : 1;
+	return 0;
+}
+
+static uint32_t pfx_succinct_asn_index(const struct pfx_succinct *succinct, const uint32_t asn)
+{
+	const uint32_t *found = bsearch(&asn, succinct->asns, succinct->asns_len, sizeof(asn), pfx_succinct_asn_cmp);
+
+	return found - succinct->asns;
+}
+
+/* Returns the index of a socket in the socket table, adds it if add is true */
+static int64_t pfx_succinct_socket_index(struct pfx_succinct *succinct, const struct rtr_socket *socket,
+					 const bool add)
+{
+	const struct rtr_socket **tmp;
+
+	for (uint32_t i = 0; i < succinct->sockets_len; i++) {
+		if (succinct->sockets[i] == socket)
+			return i;
+	}
+	if (!add)
+		return -1;
+
+	tmp = lrtr_realloc(succinct->sockets, sizeof(*tmp) * (succinct->sockets_len + 1));
+	if (!tmp)
+		return -1;
+	succinct->sockets = tmp;
+	succinct->sockets[succinct->sockets_len] = socket;
+	return succinct->sockets_len++;
+}
+
+/**
+ * @brief Reads all records once to collect the dictionaries and the number of prefixes of each length.
+ * @param[in,out] succinct Encoding that is built.
+ * @param[in] cursors Cursors of both IP versions.
+ * @param[out] max_delta Largest max_len - min_len of a record.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_succinct_count_records(struct pfx_succinct *succinct, struct pfx_succinct_cursor *cursors,
+				      const unsigned int asns_size, uint8_t *max_delta)
+{
+	struct pfx_succinct_entry entry;
+
+	succinct->asns = lrtr_malloc(sizeof(*succinct->asns) * (asns_size > 0 ? asns_size : 1));
+	if (!succinct->asns)
+		return PFX_ERROR;
+
+	for (unsigned int i = 0; i < 2; i++) {
+		struct pfx_succinct_af *af = i == 0 ? &succinct->ipv4 : &succinct->ipv6;
+		struct pfx_succinct_entry last;
+		bool has_last = false;
+
+		while (pfx_succinct_cursor_next(&cursors[i], &entry)) {
+			if (entry.len > af->max_len || entry.max_len < entry.len || entry.max_len > af->max_len ||
+			    af->vrps_len == UINT32_MAX)
+				return PFX_ERROR;
+			if (!has_last || pfx_succinct_entry_cmp(&last, &entry) != 0)
+				af->groups[entry.len + 1]++;
+			last = entry;
+			has_last = true;
+
+			succinct->asns[succinct->asns_len++] = entry.asn;
+			if (pfx_succinct_socket_index(succinct, entry.socket, true) < 0)
+				return PFX_ERROR;
+			if (entry.max_len - entry.len > *max_delta)
+				*max_delta = entry.max_len - entry.len;
+			af->vrps_len++;
+		}
+	}
+
+	// sort and remove duplicates, qsort() must not be called with the NULL array of an empty encoding
+	if (succinct->asns_len > 0)
+		qsort(succinct->asns, succinct->asns_len, sizeof(*succinct->asns), pfx_succinct_asn_cmp);
+	uint32_t len = 0;
+
+	for (uint32_t i = 0; i < succinct->asns_len; i++) {
+		if (len == 0 || succinct->asns[len - 1] != succinct->asns[i])
+			succinct->asns[len++] = succinct->asns[i];
+	}
+	succinct->asns_len = len;
+	if (len > 0) {
+		uint32_t *tmp = lrtr_realloc(succinct->asns, sizeof(*tmp) * len);
+
+		if (tmp)
+			succinct->asns = tmp;
+	}
+	return PFX_SUCCESS;
+}
+
+static int pfx_succinct_alloc_af(struct pfx_succinct_af *af, const uint8_t vrp_bits)
+{
+	uint32_t prefixes;
+	uint64_t key_bits;
+
+	// groups holds the number of prefixes of length l at index l + 1
+	for (unsigned int len = 0; len <= af->max_len; len++)
+		af->groups[len + 1] += af->groups[len];
+	for (unsigned int len = 1; len <= af->max_len; len++)
+		af->key_pos[len] = af->key_pos[len - 1] + (uint64_t)(af->groups[len] - af->groups[len - 1]) * (len - 1);
+	prefixes = pfx_succinct_prefixes(af);
+	key_bits = pfx_succinct_key_offset(af, af->max_len, prefixes);
+
+	af->keys = lrtr_calloc(pfx_succinct_words(key_bits), sizeof(uint64_t));
+	af->starts = lrtr_calloc(pfx_succinct_words(af->vrps_len), sizeof(uint64_t));
+	af->removed = lrtr_calloc(pfx_succinct_words(af->vrps_len), sizeof(uint64_t));
+	af->samples = lrtr_calloc(prefixes / PFX_SUCCINCT_SAMPLE + 1, sizeof(uint32_t));
+	af->vrps = lrtr_calloc(pfx_succinct_words((uint64_t)af->vrps_len * vrp_bits), sizeof(uint64_t));
+	if (!af->keys || !af->starts || !af->removed || !af->samples || !af->vrps)
+		return PFX_ERROR;
+	return PFX_SUCCESS;
+}
+
+/* Reads all records a second time and writes them to the allocated arrays */
+static void pfx_succinct_write_af(struct pfx_succinct *succinct, struct pfx_succinct_af *af,
+				  struct pfx_succinct_cursor *cursor)
+{
+	struct pfx_succinct_entry entry;
+	struct pfx_succinct_entry last;
+	uint32_t prefix = 0;
+	uint32_t vrp = 0;
+
+	while (pfx_succinct_cursor_next(cursor, &entry)) {
+		uint64_t value;
+
+		if (vrp == 0 || pfx_succinct_entry_cmp(&last, &entry) != 0) {
+			if (vrp > 0)
+				prefix++;
+			pfx_succinct_write_key(af->keys, pfx_succinct_key_offset(af, entry.len, prefix), entry.len,
+					       &entry.key);
+			pfx_succinct_set_bits(af->starts, vrp, 1, 1);
+			if (prefix % PFX_SUCCINCT_SAMPLE == 0)
+				af->samples[prefix / PFX_SUCCINCT_SAMPLE] = vrp;
+		}
+		last = entry;
+
+		value = pfx_succinct_asn_index(succinct, entry.asn);
+		value |= (uint64_t)(entry.max_len - entry.len) << succinct->asn_bits;
+		if (succinct->socket_bits > 0)
+			value |= (uint64_t)pfx_succinct_socket_index(succinct, entry.socket, false)
+				 << (succinct->asn_bits + succinct->delta_bits);
+		pfx_succinct_set_bits(af->vrps, (uint64_t)vrp * succinct->vrp_bits, succinct->vrp_bits, value);
+		vrp++;
+	}
+}
+
+struct pfx_succinct *pfx_succinct_merge(const struct pfx_succinct *base, struct pfx_record *records,
+					const unsigned int records_len)
+{
+	struct pfx_succinct *succinct = lrtr_calloc(1, sizeof(*succinct));
+	struct pfx_succinct_cursor cursors[2];
+	unsigned int ipv4_len = 0;
+	uint8_t max_delta = 0;
+
+	if (!succinct)
+		return NULL;
+	succinct->ipv4.max_len = 32;
+	succinct->ipv6.max_len = 128;
+
+	if (records_len > 0)
+		qsort(records, records_len, sizeof(*records), pfx_succinct_record_cmp);
+	while (ipv4_len < records_len && records[ipv4_len].prefix.ver == LRTR_IPV4)
+		ipv4_len++;
+
+	pfx_succinct_cursor_init(&cursors[0], base, LRTR_IPV4, records, ipv4_len);
+	pfx_succinct_cursor_init(&cursors[1], base, LRTR_IPV6, records + ipv4_len, records_len - ipv4_len);
+	if (pfx_succinct_count_records(succinct, cursors, (base ? pfx_succinct_count(base) : 0) + records_len,
+				       &max_delta) == PFX_ERROR)
+		goto error;
+
+	succinct->asn_bits = pfx_succinct_bits_for(succinct->asns_len);
+	succinct->delta_bits = pfx_succinct_bits_for((uint64_t)max_delta + 1);
+	succinct->socket_bits = pfx_succinct_bits_for(succinct->sockets_len);
+	if (succinct->asn_bits + succinct->delta_bits + succinct->socket_bits > 64)
+		goto error;
+	succinct->vrp_bits = succinct->asn_bits + succinct->delta_bits + succinct->socket_bits;
+
+	for (unsigned int i = 0; i < 2; i++) {
+		struct pfx_succinct_af *af = i == 0 ? &succinct->ipv4 : &succinct->ipv6;
+
+		if (pfx_succinct_alloc_af(af, succinct->vrp_bits) == PFX_ERROR)
+			goto error;
+	}
+
+	pfx_succinct_cursor_init(&cursors[0], base, LRTR_IPV4, records, ipv4_len);
+	pfx_succinct_cursor_init(&cursors[1], base, LRTR_IPV6, records + ipv4_len, records_len - ipv4_len);
+	pfx_succinct_write_af(succinct, &succinct->ipv4, &cursors[0]);
+	pfx_succinct_write_af(succinct, &succinct->ipv6, &cursors[1]);
+	return succinct;
+
+error:
+	pfx_succinct_free(succinct);
+	return NULL;
+}
+
+static void pfx_succinct_free_af(struct pfx_succinct_af *af)
+{
+	lrtr_free(af->keys);
+	lrtr_free(af->starts);
+	lrtr_free(af->samples);
+	lrtr_free(af->vrps);
+	lrtr_free(af->removed);
+}
+
+void pfx_succinct_free(struct pfx_succinct *succinct)
+{
+	if (!succinct)
+		return;
+
+	pfx_succinct_free_af(&succinct->ipv4);
+	pfx_succinct_free_af(&succinct->ipv6);
+	lrtr_free(succinct->asns);
+	lrtr_free(succinct->sockets);
+	lrtr_free(succinct);
+}
+
+bool pfx_succinct_find_prefix(const struct pfx_succinct *succinct, const struct lrtr_ip_addr *prefix,
+			      const uint8_t prefix_len, struct pfx_succinct_range *range)
+{
+	const struct pfx_succinct_af *af = pfx_succinct_get_af(succinct, prefix->ver);
+	struct pfx_succinct_key key;
+	uint32_t lo;
+	uint32_t hi;
+
+	if (prefix_len > af->max_len)
+		return false;
+
+	key = pfx_succinct_key(prefix, prefix_len);
+	lo = af->groups[prefix_len];
+	hi = af->groups[prefix_len + 1];
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		struct pfx_succinct_key mid_key =
+			pfx_succinct_read_key(af->keys, pfx_succinct_key_offset(af, prefix_len, mid), prefix_len);
+		int cmp = pfx_succinct_key_cmp(&mid_key, &key);
+
+		if (cmp == 0) {
+			range->prefix = pfx_succinct_addr(prefix->ver, key, prefix_len);
+			range->prefix_len = prefix_len;
+			range->next = pfx_succinct_select(af, mid);
+			range->end = pfx_succinct_prefix_end(af, range->next);
+			return true;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return false;
+}
+
+/* Returns the next record of a range, including the records that are marked as removed */
+static bool pfx_succinct_next_any(const struct pfx_succinct *succinct, struct pfx_succinct_range *range,
+				  struct pfx_record *record, uint32_t *index, bool *removed)
+{
+	const struct pfx_succinct_af *af = pfx_succinct_get_af(succinct, range->prefix.ver);
+	struct pfx_succinct_entry entry;
+
+	if (range->next >= range->end)
+		return false;
+
+	pfx_succinct_read_vrp(succinct, af, range->next, range->prefix_len, &entry);
+	record->asn = entry.asn;
+	record->prefix = range->prefix;
+	record->min_len = range->prefix_len;
+	record->max_len = entry.max_len;
+	record->socket = entry.socket;
+	*index = range->next;
+	*removed = pfx_succinct_bit(af->removed, range->next);
+	range->next++;
+	return true;
+}
+
+bool pfx_succinct_next(const struct pfx_succinct *succinct, struct pfx_succinct_range *range,
+		       struct pfx_record *record, uint32_t *index)
+{
+	uint32_t i;
+	bool removed;
+
+	while (pfx_succinct_next_any(succinct, range, record, &i, &removed)) {
+		if (removed)
+			continue;
+		if (index)
+			*index = i;
+		return true;
+	}
+	return false;
+}
+
+bool pfx_succinct_find(const struct pfx_succinct *succinct, const struct pfx_record *record, uint32_t *index,
+		       bool *removed)
+{
+	struct pfx_succinct_range range;
+	struct pfx_record other;
+
+	if (!pfx_succinct_find_prefix(succinct, &record->prefix, record->min_len, &range))
+		return false;
+
+	while (pfx_succinct_next_any(succinct, &range, &other, index, removed)) {
+		if (other.asn == record->asn && other.max_len == record->max_len && other.socket == record->socket)
+			return true;
+	}
+	return false;
+}
+
+void pfx_succinct_mark_removed(struct pfx_succinct *succinct, const enum lrtr_ip_version ver, const uint32_t index,
+			       const bool removed)
+{
+	struct pfx_succinct_af *af = ver == LRTR_IPV4 ? &succinct->ipv4 : &succinct->ipv6;
+	const uint64_t bit = UINT64_C(1) << (index % 64);
+
+	if (pfx_succinct_bit(af->removed, index) == removed)
+		return;
+
+	if (removed) {
+		af->removed[index / 64] |= bit;
+		af->removed_len++;
+	} else {
+		af->removed[index / 64] &= ~bit;
+		af->removed_len--;
+	}
+}
+
+void pfx_succinct_for_each(const struct pfx_succinct *succinct, const enum lrtr_ip_version ver, pfx_for_each_fp fp,
+			   void *data)
+{
+	struct pfx_succinct_cursor cursor;
+	struct pfx_succinct_entry entry;
+	struct pfx_record record;
+
+	pfx_succinct_cursor_init(&cursor, succinct, ver, NULL, 0);
+	while (pfx_succinct_cursor_next(&cursor, &entry)) {
+		record.asn = entry.asn;
+		record.prefix = pfx_succinct_addr(ver, entry.key, entry.len);
+		record.min_len = entry.len;
+		record.max_len = entry.max_len;
+		record.socket = entry.socket;
+		fp(&record, data);
+	}
+}
+
+unsigned int pfx_succinct_count(const struct pfx_succinct *succinct)
+{
+	return succinct->ipv4.vrps_len - succinct->ipv4.removed_len + succinct->ipv6.vrps_len -
+	       succinct->ipv6.removed_len;
+}
+
+unsigned int pfx_succinct_removed(const struct pfx_succinct *succinct)
+{
+	return succinct->ipv4.removed_len + succinct->ipv6.removed_len;
+}
+
+static size_t pfx_succinct_size_af(const struct pfx_succinct_af *af, const uint8_t vrp_bits)
+{
+	const uint32_t prefixes = pfx_succinct_prefixes(af);
+	const uint64_t key_bits = pfx_succinct_key_offset(af, af->max_len, prefixes);
+
+	return sizeof(uint64_t) * (pfx_succinct_words(key_bits) + 2 * pfx_succinct_words(af->vrps_len) +
+				   pfx_succinct_words((uint64_t)af->vrps_len * vrp_bits)) +
+	       sizeof(uint32_t) * (prefixes / PFX_SUCCINCT_SAMPLE + 1);
+}
+
+size_t pfx_succinct_size(const struct pfx_succinct *succinct)
+{
+	return sizeof(*succinct) + sizeof(*succinct->asns) * succinct->asns_len +
+	       sizeof(*succinct->sockets) * succinct->sockets_len +
+	       pfx_succinct_size_af(&succinct->ipv4, succinct->vrp_bits) +
+	       pfx_succinct_size_af(&succinct->ipv6, succinct->vrp_bits);
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_succinct_h Succinct record storage
+ * @ingroup mod_pfx_h
+ * @brief Compact, read optimized encoding of the records of a pfx_table.
+ * @details The prefixes of each IP version are grouped by their length and sorted within a group. A prefix of
+ * length l is stored as its l network bits in a bit-packed array, a lookup is a binary search in the group of
+ * each length that can cover a route. The records follow in the order of their prefixes, every record is a
+ * bit-packed triple of the index of its origin AS in a sorted dictionary, max_len - min_len and the index of its
+ * socket. A bit vector marks the first record of every prefix, the position of every 64th marked bit is sampled
+ * to select the records of a prefix. The encoding is never resized, removed records are only marked in another
+ * bit vector until the records are merged into a new encoding.
+ * @{
+ */
+
+#ifndef RTR_SUCCINCT_PRIVATE_H
+#define RTR_SUCCINCT_PRIVATE_H
+
+#include "rtrlib/pfx/pfx.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Succinct encoding of the records of a pfx_table.
+ */
+struct pfx_succinct;
+
+/**
+ * @brief Records of one prefix in a succinct encoding.
+ * @param prefix Prefix with all host bits cleared.
+ * @param prefix_len Length of the prefix.
+ * @param next Index of the next record of the prefix.
+ * @param end Index behind the last record of the prefix.
+ */
+struct pfx_succinct_range {
+	struct lrtr_ip_addr prefix;
+	uint8_t prefix_len;
+	uint32_t next;
+	uint32_t end;
+};
+
+/**
+ * @brief Builds a succinct encoding of the records of @p base that are not marked as removed and @p records.
+ * @details The records of @p base are read in order and merged with @p records, so the only memory needed besides
+ * both encodings are the dictionaries of the new one.
+ * @param[in] base Encoding to merge, may be NULL.
+ * @param[in,out] records Records to add, must not be part of @p base. They are sorted in place.
+ * @param[in] records_len Number of elements in @p records.
+ * @return Pointer to the new encoding, NULL on error.
+ */
+struct pfx_succinct *pfx_succinct_merge(const struct pfx_succinct *base, struct pfx_record *records,
+					const unsigned int records_len);
+
+/**
+ * @brief Frees a succinct encoding.
+ * @param[in] succinct Succinct encoding, may be NULL.
+ */
+void pfx_succinct_free(struct pfx_succinct *succinct);
+
+/**
+ * @brief Searches the records of a prefix.
+ * @param[in] succinct Succinct encoding to use.
+ * @param[in] prefix Prefix, host bits are ignored.
+ * @param[in] prefix_len Length of @p prefix.
+ * @param[out] range Records of the prefix, to be read with pfx_succinct_next().
+ * @return true If the encoding contains the prefix, its records may all be marked as removed.
+ */
+bool pfx_succinct_find_prefix(const struct pfx_succinct *succinct, const struct lrtr_ip_addr *prefix,
+			      const uint8_t prefix_len, struct pfx_succinct_range *range);
+
+/**
+ * @brief Returns the next record of a prefix that is not marked as removed.
+ * @param[in] succinct Succinct encoding to use.
+ * @param[in,out] range Range returned by pfx_succinct_find_prefix().
+ * @param[out] record Next record.
+ * @param[out] index Index of the record, may be NULL.
+ * @return false If the prefix has no further records.
+ */
+bool pfx_succinct_next(const struct pfx_succinct *succinct, struct pfx_succinct_range *range,
+		       struct pfx_record *record, uint32_t *index);
+
+/**
+ * @brief Searches a record, including the records that are marked as removed.
+ * @param[in] succinct Succinct encoding to use.
+ * @param[in] record Record to search, host bits of the prefix are ignored.
+ * @param[out] index Index of the record.
+ * @param[out] removed True if the record is marked as removed.
+ * @return true If the encoding contains the record.
+ */
+bool pfx_succinct_find(const struct pfx_succinct *succinct, const struct pfx_record *record, uint32_t *index,
+		       bool *removed);
+
+/**
+ * @brief Marks a record as removed or restores it.
+ * @param[in] succinct Succinct encoding to use.
+ * @param[in] ver IP version of the record.
+ * @param[in] index Index of the record returned by pfx_succinct_find().
+ * @param[in] removed True to mark the record as removed, false to restore it.
+ */
+void pfx_succinct_mark_removed(struct pfx_succinct *succinct, const enum lrtr_ip_version ver, const uint32_t index,
+			       const bool removed);
+
+/**
+ * @brief Calls a function for every record of an IP version that is not marked as removed.
+ * @details The records are passed ordered by prefix length, prefix and the order they were added in.
+ * @param[in] succinct Succinct encoding to use.
+ * @param[in] ver IP version of the records.
+ * @param[in] fp Function that is called for every record.
+ * @param[in] data Forwarded to @p fp.
+ */
+void pfx_succinct_for_each(const struct pfx_succinct *succinct, const enum lrtr_ip_version ver, pfx_for_each_fp fp,
+			   void *data);
+
+/**
+ * @brief Returns the number of records that are not marked as removed.
+ * @param[in] succinct Succinct encoding to use.
+ */
+unsigned int pfx_succinct_count(const struct pfx_succinct *succinct);
+
+/**
+ * @brief Returns the number of records that are marked as removed.
+ * @param[in] succinct Succinct encoding to use.
+ */
+unsigned int pfx_succinct_removed(const struct pfx_succinct *succinct);
+
+/**
+ * @brief Returns the number of bytes that are allocated for a succinct encoding.
+ * @param[in] succinct Succinct encoding to use.
+ */
+size_t pfx_succinct_size(const struct pfx_succinct *succinct);
+
+#endif
+/** @} */
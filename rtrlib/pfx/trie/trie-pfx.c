@@ -9,16 +9,27 @@
 
 #include "trie-pfx.h"
 
+#include "rtrlib/config.h"
 #include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/lib/executor_private.h"
 #include "rtrlib/lib/ip_private.h"
+#include "rtrlib/pfx/bspl/bspl_private.h"
+#include "rtrlib/pfx/compressed/compressed_private.h"
+#include "rtrlib/pfx/frozen/frozen_private.h"
 #include "rtrlib/pfx/pfx_private.h"
+#include "rtrlib/pfx/succinct/succinct_private.h"
 #include "rtrlib/pfx/trie/trie_private.h"
 #include "rtrlib/rtrlib_export_private.h"
 
+#include "third-party/tommyds/tommyhash.h"
+#include "third-party/tommyds/tommyhashlin.h"
+
 #include <assert.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 struct data_elem {
 	uint32_t asn;
@@ -29,34 +40,134 @@ struct data_elem {
 struct node_data {
 	unsigned int len;
 	struct data_elem *ary;
+	struct lrtr_ip_addr prefix;
+	uint8_t prefix_len;
+	tommy_node hash_node;
 };
 
-struct copy_cb_args {
-	struct pfx_table *pfx_table;
-	const struct rtr_socket *socket;
-	bool error;
+/**
+ * @brief Maps the prefix and prefix length of every trie node to its node_data.
+ * @details The trie moves node_data between nodes when it is restructured, but a node_data always stays
+ * associated with the same prefix, so the index remains valid without being updated by the trie.
+ */
+struct pfx_index {
+	tommy_hashlin hashtable;
 };
 
-struct notify_diff_cb_args {
-	struct pfx_table *old_table;
-	struct pfx_table *new_table;
-	const struct rtr_socket *socket;
-	pfx_update_fp pfx_update_fp;
-	bool added;
+/*
+ * The bspl structures are rebuilt once the trie answered more than 1/PFX_BSPL_REBUILD_RATIO validations
+ * per node since the last change of the prefixes. This bounds the amortized rebuild cost per validation,
+ * even if validations and updates interleave.
+ */
+#define PFX_BSPL_REBUILD_RATIO 64
+
+/*
+ * With PFX_REMOVAL_DEFERRED, the tombstones are compacted after a synchronisation once they make up
+ * 1/PFX_TOMBSTONE_SYNC_RATIO of the trie nodes. A removal compacts them once they make up half of the
+ * nodes, so the amortized cost of a removal stays constant even if the table is never synchronised.
+ */
+#define PFX_TOMBSTONE_SYNC_RATIO 8
+
+/*
+ * With PFX_STORAGE_SUCCINCT, the trie and the removed records are merged into a new encoding after a
+ * synchronisation once they make up 1/PFX_SUCCINCT_SYNC_RATIO of the encoded records. Adding records merges them
+ * once the trie holds a quarter of the encoded records, but not before it holds PFX_SUCCINCT_MIN_NODES nodes, so
+ * filling an empty table costs a constant number of merges per record.
+ */
+#define PFX_SUCCINCT_SYNC_RATIO 64
+#define PFX_SUCCINCT_MIN_NODES 4096
+
+/**
+ * @brief State of the PFX_ENGINE_BSPL engine.
+ * @details The structures only reference node_data, so they stay valid as long as no trie node is added or
+ * removed. Adding and removing nodes only sets dirty while holding the write lock. The structures are rebuilt
+ * by a validation while holding the read lock, mutex ensures that only one validation rebuilds them. dirty and
+ * trie_lookups are accessed atomically as validations run concurrently.
+ * @param ipv4 Structure over the IPv4 trie.
+ * @param ipv6 Structure over the IPv6 trie.
+ * @param dirty True if the structures do not match the tries.
+ * @param trie_lookups Number of validations that were answered by the trie since the structures became dirty.
+ * @param mutex Serializes rebuilds.
+ */
+struct pfx_bspl {
+	struct bspl *ipv4;
+	struct bspl *ipv6;
+	bool dirty;
+	unsigned int trie_lookups;
+	pthread_mutex_t mutex;
+};
+
+/*
+ * Number of changes of a sync above which the frozen index is rebuilt by a task of the executor instead of the
+ * thread that received the sync
+ */
+#define PFX_FROZEN_BACKGROUND_CHANGES 10000
+
+/**
+ * @brief Frozen index and the generation of the tries it was built from.
+ */
+struct pfx_frozen_snapshot {
+	struct pfx_frozen *frozen;
+	unsigned long generation;
+};
+
+/**
+ * @brief State of the frozen index of a pfx_table.
+ * @details Validations read the published snapshot without taking any lock. A reader registers in the current
+ * epoch before it loads the snapshot, a publish flips the epoch and frees the replaced snapshot once all readers
+ * of the previous epoch left. The snapshot is only used while its generation matches the generation of the
+ * tries, otherwise validations fall back to the locked lookup.
+ * @param snapshot Published snapshot, NULL before the first build.
+ * @param generation Incremented while holding the write lock whenever a record is added or removed.
+ * @param epoch Epoch new readers register in.
+ * @param readers Number of readers per epoch.
+ * @param build_mutex Serializes builds and publishes.
+ * @param mutex Protects build_pending, build_running and stop.
+ * @param builds The task that rebuilds the index after large changes.
+ * @param build_pending True if the builder task has to rebuild the index.
+ * @param build_running True if the builder task is submitted and did not finish yet.
+ * @param stop True if no further rebuild may be started.
+ */
+struct pfx_frozen_state {
+	struct pfx_frozen_snapshot *snapshot;
+	unsigned long generation;
+	unsigned int epoch;
+	unsigned int readers[2];
+	pthread_mutex_t build_mutex;
+	pthread_mutex_t mutex;
+	struct lrtr_wait_group builds;
+	bool build_pending;
+	bool build_running;
+	bool stop;
+};
+
+struct frozen_collect_args {
+	struct pfx_record *records;
+	unsigned int len;
+	unsigned int size;
+	bool error;
 };
 
 static struct trie_node *pfx_table_get_root(const struct pfx_table *pfx_table, const enum lrtr_ip_version ver);
-static int pfx_table_del_elem(struct node_data *data, const unsigned int index);
+static void pfx_table_del_elem(struct node_data *data, const unsigned int index);
 static int pfx_table_create_node(struct trie_node **node, const struct pfx_record *record);
 static int pfx_table_append_elem(struct node_data *data, const struct pfx_record *record);
 static struct data_elem *pfx_table_find_elem(const struct node_data *data, const struct pfx_record *record,
 					     unsigned int *index);
 static bool pfx_table_elem_matches(struct node_data *data, const uint32_t asn, const uint8_t prefix_len);
 static void pfx_table_notify_clients(struct pfx_table *pfx_table, const struct pfx_record *record, const bool added);
-static int pfx_table_remove_id(struct pfx_table *pfx_table, struct trie_node **root, struct trie_node *node,
-			       const struct rtr_socket *socket, const unsigned int level);
-static int pfx_table_node2pfx_record(struct trie_node *node, struct pfx_record records[], const unsigned int ary_len);
+static int pfx_table_remove_record(struct pfx_table *pfx_table, const struct pfx_record *record);
 static void pfx_table_free_reason(struct pfx_record **reason, unsigned int *reason_len);
+static struct node_data *pfx_table_index_search(const struct pfx_table *pfx_table, const struct lrtr_ip_addr *prefix,
+						const uint8_t prefix_len);
+static void pfx_table_index_remove(struct pfx_table *pfx_table, struct node_data *data);
+static void pfx_table_bspl_invalidate(struct pfx_table *pfx_table);
+static void pfx_table_frozen_touch(struct pfx_table *pfx_table);
+static int pfx_table_compact_locked(struct pfx_table *pfx_table);
+static int pfx_table_succinct_merge(struct pfx_table *pfx_table);
+static void pfx_table_digest_update(struct pfx_table *pfx_table, const struct pfx_record *record, const bool added);
+static int pfx_table_compressed_add(struct pfx_table *pfx_table, const struct pfx_record *record);
+static int pfx_table_compressed_remove(struct pfx_table *pfx_table, const struct pfx_record *record);
 
 void pfx_table_notify_clients(struct pfx_table *pfx_table, const struct pfx_record *record, const bool added)
 {
@@ -64,12 +175,492 @@ void pfx_table_notify_clients(struct pfx_table *pfx_table, const struct pfx_reco
 		pfx_table->update_fp(pfx_table, *record, added);
 }
 
+static tommy_uint32_t pfx_table_index_hash(const struct lrtr_ip_addr *prefix, const uint8_t prefix_len)
+{
+	if (prefix->ver == LRTR_IPV4)
+		return tommy_hash_u32(prefix_len, &prefix->u.addr4.addr, sizeof(prefix->u.addr4.addr));
+	return tommy_hash_u32(prefix_len | 0x100, prefix->u.addr6.addr, sizeof(prefix->u.addr6.addr));
+}
+
+static int pfx_table_index_cmp(const void *arg, const void *obj)
+{
+	const struct node_data *key = arg;
+	const struct node_data *data = obj;
+
+	if (key->prefix_len != data->prefix_len || !lrtr_ip_addr_equal(key->prefix, data->prefix))
+		return 1;
+	return 0;
+}
+
+/**
+ * @brief Returns the node_data of the trie node with exactly the given prefix and prefix length.
+ * @param[in] pfx_table pfx_table to search, the caller must hold the lock.
+ * @param[in] prefix Prefix of the node.
+ * @param[in] prefix_len Prefix length of the node.
+ * @return Pointer to the node_data, NULL if the table has no such node.
+ */
+struct node_data *pfx_table_index_search(const struct pfx_table *pfx_table, const struct lrtr_ip_addr *prefix,
+					 const uint8_t prefix_len)
+{
+	struct node_data key;
+
+	if (!pfx_table->index)
+		return NULL;
+
+	key.prefix = *prefix;
+	key.prefix_len = prefix_len;
+	return tommy_hashlin_search(&pfx_table->index->hashtable, pfx_table_index_cmp, &key,
+				    pfx_table_index_hash(prefix, prefix_len));
+}
+
+/**
+ * @brief Adds the node_data of a new trie node to the index.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] data node_data to add.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR If the index could not be allocated.
+ */
+static int pfx_table_index_insert(struct pfx_table *pfx_table, struct node_data *data)
+{
+	pfx_table_bspl_invalidate(pfx_table);
+
+	if (!pfx_table->index) {
+		pfx_table->index = lrtr_malloc(sizeof(*pfx_table->index));
+		if (!pfx_table->index)
+			return PFX_ERROR;
+		tommy_hashlin_init(&pfx_table->index->hashtable);
+	}
+
+	tommy_hashlin_insert(&pfx_table->index->hashtable, &data->hash_node, data,
+			     pfx_table_index_hash(&data->prefix, data->prefix_len));
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Removes the node_data of a node that was removed from the trie from the index.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] data node_data to remove.
+ */
+void pfx_table_index_remove(struct pfx_table *pfx_table, struct node_data *data)
+{
+	assert(pfx_table->index);
+	pfx_table_bspl_invalidate(pfx_table);
+	tommy_hashlin_remove_existing(&pfx_table->index->hashtable, &data->hash_node);
+
+	// an empty table does not hold any memory
+	if (tommy_hashlin_count(&pfx_table->index->hashtable) == 0) {
+		tommy_hashlin_done(&pfx_table->index->hashtable);
+		lrtr_free(pfx_table->index);
+		pfx_table->index = NULL;
+	}
+}
+
+static void pfx_table_put_u32(uint8_t *buf, size_t *len, const uint32_t value)
+{
+	buf[(*len)++] = value >> 24;
+	buf[(*len)++] = value >> 16;
+	buf[(*len)++] = value >> 8;
+	buf[(*len)++] = value;
+}
+
+RTRLIB_EXPORT uint64_t pfx_record_digest(const struct pfx_record *record)
+{
+	// version, address, min_len, max_len and asn in network byte order
+	uint8_t buf[1 + 16 + 2 + 4];
+	size_t len = 0;
+
+	buf[len++] = record->prefix.ver;
+	if (record->prefix.ver == LRTR_IPV4) {
+		uint32_t addr = record->min_len == 0 ? 0 : record->prefix.u.addr4.addr;
+
+		if (record->min_len > 0 && record->min_len < 32)
+			addr &= UINT32_MAX << (32 - record->min_len);
+		pfx_table_put_u32(buf, &len, addr);
+	} else {
+		for (unsigned int i = 0; i < 4; i++) {
+			unsigned int bits = record->min_len > 32 * i ? record->min_len - 32 * i : 0;
+			uint32_t addr = bits == 0 ? 0 : record->prefix.u.addr6.addr[i];
+
+			if (bits > 0 && bits < 32)
+				addr &= UINT32_MAX << (32 - bits);
+			pfx_table_put_u32(buf, &len, addr);
+		}
+	}
+	buf[len++] = record->min_len;
+	buf[len++] = record->max_len;
+	pfx_table_put_u32(buf, &len, record->asn);
+
+	return tommy_hash_u64(0, buf, len);
+}
+
+/**
+ * @brief Adds or subtracts the digest of a record to the digest of its IP version.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ */
+void pfx_table_digest_update(struct pfx_table *pfx_table, const struct pfx_record *record, const bool added)
+{
+	uint64_t *digest = record->prefix.ver == LRTR_IPV4 ? &pfx_table->digest_ipv4 : &pfx_table->digest_ipv6;
+
+	if (added)
+		*digest += pfx_record_digest(record);
+	else
+		*digest -= pfx_record_digest(record);
+}
+
+RTRLIB_EXPORT uint64_t pfx_table_digest(struct pfx_table *pfx_table, const enum lrtr_ip_version ver)
+{
+	uint64_t digest;
+
+	pthread_rwlock_rdlock(&(pfx_table->lock));
+	digest = ver == LRTR_IPV4 ? pfx_table->digest_ipv4 : pfx_table->digest_ipv6;
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	return digest;
+}
+
 RTRLIB_EXPORT void pfx_table_init(struct pfx_table *pfx_table, pfx_update_fp update_fp)
 {
 	pfx_table->ipv4 = NULL;
 	pfx_table->ipv6 = NULL;
 	pfx_table->update_fp = update_fp;
+	pfx_table->index = NULL;
+	pfx_table->bspl = NULL;
+	pfx_table->frozen = NULL;
+	pfx_table->digest_ipv4 = 0;
+	pfx_table->digest_ipv6 = 0;
+	pfx_table->defer_removal = false;
+	pfx_table->tombstones = 0;
+	pfx_table->succinct = NULL;
+	pfx_table->compressed = NULL;
+#ifdef RTRLIB_PFX_SUCCINCT
+	// the table falls back to the trie storage if the empty encoding can not be allocated
+	pfx_table->succinct = pfx_succinct_merge(NULL, NULL, 0);
+#endif
 	pthread_rwlock_init(&(pfx_table->lock), NULL);
+	pthread_rwlock_init(&(pfx_table->sync_lock), NULL);
+	pthread_mutex_init(&(pfx_table->update_mutex), NULL);
+}
+
+/**
+ * @brief Marks the bspl structures as outdated after a trie node was added or removed.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ */
+void pfx_table_bspl_invalidate(struct pfx_table *pfx_table)
+{
+	if (!pfx_table->bspl)
+		return;
+
+	__atomic_store_n(&pfx_table->bspl->dirty, true, __ATOMIC_RELAXED);
+	__atomic_store_n(&pfx_table->bspl->trie_lookups, 0, __ATOMIC_RELAXED);
+}
+
+static void pfx_table_bspl_free(struct pfx_bspl *bspl)
+{
+	if (!bspl)
+		return;
+
+	bspl_free(bspl->ipv4);
+	bspl_free(bspl->ipv6);
+	pthread_mutex_destroy(&bspl->mutex);
+	lrtr_free(bspl);
+}
+
+/**
+ * @brief Switches a table to PFX_STORAGE_TRIE if its succinct encoding or compressed store is empty.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @return PFX_SUCCESS If the table uses PFX_STORAGE_TRIE.
+ * @return PFX_ERROR If the succinct encoding or the compressed store holds records.
+ */
+static int pfx_table_storage_trie(struct pfx_table *pfx_table)
+{
+	if (pfx_table->compressed && pfx_compressed_count(pfx_table->compressed) > 0)
+		return PFX_ERROR;
+	pfx_compressed_free(pfx_table->compressed);
+	pfx_table->compressed = NULL;
+
+	if (!pfx_table->succinct)
+		return PFX_SUCCESS;
+	if (pfx_succinct_count(pfx_table->succinct) > 0)
+		return PFX_ERROR;
+
+	pfx_succinct_free(pfx_table->succinct);
+	pfx_table->succinct = NULL;
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Switches an empty table to PFX_STORAGE_COMPRESSED.
+ * @details The effective records of the tries can not be told apart from original records, so a table that holds
+ * records keeps its storage.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @return PFX_SUCCESS If the table uses PFX_STORAGE_COMPRESSED.
+ * @return PFX_ERROR If the table holds records, uses another engine or index, or on error.
+ */
+static int pfx_table_storage_compressed(struct pfx_table *pfx_table)
+{
+	if (pfx_table->compressed)
+		return PFX_SUCCESS;
+	if (pfx_table->bspl || pfx_table->frozen || pfx_table_storage_trie(pfx_table) == PFX_ERROR)
+		return PFX_ERROR;
+
+	// tombstones are the only nodes an empty table can have
+	if (pfx_table_compact_locked(pfx_table) == PFX_ERROR || pfx_table->index)
+		return PFX_ERROR;
+
+	pfx_table->compressed = pfx_compressed_new();
+	return pfx_table->compressed ? PFX_SUCCESS : PFX_ERROR;
+}
+
+RTRLIB_EXPORT int pfx_table_set_engine(struct pfx_table *pfx_table, enum pfx_engine engine)
+{
+	int rtval = PFX_SUCCESS;
+
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	if (engine == PFX_ENGINE_BSPL && pfx_table_storage_trie(pfx_table) == PFX_ERROR) {
+		rtval = PFX_ERROR;
+	} else if (engine == PFX_ENGINE_BSPL && !pfx_table->bspl) {
+		pfx_table->bspl = lrtr_calloc(1, sizeof(*pfx_table->bspl));
+		if (pfx_table->bspl) {
+			pthread_mutex_init(&pfx_table->bspl->mutex, NULL);
+			pfx_table->bspl->dirty = true;
+		} else {
+			rtval = PFX_ERROR;
+		}
+	} else if (engine == PFX_ENGINE_TRIE) {
+		pfx_table_bspl_free(pfx_table->bspl);
+		pfx_table->bspl = NULL;
+	}
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	return rtval;
+}
+
+/**
+ * @brief Marks the frozen index as outdated after a record was added or removed.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ */
+void pfx_table_frozen_touch(struct pfx_table *pfx_table)
+{
+	if (pfx_table->frozen)
+		__atomic_add_fetch(&pfx_table->frozen->generation, 1, __ATOMIC_SEQ_CST);
+}
+
+static void pfx_table_frozen_free(struct pfx_frozen_state *state)
+{
+	if (!state)
+		return;
+
+	if (state->snapshot) {
+		pfx_frozen_free(state->snapshot->frozen);
+		lrtr_free(state->snapshot);
+	}
+	pthread_mutex_destroy(&state->build_mutex);
+	pthread_mutex_destroy(&state->mutex);
+	lrtr_wait_group_destroy(&state->builds);
+	lrtr_free(state);
+}
+
+/* Copies the records of a trie in preorder, the records of a node are stored consecutively */
+static void pfx_table_frozen_collect(const struct trie_node *node, struct frozen_collect_args *args)
+{
+	const struct node_data *data = node->data;
+
+	if (args->len + data->len > args->size) {
+		unsigned int size = 2 * (args->len + data->len);
+		struct pfx_record *tmp = lrtr_realloc(args->records, sizeof(*tmp) * size);
+
+		if (!tmp) {
+			args->error = true;
+			return;
+		}
+		args->records = tmp;
+		args->size = size;
+	}
+
+	for (unsigned int i = 0; i < data->len; i++) {
+		struct pfx_record *record = &args->records[args->len++];
+
+		record->asn = data->ary[i].asn;
+		record->prefix = node->prefix;
+		record->min_len = node->len;
+		record->max_len = data->ary[i].max_len;
+		record->socket = data->ary[i].socket;
+	}
+
+	if (node->lchild && !args->error)
+		pfx_table_frozen_collect(node->lchild, args);
+	if (node->rchild && !args->error)
+		pfx_table_frozen_collect(node->rchild, args);
+}
+
+/**
+ * @brief Builds a frozen index from the tries and publishes it.
+ * @details The records are copied while holding the read lock, the index is built after the lock was released.
+ * Nothing is built if the published snapshot matches the tries.
+ * @param[in] pfx_table pfx_table to use, the frozen index must be enabled.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_frozen_rebuild(struct pfx_table *pfx_table)
+{
+	struct pfx_frozen_state *state = pfx_table->frozen;
+	struct frozen_collect_args args = {NULL, 0, 0, false};
+	struct pfx_frozen_snapshot *snapshot;
+	struct pfx_frozen_snapshot *old;
+	unsigned long generation;
+	unsigned int epoch;
+
+	pthread_mutex_lock(&state->build_mutex);
+	pthread_rwlock_rdlock(&(pfx_table->lock));
+	generation = __atomic_load_n(&state->generation, __ATOMIC_SEQ_CST);
+	if (state->snapshot && state->snapshot->generation == generation) {
+		pthread_rwlock_unlock(&pfx_table->lock);
+		pthread_mutex_unlock(&state->build_mutex);
+		return PFX_SUCCESS;
+	}
+	if (pfx_table->ipv4)
+		pfx_table_frozen_collect(pfx_table->ipv4, &args);
+	if (pfx_table->ipv6 && !args.error)
+		pfx_table_frozen_collect(pfx_table->ipv6, &args);
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	snapshot = args.error ? NULL : lrtr_malloc(sizeof(*snapshot));
+	if (snapshot) {
+		snapshot->generation = generation;
+		snapshot->frozen = pfx_frozen_build(args.records, args.len);
+	}
+	lrtr_free(args.records);
+	if (!snapshot || !snapshot->frozen) {
+		lrtr_free(snapshot);
+		pthread_mutex_unlock(&state->build_mutex);
+		return PFX_ERROR;
+	}
+
+	old = __atomic_exchange_n(&state->snapshot, snapshot, __ATOMIC_SEQ_CST);
+
+	// readers of the previous epoch may still use the old snapshot
+	epoch = __atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&state->epoch, epoch ^ 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&state->readers[epoch], __ATOMIC_SEQ_CST) != 0)
+		sched_yield();
+	pthread_mutex_unlock(&state->build_mutex);
+
+	if (old) {
+		pfx_frozen_free(old->frozen);
+		lrtr_free(old);
+	}
+	return PFX_SUCCESS;
+}
+
+/* Rebuilds the frozen index until no rebuild is pending, submitted to the executor by pfx_table_frozen_refresh() */
+static void pfx_table_frozen_builder(void *arg)
+{
+	struct pfx_table *pfx_table = arg;
+	struct pfx_frozen_state *state = pfx_table->frozen;
+
+	pthread_mutex_lock(&state->mutex);
+	while (state->build_pending && !state->stop) {
+		state->build_pending = false;
+		pthread_mutex_unlock(&state->mutex);
+		pfx_table_frozen_rebuild(pfx_table);
+		pthread_mutex_lock(&state->mutex);
+	}
+	state->build_running = false;
+	pthread_mutex_unlock(&state->mutex);
+}
+
+RTRLIB_EXPORT int pfx_table_enable_frozen_index(struct pfx_table *pfx_table)
+{
+	struct pfx_frozen_state *state;
+
+	if (pfx_table->frozen)
+		return PFX_SUCCESS;
+
+	state = lrtr_calloc(1, sizeof(*state));
+	if (!state)
+		return PFX_ERROR;
+	pthread_mutex_init(&state->build_mutex, NULL);
+	pthread_mutex_init(&state->mutex, NULL);
+	lrtr_wait_group_init(&state->builds);
+
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	// the index is built from the tries only
+	if (pfx_table_storage_trie(pfx_table) == PFX_ERROR) {
+		pthread_rwlock_unlock(&pfx_table->lock);
+		pfx_table_frozen_free(state);
+		return PFX_ERROR;
+	}
+	__atomic_store_n(&pfx_table->frozen, state, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	return PFX_SUCCESS;
+}
+
+RTRLIB_EXPORT int pfx_table_freeze(struct pfx_table *pfx_table)
+{
+	if (!pfx_table->frozen)
+		return PFX_ERROR;
+
+	return pfx_table_frozen_rebuild(pfx_table);
+}
+
+void pfx_table_frozen_refresh(struct pfx_table *pfx_table, const unsigned int changes)
+{
+	struct pfx_frozen_state *state = pfx_table->frozen;
+
+	if (!state)
+		return;
+
+	if (changes < PFX_FROZEN_BACKGROUND_CHANGES) {
+		pfx_table_frozen_rebuild(pfx_table);
+		return;
+	}
+
+	pthread_mutex_lock(&state->mutex);
+	state->build_pending = true;
+	if (state->build_running) {
+		pthread_mutex_unlock(&state->mutex);
+		return;
+	}
+	state->build_running = true;
+	pthread_mutex_unlock(&state->mutex);
+
+	lrtr_executor_submit(&state->builds, pfx_table_frozen_builder, pfx_table);
+}
+
+/**
+ * @brief Validates a route with the frozen index without taking the lock of the pfx_table.
+ * @param[out] rtval Return value of the validation, only set if the frozen index was used.
+ * @return true If the frozen index matched the tries and was used for the validation.
+ */
+static bool pfx_table_validate_frozen(struct pfx_table *pfx_table, struct pfx_record **reason,
+				      unsigned int *reason_len, const uint32_t asn, const struct lrtr_ip_addr *prefix,
+				      const uint8_t prefix_len, enum pfxv_state *result, int *rtval)
+{
+	struct pfx_frozen_state *state = __atomic_load_n(&pfx_table->frozen, __ATOMIC_ACQUIRE);
+	struct pfx_frozen_snapshot *snapshot;
+	unsigned int epoch;
+	bool used = false;
+
+	if (!state)
+		return false;
+
+	while (true) {
+		epoch = __atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&state->readers[epoch], 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST) == epoch)
+			break;
+		__atomic_sub_fetch(&state->readers[epoch], 1, __ATOMIC_SEQ_CST);
+	}
+
+	snapshot = __atomic_load_n(&state->snapshot, __ATOMIC_SEQ_CST);
+	if (snapshot && snapshot->generation == __atomic_load_n(&state->generation, __ATOMIC_SEQ_CST)) {
+		*rtval = pfx_frozen_validate(snapshot->frozen, reason, reason_len, asn, prefix, prefix_len, result);
+		used = true;
+	}
+
+	__atomic_sub_fetch(&state->readers[epoch], 1, __ATOMIC_SEQ_CST);
+	return used;
 }
 
 void pfx_table_free_without_notify(struct pfx_table *pfx_table)
@@ -78,7 +669,12 @@ void pfx_table_free_without_notify(struct pfx_table *pfx_table)
 	pfx_table_free(pfx_table);
 }
 
-RTRLIB_EXPORT void pfx_table_free(struct pfx_table *pfx_table)
+/**
+ * @brief Removes all nodes from the tries.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] notify True if the clients are notified about the records of the nodes.
+ */
+static void pfx_table_free_tries(struct pfx_table *pfx_table, const bool notify)
 {
 	for (int i = 0; i < 2; i++) {
 		struct trie_node *root = (i == 0 ? pfx_table->ipv4 : pfx_table->ipv6);
@@ -86,11 +682,10 @@ RTRLIB_EXPORT void pfx_table_free(struct pfx_table *pfx_table)
 		if (root) {
 			struct trie_node *rm_node;
 
-			pthread_rwlock_wrlock(&(pfx_table->lock));
 			do {
 				struct node_data *data = (struct node_data *)(root->data);
 
-				for (unsigned int j = 0; j < data->len; j++) {
+				for (unsigned int j = 0; j < data->len && notify; j++) {
 					struct pfx_record record = {data->ary[j].asn, (root->prefix), root->len,
 								    data->ary[j].max_len, data->ary[j].socket};
 					pfx_table_notify_clients(pfx_table, &record, false);
@@ -105,11 +700,58 @@ RTRLIB_EXPORT void pfx_table_free(struct pfx_table *pfx_table)
 				pfx_table->ipv4 = NULL;
 			else
 				pfx_table->ipv6 = NULL;
-
-			pthread_rwlock_unlock(&(pfx_table->lock));
 		}
 	}
+	if (pfx_table->index) {
+		tommy_hashlin_done(&pfx_table->index->hashtable);
+		lrtr_free(pfx_table->index);
+		pfx_table->index = NULL;
+	}
+	pfx_table->tombstones = 0;
+	pfx_table_bspl_invalidate(pfx_table);
+}
+
+/* Notifies the clients of the table passed as data about a removed record, used as pfx_for_each_fp */
+static void pfx_table_notify_removed(const struct pfx_record *record, void *data)
+{
+	pfx_table_notify_clients(data, record, false);
+}
+
+RTRLIB_EXPORT void pfx_table_free(struct pfx_table *pfx_table)
+{
+	if (pfx_table->frozen) {
+		pthread_mutex_lock(&pfx_table->frozen->mutex);
+		pfx_table->frozen->stop = true;
+		pthread_mutex_unlock(&pfx_table->frozen->mutex);
+		lrtr_wait_group_wait(&pfx_table->frozen->builds);
+	}
+
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	if (pfx_table->succinct) {
+		pfx_succinct_for_each(pfx_table->succinct, LRTR_IPV4, pfx_table_notify_removed, pfx_table);
+		pfx_succinct_for_each(pfx_table->succinct, LRTR_IPV6, pfx_table_notify_removed, pfx_table);
+		pfx_succinct_free(pfx_table->succinct);
+		pfx_table->succinct = NULL;
+	}
+	// the clients know the original records, not the effective records of the tries
+	if (pfx_table->compressed) {
+		pfx_compressed_for_each(pfx_table->compressed, LRTR_IPV4, pfx_table_notify_removed, pfx_table);
+		pfx_compressed_for_each(pfx_table->compressed, LRTR_IPV6, pfx_table_notify_removed, pfx_table);
+	}
+	pfx_table_free_tries(pfx_table, !pfx_table->compressed);
+	pfx_compressed_free(pfx_table->compressed);
+	pfx_table->compressed = NULL;
+	pthread_rwlock_unlock(&(pfx_table->lock));
+
+	pfx_table_bspl_free(pfx_table->bspl);
+	pfx_table->bspl = NULL;
+	pfx_table_frozen_free(pfx_table->frozen);
+	pfx_table->frozen = NULL;
+	pfx_table->digest_ipv4 = 0;
+	pfx_table->digest_ipv6 = 0;
 	pthread_rwlock_destroy(&(pfx_table->lock));
+	pthread_rwlock_destroy(&(pfx_table->sync_lock));
+	pthread_mutex_destroy(&(pfx_table->update_mutex));
 }
 
 int pfx_table_append_elem(struct node_data *data, const struct pfx_record *record)
@@ -148,6 +790,8 @@ int pfx_table_create_node(struct trie_node **node, const struct pfx_record *reco
 
 	((struct node_data *)(*node)->data)->len = 0;
 	((struct node_data *)(*node)->data)->ary = NULL;
+	((struct node_data *)(*node)->data)->prefix = record->prefix;
+	((struct node_data *)(*node)->data)->prefix_len = record->min_len;
 
 	err = pfx_table_append_elem(((struct node_data *)(*node)->data), record);
 	if (err)
@@ -183,10 +827,9 @@ inline struct trie_node *pfx_table_get_root(const struct pfx_table *pfx_table, c
 	return ver == LRTR_IPV4 ? pfx_table->ipv4 : pfx_table->ipv6;
 }
 
-int pfx_table_del_elem(struct node_data *data, const unsigned int index)
+void pfx_table_del_elem(struct node_data *data, const unsigned int index)
 {
 	struct data_elem *tmp;
-	struct data_elem deleted_elem = data->ary[index];
 
 	// if index is not the last elem in the list, move all other elems backwards in the array
 	if (index != data->len - 1) {
@@ -198,316 +841,1723 @@ int pfx_table_del_elem(struct node_data *data, const unsigned int index)
 	if (!data->len) {
 		lrtr_free(data->ary);
 		data->ary = NULL;
-		return PFX_SUCCESS;
+		return;
 	}
 
+	// the array keeps its size if it can not be shrunk
 	tmp = lrtr_realloc(data->ary, sizeof(struct data_elem) * data->len);
-	if (!tmp) {
-		data->ary[data->len] = deleted_elem;
-		data->len++;
-		return PFX_ERROR;
-	}
-
-	data->ary = tmp;
-
-	return PFX_SUCCESS;
+	if (tmp)
+		data->ary = tmp;
 }
 
-RTRLIB_EXPORT int pfx_table_add(struct pfx_table *pfx_table, const struct pfx_record *record)
+/**
+ * @brief Restores a record of the succinct encoding that was marked as removed.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to add.
+ * @return PFX_SUCCESS If the record was restored.
+ * @return PFX_DUPLICATE_RECORD If the encoding holds the record.
+ * @return PFX_RECORD_NOT_FOUND If the record is not part of the encoding and has to be added to the trie.
+ */
+static int pfx_table_add_encoded(struct pfx_table *pfx_table, const struct pfx_record *record)
 {
-	pthread_rwlock_wrlock(&(pfx_table->lock));
+	uint32_t index;
+	bool removed;
 
-	struct trie_node *root = pfx_table_get_root(pfx_table, record->prefix.ver);
-	unsigned int lvl = 0;
+	if (!pfx_table->succinct || !pfx_succinct_find(pfx_table->succinct, record, &index, &removed))
+		return PFX_RECORD_NOT_FOUND;
+	if (!removed)
+		return PFX_DUPLICATE_RECORD;
 
-	if (root) {
-		bool found;
-		struct trie_node *node = trie_lookup_exact(root, &(record->prefix), record->min_len, &lvl, &found);
+	pfx_succinct_mark_removed(pfx_table->succinct, record->prefix.ver, index, false);
+	pfx_table_digest_update(pfx_table, record, true);
+	return PFX_SUCCESS;
+}
 
-		if (found) { // node with prefix exists
-			if (pfx_table_find_elem(node->data, record, NULL)) {
-				pthread_rwlock_unlock(&pfx_table->lock);
-				return PFX_DUPLICATE_RECORD;
-			}
-			// append record to note_data array
-			int rtval = pfx_table_append_elem(node->data, record);
+/**
+ * @brief Adds a record to the tries without notifying the clients.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to add.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_DUPLICATE_RECORD If the tries hold the record.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_insert_record(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	struct node_data *data = pfx_table_index_search(pfx_table, &(record->prefix), record->min_len);
 
-			pthread_rwlock_unlock(&pfx_table->lock);
-			if (rtval == PFX_SUCCESS)
-				pfx_table_notify_clients(pfx_table, record, true);
-			return rtval;
-		}
+	if (data) { // node with prefix exists
+		if (pfx_table_find_elem(data, record, NULL))
+			return PFX_DUPLICATE_RECORD;
 
-		// no node with same prefix and prefix_len found
-		struct trie_node *new_node = NULL;
+		// append record to note_data array, a tombstone becomes a regular node again
+		bool tombstone = data->len == 0;
 
-		if (pfx_table_create_node(&new_node, record) == PFX_ERROR) {
-			pthread_rwlock_unlock(&pfx_table->lock);
+		if (pfx_table_append_elem(data, record) == PFX_ERROR)
 			return PFX_ERROR;
-		}
-		trie_insert(node, new_node, lvl);
-		pthread_rwlock_unlock(&pfx_table->lock);
-		pfx_table_notify_clients(pfx_table, record, true);
+		if (tombstone)
+			pfx_table->tombstones--;
+		pfx_table_frozen_touch(pfx_table);
 		return PFX_SUCCESS;
 	}
 
-	// tree is empty, record will be the root_node
+	// no node with same prefix and prefix_len exists
+	struct trie_node *root = pfx_table_get_root(pfx_table, record->prefix.ver);
 	struct trie_node *new_node = NULL;
 
-	if (pfx_table_create_node(&new_node, record) == PFX_ERROR) {
-		pthread_rwlock_unlock(&pfx_table->lock);
+	if (pfx_table_create_node(&new_node, record) == PFX_ERROR)
+		return PFX_ERROR;
+	if (pfx_table_index_insert(pfx_table, new_node->data) == PFX_ERROR) {
+		lrtr_free(((struct node_data *)new_node->data)->ary);
+		lrtr_free(new_node->data);
+		lrtr_free(new_node);
 		return PFX_ERROR;
 	}
-	if (record->prefix.ver == LRTR_IPV4)
+
+	if (root) {
+		unsigned int lvl = 0;
+		bool found;
+		struct trie_node *node = trie_lookup_exact(root, &(record->prefix), record->min_len, &lvl, &found);
+
+		assert(!found);
+		trie_insert(node, new_node, lvl);
+	} else if (record->prefix.ver == LRTR_IPV4) {
+		// tree is empty, record will be the root_node
 		pfx_table->ipv4 = new_node;
-	else
+	} else {
 		pfx_table->ipv6 = new_node;
+	}
+	pfx_table_frozen_touch(pfx_table);
+	return PFX_SUCCESS;
+}
+
+RTRLIB_EXPORT int pfx_table_add(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	int rtval;
+
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+
+	// a record is either part of the succinct encoding or of the trie
+	int encoded = pfx_table_add_encoded(pfx_table, record);
+
+	if (encoded != PFX_RECORD_NOT_FOUND) {
+		pthread_rwlock_unlock(&pfx_table->lock);
+		if (encoded == PFX_SUCCESS)
+			pfx_table_notify_clients(pfx_table, record, true);
+		return encoded;
+	}
+
+	if (pfx_table->compressed) {
+		rtval = pfx_table_compressed_add(pfx_table, record);
+	} else {
+		rtval = pfx_table_insert_record(pfx_table, record);
+		if (rtval == PFX_SUCCESS)
+			pfx_table_digest_update(pfx_table, record, true);
+	}
+
+	// if the merge fails the record stays in the trie
+	if (rtval == PFX_SUCCESS && pfx_table->succinct) {
+		size_t nodes = tommy_hashlin_count(&pfx_table->index->hashtable);
+
+		if (nodes >= PFX_SUCCINCT_MIN_NODES && nodes >= pfx_succinct_count(pfx_table->succinct) / 4)
+			pfx_table_succinct_merge(pfx_table);
+	}
+
+	pthread_rwlock_unlock(&pfx_table->lock);
+	if (rtval == PFX_SUCCESS)
+		pfx_table_notify_clients(pfx_table, record, true);
+	return rtval;
+}
+
+/**
+ * @brief Removes the trie node of a node_data without records and frees it.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] ndata node_data to remove.
+ */
+static void pfx_table_remove_node(struct pfx_table *pfx_table, struct node_data *ndata)
+{
+	struct trie_node *root = pfx_table_get_root(pfx_table, ndata->prefix.ver);
+	struct trie_node *node = trie_remove(root, &(ndata->prefix), ndata->prefix_len, 0);
+
+	assert(node);
+	assert(node->data == ndata);
+
+	if (node == root) {
+		if (ndata->prefix.ver == LRTR_IPV4)
+			pfx_table->ipv4 = NULL;
+		else
+			pfx_table->ipv6 = NULL;
+	}
+	pfx_table_index_remove(pfx_table, ndata);
+	lrtr_free(ndata);
+	lrtr_free(node);
+}
+
+static void pfx_table_collect_tombstones(const struct trie_node *node, struct node_data **tombstones,
+					 unsigned int *len)
+{
+	struct node_data *data = node->data;
+
+	if (data->len == 0)
+		tombstones[(*len)++] = data;
+
+	if (node->lchild)
+		pfx_table_collect_tombstones(node->lchild, tombstones, len);
+	if (node->rchild)
+		pfx_table_collect_tombstones(node->rchild, tombstones, len);
+}
+
+/**
+ * @brief Removes all tombstones from the tries in one pass.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error, the tombstones stay in the tries.
+ */
+int pfx_table_compact_locked(struct pfx_table *pfx_table)
+{
+	struct node_data **tombstones;
+	unsigned int len = 0;
+
+	if (pfx_table->tombstones == 0)
+		return PFX_SUCCESS;
+
+	tombstones = lrtr_malloc(sizeof(*tombstones) * pfx_table->tombstones);
+	if (!tombstones)
+		return PFX_ERROR;
+
+	// node_data is only moved between the nodes by trie_remove, so the collected pointers stay valid
+	if (pfx_table->ipv4)
+		pfx_table_collect_tombstones(pfx_table->ipv4, tombstones, &len);
+	if (pfx_table->ipv6)
+		pfx_table_collect_tombstones(pfx_table->ipv6, tombstones, &len);
+	assert(len == pfx_table->tombstones);
+
+	for (unsigned int i = 0; i < len; i++)
+		pfx_table_remove_node(pfx_table, tombstones[i]);
+	lrtr_free(tombstones);
+	pfx_table->tombstones = 0;
+
+	return PFX_SUCCESS;
+}
+
+RTRLIB_EXPORT int pfx_table_compact(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	int rtval = pfx_table_compact_locked(pfx_table);
+
+	pthread_rwlock_unlock(&pfx_table->lock);
+	return rtval;
+}
+
+/**
+ * @brief Merges the trie and the succinct encoding if enough records were added or removed since it was built.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ */
+static void pfx_table_succinct_refresh(struct pfx_table *pfx_table)
+{
+	size_t changes;
+
+	if (!pfx_table->succinct)
+		return;
+
+	changes = pfx_succinct_removed(pfx_table->succinct);
+	if (pfx_table->index)
+		changes += tommy_hashlin_count(&pfx_table->index->hashtable);
+	if (changes > 0 && changes >= pfx_succinct_count(pfx_table->succinct) / PFX_SUCCINCT_SYNC_RATIO)
+		pfx_table_succinct_merge(pfx_table);
+}
+
+void pfx_table_compact_after_sync(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	if (pfx_table->tombstones > 0 &&
+	    pfx_table->tombstones >= tommy_hashlin_count(&pfx_table->index->hashtable) / PFX_TOMBSTONE_SYNC_RATIO)
+		pfx_table_compact_locked(pfx_table);
+	pfx_table_succinct_refresh(pfx_table);
+	pthread_rwlock_unlock(&pfx_table->lock);
+}
+
+RTRLIB_EXPORT int pfx_table_set_removal(struct pfx_table *pfx_table, enum pfx_removal removal)
+{
+	int rtval = PFX_SUCCESS;
+
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	if (removal == PFX_REMOVAL_IMMEDIATE)
+		rtval = pfx_table_compact_locked(pfx_table);
+	if (rtval == PFX_SUCCESS)
+		pfx_table->defer_removal = removal == PFX_REMOVAL_DEFERRED;
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	return rtval;
+}
+
+/**
+ * @brief Marks a record of the succinct encoding as removed.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to remove.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_RECORD_NOT_FOUND If the encoding does not hold the record.
+ */
+static int pfx_table_remove_encoded(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	uint32_t index;
+	bool removed;
+
+	if (!pfx_table->succinct || !pfx_succinct_find(pfx_table->succinct, record, &index, &removed) || removed)
+		return PFX_RECORD_NOT_FOUND;
+
+	pfx_succinct_mark_removed(pfx_table->succinct, record->prefix.ver, index, true);
+	pfx_table_digest_update(pfx_table, record, false);
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Removes a record from a trie node, the node is removed or left as tombstone if it becomes empty.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] ndata node_data that holds the record.
+ * @param[in] index Index of the record in @p ndata.
+ */
+static void pfx_table_delete_elem(struct pfx_table *pfx_table, struct node_data *ndata, const unsigned int index)
+{
+	pfx_table_del_elem(ndata, index);
+	pfx_table_frozen_touch(pfx_table);
+
+	if (ndata->len == 0 && pfx_table->defer_removal) {
+		// the node stays in the trie, if the compaction fails it is retried by the next removal
+		pfx_table->tombstones++;
+		if (pfx_table->tombstones > tommy_hashlin_count(&pfx_table->index->hashtable) / 2)
+			pfx_table_compact_locked(pfx_table);
+	} else if (ndata->len == 0) {
+		// the trie only has to be traversed if the node itself is removed
+		pfx_table_remove_node(pfx_table, ndata);
+	}
+}
+
+/**
+ * @brief Removes a record from the tries without notifying the clients.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to remove.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_RECORD_NOT_FOUND If the table does not contain the record.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_remove_record(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	if (pfx_table->compressed)
+		return pfx_table_compressed_remove(pfx_table, record);
+
+	struct node_data *ndata = pfx_table_index_search(pfx_table, &(record->prefix), record->min_len);
+
+	if (!ndata)
+		return pfx_table_remove_encoded(pfx_table, record);
+
+	unsigned int index;
+	struct data_elem *elem = pfx_table_find_elem(ndata, record, &index);
+
+	if (!elem)
+		return pfx_table_remove_encoded(pfx_table, record);
+
+	pfx_table_delete_elem(pfx_table, ndata, index);
+	pfx_table_digest_update(pfx_table, record, false);
+	return PFX_SUCCESS;
+}
+
+RTRLIB_EXPORT int pfx_table_remove(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	int rtval = pfx_table_remove_record(pfx_table, record);
+
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	if (rtval == PFX_SUCCESS)
+		pfx_table_notify_clients(pfx_table, record, false);
+
+	return rtval;
+}
+
+/**
+ * @brief Effective records that are collected by pfx_table_compressed_subsumed().
+ */
+struct compressed_collect_args {
+	struct pfx_record *records;
+	unsigned int len;
+	unsigned int size;
+	bool error;
+};
+
+/* Returns the effective record at an index of a trie node */
+static struct pfx_record pfx_table_compressed_elem(const struct node_data *data, const unsigned int index)
+{
+	struct pfx_record effective = {data->ary[index].asn, data->prefix, data->prefix_len, data->ary[index].max_len,
+				       NULL};
+
+	return effective;
+}
+
+/**
+ * @brief Searches an effective record that subsumes a record.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the lock.
+ * @param[in] record Effective record to check.
+ * @param[in] ignored Effective record that is not considered, may be NULL.
+ * @param[out] cover Subsuming effective record.
+ * @return true If an effective record subsumes @p record.
+ */
+static bool pfx_table_compressed_cover(const struct pfx_table *pfx_table, const struct pfx_record *record,
+				       const struct pfx_record *ignored, struct pfx_record *cover)
+{
+	struct trie_node *node = pfx_table_get_root(pfx_table, record->prefix.ver);
+	unsigned int lvl = 0;
+
+	if (node)
+		node = trie_lookup(node, &(record->prefix), record->min_len, &lvl);
+	while (node) {
+		const struct node_data *data = node->data;
+
+		for (unsigned int i = 0; i < data->len; i++) {
+			struct pfx_record effective = pfx_table_compressed_elem(data, i);
+
+			if ((!ignored || !pfx_compressed_equal(&effective, ignored)) &&
+			    pfx_compressed_subsumes(&effective, record)) {
+				*cover = effective;
+				return true;
+			}
+		}
+
+		if (lrtr_ip_addr_is_zero(lrtr_ip_addr_get_bits(&(record->prefix), lvl++, 1)))
+			node = trie_lookup(node->lchild, &(record->prefix), record->min_len, &lvl);
+		else
+			node = trie_lookup(node->rchild, &(record->prefix), record->min_len, &lvl);
+	}
+	return false;
+}
+
+/**
+ * @brief Collects the effective records of a subtree that are subsumed by a record.
+ * @param[in] node Root of the subtree.
+ * @param[in] lvl Level of @p node in the trie.
+ * @param[in] record Effective record, it is not collected itself.
+ * @param[in] ignored Effective record that is not collected, may be NULL.
+ * @param[in,out] args Collected records.
+ */
+static void pfx_table_compressed_subsumed(const struct trie_node *node, const unsigned int lvl,
+					  const struct pfx_record *record, const struct pfx_record *ignored,
+					  struct compressed_collect_args *args)
+{
+	const struct node_data *data = node->data;
+
+	for (unsigned int i = 0; i < data->len && !args->error; i++) {
+		struct pfx_record effective = pfx_table_compressed_elem(data, i);
+
+		if (pfx_compressed_equal(&effective, record) || !pfx_compressed_subsumes(record, &effective) ||
+		    (ignored && pfx_compressed_equal(&effective, ignored)))
+			continue;
+
+		if (args->len == args->size) {
+			unsigned int size = args->size ? 2 * args->size : 8;
+			struct pfx_record *tmp = lrtr_realloc(args->records, sizeof(*tmp) * size);
+
+			if (!tmp) {
+				args->error = true;
+				return;
+			}
+			args->records = tmp;
+			args->size = size;
+		}
+		args->records[args->len++] = effective;
+	}
+
+	// above the length of the record, only the child on the path of its prefix holds covered prefixes
+	if (lvl < record->min_len) {
+		const struct trie_node *child = lrtr_ip_addr_is_zero(lrtr_ip_addr_get_bits(&(record->prefix), lvl, 1)) ?
+							node->lchild :
+							node->rchild;
+
+		if (child)
+			pfx_table_compressed_subsumed(child, lvl + 1, record, ignored, args);
+		return;
+	}
+
+	if (node->lchild && !args->error)
+		pfx_table_compressed_subsumed(node->lchild, lvl + 1, record, ignored, args);
+	if (node->rchild && !args->error)
+		pfx_table_compressed_subsumed(node->rchild, lvl + 1, record, ignored, args);
+}
+
+/**
+ * @brief Searches the effective record of an origin AS at a prefix.
+ * @details There is at most one for an AS other than 0, the one with the larger maximum length would subsume the
+ * others.
+ * @return true If the record was found.
+ */
+static bool pfx_table_compressed_get(const struct pfx_table *pfx_table, const struct lrtr_ip_addr *prefix,
+				     const uint8_t prefix_len, const uint32_t asn, struct pfx_record *effective)
+{
+	const struct node_data *data = pfx_table_index_search(pfx_table, prefix, prefix_len);
+
+	for (unsigned int i = 0; data && i < data->len; i++) {
+		if (data->ary[i].asn == asn) {
+			*effective = pfx_table_compressed_elem(data, i);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Removes an effective record from the tries.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] effective Effective record, the original records stay assigned to it.
+ */
+static void pfx_table_compressed_delete(struct pfx_table *pfx_table, const struct pfx_record *effective)
+{
+	struct node_data *data = pfx_table_index_search(pfx_table, &(effective->prefix), effective->min_len);
+	unsigned int index;
+
+	assert(data);
+	if (pfx_table_find_elem(data, effective, &index))
+		pfx_table_delete_elem(pfx_table, data, index);
+}
+
+/**
+ * @brief Absorbs the effective records that a new effective record subsumes.
+ * @details The original records of the absorbed records become subsumed records of @p effective. If they can not
+ * be collected, they stay in the tries, which does not change any validation result.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] effective Effective record that was added to the tries.
+ * @param[in] ignored Effective record that is not absorbed, may be NULL.
+ */
+static void pfx_table_compressed_absorb(struct pfx_table *pfx_table, const struct pfx_record *effective,
+					const struct pfx_record *ignored)
+{
+	struct compressed_collect_args args = {NULL, 0, 0, false};
+	const struct trie_node *root = pfx_table_get_root(pfx_table, effective->prefix.ver);
+
+	if (root)
+		pfx_table_compressed_subsumed(root, 0, effective, ignored, &args);
+
+	for (unsigned int i = 0; i < args.len; i++) {
+		pfx_table_compressed_delete(pfx_table, &args.records[i]);
+		pfx_compressed_move(pfx_table->compressed, &args.records[i], effective, false);
+	}
+	lrtr_free(args.records);
+}
+
+/**
+ * @brief Merges an effective record with two others of the same origin AS into one record.
+ * @details Two sibling prefixes with the same maximum length and their parent prefix with a smaller maximum length
+ * give the same validation results as the parent prefix with the maximum length of the siblings. The record is
+ * merged as one of the siblings or as the parent, the merged record is merged again. No record is merged if the
+ * merged record can not be added to the tries.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] effective Effective record of the tries, not a pointer into the store.
+ */
+static void pfx_table_compressed_aggregate(struct pfx_table *pfx_table, const struct pfx_record *effective)
+{
+	const uint8_t bits = effective->prefix.ver == LRTR_IPV4 ? 32 : 128;
+	const uint8_t len = effective->min_len;
+	struct pfx_record parts[3] = {*effective};
+	struct pfx_record merged;
+	bool found = false;
+
+	// records of AS 0 are either subsumed or cover different prefixes
+	if (effective->asn == 0)
+		return;
+
+	if (len > 0) {
+		struct lrtr_ip_addr sibling = pfx_compressed_flip(&(effective->prefix), len - 1);
+		struct lrtr_ip_addr parent = pfx_compressed_mask(&(effective->prefix), len - 1);
+
+		found = pfx_table_compressed_get(pfx_table, &sibling, len, effective->asn, &parts[1]) &&
+			parts[1].max_len == effective->max_len &&
+			pfx_table_compressed_get(pfx_table, &parent, len - 1, effective->asn, &parts[2]) &&
+			parts[2].max_len < effective->max_len;
+		merged = parts[2];
+		merged.max_len = effective->max_len;
+	}
+
+	if (!found && len < bits) {
+		struct lrtr_ip_addr right = pfx_compressed_flip(&(effective->prefix), len);
+
+		found = pfx_table_compressed_get(pfx_table, &(effective->prefix), len + 1, effective->asn, &parts[1]) &&
+			pfx_table_compressed_get(pfx_table, &right, len + 1, effective->asn, &parts[2]) &&
+			parts[1].max_len == parts[2].max_len && parts[1].max_len > effective->max_len;
+		merged = *effective;
+		merged.max_len = parts[1].max_len;
+	}
+
+	// every record that subsumes the merged record would subsume its parts, so it is not subsumed
+	if (!found || pfx_table_insert_record(pfx_table, &merged) != PFX_SUCCESS)
+		return;
+
+	for (unsigned int i = 0; i < 3; i++) {
+		pfx_table_compressed_delete(pfx_table, &parts[i]);
+		pfx_compressed_move(pfx_table->compressed, &parts[i], &merged, true);
+	}
+	pfx_table_compressed_aggregate(pfx_table, &merged);
+}
+
+/**
+ * @brief Assigns a detached original record to an effective record.
+ * @details If no effective record subsumes the original record, it is added to the tries as a new effective
+ * record that absorbs the effective records it subsumes.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] entry Original record.
+ * @param[in] ignored Effective record that is neither used nor absorbed, may be NULL.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error, @p entry stays detached.
+ */
+static int pfx_table_compressed_place(struct pfx_table *pfx_table, struct pfx_compressed_entry *entry,
+				      const struct pfx_record *ignored)
+{
+	struct pfx_record effective = pfx_compressed_effective(&(entry->record));
+	struct pfx_record cover;
+
+	if (pfx_table_compressed_cover(pfx_table, &effective, ignored, &cover)) {
+		pfx_compressed_attach(pfx_table->compressed, entry, &cover, false);
+		return PFX_SUCCESS;
+	}
+
+	if (pfx_table_insert_record(pfx_table, &effective) != PFX_SUCCESS)
+		return PFX_ERROR;
+	pfx_compressed_attach(pfx_table->compressed, entry, &effective, true);
+	pfx_table_compressed_absorb(pfx_table, &effective, ignored);
+	return PFX_SUCCESS;
+}
+
+/* Checks if an original record is the only one its effective record was derived from */
+static bool pfx_table_compressed_own(const struct pfx_compressed_entry *entry)
+{
+	struct pfx_record effective = pfx_compressed_effective(&(entry->record));
+
+	return entry->attached && entry->structural && pfx_compressed_equal(&(entry->effective), &effective);
+}
+
+/* Makes all original records of an effective record structural */
+static void pfx_table_compressed_restructure(struct pfx_compressed *compressed, const struct pfx_record *effective)
+{
+	struct pfx_compressed_entry *detached = pfx_compressed_detach(compressed, effective);
+
+	while (detached) {
+		struct pfx_compressed_entry *next = detached->next;
+
+		pfx_compressed_attach(compressed, detached, effective, true);
+		detached = next;
+	}
+}
+
+/**
+ * @brief Assigns original records that were placed while an effective record was ignored to it again.
+ * @details The effective records that were derived from the records are removed from the tries again, their
+ * original records are assigned to @p effective as well.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] effective Effective record that was ignored.
+ * @param[in] placed Original records that were placed.
+ * @param[in] placed_len Number of elements in @p placed.
+ */
+static void pfx_table_compressed_restore(struct pfx_table *pfx_table, const struct pfx_record *effective,
+					 struct pfx_compressed_entry **placed, const unsigned int placed_len)
+{
+	for (unsigned int i = 0; i < placed_len; i++) {
+		struct pfx_compressed_entry *entry = placed[i];
+		struct pfx_record other = entry->effective;
+		struct pfx_compressed_entry *detached;
+
+		if (pfx_compressed_equal(&other, effective)) {
+			continue;
+		} else if (pfx_table_compressed_own(entry)) {
+			pfx_table_compressed_delete(pfx_table, &other);
+			pfx_compressed_move(pfx_table->compressed, &other, effective, false);
+			continue;
+		}
+
+		// the record is subsumed by an effective record that stays, only the record itself is reassigned
+		detached = pfx_compressed_detach(pfx_table->compressed, &other);
+		while (detached) {
+			struct pfx_compressed_entry *next = detached->next;
+
+			if (detached == entry)
+				pfx_compressed_attach(pfx_table->compressed, detached, effective, false);
+			else
+				pfx_compressed_attach(pfx_table->compressed, detached, &other, detached->structural);
+			detached = next;
+		}
+	}
+}
+
+/**
+ * @brief Adds an original record to a table with PFX_STORAGE_COMPRESSED.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to add.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_DUPLICATE_RECORD If the table holds the record.
+ * @return PFX_ERROR On error.
+ */
+int pfx_table_compressed_add(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	struct pfx_compressed_entry *entry;
+
+	if (pfx_compressed_find(pfx_table->compressed, record))
+		return PFX_DUPLICATE_RECORD;
+
+	entry = pfx_compressed_add(pfx_table->compressed, record);
+	if (!entry)
+		return PFX_ERROR;
+	if (pfx_table_compressed_place(pfx_table, entry, NULL) == PFX_ERROR) {
+		pfx_compressed_remove(pfx_table->compressed, entry);
+		return PFX_ERROR;
+	}
+
+	// a record that is subsumed does not change the tries
+	if (entry->structural) {
+		struct pfx_record effective = entry->effective;
+
+		pfx_table_compressed_aggregate(pfx_table, &effective);
+	}
+	pfx_table_digest_update(pfx_table, record, true);
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Removes an original record from a table with PFX_STORAGE_COMPRESSED.
+ * @details Removing a subsumed record does not change the tries. If the effective record was derived from the
+ * record, the other original records of the effective record are placed again while it is ignored, then it is
+ * removed. If they can not be placed, the effective record stays and all of its original records become
+ * structural, so it is placed again with the next removal.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @param[in] record Record to remove.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_RECORD_NOT_FOUND If the table does not contain the record.
+ * @return PFX_ERROR On error, the record stays in the table.
+ */
+int pfx_table_compressed_remove(struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	struct pfx_compressed *compressed = pfx_table->compressed;
+	struct pfx_compressed_entry *entry = pfx_compressed_find(compressed, record);
+	struct pfx_compressed_entry **others;
+	struct pfx_compressed_entry *detached;
+	struct pfx_compressed_entry *successor = NULL;
+	struct pfx_record effective;
+	unsigned int others_len = 0;
+	unsigned int placed = 0;
+
+	if (!entry)
+		return PFX_RECORD_NOT_FOUND;
+
+	effective = entry->effective;
+	if (!entry->structural) {
+		pfx_compressed_remove(compressed, entry);
+		pfx_table_digest_update(pfx_table, record, false);
+		return PFX_SUCCESS;
+	}
+
+	detached = pfx_compressed_detach(compressed, &effective);
+	for (struct pfx_compressed_entry *other = detached; other; other = other->next) {
+		struct pfx_record own = pfx_compressed_effective(&(other->record));
+
+		others_len++;
+		// another source of the same VRP takes over the effective record
+		if (other != entry && pfx_compressed_equal(&own, &effective))
+			successor = other;
+	}
+
+	others = successor ? NULL : lrtr_malloc(sizeof(*others) * others_len);
+	others_len = 0;
+	while (detached) {
+		struct pfx_compressed_entry *next = detached->next;
+
+		if (detached != entry && others)
+			others[others_len++] = detached;
+		else if (detached != entry)
+			pfx_compressed_attach(compressed, detached, &effective,
+					      detached == successor || detached->structural);
+		detached = next;
+	}
+
+	if (successor) {
+		pfx_compressed_remove(compressed, entry);
+		pfx_table_digest_update(pfx_table, record, false);
+		return PFX_SUCCESS;
+	}
+	if (!others) {
+		pfx_compressed_attach(compressed, entry, &effective, true);
+		return PFX_ERROR;
+	}
+
+	while (placed < others_len && pfx_table_compressed_place(pfx_table, others[placed], &effective) == PFX_SUCCESS)
+		placed++;
+
+	if (placed < others_len) {
+		pfx_table_compressed_restore(pfx_table, &effective, others, placed);
+		for (unsigned int i = placed; i < others_len; i++)
+			pfx_compressed_attach(compressed, others[i], &effective, true);
+		pfx_compressed_attach(compressed, entry, &effective, true);
+		pfx_table_compressed_restructure(compressed, &effective);
+		lrtr_free(others);
+		return PFX_ERROR;
+	}
+
+	pfx_table_compressed_delete(pfx_table, &effective);
+	pfx_compressed_remove(compressed, entry);
+	pfx_table_digest_update(pfx_table, record, false);
+
+	// the records that were placed while the effective record was ignored are merged now
+	for (unsigned int i = 0; i < others_len; i++) {
+		if (pfx_table_compressed_own(others[i])) {
+			struct pfx_record own = others[i]->effective;
+
+			pfx_table_compressed_aggregate(pfx_table, &own);
+		}
+	}
+	lrtr_free(others);
+	return PFX_SUCCESS;
+}
+
+bool pfx_table_elem_matches(struct node_data *data, const uint32_t asn, const uint8_t prefix_len)
+{
+	for (unsigned int i = 0; i < data->len; i++) {
+		if (data->ary[i].asn != 0 && data->ary[i].asn == asn && prefix_len <= data->ary[i].max_len)
+			return true;
+	}
+	return false;
+}
+
+inline void pfx_table_free_reason(struct pfx_record **reason, unsigned int *reason_len)
+{
+	if (reason) {
+		lrtr_free(*reason);
+		*reason = NULL;
+	}
+	if (reason_len)
+		*reason_len = 0;
+}
+
+static void pfx_table_bspl_collect(const struct trie_node *node, struct bspl_prefix *prefixes, unsigned int *len)
+{
+	prefixes[*len].prefix = node->prefix;
+	prefixes[*len].len = node->len;
+	prefixes[*len].data = node->data;
+	(*len)++;
+
+	if (node->lchild)
+		pfx_table_bspl_collect(node->lchild, prefixes, len);
+	if (node->rchild)
+		pfx_table_bspl_collect(node->rchild, prefixes, len);
+}
+
+/**
+ * @brief Rebuilds the bspl structures from the tries.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the lock and the mutex of the engine.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_bspl_rebuild(struct pfx_table *pfx_table)
+{
+	struct pfx_bspl *bspl = pfx_table->bspl;
+	unsigned int nodes = pfx_table->index ? tommy_hashlin_count(&pfx_table->index->hashtable) : 0;
+	struct bspl_prefix *prefixes = lrtr_malloc(sizeof(*prefixes) * (nodes + 1));
+	struct bspl *ipv4;
+	struct bspl *ipv6;
+	unsigned int len = 0;
+
+	if (!prefixes)
+		return PFX_ERROR;
+
+	if (pfx_table->ipv4)
+		pfx_table_bspl_collect(pfx_table->ipv4, prefixes, &len);
+	ipv4 = bspl_build(prefixes, len);
+
+	len = 0;
+	if (pfx_table->ipv6)
+		pfx_table_bspl_collect(pfx_table->ipv6, prefixes, &len);
+	ipv6 = bspl_build(prefixes, len);
+	lrtr_free(prefixes);
+
+	if (!ipv4 || !ipv6) {
+		bspl_free(ipv4);
+		bspl_free(ipv6);
+		return PFX_ERROR;
+	}
+
+	bspl_free(bspl->ipv4);
+	bspl_free(bspl->ipv6);
+	bspl->ipv4 = ipv4;
+	bspl->ipv6 = ipv6;
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Checks if a validation can use the bspl structures and rebuilds them if they are outdated and enough
+ * validations were answered by the trie since the last change.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the read lock.
+ * @return true If the bspl structures match the tries.
+ */
+static bool pfx_table_bspl_ready(struct pfx_table *pfx_table)
+{
+	struct pfx_bspl *bspl = pfx_table->bspl;
+	unsigned int nodes;
+
+	if (!__atomic_load_n(&bspl->dirty, __ATOMIC_ACQUIRE))
+		return true;
+
+	nodes = pfx_table->index ? tommy_hashlin_count(&pfx_table->index->hashtable) : 0;
+	if (__atomic_add_fetch(&bspl->trie_lookups, 1, __ATOMIC_RELAXED) <= nodes / PFX_BSPL_REBUILD_RATIO)
+		return false;
+
+	if (pthread_mutex_trylock(&bspl->mutex) != 0)
+		return false;
+
+	if (__atomic_load_n(&bspl->dirty, __ATOMIC_ACQUIRE)) {
+		if (pfx_table_bspl_rebuild(pfx_table) == PFX_SUCCESS)
+			__atomic_store_n(&bspl->dirty, false, __ATOMIC_RELEASE);
+		else
+			__atomic_store_n(&bspl->trie_lookups, 0, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&bspl->mutex);
+
+	return !__atomic_load_n(&bspl->dirty, __ATOMIC_ACQUIRE);
+}
+
+static int pfx_table_append_reason(struct pfx_record **reason, unsigned int *reason_len, const struct node_data *data)
+{
+	struct pfx_record *tmp;
+
+	if (data->len == 0)
+		return PFX_SUCCESS;
+
+	tmp = lrtr_realloc(*reason, (*reason_len + data->len) * sizeof(struct pfx_record));
+	if (!tmp)
+		return PFX_ERROR;
+
+	*reason = tmp;
+	for (unsigned int i = 0; i < data->len; i++) {
+		struct pfx_record *record = &(*reason)[*reason_len + i];
+
+		record->asn = data->ary[i].asn;
+		record->prefix = data->prefix;
+		record->min_len = data->prefix_len;
+		record->max_len = data->ary[i].max_len;
+		record->socket = data->ary[i].socket;
+	}
+	*reason_len += data->len;
+	return PFX_SUCCESS;
+}
+
+static int pfx_table_append_reason_record(struct pfx_record **reason, unsigned int *reason_len,
+					  const struct pfx_record *record)
+{
+	struct pfx_record *tmp = lrtr_realloc(*reason, (*reason_len + 1) * sizeof(struct pfx_record));
+
+	if (!tmp)
+		return PFX_ERROR;
+
+	*reason = tmp;
+	(*reason)[(*reason_len)++] = *record;
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Validates a route with the bspl structures, the result and reason equal the one of the trie.
+ * @details The covering prefixes are checked from the shortest to the longest one, until one matches.
+ */
+static int pfx_table_validate_bspl(struct pfx_table *pfx_table, struct pfx_record **reason,
+				   unsigned int *reason_len, const uint32_t asn, const struct lrtr_ip_addr *prefix,
+				   const uint8_t prefix_len, enum pfxv_state *result)
+{
+	const struct bspl *bspl = prefix->ver == LRTR_IPV4 ? pfx_table->bspl->ipv4 : pfx_table->bspl->ipv6;
+	const struct bspl_entry *covering[129];
+	unsigned int covering_len = 0;
+	bool covered = false;
+
+	for (const struct bspl_entry *entry = bspl_lookup(bspl, prefix, prefix_len); entry; entry = entry->parent)
+		covering[covering_len++] = entry;
+
+	if (covering_len == 0) {
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+		return PFX_SUCCESS;
+	}
+
+	if (reason_len && reason)
+		*reason_len = 0;
+
+	while (covering_len > 0) {
+		const struct bspl_entry *entry = covering[--covering_len];
+
+		for (unsigned int i = 0; i < entry->data_len; i++) {
+			struct node_data *data = entry->data[i];
+
+			covered = covered || data->len > 0;
+			if (reason_len && reason && pfx_table_append_reason(reason, reason_len, data) == PFX_ERROR) {
+				pfx_table_free_reason(reason, reason_len);
+				return PFX_ERROR;
+			}
+
+			if (pfx_table_elem_matches(data, asn, prefix_len)) {
+				*result = BGP_PFXV_STATE_VALID;
+				return PFX_SUCCESS;
+			}
+		}
+	}
+
+	// only tombstones cover the route
+	if (!covered) {
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+		return PFX_SUCCESS;
+	}
+
+	*result = BGP_PFXV_STATE_INVALID;
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Validates a route with the succinct encoding and the trie, the result and reason equal the one of a
+ * table that holds all records in the trie.
+ * @details The covering prefixes of both are checked from the shortest to the longest one, until one matches.
+ */
+static int pfx_table_validate_succinct(struct pfx_table *pfx_table, struct pfx_record **reason,
+				       unsigned int *reason_len, const uint32_t asn, const struct lrtr_ip_addr *prefix,
+				       const uint8_t prefix_len, enum pfxv_state *result)
+{
+	const struct trie_node *nodes[129];
+	unsigned int nodes_len = 0;
+	unsigned int lvl = 0;
+	struct trie_node *node = pfx_table_get_root(pfx_table, prefix->ver);
+	const uint8_t max_len = prefix->ver == LRTR_IPV4 ? 32 : 128;
+	bool covered = false;
+
+	// the covering trie nodes from the shortest to the longest prefix
+	if (node)
+		node = trie_lookup(node, prefix, prefix_len, &lvl);
+	while (node) {
+		nodes[nodes_len++] = node;
+		if (lrtr_ip_addr_is_zero(lrtr_ip_addr_get_bits(prefix, lvl++, 1)))
+			node = trie_lookup(node->lchild, prefix, prefix_len, &lvl);
+		else
+			node = trie_lookup(node->rchild, prefix, prefix_len, &lvl);
+	}
+
+	if (reason_len && reason)
+		*reason_len = 0;
+
+	for (unsigned int len = 0, i = 0; len <= prefix_len && len <= max_len; len++) {
+		struct pfx_succinct_range range;
+		struct pfx_record record;
+		bool matched = false;
+
+		if (pfx_succinct_find_prefix(pfx_table->succinct, prefix, len, &range)) {
+			while (pfx_succinct_next(pfx_table->succinct, &range, &record, NULL)) {
+				covered = true;
+				if (record.asn != 0 && record.asn == asn && prefix_len <= record.max_len)
+					matched = true;
+				if (reason_len && reason &&
+				    pfx_table_append_reason_record(reason, reason_len, &record) == PFX_ERROR) {
+					pfx_table_free_reason(reason, reason_len);
+					return PFX_ERROR;
+				}
+			}
+		}
+
+		if (i < nodes_len && nodes[i]->len == len) {
+			struct node_data *data = nodes[i++]->data;
+
+			covered = covered || data->len > 0;
+			matched = matched || pfx_table_elem_matches(data, asn, prefix_len);
+			if (reason_len && reason && pfx_table_append_reason(reason, reason_len, data) == PFX_ERROR) {
+				pfx_table_free_reason(reason, reason_len);
+				return PFX_ERROR;
+			}
+		}
+
+		if (matched) {
+			*result = BGP_PFXV_STATE_VALID;
+			return PFX_SUCCESS;
+		}
+	}
+
+	if (!covered) {
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+		return PFX_SUCCESS;
+	}
+
+	*result = BGP_PFXV_STATE_INVALID;
+	return PFX_SUCCESS;
+}
+
+/**
+ * @brief Arguments of pfx_table_compressed_reason_cb().
+ * @param reason Original records that were collected.
+ * @param reason_len Number of elements in reason.
+ * @param prefix Prefix of the validated route.
+ * @param prefix_len Prefix length of the validated route.
+ * @param error True if reason could not be grown.
+ */
+struct compressed_reason_args {
+	struct pfx_record *reason;
+	unsigned int reason_len;
+	const struct lrtr_ip_addr *prefix;
+	uint8_t prefix_len;
+	bool error;
+};
+
+/* Appends an original record that covers the route to the reason, used as pfx_for_each_fp */
+static void pfx_table_compressed_reason_cb(const struct pfx_record *record, void *data)
+{
+	struct compressed_reason_args *args = data;
+
+	if (args->error || !pfx_compressed_covers(&(record->prefix), record->min_len, args->prefix, args->prefix_len))
+		return;
+	if (pfx_table_append_reason_record(&args->reason, &args->reason_len, record) == PFX_ERROR)
+		args->error = true;
+}
+
+/**
+ * @brief Replaces the effective records of a reason with the original records that cover the route.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the lock.
+ * @param[in,out] reason Effective records that cover the route, the original records on success.
+ * @param[in,out] reason_len Number of elements in @p reason.
+ * @param[in] prefix Prefix of the validated route.
+ * @param[in] prefix_len Prefix length of the validated route.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error, the reason is freed.
+ */
+static int pfx_table_compressed_reason(struct pfx_table *pfx_table, struct pfx_record **reason,
+				       unsigned int *reason_len, const struct lrtr_ip_addr *prefix,
+				       const uint8_t prefix_len)
+{
+	struct compressed_reason_args args = {NULL, 0, prefix, prefix_len, false};
+
+	for (unsigned int i = 0; i < *reason_len && !args.error; i++)
+		pfx_compressed_for_each_original(pfx_table->compressed, &(*reason)[i], pfx_table_compressed_reason_cb,
+						 &args);
+
+	pfx_table_free_reason(reason, reason_len);
+	if (args.error) {
+		lrtr_free(args.reason);
+		return PFX_ERROR;
+	}
+	*reason = args.reason;
+	*reason_len = args.reason_len;
+	return PFX_SUCCESS;
+}
+
+RTRLIB_EXPORT int pfx_table_validate_r(struct pfx_table *pfx_table, struct pfx_record **reason,
+				       unsigned int *reason_len, const uint32_t asn, const struct lrtr_ip_addr *prefix,
+				       const uint8_t prefix_len, enum pfxv_state *result)
+{
+	// assert(reason_len == NULL || *reason_len  == 0);
+	// assert(reason == NULL || *reason == NULL);
+	int frozen_rtval;
+
+	if (pfx_table_validate_frozen(pfx_table, reason, reason_len, asn, prefix, prefix_len, result, &frozen_rtval))
+		return frozen_rtval;
+
+	pthread_rwlock_rdlock(&(pfx_table->lock));
+	if (pfx_table->bspl && pfx_table_bspl_ready(pfx_table)) {
+		int rtval = pfx_table_validate_bspl(pfx_table, reason, reason_len, asn, prefix, prefix_len, result);
+
+		pthread_rwlock_unlock(&pfx_table->lock);
+		return rtval;
+	}
+
+	if (pfx_table->succinct) {
+		int rtval = pfx_table_validate_succinct(pfx_table, reason, reason_len, asn, prefix, prefix_len, result);
+
+		pthread_rwlock_unlock(&pfx_table->lock);
+		return rtval;
+	}
+
+	struct trie_node *root = pfx_table_get_root(pfx_table, prefix->ver);
+
+	if (!root) {
+		pthread_rwlock_unlock(&pfx_table->lock);
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+		return PFX_SUCCESS;
+	}
+
+	unsigned int lvl = 0;
+	struct trie_node *node = trie_lookup(root, prefix, prefix_len, &lvl);
+
+	if (!node) {
+		pthread_rwlock_unlock(&pfx_table->lock);
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+		return PFX_SUCCESS;
+	}
+
+	if (reason_len && reason)
+		*reason_len = 0;
+
+	bool covered = false;
+	int rtval = PFX_SUCCESS;
+
+	while (node) {
+		struct node_data *data = node->data;
+
+		covered = covered || data->len > 0;
+		if (reason_len && reason && pfx_table_append_reason(reason, reason_len, data) == PFX_ERROR) {
+			pthread_rwlock_unlock(&pfx_table->lock);
+			pfx_table_free_reason(reason, reason_len);
+			return PFX_ERROR;
+		}
+
+		if (pfx_table_elem_matches(data, asn, prefix_len))
+			break;
+
+		if (lrtr_ip_addr_is_zero(lrtr_ip_addr_get_bits(
+			    prefix, lvl++,
+			    1))) //post-incr lvl, trie_lookup is performed on child_nodes => parent lvl + 1
+			node = trie_lookup(node->lchild, prefix, prefix_len, &lvl);
+		else
+			node = trie_lookup(node->rchild, prefix, prefix_len, &lvl);
+	}
+
+	if (node) {
+		*result = BGP_PFXV_STATE_VALID;
+	} else if (covered) {
+		// tombstones do not cover the route
+		*result = BGP_PFXV_STATE_INVALID;
+	} else {
+		*result = BGP_PFXV_STATE_NOT_FOUND;
+		pfx_table_free_reason(reason, reason_len);
+	}
+
+	// the reason holds the original records instead of the effective ones of the tries
+	if (pfx_table->compressed && covered && reason_len && reason)
+		rtval = pfx_table_compressed_reason(pfx_table, reason, reason_len, prefix, prefix_len);
+
+	pthread_rwlock_unlock(&pfx_table->lock);
+	return rtval;
+}
+
+RTRLIB_EXPORT int pfx_table_validate(struct pfx_table *pfx_table, const uint32_t asn, const struct lrtr_ip_addr *prefix,
+				     const uint8_t prefix_len, enum pfxv_state *result)
+{
+	return pfx_table_validate_r(pfx_table, NULL, NULL, asn, prefix, prefix_len, result);
+}
 
-	pthread_rwlock_unlock(&pfx_table->lock);
-	pfx_table_notify_clients(pfx_table, record, true);
-	return PFX_SUCCESS;
+/**
+ * @brief Checks if a socket is part of a socket array.
+ * @param[in] socket Socket to search for.
+ * @param[in] sockets Socket array.
+ * @param[in] sockets_len Number of elements in @p sockets.
+ */
+static bool pfx_table_socket_in(const struct rtr_socket *socket, const struct rtr_socket **sockets,
+				const unsigned int sockets_len)
+{
+	for (unsigned int i = 0; i < sockets_len; i++) {
+		if (sockets[i] == socket)
+			return true;
+	}
+	return false;
 }
 
-RTRLIB_EXPORT int pfx_table_remove(struct pfx_table *pfx_table, const struct pfx_record *record)
+/**
+ * @brief Sockets whose records will be removed, passed to pfx_table_retained_cb().
+ * @param sockets Socket array.
+ * @param sockets_len Number of elements in sockets.
+ * @param retained True if a record of another socket was found.
+ */
+struct pfx_retained_args {
+	const struct rtr_socket **sockets;
+	unsigned int sockets_len;
+	bool retained;
+};
+
+/* Checks if a record belongs to a socket that is not removed, used as pfx_for_each_fp */
+static void pfx_table_retained_cb(const struct pfx_record *record, void *data)
 {
-	pthread_rwlock_wrlock(&(pfx_table->lock));
-	struct trie_node *root = pfx_table_get_root(pfx_table, record->prefix.ver);
+	struct pfx_retained_args *args = data;
 
-	unsigned int lvl = 0; // tree depth were node was found
-	bool found;
-	struct trie_node *node = trie_lookup_exact(root, &(record->prefix), record->min_len, &lvl, &found);
+	if (!pfx_table_socket_in(record->socket, args->sockets, args->sockets_len))
+		args->retained = true;
+}
 
-	if (!found) {
-		pthread_rwlock_unlock(&pfx_table->lock);
-		return PFX_RECORD_NOT_FOUND;
-	}
+/**
+ * @brief Checks if the table holds the same prefix, asn and max_len as @p record from a socket that is not part
+ * of @p sockets.
+ * @param[in] pfx_table pfx_table that holds @p record, the caller must hold the lock.
+ * @param[in] record Record that will be removed.
+ * @param[in] sockets Sockets whose records will be removed.
+ * @param[in] sockets_len Number of elements in @p sockets.
+ */
+static bool pfx_table_record_retained(const struct pfx_table *pfx_table, const struct pfx_record *record,
+				      const struct rtr_socket **sockets, const unsigned int sockets_len)
+{
+	const struct node_data *data = pfx_table_index_search(pfx_table, &(record->prefix), record->min_len);
+	struct pfx_succinct_range range;
+	struct pfx_record other;
 
-	unsigned int index;
-	struct data_elem *elem = pfx_table_find_elem(node->data, record, &index);
+	if (pfx_table->compressed) {
+		struct pfx_retained_args args = {sockets, sockets_len, false};
 
-	if (!elem) {
-		pthread_rwlock_unlock(&pfx_table->lock);
-		return PFX_RECORD_NOT_FOUND;
+		pfx_compressed_for_each_socket(pfx_table->compressed, record, pfx_table_retained_cb, &args);
+		return args.retained;
 	}
 
-	struct node_data *ndata = (struct node_data *)node->data;
+	for (unsigned int i = 0; data && i < data->len; i++) {
+		if (data->ary[i].asn == record->asn && data->ary[i].max_len == record->max_len &&
+		    !pfx_table_socket_in(data->ary[i].socket, sockets, sockets_len))
+			return true;
+	}
 
-	if (pfx_table_del_elem(ndata, index) == PFX_ERROR) {
-		pthread_rwlock_unlock(&pfx_table->lock);
-		return PFX_ERROR;
+	if (!pfx_table->succinct ||
+	    !pfx_succinct_find_prefix(pfx_table->succinct, &(record->prefix), record->min_len, &range))
+		return false;
+	while (pfx_succinct_next(pfx_table->succinct, &range, &other, NULL)) {
+		if (other.asn == record->asn && other.max_len == record->max_len &&
+		    !pfx_table_socket_in(other.socket, sockets, sockets_len))
+			return true;
 	}
+	return false;
+}
 
-	if (ndata->len == 0) {
-		node = trie_remove(node, &(record->prefix), record->min_len, lvl);
-		assert(node);
+/* Checks if a table holds a record, the caller must hold the lock of the table */
+static bool pfx_table_contains(const struct pfx_table *pfx_table, const struct pfx_record *record)
+{
+	const struct node_data *data = pfx_table_index_search(pfx_table, &(record->prefix), record->min_len);
+	uint32_t index;
+	bool removed;
+
+	if (pfx_table->compressed)
+		return pfx_compressed_find(pfx_table->compressed, record);
+	if (data && pfx_table_find_elem(data, record, NULL))
+		return true;
+	return pfx_table->succinct && pfx_succinct_find(pfx_table->succinct, record, &index, &removed) && !removed;
+}
 
-		if (node == root) {
-			if (record->prefix.ver == LRTR_IPV4)
-				pfx_table->ipv4 = NULL;
-			else
-				pfx_table->ipv6 = NULL;
-		}
-		assert(((struct node_data *)node->data)->len == 0);
-		lrtr_free(node->data);
-		lrtr_free(node);
-	}
-	pthread_rwlock_unlock(&pfx_table->lock);
+/*
+ * Tables with fewer trie nodes are traversed by the calling thread alone, scheduling tasks would cost more than
+ * it saves
+ */
+#define PFX_TRAVERSAL_MIN_NODES 65536
 
-	pfx_table_notify_clients(pfx_table, record, false);
+/* Upper bound of the number of workers that traverse a trie, the executor may allow fewer */
+#define PFX_TRAVERSAL_MAX_WORKERS 8
 
-	return PFX_SUCCESS;
+/* Number of subtrees per worker, more and smaller subtrees balance unevenly filled tries */
+#define PFX_TRAVERSAL_TASKS_PER_WORKER 8
+
+/**
+ * @brief Selects the records that are collected by pfx_table_traverse().
+ * @param sockets Records of these sockets are selected, records of all sockets if sockets_len is 0.
+ * @param sockets_len Number of elements in sockets.
+ * @param exclude Records of all sockets except sockets are selected.
+ * @param absent_from Only records that are not part of this table are selected if not NULL, the caller must hold
+ * the lock of the table.
+ */
+struct pfx_traversal_filter {
+	const struct rtr_socket **sockets;
+	unsigned int sockets_len;
+	bool exclude;
+	const struct pfx_table *absent_from;
+};
+
+/**
+ * @brief Part of a trie that is traversed by one thread.
+ * @param node Trie node the part starts at.
+ * @param subtree True if the part consists of the subtree below node, false if it only consists of node.
+ * @param records Selected records of the part in order.
+ * @param len Number of elements in records.
+ * @param size Number of elements records has space for.
+ * @param error True if records could not be grown.
+ */
+struct pfx_traversal_task {
+	const struct trie_node *node;
+	bool subtree;
+	struct pfx_record *records;
+	unsigned int len;
+	unsigned int size;
+	bool error;
+};
+
+/**
+ * @brief Traversal of a trie that is shared by all threads.
+ * @param tasks Parts of the trie in order.
+ * @param tasks_len Number of elements in tasks.
+ * @param next Index of the next task that is taken by a thread, accessed atomically.
+ * @param filter Selects the records.
+ */
+struct pfx_traversal {
+	struct pfx_traversal_task *tasks;
+	unsigned int tasks_len;
+	unsigned int next;
+	const struct pfx_traversal_filter *filter;
+};
+
+static bool pfx_traversal_selects(const struct pfx_traversal_filter *filter, const struct pfx_record *record)
+{
+	if (filter->sockets_len > 0 &&
+	    pfx_table_socket_in(record->socket, filter->sockets, filter->sockets_len) == filter->exclude)
+		return false;
+
+	if (filter->absent_from && pfx_table_contains(filter->absent_from, record))
+		return false;
+	return true;
 }
 
-bool pfx_table_elem_matches(struct node_data *data, const uint32_t asn, const uint8_t prefix_len)
+/* Appends a record to the records of a task, returns false on error */
+static bool pfx_traversal_append(struct pfx_traversal_task *task, const struct pfx_record *record)
 {
-	for (unsigned int i = 0; i < data->len; i++) {
-		if (data->ary[i].asn != 0 && data->ary[i].asn == asn && prefix_len <= data->ary[i].max_len)
-			return true;
+	if (task->len == task->size) {
+		unsigned int size = task->size > 0 ? 2 * task->size : 64;
+		struct pfx_record *tmp = lrtr_realloc(task->records, sizeof(*tmp) * size);
+
+		if (!tmp) {
+			task->error = true;
+			return false;
+		}
+		task->records = tmp;
+		task->size = size;
 	}
-	return false;
+	task->records[task->len++] = *record;
+	return true;
 }
 
-int pfx_table_node2pfx_record(struct trie_node *node, struct pfx_record *records, const unsigned int ary_len)
+/* Appends the selected records of a single node to the records of a task */
+static void pfx_traversal_visit(const struct trie_node *node, struct pfx_traversal_task *task,
+				const struct pfx_traversal_filter *filter)
 {
-	struct node_data *data = node->data;
-
-	if (ary_len < data->len)
-		return PFX_ERROR;
+	const struct node_data *data = node->data;
 
 	for (unsigned int i = 0; i < data->len; i++) {
-		records[i].asn = data->ary[i].asn;
-		records[i].prefix = node->prefix;
-		records[i].min_len = node->len;
-		records[i].max_len = data->ary[i].max_len;
-		records[i].socket = data->ary[i].socket;
+		struct pfx_record record = {data->ary[i].asn, node->prefix, node->len, data->ary[i].max_len,
+					    data->ary[i].socket};
+
+		if (pfx_traversal_selects(filter, &record) && !pfx_traversal_append(task, &record))
+			return;
 	}
-	return data->len;
 }
 
-inline void pfx_table_free_reason(struct pfx_record **reason, unsigned int *reason_len)
+/* Visits a subtree in the same order as pfx_table_for_each_rec() */
+static void pfx_traversal_walk(const struct trie_node *node, struct pfx_traversal_task *task,
+			       const struct pfx_traversal_filter *filter)
 {
-	if (reason) {
-		lrtr_free(*reason);
-		*reason = NULL;
+	if (node->lchild)
+		pfx_traversal_walk(node->lchild, task, filter);
+	if (!task->error)
+		pfx_traversal_visit(node, task, filter);
+	if (node->rchild && !task->error)
+		pfx_traversal_walk(node->rchild, task, filter);
+}
+
+/* Splits a trie in order into the subtrees at depth and the single nodes above them */
+static void pfx_traversal_split(const struct trie_node *node, const unsigned int depth,
+				struct pfx_traversal_task *tasks, unsigned int *tasks_len)
+{
+	if (depth == 0) {
+		tasks[*tasks_len].node = node;
+		tasks[*tasks_len].subtree = true;
+		(*tasks_len)++;
+		return;
 	}
-	if (reason_len)
-		*reason_len = 0;
+
+	if (node->lchild)
+		pfx_traversal_split(node->lchild, depth - 1, tasks, tasks_len);
+	tasks[*tasks_len].node = node;
+	tasks[*tasks_len].subtree = false;
+	(*tasks_len)++;
+	if (node->rchild)
+		pfx_traversal_split(node->rchild, depth - 1, tasks, tasks_len);
 }
 
-RTRLIB_EXPORT int pfx_table_validate_r(struct pfx_table *pfx_table, struct pfx_record **reason,
-				       unsigned int *reason_len, const uint32_t asn, const struct lrtr_ip_addr *prefix,
-				       const uint8_t prefix_len, enum pfxv_state *result)
+static void pfx_traversal_worker(void *arg)
 {
-	// assert(reason_len == NULL || *reason_len  == 0);
-	// assert(reason == NULL || *reason == NULL);
+	struct pfx_traversal *traversal = arg;
+	unsigned int i;
 
-	pthread_rwlock_rdlock(&(pfx_table->lock));
-	struct trie_node *root = pfx_table_get_root(pfx_table, prefix->ver);
+	while ((i = __atomic_fetch_add(&traversal->next, 1, __ATOMIC_RELAXED)) < traversal->tasks_len) {
+		struct pfx_traversal_task *task = &traversal->tasks[i];
 
-	if (!root) {
-		pthread_rwlock_unlock(&pfx_table->lock);
-		*result = BGP_PFXV_STATE_NOT_FOUND;
-		pfx_table_free_reason(reason, reason_len);
-		return PFX_SUCCESS;
+		if (task->subtree)
+			pfx_traversal_walk(task->node, task, traversal->filter);
+		else
+			pfx_traversal_visit(task->node, task, traversal->filter);
 	}
+}
 
-	unsigned int lvl = 0;
-	struct trie_node *node = trie_lookup(root, prefix, prefix_len, &lvl);
+static unsigned int pfx_traversal_workers(const struct pfx_table *pfx_table)
+{
+	unsigned int workers;
 
-	if (!node) {
-		pthread_rwlock_unlock(&pfx_table->lock);
-		*result = BGP_PFXV_STATE_NOT_FOUND;
-		pfx_table_free_reason(reason, reason_len);
+	if (!pfx_table->index || tommy_hashlin_count(&pfx_table->index->hashtable) < PFX_TRAVERSAL_MIN_NODES)
+		return 1;
+
+	workers = lrtr_executor_parallelism();
+	return workers < PFX_TRAVERSAL_MAX_WORKERS ? workers : PFX_TRAVERSAL_MAX_WORKERS;
+}
+
+/**
+ * @brief Collects the selected records of a trie.
+ * @details Large tries are split into subtrees that are traversed by several tasks of the executor. The records of
+ * the subtrees are concatenated, so they are returned in the order pfx_table_for_each_ipv4_record() passes them to
+ * its callback.
+ * @param[in] pfx_table pfx_table the trie belongs to, the caller must hold the lock.
+ * @param[in] root Root of the trie, may be NULL.
+ * @param[in] filter Selects the records.
+ * @param[out] records Selected records, must be freed with lrtr_free(), NULL if no record was selected.
+ * @param[out] records_len Number of elements in @p records.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_traverse(const struct pfx_table *pfx_table, const struct trie_node *root,
+			      const struct pfx_traversal_filter *filter, struct pfx_record **records,
+			      unsigned int *records_len)
+{
+	struct pfx_traversal traversal = {NULL, 0, 0, filter};
+	struct lrtr_wait_group group;
+	unsigned int workers = pfx_traversal_workers(pfx_table);
+	unsigned int depth = 0;
+	unsigned int len = 0;
+	int rtval = PFX_SUCCESS;
+
+	*records = NULL;
+	*records_len = 0;
+	if (!root)
 		return PFX_SUCCESS;
+
+	while (workers > 1 && (1U << depth) < workers * PFX_TRAVERSAL_TASKS_PER_WORKER)
+		depth++;
+
+	traversal.tasks = lrtr_calloc((2U << depth) - 1, sizeof(*traversal.tasks));
+	if (!traversal.tasks)
+		return PFX_ERROR;
+	pfx_traversal_split(root, depth, traversal.tasks, &traversal.tasks_len);
+
+	lrtr_wait_group_init(&group);
+	for (unsigned int i = 1; i < workers; i++)
+		lrtr_executor_submit(&group, pfx_traversal_worker, &traversal);
+
+	// the calling thread takes subtrees as well, it does all of them if the workers are not run yet
+	pfx_traversal_worker(&traversal);
+	lrtr_wait_group_wait(&group);
+	lrtr_wait_group_destroy(&group);
+
+	for (unsigned int i = 0; i < traversal.tasks_len; i++) {
+		if (traversal.tasks[i].error)
+			rtval = PFX_ERROR;
+		len += traversal.tasks[i].len;
 	}
 
-	if (reason_len && reason) {
-		*reason_len = ((struct node_data *)node->data)->len;
-		*reason = lrtr_realloc(*reason, *reason_len * sizeof(struct pfx_record));
-		if (!*reason) {
-			pthread_rwlock_unlock(&pfx_table->lock);
-			pfx_table_free_reason(reason, reason_len);
-			return PFX_ERROR;
-		}
-		if (pfx_table_node2pfx_record(node, *reason, *reason_len) == PFX_ERROR) {
-			pthread_rwlock_unlock(&pfx_table->lock);
-			pfx_table_free_reason(reason, reason_len);
-			return PFX_ERROR;
+	if (rtval == PFX_SUCCESS && traversal.tasks_len == 1) {
+		*records = traversal.tasks[0].records;
+		*records_len = len;
+		traversal.tasks[0].records = NULL;
+	} else if (rtval == PFX_SUCCESS && len > 0) {
+		*records = lrtr_malloc(sizeof(**records) * len);
+		if (!*records)
+			rtval = PFX_ERROR;
+	}
+
+	for (unsigned int i = 0; i < traversal.tasks_len; i++) {
+		if (*records && traversal.tasks[i].records) {
+			memcpy(*records + *records_len, traversal.tasks[i].records,
+			       sizeof(**records) * traversal.tasks[i].len);
+			*records_len += traversal.tasks[i].len;
 		}
+		lrtr_free(traversal.tasks[i].records);
 	}
+	lrtr_free(traversal.tasks);
 
-	while (!pfx_table_elem_matches(node->data, asn, prefix_len)) {
-		if (lrtr_ip_addr_is_zero(lrtr_ip_addr_get_bits(
-			    prefix, lvl++,
-			    1))) //post-incr lvl, trie_lookup is performed on child_nodes => parent lvl + 1
-			node = trie_lookup(node->lchild, prefix, prefix_len, &lvl);
-		else
-			node = trie_lookup(node->rchild, prefix, prefix_len, &lvl);
+	return rtval;
+}
 
-		if (!node) {
-			pthread_rwlock_unlock(&pfx_table->lock);
-			*result = BGP_PFXV_STATE_INVALID;
-			return PFX_SUCCESS;
-		}
+/**
+ * @brief Selected records of a succinct encoding, passed to pfx_traversal_visit_encoded().
+ */
+struct pfx_traversal_encoded {
+	struct pfx_traversal_task task;
+	const struct pfx_traversal_filter *filter;
+};
 
-		if (reason_len && reason) {
-			unsigned int r_len_old = *reason_len;
-			*reason_len += ((struct node_data *)node->data)->len;
-			*reason = lrtr_realloc(*reason, *reason_len * sizeof(struct pfx_record));
-			struct pfx_record *start = *reason + r_len_old;
+/* Appends a record of a succinct encoding if it is selected, used as pfx_for_each_fp */
+static void pfx_traversal_visit_encoded(const struct pfx_record *record, void *data)
+{
+	struct pfx_traversal_encoded *encoded = data;
 
-			if (!*reason) {
-				pthread_rwlock_unlock(&pfx_table->lock);
-				pfx_table_free_reason(reason, reason_len);
-				return PFX_ERROR;
-			}
-			if (pfx_table_node2pfx_record(node, start, ((struct node_data *)node->data)->len) ==
-			    PFX_ERROR) {
-				pthread_rwlock_unlock(&pfx_table->lock);
-				pfx_table_free_reason(reason, reason_len);
-				return PFX_ERROR;
-			}
-		}
+	if (!encoded->task.error && pfx_traversal_selects(encoded->filter, record))
+		pfx_traversal_append(&encoded->task, record);
+}
+
+/**
+ * @brief Collects the selected records of an IP version of a table.
+ * @details The records of the trie are returned in the order of pfx_table_traverse(), followed by the records of
+ * the succinct encoding. With PFX_STORAGE_COMPRESSED, the original records are returned in no particular order.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the lock.
+ * @param[in] ver IP version of the records.
+ * @param[in] filter Selects the records.
+ * @param[out] records Selected records, must be freed with lrtr_free(), NULL if no record was selected.
+ * @param[out] records_len Number of elements in @p records.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_collect(const struct pfx_table *pfx_table, const enum lrtr_ip_version ver,
+			     const struct pfx_traversal_filter *filter, struct pfx_record **records,
+			     unsigned int *records_len)
+{
+	struct pfx_traversal_encoded encoded;
+	int rtval = PFX_SUCCESS;
+
+	// the tries of a compressed table do not hold the original records
+	if (pfx_table->compressed) {
+		*records = NULL;
+		*records_len = 0;
+	} else {
+		rtval = pfx_table_traverse(pfx_table, pfx_table_get_root(pfx_table, ver), filter, records, records_len);
 	}
 
-	pthread_rwlock_unlock(&pfx_table->lock);
-	*result = BGP_PFXV_STATE_VALID;
+	if (rtval == PFX_ERROR || (!pfx_table->succinct && !pfx_table->compressed))
+		return rtval;
+
+	memset(&encoded, 0, sizeof(encoded));
+	encoded.task.records = *records;
+	encoded.task.len = *records_len;
+	encoded.task.size = *records_len;
+	encoded.filter = filter;
+	if (pfx_table->compressed)
+		pfx_compressed_for_each(pfx_table->compressed, ver, pfx_traversal_visit_encoded, &encoded);
+	else
+		pfx_succinct_for_each(pfx_table->succinct, ver, pfx_traversal_visit_encoded, &encoded);
+
+	if (encoded.task.error) {
+		lrtr_free(encoded.task.records);
+		*records = NULL;
+		*records_len = 0;
+		return PFX_ERROR;
+	}
+	*records = encoded.task.records;
+	*records_len = encoded.task.len;
 	return PFX_SUCCESS;
 }
 
-RTRLIB_EXPORT int pfx_table_validate(struct pfx_table *pfx_table, const uint32_t asn, const struct lrtr_ip_addr *prefix,
-				     const uint8_t prefix_len, enum pfxv_state *result)
+/**
+ * @brief Merges the records of the tries into a new succinct encoding and removes them from the tries.
+ * @param[in] pfx_table pfx_table to use, the caller must hold the write lock.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error, the table is not modified.
+ */
+int pfx_table_succinct_merge(struct pfx_table *pfx_table)
 {
-	return pfx_table_validate_r(pfx_table, NULL, NULL, asn, prefix, prefix_len, result);
+	struct pfx_traversal_filter filter = {NULL, 0, false, NULL};
+	struct pfx_record *records[2] = {NULL, NULL};
+	unsigned int records_len[2] = {0, 0};
+	struct pfx_succinct *succinct = NULL;
+
+	if (pfx_table_traverse(pfx_table, pfx_table->ipv4, &filter, &records[0], &records_len[0]) == PFX_SUCCESS &&
+	    pfx_table_traverse(pfx_table, pfx_table->ipv6, &filter, &records[1], &records_len[1]) == PFX_SUCCESS) {
+		struct pfx_record *tmp = records[0];
+
+		if (records_len[1] > 0)
+			tmp = lrtr_realloc(records[0], sizeof(*tmp) * (records_len[0] + records_len[1]));
+		if (tmp && records_len[1] > 0) {
+			memcpy(tmp + records_len[0], records[1], sizeof(*tmp) * records_len[1]);
+			records[0] = tmp;
+		}
+		if (tmp || records_len[0] + records_len[1] == 0)
+			succinct = pfx_succinct_merge(pfx_table->succinct, records[0],
+						      records_len[0] + records_len[1]);
+	}
+	lrtr_free(records[0]);
+	lrtr_free(records[1]);
+	if (!succinct)
+		return PFX_ERROR;
+
+	pfx_succinct_free(pfx_table->succinct);
+	pfx_table->succinct = succinct;
+	pfx_table_free_tries(pfx_table, false);
+	return PFX_SUCCESS;
 }
 
-RTRLIB_EXPORT int pfx_table_src_remove(struct pfx_table *pfx_table, const struct rtr_socket *socket)
+RTRLIB_EXPORT int pfx_table_set_storage(struct pfx_table *pfx_table, enum pfx_storage storage)
 {
-	for (unsigned int i = 0; i < 2; i++) {
-		struct trie_node **root = (i == 0 ? &(pfx_table->ipv4) : &(pfx_table->ipv6));
-
-		pthread_rwlock_wrlock(&(pfx_table->lock));
-		if (*root) {
-			int rtval = pfx_table_remove_id(pfx_table, root, *root, socket, 0);
+	int rtval = PFX_SUCCESS;
 
-			if (rtval == PFX_ERROR) {
-				pthread_rwlock_unlock(&pfx_table->lock);
-				return PFX_ERROR;
-			}
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	if (storage == PFX_STORAGE_TRIE) {
+		rtval = pfx_table_storage_trie(pfx_table);
+	} else if (storage == PFX_STORAGE_COMPRESSED) {
+		rtval = pfx_table_storage_compressed(pfx_table);
+	} else if (pfx_table->compressed && pfx_table_storage_trie(pfx_table) == PFX_ERROR) {
+		rtval = PFX_ERROR;
+	} else if (!pfx_table->succinct && (pfx_table->bspl || pfx_table->frozen)) {
+		rtval = PFX_ERROR;
+	} else if (!pfx_table->succinct) {
+		// the records that the tries already hold are encoded right away
+		pfx_table->succinct = pfx_succinct_merge(NULL, NULL, 0);
+		if (!pfx_table->succinct || pfx_table_succinct_merge(pfx_table) == PFX_ERROR) {
+			pfx_succinct_free(pfx_table->succinct);
+			pfx_table->succinct = NULL;
+			rtval = PFX_ERROR;
 		}
-		pthread_rwlock_unlock(&pfx_table->lock);
 	}
-	return PFX_SUCCESS;
+	pthread_rwlock_unlock(&pfx_table->lock);
+
+	return rtval;
 }
 
-int pfx_table_remove_id(struct pfx_table *pfx_table, struct trie_node **root, struct trie_node *node,
-			const struct rtr_socket *socket, const unsigned int level)
+RTRLIB_EXPORT int pfx_table_get_records(struct pfx_table *pfx_table, const enum lrtr_ip_version ver,
+					struct pfx_record **records, unsigned int *records_len)
 {
-	assert(node);
-	assert(root);
-	assert(*root);
-	bool check_node = true;
+	struct pfx_traversal_filter filter = {NULL, 0, false, NULL};
+	int rtval;
 
-	while (check_node) {
-		// data from removed node are replaced from data from child nodes (if children exists),
-		// same node must be checked again if it was replaced with previous child node data
-		struct node_data *data = node->data;
+	pthread_rwlock_rdlock(&(pfx_table->lock));
+	rtval = pfx_table_collect(pfx_table, ver, &filter, records, records_len);
+	pthread_rwlock_unlock(&pfx_table->lock);
 
-		for (unsigned int i = 0; i < data->len; i++) {
-			while (data->len > i && data->ary[i].socket == socket) {
-				struct pfx_record record = {data->ary[i].asn, node->prefix, node->len,
-							    data->ary[i].max_len, data->ary[i].socket};
-				if (pfx_table_del_elem(data, i) == PFX_ERROR)
-					return PFX_ERROR;
-				pfx_table_notify_clients(pfx_table, &record, false);
-			}
-		}
-		if (data->len == 0) {
-			struct trie_node *rm_node = trie_remove(node, &(node->prefix), node->len, level);
+	return rtval;
+}
 
-			assert(rm_node);
-			assert(((struct node_data *)rm_node->data)->len == 0);
-			lrtr_free(((struct node_data *)rm_node->data));
-			lrtr_free(rm_node);
+/**
+ * @brief Removes all records of the given sockets.
+ * @param[in] pfx_table pfx_table to use.
+ * @param[in] sockets Sockets whose records are removed.
+ * @param[in] sockets_len Number of elements in @p sockets.
+ * @param[in] handover True if clients are not notified about records that another socket announces as well.
+ * @return PFX_SUCCESS On success.
+ * @return PFX_ERROR On error.
+ */
+static int pfx_table_remove_sockets(struct pfx_table *pfx_table, const struct rtr_socket **sockets,
+				    const unsigned int sockets_len, const bool handover)
+{
+	struct pfx_traversal_filter filter = {sockets, sockets_len, false, NULL};
+	int rtval = PFX_SUCCESS;
 
-			if (rm_node == *root) {
-				*root = NULL;
-				return PFX_SUCCESS;
-			} else if (rm_node == node) {
-				return PFX_SUCCESS;
-			}
-		} else {
-			check_node = false;
+	pthread_rwlock_wrlock(&(pfx_table->lock));
+	for (unsigned int i = 0; i < 2 && rtval == PFX_SUCCESS; i++) {
+		struct pfx_record *records;
+		unsigned int records_len;
+
+		rtval = pfx_table_collect(pfx_table, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &filter, &records, &records_len);
+
+		for (unsigned int j = 0; j < records_len && rtval == PFX_SUCCESS; j++) {
+			// on a handover the VRP stays valid if another source announces it as well
+			bool retained =
+				handover && pfx_table_record_retained(pfx_table, &records[j], sockets, sockets_len);
+
+			rtval = pfx_table_remove_record(pfx_table, &records[j]);
+			if (rtval == PFX_SUCCESS && !retained)
+				pfx_table_notify_clients(pfx_table, &records[j], false);
 		}
+		lrtr_free(records);
 	}
+	// the removed records of the succinct encoding are not freed until it is merged
+	pfx_table_succinct_refresh(pfx_table);
+	pthread_rwlock_unlock(&pfx_table->lock);
 
-	if (node->lchild) {
-		if (pfx_table_remove_id(pfx_table, root, node->lchild, socket, level + 1) == PFX_ERROR)
-			return PFX_ERROR;
-	}
-	if (node->rchild)
-		return pfx_table_remove_id(pfx_table, root, node->rchild, socket, level + 1);
-	return PFX_SUCCESS;
+	return rtval == PFX_SUCCESS ? PFX_SUCCESS : PFX_ERROR;
+}
+
+RTRLIB_EXPORT int pfx_table_src_remove(struct pfx_table *pfx_table, const struct rtr_socket *socket)
+{
+	return pfx_table_remove_sockets(pfx_table, &socket, 1, false);
+}
+
+int pfx_table_src_handover(struct pfx_table *pfx_table, const struct rtr_socket **sockets,
+			   const unsigned int sockets_len)
+{
+	return pfx_table_remove_sockets(pfx_table, sockets, sockets_len, true);
 }
 
 static void pfx_table_for_each_rec(struct trie_node *n, pfx_for_each_fp fp, void *data)
@@ -541,11 +2591,13 @@ RTRLIB_EXPORT void pfx_table_for_each_ipv4_record(struct pfx_table *pfx_table, p
 {
 	assert(pfx_table);
 
-	if (!pfx_table->ipv4)
-		return;
-
 	pthread_rwlock_rdlock(&(pfx_table->lock));
-	pfx_table_for_each_rec(pfx_table->ipv4, fp, data);
+	if (pfx_table->compressed)
+		pfx_compressed_for_each(pfx_table->compressed, LRTR_IPV4, fp, data);
+	else if (pfx_table->ipv4)
+		pfx_table_for_each_rec(pfx_table->ipv4, fp, data);
+	if (pfx_table->succinct)
+		pfx_succinct_for_each(pfx_table->succinct, LRTR_IPV4, fp, data);
 	pthread_rwlock_unlock(&pfx_table->lock);
 }
 
@@ -553,44 +2605,90 @@ RTRLIB_EXPORT void pfx_table_for_each_ipv6_record(struct pfx_table *pfx_table, p
 {
 	assert(pfx_table);
 
-	if (!pfx_table->ipv6)
-		return;
-
 	pthread_rwlock_rdlock(&(pfx_table->lock));
-	pfx_table_for_each_rec(pfx_table->ipv6, fp, data);
+	if (pfx_table->compressed)
+		pfx_compressed_for_each(pfx_table->compressed, LRTR_IPV6, fp, data);
+	else if (pfx_table->ipv6)
+		pfx_table_for_each_rec(pfx_table->ipv6, fp, data);
+	if (pfx_table->succinct)
+		pfx_succinct_for_each(pfx_table->succinct, LRTR_IPV6, fp, data);
 	pthread_rwlock_unlock(&pfx_table->lock);
 }
 
-static void pfx_table_copy_cb(const struct pfx_record *record, void *data)
+int pfx_table_copy_except_socket(struct pfx_table *src_table, struct pfx_table *dst_table,
+				 const struct rtr_socket *socket)
 {
-	struct copy_cb_args *args = data;
+	struct pfx_traversal_filter filter = {&socket, 1, true, NULL};
+	int rtval = PFX_SUCCESS;
 
-	if (record->socket != args->socket) {
-		if (pfx_table_add(args->pfx_table, record) != PFX_SUCCESS)
-			args->error = true;
+	for (unsigned int i = 0; i < 2 && rtval == PFX_SUCCESS; i++) {
+		struct pfx_record *records;
+		unsigned int records_len;
+
+		pthread_rwlock_rdlock(&(src_table->lock));
+		rtval = pfx_table_collect(src_table, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &filter, &records, &records_len);
+		pthread_rwlock_unlock(&src_table->lock);
+
+		for (unsigned int j = 0; j < records_len && rtval == PFX_SUCCESS; j++) {
+			if (pfx_table_add(dst_table, &records[j]) != PFX_SUCCESS)
+				rtval = PFX_ERROR;
+		}
+		lrtr_free(records);
 	}
+	return rtval;
 }
 
-int pfx_table_copy_except_socket(struct pfx_table *src_table, struct pfx_table *dst_table,
-				 const struct rtr_socket *socket)
+void pfx_table_update_begin(struct pfx_table *pfx_table)
 {
-	struct copy_cb_args args = {dst_table, socket, false};
+	pthread_mutex_lock(&pfx_table->update_mutex);
+}
 
-	pfx_table_for_each_ipv4_record(src_table, pfx_table_copy_cb, &args);
-	if (args.error)
-		return PFX_ERROR;
+void pfx_table_update_end(struct pfx_table *pfx_table)
+{
+	pthread_mutex_unlock(&pfx_table->update_mutex);
+}
 
-	pfx_table_for_each_ipv6_record(src_table, pfx_table_copy_cb, &args);
-	if (args.error)
-		return PFX_ERROR;
+void pfx_table_commit_begin(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_wrlock(&pfx_table->sync_lock);
+}
 
-	return PFX_SUCCESS;
+void pfx_table_commit_end(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_unlock(&pfx_table->sync_lock);
+}
+
+void pfx_table_sync_begin(struct pfx_table *pfx_table)
+{
+	pfx_table_update_begin(pfx_table);
+	pfx_table_commit_begin(pfx_table);
+}
+
+void pfx_table_sync_end(struct pfx_table *pfx_table)
+{
+	pfx_table_commit_end(pfx_table);
+	pfx_table_update_end(pfx_table);
+}
+
+void pfx_table_snapshot_begin(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_rdlock(&pfx_table->sync_lock);
+}
+
+void pfx_table_snapshot_end(struct pfx_table *pfx_table)
+{
+	pthread_rwlock_unlock(&pfx_table->sync_lock);
 }
 
 void pfx_table_swap(struct pfx_table *a, struct pfx_table *b)
 {
 	struct trie_node *ipv4_tmp;
 	struct trie_node *ipv6_tmp;
+	struct pfx_index *index_tmp;
+	struct pfx_succinct *succinct_tmp;
+	struct pfx_compressed *compressed_tmp;
+	uint64_t digest_tmp;
+	unsigned int tombstones_tmp;
 
 	pthread_rwlock_wrlock(&(a->lock));
 	pthread_rwlock_wrlock(&(b->lock));
@@ -604,42 +2702,70 @@ void pfx_table_swap(struct pfx_table *a, struct pfx_table *b)
 	b->ipv4 = ipv4_tmp;
 	b->ipv6 = ipv6_tmp;
 
-	pthread_rwlock_unlock(&(b->lock));
-	pthread_rwlock_unlock(&(a->lock));
-}
+	// the engine stays with the table, its structures have to be rebuilt for the swapped tries
+	pfx_table_bspl_invalidate(a);
+	pfx_table_bspl_invalidate(b);
+	pfx_table_frozen_touch(a);
+	pfx_table_frozen_touch(b);
 
-static void pfx_table_notify_diff_cb(const struct pfx_record *record, void *data)
-{
-	struct notify_diff_cb_args *args = data;
+	index_tmp = a->index;
+	a->index = b->index;
+	b->index = index_tmp;
 
-	if (args->socket == record->socket && args->added) {
-		if (pfx_table_remove(args->old_table, record) != PFX_SUCCESS)
-			pfx_table_notify_clients(args->new_table, record, args->added);
-	} else if (args->socket == record->socket && !args->added) {
-		pfx_table_notify_clients(args->new_table, record, args->added);
-	}
-}
+	digest_tmp = a->digest_ipv4;
+	a->digest_ipv4 = b->digest_ipv4;
+	b->digest_ipv4 = digest_tmp;
 
-void pfx_table_notify_diff(struct pfx_table *new_table, struct pfx_table *old_table, const struct rtr_socket *socket)
-{
-	pfx_update_fp old_table_fp;
-	struct notify_diff_cb_args args = {old_table, new_table, socket, new_table->update_fp, true};
+	digest_tmp = a->digest_ipv6;
+	a->digest_ipv6 = b->digest_ipv6;
+	b->digest_ipv6 = digest_tmp;
+
+	tombstones_tmp = a->tombstones;
+	a->tombstones = b->tombstones;
+	b->tombstones = tombstones_tmp;
 
-	// Disable update callback for old_table table
-	old_table_fp = old_table->update_fp;
-	old_table->update_fp = NULL;
+	// the storage moves with the records
+	succinct_tmp = a->succinct;
+	a->succinct = b->succinct;
+	b->succinct = succinct_tmp;
 
-	// Iterate new_table and try to delete every prefix from the given socket in old_table
-	// If the prefix could not be removed it was added in new_table and the update cb must be called
-	pfx_table_for_each_ipv4_record(new_table, pfx_table_notify_diff_cb, &args);
-	pfx_table_for_each_ipv6_record(new_table, pfx_table_notify_diff_cb, &args);
+	compressed_tmp = a->compressed;
+	a->compressed = b->compressed;
+	b->compressed = compressed_tmp;
+
+	pthread_rwlock_unlock(&(b->lock));
+	pthread_rwlock_unlock(&(a->lock));
+}
 
-	// Iterate over old_table table and search and remove remaining prefixes from the socket
-	// issue a remove notification for every one of them, because they are not present in new_table.
-	args.added = false;
-	pfx_table_for_each_ipv4_record(old_table, pfx_table_notify_diff_cb, &args);
-	pfx_table_for_each_ipv6_record(old_table, pfx_table_notify_diff_cb, &args);
+void pfx_table_notify_diff(struct pfx_table *new_table, struct pfx_table *old_table, const struct rtr_socket *socket)
+{
+	// records of the socket that are only part of one of the tables
+	struct pfx_traversal_filter added_filter = {&socket, 1, false, old_table};
+	struct pfx_traversal_filter removed_filter = {&socket, 1, false, new_table};
+	struct pfx_record *added[2];
+	struct pfx_record *removed[2];
+	unsigned int added_len[2];
+	unsigned int removed_len[2];
+
+	pthread_rwlock_rdlock(&(new_table->lock));
+	pthread_rwlock_rdlock(&(old_table->lock));
+	// a failed traversal returns no records, the clients are not notified about them
+	for (unsigned int i = 0; i < 2; i++) {
+		pfx_table_collect(new_table, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &added_filter, &added[i], &added_len[i]);
+		pfx_table_collect(old_table, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &removed_filter, &removed[i],
+				  &removed_len[i]);
+	}
+	pthread_rwlock_unlock(&old_table->lock);
+	pthread_rwlock_unlock(&new_table->lock);
 
-	// Restore original state of old_tables update_fp
-	old_table->update_fp = old_table_fp;
+	for (unsigned int i = 0; i < 2; i++) {
+		for (unsigned int j = 0; j < added_len[i]; j++)
+			pfx_table_notify_clients(new_table, &added[i][j], true);
+		lrtr_free(added[i]);
+	}
+	for (unsigned int i = 0; i < 2; i++) {
+		for (unsigned int j = 0; j < removed_len[i]; j++)
+			pfx_table_notify_clients(new_table, &removed[i][j], false);
+		lrtr_free(removed[i]);
+	}
 }
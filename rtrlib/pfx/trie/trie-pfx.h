@@ -30,6 +30,11 @@
 #include <stdint.h>
 
 struct pfx_table;
+struct pfx_index;
+struct pfx_bspl;
+struct pfx_frozen_state;
+struct pfx_succinct;
+struct pfx_compressed;
 
 /**
  * @brief pfx_record.
@@ -61,12 +66,37 @@ typedef void (*pfx_update_fp)(struct pfx_table *pfx_table, const struct pfx_reco
  * @param ipv6
  * @param update_fp
  * @param lock
+ * @param index Exact match index over the prefixes of both tries
+ * @param bspl Lookup structure of the PFX_ENGINE_BSPL engine, NULL for the trie engine
+ * @param frozen State of the frozen validation index, NULL if it is not enabled
+ * @param digest_ipv4 Sum of pfx_record_digest() over all IPv4 records
+ * @param digest_ipv6 Sum of pfx_record_digest() over all IPv6 records
+ * @param defer_removal True if emptied trie nodes stay as tombstones (PFX_REMOVAL_DEFERRED)
+ * @param tombstones Number of trie nodes without records
+ * @param succinct Succinct encoding of PFX_STORAGE_SUCCINCT, the tries only hold the records that were added since
+ * it was built. NULL for PFX_STORAGE_TRIE
+ * @param compressed Original records of PFX_STORAGE_COMPRESSED, the tries hold an equivalent reduced set of
+ * records. NULL for the other storages
+ * @param sync_lock Held for writing while a socket updates the table and its spki_table, readers see the state of
+ * both tables before or after the update, see pfx_table_sync_begin()
+ * @param update_mutex Serialises the updates of the sockets, see pfx_table_update_begin()
  */
 struct pfx_table {
 	struct trie_node *ipv4;
 	struct trie_node *ipv6;
 	pfx_update_fp update_fp;
 	pthread_rwlock_t lock;
+	struct pfx_index *index;
+	struct pfx_bspl *bspl;
+	struct pfx_frozen_state *frozen;
+	uint64_t digest_ipv4;
+	uint64_t digest_ipv6;
+	bool defer_removal;
+	unsigned int tombstones;
+	struct pfx_succinct *succinct;
+	struct pfx_compressed *compressed;
+	pthread_rwlock_t sync_lock;
+	pthread_mutex_t update_mutex;
 };
 
 #endif
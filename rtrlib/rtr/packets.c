@@ -30,6 +30,8 @@
 
 #define MGR_DBG1(a) lrtr_dbg("RTR_MGR: " a)
 #define TEMPORARY_PDU_STORE_INCREMENT_VALUE 100
+// number of buffered PDUs after which a progressive synchronisation adds them to the tables
+#define PROGRESSIVE_SYNC_BATCH 1024
 #define MAX_SUPPORTED_PDU_TYPE 10
 
 enum pdu_error_type {
@@ -197,6 +199,16 @@ static inline enum pdu_type rtr_get_pdu_type(const void *pdu)
 	return *((char *)pdu + 1);
 }
 
+/* Returns the milliseconds since the last Serial Query or Reset Query was sent */
+static unsigned int rtr_get_query_duration(const struct rtr_socket *rtr_socket)
+{
+	uint64_t now;
+
+	if (lrtr_get_monotonic_time_ms(&now) == -1 || now < rtr_socket->query_time)
+		return 0;
+	return now - rtr_socket->query_time;
+}
+
 static int rtr_set_last_update(struct rtr_socket *rtr_socket)
 {
 	if (lrtr_get_monotonic_time(&(rtr_socket->last_update)) == -1) {
@@ -273,14 +285,21 @@ int rtr_check_interval_option(struct rtr_socket *rtr_socket, int interval_mode,
 
 void rtr_change_socket_state(struct rtr_socket *rtr_socket, const enum rtr_socket_state new_state)
 {
-	if (rtr_socket->state == new_state)
-		return;
+	enum rtr_socket_state state = __atomic_load_n(&rtr_socket->state, __ATOMIC_SEQ_CST);
 
-	// RTR_SHUTDOWN state is final,struct rtr_socket will be shutdowned can't be switched to any other state
-	if (rtr_socket->state == RTR_SHUTDOWN)
-		return;
+	// the socket thread must not overwrite the RTR_SHUTDOWN state that rtr_stop_request() sets concurrently
+	do {
+		if (state == new_state)
+			return;
 
-	rtr_socket->state = new_state;
+		// RTR_SHUTDOWN state is final,struct rtr_socket will be shutdowned can't be switched to any other state
+		if (state == RTR_SHUTDOWN)
+			return;
+	} while (!__atomic_compare_exchange_n(&rtr_socket->state, &state, new_state, false, __ATOMIC_SEQ_CST,
+					      __ATOMIC_SEQ_CST));
+
+	if (new_state == RTR_ERROR_FATAL || new_state == RTR_ERROR_TRANSPORT || new_state == RTR_ERROR_NO_DATA_AVAIL)
+		rtr_socket->metrics.failures++;
 	if (new_state == RTR_SHUTDOWN)
 		MGR_DBG1("Calling rtr_mgr_cb with RTR_SHUTDOWN");
 
@@ -893,6 +912,10 @@ static int rtr_store_router_key_pdu(struct rtr_socket *rtr_socket, const void *p
 	return RTR_SUCCESS;
 }
 
+/*
+ * @brief Applies a Prefix PDU to the pfx_table. On error, the error PDU is sent to the cache, but the state of the
+ * socket is left to the caller, which may not change it before the tables are unlocked.
+ */
 static int rtr_update_pfx_table(struct rtr_socket *rtr_socket, struct pfx_table *pfx_table, const void *pdu)
 {
 	const enum pdu_type type = rtr_get_pdu_type(pdu);
@@ -925,25 +948,26 @@ static int rtr_update_pfx_table(struct rtr_socket *rtr_socket, struct pfx_table
 		RTR_DBG("Duplicate Announcement for record: %s/%u-%u, ASN: %u, received", ip, pfxr.min_len,
 			pfxr.max_len, pfxr.asn);
 		rtr_send_error_pdu_from_host(rtr_socket, pdu, pdu_size, DUPLICATE_ANNOUNCEMENT, NULL, 0);
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	} else if (rtval == PFX_RECORD_NOT_FOUND) {
 		RTR_DBG1("Withdrawal of unknown record");
 		rtr_send_error_pdu_from_host(rtr_socket, pdu, pdu_size, WITHDRAWAL_OF_UNKNOWN_RECORD, NULL, 0);
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	} else if (rtval == PFX_ERROR) {
 		const char txt[] = "PFX_TABLE Error";
 
 		RTR_DBG("%s", txt);
 		rtr_send_error_pdu_from_host(rtr_socket, NULL, 0, INTERNAL_ERROR, txt, sizeof(txt));
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	}
 
 	return RTR_SUCCESS;
 }
 
+/*
+ * @brief Applies a Router Key PDU to the spki_table. Like rtr_update_pfx_table(), the caller changes the state of the
+ * socket on error.
+ */
 static int rtr_update_spki_table(struct rtr_socket *rtr_socket, struct spki_table *spki_table, const void *pdu)
 {
 	const enum pdu_type type = rtr_get_pdu_type(pdu);
@@ -976,25 +1000,63 @@ static int rtr_update_spki_table(struct rtr_socket *rtr_socket, struct spki_tabl
 		// TODO: This debug message isn't working yet, how to display SKI/SPKI without %x?
 		RTR_DBG("Duplicate Announcement for router key: ASN: %u received", entry.asn);
 		rtr_send_error_pdu_from_host(rtr_socket, pdu, pdu_size, DUPLICATE_ANNOUNCEMENT, NULL, 0);
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	} else if (rtval == SPKI_RECORD_NOT_FOUND) {
 		RTR_DBG1("Withdrawal of unknown router key");
 		rtr_send_error_pdu_from_host(rtr_socket, pdu, pdu_size, WITHDRAWAL_OF_UNKNOWN_RECORD, NULL, 0);
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	} else if (rtval == SPKI_ERROR) {
 		const char txt[] = "spki_table Error";
 
 		RTR_DBG("%s", txt);
 		rtr_send_error_pdu_from_host(rtr_socket, NULL, 0, INTERNAL_ERROR, txt, sizeof(txt));
-		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 		return RTR_ERROR;
 	}
 
 	return RTR_SUCCESS;
 }
 
+/**
+ * @brief Adds the buffered PDUs of a progressive synchronisation to the tables of the socket.
+ * @details The buffers are emptied, the number of applied PDUs is added to @p pfx_pdus and @p router_key_pdus.
+ * Nothing has to be undone on error, the records of the socket are removed once the synchronisation failed.
+ */
+static int rtr_apply_progressive_batch(struct rtr_socket *rtr_socket, struct pdu_ipv4 *ipv4_pdus,
+				       unsigned int *ipv4_pdus_nindex, struct pdu_ipv6 *ipv6_pdus,
+				       unsigned int *ipv6_pdus_nindex, struct pdu_router_key *router_key_pdus,
+				       unsigned int *router_key_pdus_nindex, unsigned int *pfx_pdus,
+				       unsigned int *router_key_pdus_applied)
+{
+	int retval = RTR_ERROR;
+
+	pfx_table_sync_begin(rtr_socket->pfx_table);
+	for (unsigned int i = 0; i < *ipv4_pdus_nindex; i++) {
+		if (rtr_update_pfx_table(rtr_socket, rtr_socket->pfx_table, &ipv4_pdus[i]) == RTR_ERROR)
+			goto out;
+	}
+	for (unsigned int i = 0; i < *ipv6_pdus_nindex; i++) {
+		if (rtr_update_pfx_table(rtr_socket, rtr_socket->pfx_table, &ipv6_pdus[i]) == RTR_ERROR)
+			goto out;
+	}
+	for (unsigned int i = 0; i < *router_key_pdus_nindex; i++) {
+		if (rtr_update_spki_table(rtr_socket, rtr_socket->spki_table, &router_key_pdus[i]) == RTR_ERROR)
+			goto out;
+	}
+
+	RTR_DBG("Progressive sync added %u Prefix PDUs and %u Router Key PDUs",
+		*ipv4_pdus_nindex + *ipv6_pdus_nindex, *router_key_pdus_nindex);
+	*pfx_pdus += *ipv4_pdus_nindex + *ipv6_pdus_nindex;
+	*router_key_pdus_applied += *router_key_pdus_nindex;
+	*ipv4_pdus_nindex = 0;
+	*ipv6_pdus_nindex = 0;
+	*router_key_pdus_nindex = 0;
+	retval = RTR_SUCCESS;
+
+out:
+	pfx_table_sync_end(rtr_socket->pfx_table);
+	return retval;
+}
+
 void recv_loop_cleanup(void *p)
 {
 	struct recv_loop_cleanup_args *args = p;
@@ -1005,6 +1067,116 @@ void recv_loop_cleanup(void *p)
 }
 
 /* WARNING: This Function has cancelable sections*/
+static void rtr_free_shadow_tables(struct pfx_table *pfx_shadow_table, struct spki_table *spki_shadow_table)
+{
+	if (pfx_shadow_table) {
+		pfx_table_free_without_notify(pfx_shadow_table);
+		lrtr_free(pfx_shadow_table);
+	}
+
+	if (spki_shadow_table) {
+		spki_table_free_without_notify(spki_shadow_table);
+		lrtr_free(spki_shadow_table);
+	}
+}
+
+/*
+ * @brief Creates the tables of an atomic reset. The pfx shadow table holds the records of all other sockets, the
+ * spki shadow table is empty. Has to be called between pfx_table_update_begin() and pfx_table_update_end(), the
+ * copy would miss the records another socket swaps in before this socket swaps in the shadow tables otherwise.
+ */
+static int rtr_create_shadow_tables(struct rtr_socket *rtr_socket, struct pfx_table **pfx_shadow_table,
+				    struct spki_table **spki_shadow_table)
+{
+	// the storage is swapped with the records, so the shadow table has to use the same one
+	enum pfx_storage storage = PFX_STORAGE_TRIE;
+
+	*pfx_shadow_table = NULL;
+	*spki_shadow_table = NULL;
+
+	if (rtr_socket->pfx_table->succinct)
+		storage = PFX_STORAGE_SUCCINCT;
+	else if (rtr_socket->pfx_table->compressed)
+		storage = PFX_STORAGE_COMPRESSED;
+
+	*pfx_shadow_table = lrtr_malloc(sizeof(struct pfx_table));
+	if (!*pfx_shadow_table) {
+		RTR_DBG1("Memory allocation for pfx shadow table failed");
+		return RTR_ERROR;
+	}
+
+	pfx_table_init(*pfx_shadow_table, NULL);
+	if (pfx_table_set_storage(*pfx_shadow_table, storage) ||
+	    pfx_table_copy_except_socket(rtr_socket->pfx_table, *pfx_shadow_table, rtr_socket)) {
+		RTR_DBG1("Creation of pfx shadow table failed");
+		goto err;
+	}
+
+	*spki_shadow_table = lrtr_malloc(sizeof(struct spki_table));
+	if (!*spki_shadow_table) {
+		RTR_DBG1("Memory allocation for spki shadow table failed");
+		goto err;
+	}
+	/* The spki shadow table only holds the new partition of this socket */
+	spki_table_init(*spki_shadow_table, NULL);
+
+	RTR_DBG1("Shadow table created");
+	return RTR_SUCCESS;
+
+err:
+	rtr_free_shadow_tables(*pfx_shadow_table, NULL);
+	*pfx_shadow_table = NULL;
+	return RTR_ERROR;
+}
+
+/*
+ * @brief Replaces the records of the socket by the ones of the shadow tables and notifies the difference. Blocks
+ * the readers, has to be called between pfx_table_update_begin() and pfx_table_update_end().
+ */
+static void rtr_swap_shadow_tables(struct rtr_socket *rtr_socket, struct pfx_table *pfx_shadow_table,
+				   struct spki_table *spki_shadow_table)
+{
+	pfx_table_commit_begin(rtr_socket->pfx_table);
+	pfx_table_swap(rtr_socket->pfx_table, pfx_shadow_table);
+
+	if (rtr_socket->pfx_table->update_fp) {
+		RTR_DBG1("Calculating and notifying pfx diff");
+		pfx_table_notify_diff(rtr_socket->pfx_table, pfx_shadow_table, rtr_socket);
+	} else {
+		RTR_DBG1("No pfx update callback. Skipping diff");
+	}
+
+	RTR_DBG1("Swapping spki partition and notifying diff");
+	spki_table_src_replace(rtr_socket->spki_table, spki_shadow_table, rtr_socket);
+	pfx_table_commit_end(rtr_socket->pfx_table);
+	rtr_socket->has_stale_records = false;
+}
+
+/*
+ * @brief Removes the records of the socket after a failed update could not be undone. A reset does not block the
+ * readers while it fills the shadow tables, so they are blocked for the removal.
+ */
+static void rtr_purge_pfx_records(struct rtr_socket *rtr_socket)
+{
+	if (rtr_socket->is_resetting)
+		pfx_table_commit_begin(rtr_socket->pfx_table);
+	pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+	if (rtr_socket->is_resetting)
+		pfx_table_commit_end(rtr_socket->pfx_table);
+}
+
+/*
+ * @brief Ends the update of rtr_sync_receive_and_store_pdus(). A reset only waited for the updates of the other
+ * sockets, an incremental update also blocked the readers.
+ */
+static void rtr_sync_end(struct rtr_socket *rtr_socket)
+{
+	if (rtr_socket->is_resetting)
+		pfx_table_update_end(rtr_socket->pfx_table);
+	else
+		pfx_table_sync_end(rtr_socket->pfx_table);
+}
+
 static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 {
 	char pdu[RTR_MAX_PDU_LEN];
@@ -1026,12 +1198,29 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 	struct pfx_table *pfx_shadow_table = NULL;
 	struct spki_table *spki_shadow_table = NULL;
 
+	// a progressive synchronisation adds the PDUs in batches before EOD, see rtr_set_progressive_sync()
+	const bool progressive = rtr_socket->progressive_sync && rtr_socket->request_session_id &&
+				 !rtr_socket->is_resetting;
+	unsigned int applied_pfx_pdus = 0;
+	unsigned int applied_router_key_pdus = 0;
+	bool sync_started = false;
+
 	int oldcancelstate;
 	struct recv_loop_cleanup_args cleanup_args = {
 		.ipv4_pdus = ipv4_pdus, .ipv6_pdus = ipv6_pdus, .router_key_pdus = router_key_pdus};
 
 	// receive LRTR_IPV4/IPV6 PDUs till EOD
 	do {
+		if (progressive &&
+		    ipv4_pdus_nindex + ipv6_pdus_nindex + router_key_pdus_nindex >= PROGRESSIVE_SYNC_BATCH &&
+		    rtr_apply_progressive_batch(rtr_socket, ipv4_pdus, &ipv4_pdus_nindex, ipv6_pdus, &ipv6_pdus_nindex,
+						router_key_pdus, &router_key_pdus_nindex, &applied_pfx_pdus,
+						&applied_router_key_pdus) == RTR_ERROR) {
+			rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
+			retval = RTR_ERROR;
+			goto cleanup;
+		}
+
 		pthread_cleanup_push(recv_loop_cleanup, &cleanup_args);
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldcancelstate);
 		retval = rtr_receive_pdu(rtr_socket, pdu, RTR_MAX_PDU_LEN, RTR_RECV_TIMEOUT);
@@ -1133,42 +1322,39 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 					rtr_socket->retry_interval);
 			}
 
+			// the remaining PDUs are added like a batch, the loops below find the buffers empty
+			if (progressive &&
+			    rtr_apply_progressive_batch(rtr_socket, ipv4_pdus, &ipv4_pdus_nindex, ipv6_pdus,
+							&ipv6_pdus_nindex, router_key_pdus, &router_key_pdus_nindex,
+							&applied_pfx_pdus, &applied_router_key_pdus) == RTR_ERROR) {
+				rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
+				retval = RTR_ERROR;
+				goto cleanup;
+			}
+
 			struct pfx_table *pfx_update_table;
 			struct spki_table *spki_update_table;
 
+			// validations find the records of the socket either before or after the synchronisation. A
+			// reset fills the shadow tables without blocking them and only blocks them for the swap.
+			if (rtr_socket->is_resetting)
+				pfx_table_update_begin(rtr_socket->pfx_table);
+			else
+				pfx_table_sync_begin(rtr_socket->pfx_table);
+			sync_started = true;
+
 			if (rtr_socket->is_resetting) {
 				RTR_DBG1("Reset in progress creating shadow table for atomic reset");
-				pfx_shadow_table = lrtr_malloc(sizeof(struct pfx_table));
-				if (!pfx_shadow_table) {
-					RTR_DBG1("Memory allocation for pfx shadow table failed");
-					retval = RTR_ERROR;
-					goto cleanup;
-				}
-
-				pfx_table_init(pfx_shadow_table, NULL);
-				pfx_update_table = pfx_shadow_table;
-				if (pfx_table_copy_except_socket(rtr_socket->pfx_table, pfx_update_table, rtr_socket)) {
-					RTR_DBG1("Creation of pfx shadow table failed");
+				if (rtr_create_shadow_tables(rtr_socket, &pfx_shadow_table, &spki_shadow_table) ==
+				    RTR_ERROR) {
+					rtr_sync_end(rtr_socket);
+					sync_started = false;
 					rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 					retval = RTR_ERROR;
 					goto cleanup;
 				}
-
-				spki_shadow_table = lrtr_malloc(sizeof(struct spki_table));
-				if (!spki_shadow_table) {
-					RTR_DBG1("Memory allocation for spki shadow table failed");
-					retval = RTR_ERROR;
-					goto cleanup;
-				}
-				spki_table_init(spki_shadow_table, NULL);
+				pfx_update_table = pfx_shadow_table;
 				spki_update_table = spki_shadow_table;
-				if (spki_table_copy_except_socket(rtr_socket->spki_table, spki_update_table,
-								  rtr_socket) != SPKI_SUCCESS) {
-					RTR_DBG1("Creation of spki shadow table failed");
-					rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
-					retval = RTR_ERROR;
-					goto cleanup;
-				}
 
 				RTR_DBG1("Shadow table created");
 			} else {
@@ -1189,9 +1375,12 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 					if (retval == RTR_ERROR) {
 						RTR_DBG1(
 							"Couldn't undo all update operations from failed data synchronisation: Purging all records");
-						pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+						rtr_purge_pfx_records(rtr_socket);
 						rtr_socket->request_session_id = true;
 					}
+					// the state callback of the manager can stop the sockets that share the tables
+					rtr_sync_end(rtr_socket);
+					sync_started = false;
 					rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 					retval = RTR_ERROR;
 					goto cleanup;
@@ -1213,9 +1402,11 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 					if (retval == PFX_ERROR) {
 						RTR_DBG1(
 							"Couldn't undo all update operations from failed data synchronisation: Purging all records");
-						pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+						rtr_purge_pfx_records(rtr_socket);
 						rtr_socket->request_session_id = true;
 					}
+					rtr_sync_end(rtr_socket);
+					sync_started = false;
 					rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 					retval = RTR_ERROR;
 					goto cleanup;
@@ -1247,6 +1438,8 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 						spki_table_src_remove(spki_update_table, rtr_socket);
 						rtr_socket->request_session_id = true;
 					}
+					rtr_sync_end(rtr_socket);
+					sync_started = false;
 					rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
 					retval = RTR_ERROR;
 					goto cleanup;
@@ -1255,27 +1448,22 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 			RTR_DBG1("spki data added");
 			if (rtr_socket->is_resetting) {
 				RTR_DBG1("Reset finished. Swapping new table in.");
-				pfx_table_swap(rtr_socket->pfx_table, pfx_shadow_table);
-				spki_table_swap(rtr_socket->spki_table, spki_shadow_table);
-
-				if (rtr_socket->pfx_table->update_fp) {
-					RTR_DBG1("Calculating and notifying pfx diff");
-					pfx_table_notify_diff(rtr_socket->pfx_table, pfx_shadow_table, rtr_socket);
-				} else {
-					RTR_DBG1("No pfx update callback. Skipping diff");
-				}
-
-				if (rtr_socket->spki_table->update_fp) {
-					RTR_DBG1("Calculating and notifying spki diff");
-					spki_table_notify_diff(rtr_socket->spki_table, spki_shadow_table, rtr_socket);
-				} else {
-					RTR_DBG1("No spki update callback. Skipping diff");
-				}
+				rtr_swap_shadow_tables(rtr_socket, pfx_shadow_table, spki_shadow_table);
 			}
+			rtr_sync_end(rtr_socket);
+			sync_started = false;
+
+			applied_pfx_pdus += ipv4_pdus_nindex + ipv6_pdus_nindex;
+			applied_router_key_pdus += router_key_pdus_nindex;
+			pfx_table_compact_after_sync(rtr_socket->pfx_table);
+			pfx_table_frozen_refresh(rtr_socket->pfx_table, applied_pfx_pdus);
 
 			rtr_socket->serial_number = eod_pdu->sn;
+			rtr_socket->metrics.sync_time = rtr_get_query_duration(rtr_socket);
+			rtr_socket->metrics.sync_pdus = applied_pfx_pdus + applied_router_key_pdus;
+			rtr_socket->metrics.syncs++;
 			RTR_DBG("Sync successful, received %u Prefix PDUs, %u Router Key PDUs, session_id: %u, SN: %u",
-				(ipv4_pdus_nindex + ipv6_pdus_nindex), router_key_pdus_nindex, rtr_socket->session_id,
+				applied_pfx_pdus, applied_router_key_pdus, rtr_socket->session_id,
 				rtr_socket->serial_number);
 			goto cleanup;
 		} else if (type == ERROR) {
@@ -1297,17 +1485,22 @@ static int rtr_sync_receive_and_store_pdus(struct rtr_socket *rtr_socket)
 
 cleanup:
 
-	if (rtr_socket->is_resetting) {
-		RTR_DBG1("Freeing shadow tables.");
-		if (pfx_shadow_table) {
-			pfx_table_free_without_notify(pfx_shadow_table);
-			lrtr_free(pfx_shadow_table);
+	// the socket held no records before, a later reset must not find the ones that were already added
+	if (progressive && retval == RTR_ERROR) {
+		RTR_DBG1("Progressive sync failed, removing the records that were added");
+		if (!sync_started) {
+			pfx_table_sync_begin(rtr_socket->pfx_table);
+			sync_started = true;
 		}
+		pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+		spki_table_src_remove(rtr_socket->spki_table, rtr_socket);
+	}
+	if (sync_started)
+		rtr_sync_end(rtr_socket);
 
-		if (spki_shadow_table) {
-			spki_table_free_without_notify(spki_shadow_table);
-			lrtr_free(spki_shadow_table);
-		}
+	if (rtr_socket->is_resetting) {
+		RTR_DBG1("Freeing shadow tables.");
+		rtr_free_shadow_tables(pfx_shadow_table, spki_shadow_table);
 		rtr_socket->is_resetting = false;
 	}
 
@@ -1324,10 +1517,13 @@ int rtr_sync(struct rtr_socket *rtr_socket)
 	enum pdu_type type;
 
 	int oldcancelstate;
+	// a probe has to be answered quickly, otherwise the session is considered dead
+	time_t timeout = rtr_socket->is_probing ? rtr_socket->probe_timeout : RTR_RECV_TIMEOUT;
 
+	rtr_socket->is_probing = false;
 	do {
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldcancelstate);
-		int rtval = rtr_receive_pdu(rtr_socket, pdu, RTR_MAX_PDU_LEN, RTR_RECV_TIMEOUT);
+		int rtval = rtr_receive_pdu(rtr_socket, pdu, RTR_MAX_PDU_LEN, timeout);
 
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldcancelstate);
 		// If the cache has closed the connection and we don't have a
@@ -1344,6 +1540,7 @@ int rtr_sync(struct rtr_socket *rtr_socket)
 		}
 
 		if (rtval == TR_WOULDBLOCK) {
+			RTR_DBG1("No answer to the query in time");
 			rtr_change_socket_state(rtr_socket, RTR_ERROR_TRANSPORT);
 			return RTR_ERROR;
 		} else if (rtval < 0) {
@@ -1365,6 +1562,7 @@ int rtr_sync(struct rtr_socket *rtr_socket)
 		rtr_change_socket_state(rtr_socket, RTR_ERROR_NO_INCR_UPDATE_AVAIL);
 		return RTR_ERROR;
 	case CACHE_RESPONSE:
+		rtr_socket->metrics.query_rtt = rtr_get_query_duration(rtr_socket);
 		rtr_handle_cache_response_pdu(rtr_socket, pdu);
 		break;
 	default:
@@ -1388,6 +1586,54 @@ int rtr_sync(struct rtr_socket *rtr_socket)
 	return RTR_SUCCESS;
 }
 
+int rtr_load(struct rtr_socket *rtr_socket)
+{
+	struct pfx_table *pfx_shadow_table;
+	struct spki_table *spki_shadow_table;
+	uint16_t session_id;
+	uint32_t serial;
+	int rtval;
+
+	RTR_DBG1("Loading all records from the transport");
+	lrtr_get_monotonic_time_ms(&rtr_socket->query_time);
+
+	// the readers are only blocked to swap the loaded records in
+	pfx_table_update_begin(rtr_socket->pfx_table);
+	if (rtr_create_shadow_tables(rtr_socket, &pfx_shadow_table, &spki_shadow_table) == RTR_ERROR) {
+		pfx_table_update_end(rtr_socket->pfx_table);
+		rtr_change_socket_state(rtr_socket, RTR_ERROR_FATAL);
+		return RTR_ERROR;
+	}
+
+	rtval = tr_load(rtr_socket->tr_socket, pfx_shadow_table, spki_shadow_table, rtr_socket, &session_id, &serial);
+	if (rtval < 0) {
+		RTR_DBG1("Loading the records failed");
+		pfx_table_update_end(rtr_socket->pfx_table);
+		rtr_free_shadow_tables(pfx_shadow_table, spki_shadow_table);
+		rtr_change_socket_state(rtr_socket, RTR_ERROR_TRANSPORT);
+		return RTR_ERROR;
+	}
+
+	rtr_swap_shadow_tables(rtr_socket, pfx_shadow_table, spki_shadow_table);
+	pfx_table_update_end(rtr_socket->pfx_table);
+	rtr_free_shadow_tables(pfx_shadow_table, spki_shadow_table);
+
+	pfx_table_compact_after_sync(rtr_socket->pfx_table);
+	pfx_table_frozen_refresh(rtr_socket->pfx_table, rtval);
+
+	rtr_socket->session_id = session_id;
+	rtr_socket->serial_number = serial;
+	rtr_socket->request_session_id = false;
+	rtr_socket->is_resetting = false;
+	rtr_socket->metrics.query_rtt = rtr_get_query_duration(rtr_socket);
+	rtr_socket->metrics.sync_time = rtr_socket->metrics.query_rtt;
+	rtr_socket->metrics.sync_pdus = rtval;
+	rtr_socket->metrics.syncs++;
+	RTR_DBG("Load successful, %d records, session_id: %u, SN: %u", rtval, rtr_socket->session_id,
+		rtr_socket->serial_number);
+	return rtr_set_last_update(rtr_socket);
+}
+
 int rtr_wait_for_sync(struct rtr_socket *rtr_socket)
 {
 	char pdu[RTR_MAX_PDU_LEN];
@@ -1396,10 +1642,16 @@ int rtr_wait_for_sync(struct rtr_socket *rtr_socket)
 
 	lrtr_get_monotonic_time(&cur_time);
 	time_t wait = (rtr_socket->last_update + rtr_socket->refresh_interval) - cur_time;
+	bool probe = false;
 
 	if (wait < 0)
 		wait = 0;
 
+	if (rtr_socket->probe_interval > 0 && wait > rtr_socket->probe_interval) {
+		wait = rtr_socket->probe_interval;
+		probe = true;
+	}
+
 	RTR_DBG("waiting %jd sec. till next sync", (intmax_t)wait);
 	const int rtval = rtr_receive_pdu(rtr_socket, pdu, sizeof(pdu), wait);
 
@@ -1410,6 +1662,10 @@ int rtr_wait_for_sync(struct rtr_socket *rtr_socket)
 			RTR_DBG("Serial Notify received (%u)", ((struct pdu_serial_notify *)pdu)->sn);
 			return RTR_SUCCESS;
 		}
+	} else if (rtval == TR_WOULDBLOCK && probe) {
+		RTR_DBG1("Session idle, probing the cache");
+		rtr_socket->is_probing = true;
+		return RTR_SUCCESS;
 	} else if (rtval == TR_WOULDBLOCK) {
 		RTR_DBG1("Refresh interval expired");
 		return RTR_SUCCESS;
@@ -1500,6 +1756,7 @@ int rtr_send_serial_query(struct rtr_socket *rtr_socket)
 		rtr_change_socket_state(rtr_socket, RTR_ERROR_TRANSPORT);
 		return RTR_ERROR;
 	}
+	lrtr_get_monotonic_time_ms(&rtr_socket->query_time);
 	return RTR_SUCCESS;
 }
 
@@ -1517,5 +1774,6 @@ int rtr_send_reset_query(struct rtr_socket *rtr_socket)
 		rtr_change_socket_state(rtr_socket, RTR_ERROR_TRANSPORT);
 		return RTR_ERROR;
 	}
+	lrtr_get_monotonic_time_ms(&rtr_socket->query_time);
 	return RTR_SUCCESS;
 }
@@ -22,6 +22,11 @@ static const unsigned int RTR_SEND_TIMEOUT = 60;
 void __attribute__((weak))
 rtr_change_socket_state(struct rtr_socket *rtr_socket, const enum rtr_socket_state new_state);
 int rtr_sync(struct rtr_socket *rtr_socket);
+/**
+ * @brief Replaces the records of the socket by all records of its transport in one step, without a Reset Query.
+ * @details Only available if the transport implements tr_load_fp.
+ */
+int rtr_load(struct rtr_socket *rtr_socket);
 int rtr_wait_for_sync(struct rtr_socket *rtr_socket);
 int rtr_send_serial_query(struct rtr_socket *rtr_socket);
 int rtr_send_reset_query(struct rtr_socket *rtr_socket);
@@ -18,8 +18,10 @@
 #include "rtrlib/transport/transport_private.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -42,6 +44,8 @@ int rtr_init(struct rtr_socket *rtr_socket, struct tr_socket *tr, struct pfx_tab
 	     const unsigned int retry_interval, enum rtr_interval_mode iv_mode, rtr_connection_state_fp fp,
 	     void *fp_param_config, void *fp_param_group)
 {
+	pthread_condattr_t attr;
+
 	if (tr)
 		rtr_socket->tr_socket = tr;
 
@@ -71,9 +75,38 @@ int rtr_init(struct rtr_socket *rtr_socket, struct tr_socket *tr, struct pfx_tab
 	rtr_socket->version = RTR_PROTOCOL_MAX_SUPPORTED_VERSION;
 	rtr_socket->has_received_pdus = false;
 	rtr_socket->is_resetting = false;
+	rtr_socket->retain_stale_records = false;
+	rtr_socket->has_stale_records = false;
+	memset(&rtr_socket->metrics, 0, sizeof(rtr_socket->metrics));
+	rtr_socket->query_time = 0;
+	rtr_socket->probe_interval = 0;
+	rtr_socket->probe_timeout = 0;
+	rtr_socket->is_probing = false;
+	rtr_socket->progressive_sync = false;
+
+	// the retry interval is measured on the monotonic clock like all other intervals
+	if (pthread_condattr_init(&attr) != 0)
+		return RTR_ERROR;
+	if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0 ||
+	    pthread_cond_init(&rtr_socket->wakeup_cond, &attr) != 0) {
+		pthread_condattr_destroy(&attr);
+		return RTR_ERROR;
+	}
+	pthread_condattr_destroy(&attr);
+	if (pthread_mutex_init(&rtr_socket->wakeup_mutex, NULL) != 0) {
+		pthread_cond_destroy(&rtr_socket->wakeup_cond);
+		return RTR_ERROR;
+	}
 	return RTR_SUCCESS;
 }
 
+void rtr_free(struct rtr_socket *rtr_socket)
+{
+	assert(rtr_socket->thread_id == 0);
+	pthread_cond_destroy(&rtr_socket->wakeup_cond);
+	pthread_mutex_destroy(&rtr_socket->wakeup_mutex);
+}
+
 int rtr_start(struct rtr_socket *rtr_socket)
 {
 	if (rtr_socket->thread_id)
@@ -96,10 +129,18 @@ void rtr_purge_outdated_records(struct rtr_socket *rtr_socket)
 	if (rtval == -1 || (rtr_socket->last_update + rtr_socket->expire_interval) < cur_time) {
 		if (rtval == -1)
 			RTR_DBG1("get_monotic_time(..) failed");
-		pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
-		RTR_DBG1("Removed outdated records from pfx_table");
-		spki_table_src_remove(rtr_socket->spki_table, rtr_socket);
-		RTR_DBG1("Removed outdated router keys from spki_table");
+		if (rtr_socket->retain_stale_records) {
+			// the reset replaces the records and the diff only reports records that changed
+			rtr_socket->has_stale_records = true;
+			RTR_DBG1("Marked outdated records and router keys as stale");
+		} else {
+			pfx_table_sync_begin(rtr_socket->pfx_table);
+			pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+			RTR_DBG1("Removed outdated records from pfx_table");
+			spki_table_src_remove(rtr_socket->spki_table, rtr_socket);
+			RTR_DBG1("Removed outdated router keys from spki_table");
+			pfx_table_sync_end(rtr_socket->pfx_table);
+		}
 		rtr_socket->request_session_id = true;
 		rtr_socket->serial_number = 0;
 		rtr_socket->last_update = 0;
@@ -107,28 +148,71 @@ void rtr_purge_outdated_records(struct rtr_socket *rtr_socket)
 	}
 }
 
+/* Opens the transport connection and measures how long it took */
+static int rtr_connect(struct rtr_socket *rtr_socket)
+{
+	uint64_t start = 0;
+	uint64_t end = 0;
+
+	lrtr_get_monotonic_time_ms(&start);
+	if (tr_open(rtr_socket->tr_socket) == TR_ERROR)
+		return TR_ERROR;
+
+	lrtr_get_monotonic_time_ms(&end);
+	rtr_socket->metrics.connect_time = end - start;
+	return TR_SUCCESS;
+}
+
+static void rtr_sleep_cleanup(void *mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+/* Waits before the next connection attempt, returns early if the socket shuts down */
+static void rtr_sleep(struct rtr_socket *rtr_socket, const unsigned int seconds)
+{
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += seconds;
+
+	pthread_mutex_lock(&rtr_socket->wakeup_mutex);
+	pthread_cleanup_push(rtr_sleep_cleanup, &rtr_socket->wakeup_mutex);
+	while (rtr_socket->state != RTR_SHUTDOWN) {
+		if (pthread_cond_timedwait(&rtr_socket->wakeup_cond, &rtr_socket->wakeup_mutex, &deadline) ==
+		    ETIMEDOUT)
+			break;
+	}
+	pthread_cleanup_pop(1);
+}
+
 /* WARNING: This Function has cancelable sections*/
 void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 {
-	if (rtr_socket->state == RTR_SHUTDOWN)
-		return NULL;
+	enum rtr_socket_state state = __atomic_load_n(&rtr_socket->state, __ATOMIC_SEQ_CST);
+
+	// the socket may be stopped before the thread runs
+	do {
+		if (state == RTR_SHUTDOWN)
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&rtr_socket->state, &state, RTR_CONNECTING, false, __ATOMIC_SEQ_CST,
+					      __ATOMIC_SEQ_CST));
 
 	// We don't care about the old state, but POSIX demands a non null value for setcancelstate
 	int oldcancelstate;
 
 	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldcancelstate);
-
-	rtr_socket->state = RTR_CONNECTING;
 	while (1) {
 		if (rtr_socket->state == RTR_CONNECTING) {
 			RTR_DBG1("State: RTR_CONNECTING");
 			rtr_socket->has_received_pdus = false;
+			rtr_socket->is_probing = false;
 
 			// old pfx_record could exists in the pfx_table, check if they are too old and must be removed
 			// old key_entry could exists in the spki_table, check if they are too old and must be removed
 			rtr_purge_outdated_records(rtr_socket);
 
-			if (tr_open(rtr_socket->tr_socket) == TR_ERROR) {
+			if (rtr_connect(rtr_socket) == TR_ERROR) {
 				rtr_change_socket_state(rtr_socket, RTR_ERROR_TRANSPORT);
 			} else if (rtr_socket->request_session_id) {
 				// change to state RESET, if socket doesn't have a session_id
@@ -144,7 +228,11 @@ void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 
 		else if (rtr_socket->state == RTR_RESET) {
 			RTR_DBG1("State: RTR_RESET");
-			if (rtr_send_reset_query(rtr_socket) == RTR_SUCCESS) {
+			if (rtr_socket->tr_socket->load_fp) {
+				// the transport adds its records directly, the following updates are incremental
+				if (rtr_load(rtr_socket) == RTR_SUCCESS)
+					rtr_change_socket_state(rtr_socket, RTR_ESTABLISHED);
+			} else if (rtr_send_reset_query(rtr_socket) == RTR_SUCCESS) {
 				RTR_DBG1("rtr_start: reset pdu sent");
 				rtr_change_socket_state(rtr_socket,
 							RTR_SYNC); // start to sync after connection is established
@@ -186,7 +274,7 @@ void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 			rtr_socket->request_session_id = true;
 			rtr_socket->serial_number = 0;
 			rtr_change_socket_state(rtr_socket, RTR_RESET);
-			sleep(rtr_socket->retry_interval);
+			rtr_sleep(rtr_socket, rtr_socket->retry_interval);
 			rtr_purge_outdated_records(rtr_socket);
 		}
 
@@ -204,7 +292,7 @@ void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 			rtr_change_socket_state(rtr_socket, RTR_CONNECTING);
 			RTR_DBG("Waiting %u", rtr_socket->retry_interval);
 			pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldcancelstate);
-			sleep(rtr_socket->retry_interval);
+			rtr_sleep(rtr_socket, rtr_socket->retry_interval);
 			pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldcancelstate);
 		}
 
@@ -214,7 +302,7 @@ void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 			rtr_change_socket_state(rtr_socket, RTR_CONNECTING);
 			RTR_DBG("Waiting %u", rtr_socket->retry_interval);
 			pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldcancelstate);
-			sleep(rtr_socket->retry_interval);
+			rtr_sleep(rtr_socket, rtr_socket->retry_interval);
 			pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldcancelstate);
 		}
 
@@ -225,13 +313,25 @@ void *rtr_fsm_start(struct rtr_socket *rtr_socket)
 	}
 }
 
-void rtr_stop(struct rtr_socket *rtr_socket)
+void rtr_stop_request(struct rtr_socket *rtr_socket)
 {
 	RTR_DBG("%s()", __func__);
 	rtr_change_socket_state(rtr_socket, RTR_SHUTDOWN);
-	if (rtr_socket->thread_id != 0) {
+
+	// rtr_sleep() checks the state with the mutex held, it either sees RTR_SHUTDOWN or gets the signal
+	pthread_mutex_lock(&rtr_socket->wakeup_mutex);
+	pthread_cond_signal(&rtr_socket->wakeup_cond);
+	pthread_mutex_unlock(&rtr_socket->wakeup_mutex);
+
+	if (rtr_socket->thread_id != 0 && tr_interrupt(rtr_socket->tr_socket) != TR_SUCCESS) {
 		RTR_DBG1("pthread_cancel()");
 		pthread_cancel(rtr_socket->thread_id);
+	}
+}
+
+void rtr_stop_wait(struct rtr_socket *rtr_socket)
+{
+	if (rtr_socket->thread_id != 0) {
 		RTR_DBG1("pthread_join()");
 		pthread_join(rtr_socket->thread_id, NULL);
 
@@ -239,14 +339,32 @@ void rtr_stop(struct rtr_socket *rtr_socket)
 		rtr_socket->request_session_id = true;
 		rtr_socket->serial_number = 0;
 		rtr_socket->last_update = 0;
-		pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
-		spki_table_src_remove(rtr_socket->spki_table, rtr_socket);
+		rtr_socket->has_stale_records = false;
 		rtr_socket->thread_id = 0;
 		rtr_socket->state = RTR_CLOSED;
 	}
 	RTR_DBG1("Socket shut down");
 }
 
+void rtr_stop_keep_records(struct rtr_socket *rtr_socket)
+{
+	rtr_stop_request(rtr_socket);
+	rtr_stop_wait(rtr_socket);
+}
+
+void rtr_stop(struct rtr_socket *rtr_socket)
+{
+	bool running = rtr_socket->thread_id != 0;
+
+	rtr_stop_keep_records(rtr_socket);
+	if (running) {
+		pfx_table_sync_begin(rtr_socket->pfx_table);
+		pfx_table_src_remove(rtr_socket->pfx_table, rtr_socket);
+		spki_table_src_remove(rtr_socket->spki_table, rtr_socket);
+		pfx_table_sync_end(rtr_socket->pfx_table);
+	}
+}
+
 RTRLIB_EXPORT const char *rtr_state_to_str(enum rtr_socket_state state)
 {
 	return socket_str_states[state];
@@ -258,6 +376,41 @@ RTRLIB_EXPORT enum rtr_interval_mode rtr_get_interval_mode(struct rtr_socket *rt
 	return rtr_socket->iv_mode;
 }
 
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT void rtr_set_retain_stale_records(struct rtr_socket *rtr_socket, bool retain)
+{
+	rtr_socket->retain_stale_records = retain;
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT bool rtr_has_stale_records(const struct rtr_socket *rtr_socket)
+{
+	return rtr_socket->has_stale_records;
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT void rtr_get_metrics(const struct rtr_socket *rtr_socket, struct rtr_socket_metrics *metrics)
+{
+	*metrics = rtr_socket->metrics;
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_set_liveness_probe(struct rtr_socket *rtr_socket, unsigned int interval, unsigned int timeout)
+{
+	if (interval > 0 && timeout == 0)
+		return RTR_INVALID_PARAM;
+
+	rtr_socket->probe_interval = interval;
+	rtr_socket->probe_timeout = timeout;
+	return RTR_SUCCESS;
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT void rtr_set_progressive_sync(struct rtr_socket *rtr_socket, bool enabled)
+{
+	rtr_socket->progressive_sync = enabled;
+}
+
 /* cppcheck-suppress unusedFunction */
 RTRLIB_EXPORT void rtr_set_interval_mode(struct rtr_socket *rtr_socket, enum rtr_interval_mode option)
 {
@@ -81,6 +81,26 @@ enum rtr_socket_state {
 
 struct rtr_socket;
 
+/**
+ * @brief Measurements of the connection of a rtr_socket to its RTR server.
+ * @details All durations are in milliseconds and refer to the last successful operation, they are 0 until it
+ * happened once.
+ * @param connect_time Duration of establishing the transport connection.
+ * @param query_rtt Time between sending a Serial Query or Reset Query and receiving the Cache Response.
+ * @param sync_time Time between sending a Serial Query or Reset Query and receiving the End of Data PDU.
+ * @param sync_pdus Number of Prefix and Router Key PDUs received by the last synchronisation.
+ * @param syncs Number of successful synchronisations.
+ * @param failures Number of transport, protocol and no data errors.
+ */
+struct rtr_socket_metrics {
+	unsigned int connect_time;
+	unsigned int query_rtt;
+	unsigned int sync_time;
+	unsigned int sync_pdus;
+	unsigned int syncs;
+	unsigned int failures;
+};
+
 /**
  * @brief A function pointer that is called if the state of the rtr socket has changed.
  */
@@ -112,6 +132,18 @@ typedef void (*rtr_connection_state_fp)(const struct rtr_socket *rtr_socket, con
  * @param version Protocol version used by this socket
  * @param has_received_pdus True, if this socket has already received PDUs
  * @param spki_table spki_table that stores the router keys obtained from the connected rtr server
+ * @param is_resetting True, if the next synchronisation replaces all records of this socket
+ * @param retain_stale_records True, if expired records stay in the tables until the next reset completes
+ * @param has_stale_records True, if the tables contain expired records of this socket
+ * @param metrics Measurements of the connection to the RTR server
+ * @param query_time Monotonic time in milliseconds at which the last Serial Query or Reset Query was sent
+ * @param wakeup_mutex Protects the transition to RTR_SHUTDOWN against a thread that starts to wait on wakeup_cond
+ * @param wakeup_cond Signalled when the socket shuts down, wakes the thread while it waits for the next attempt
+ * @param probe_interval Time period in seconds after which an idle session is probed with a Serial Query, 0 if
+ * sessions are not probed
+ * @param probe_timeout Time period in seconds to wait for the Cache Response to a probe
+ * @param is_probing True, if the Serial Query that is sent next is a probe
+ * @param progressive_sync True, if the records of the initial synchronisation become visible before EOD
  */
 struct rtr_socket {
 	struct tr_socket *tr_socket;
@@ -133,6 +165,16 @@ struct rtr_socket {
 	bool has_received_pdus;
 	struct spki_table *spki_table;
 	bool is_resetting;
+	bool retain_stale_records;
+	bool has_stale_records;
+	struct rtr_socket_metrics metrics;
+	uint64_t query_time;
+	pthread_mutex_t wakeup_mutex;
+	pthread_cond_t wakeup_cond;
+	unsigned int probe_interval;
+	unsigned int probe_timeout;
+	bool is_probing;
+	bool progressive_sync;
 };
 
 /**
@@ -157,5 +199,61 @@ void rtr_set_interval_mode(struct rtr_socket *rtr_socket, enum rtr_interval_mode
  * @return The value of the interval_option variable.
  */
 enum rtr_interval_mode rtr_get_interval_mode(struct rtr_socket *rtr_socket);
+
+/**
+ * @brief Keeps the records of the socket when they expire instead of removing them.
+ * @details By default, records are removed from the pfx_table and spki_table once the socket was unable to
+ * refresh them for expire_interval seconds, and added again by the reset query after the reconnect. With this
+ * option enabled, expired records stay in the tables and are marked as stale. The next successful reset replaces
+ * them and only notifies about records that actually changed. The records are still removed if the socket is
+ * stopped.
+ * @param[in] rtr_socket The target socket.
+ * @param[in] retain True to keep expired records until the next reset completes.
+ */
+void rtr_set_retain_stale_records(struct rtr_socket *rtr_socket, bool retain);
+
+/**
+ * @brief Checks if the tables contain expired records of the socket.
+ * @param[in] rtr_socket The target socket.
+ * @return True if records of the socket expired and were not replaced by a reset yet.
+ */
+bool rtr_has_stale_records(const struct rtr_socket *rtr_socket);
+
+/**
+ * @brief Returns the measurements of the connection of the socket.
+ * @details The values are updated by the thread of the socket, the copy may mix values of consecutive
+ * synchronisations.
+ * @param[in] rtr_socket The target socket.
+ * @param[out] metrics Copy of the measurements.
+ */
+void rtr_get_metrics(const struct rtr_socket *rtr_socket, struct rtr_socket_metrics *metrics);
+
+/**
+ * @brief Probes the liveness of the session while it waits for the next refresh.
+ * @details A cache that stops responding without closing the connection is otherwise only noticed when the
+ * Serial Query after the refresh_interval times out. With probing enabled, a Serial Query is sent once the
+ * session was idle for @p interval seconds. If the Cache Response does not arrive within @p timeout seconds,
+ * the socket changes to RTR_ERROR_TRANSPORT, which lets the rtr_mgr fail over to another group. The probe is a
+ * regular incremental synchronisation. Must be called before the socket is started.
+ * @param[in] rtr_socket The target socket.
+ * @param[in] interval Idle time in seconds after which the session is probed, 0 disables probing.
+ * @param[in] timeout Time in seconds to wait for the answer to a probe.
+ * @return RTR_SUCCESS On success.
+ * @return RTR_INVALID_PARAM If @p interval is set but @p timeout is 0.
+ */
+int rtr_set_liveness_probe(struct rtr_socket *rtr_socket, unsigned int interval, unsigned int timeout);
+
+/**
+ * @brief Makes the records of the initial synchronisation visible while they are received.
+ * @details A synchronisation is applied to the tables when its End of Data PDU arrives, so until the last PDU of
+ * the first cache response arrived, all routes are validated as if the socket had no records. With this option
+ * enabled, a synchronisation that starts while the tables hold no records of the socket adds the received records
+ * in batches. The End of Data PDU then only marks the socket as in sync. If the synchronisation fails, the
+ * records added so far are removed again. Incremental updates and resets of a socket that has records are
+ * applied atomically as before.
+ * @param[in] rtr_socket The target socket.
+ * @param[in] enabled True to add the records of the initial synchronisation in batches.
+ */
+void rtr_set_progressive_sync(struct rtr_socket *rtr_socket, bool enabled);
 #endif
 /** @} */
@@ -63,6 +63,7 @@ enum rtr_interval_type { RTR_INTERVAL_TYPE_EXPIRATION, RTR_INTERVAL_TYPE_REFRESH
  * @param[in] fp_data_group Parameter that is passed to the connection_state_fp callback.
  * Expects rtr_mgr_group.
  * @return RTR_INVALID_PARAM If the refresh_interval or the expire_interval is not valid.
+ * @return RTR_ERROR If the synchronisation primitives of the socket could not be initialized.
  * @return RTR_SUCCESS On success.
  */
 int rtr_init(struct rtr_socket *rtr_socket, struct tr_socket *tr_socket, struct pfx_table *pfx_table,
@@ -85,4 +86,36 @@ int rtr_start(struct rtr_socket *rtr_socket);
  */
 void rtr_stop(struct rtr_socket *rtr_socket);
 
+/**
+ * @brief Stops the RTR connection and terminates the transport connection like rtr_stop(), but leaves the records
+ * of the socket in the pfx_table and spki_table.
+ * @details The caller is responsible for removing the records, e.g. with pfx_table_src_handover() and
+ * spki_table_src_handover(), before the socket is started again.
+ * @param[in] rtr_socket rtr_socket that will be used.
+ */
+void rtr_stop_keep_records(struct rtr_socket *rtr_socket);
+
+/**
+ * @brief Asks the thread of the rtr_socket to terminate and returns without waiting for it.
+ * @details The thread is woken up if it waits for data or for the next connection attempt. Transports that
+ * can not be interrupted fall back to cancelling the thread. rtr_stop_wait() must be called afterwards, the
+ * two steps allow to stop many sockets in parallel.
+ * @param[in] rtr_socket rtr_socket that will be used.
+ */
+void rtr_stop_request(struct rtr_socket *rtr_socket);
+
+/**
+ * @brief Waits until the thread of a rtr_socket that was passed to rtr_stop_request() terminated and closes the
+ * transport connection. The records of the socket stay in the pfx_table and spki_table like with
+ * rtr_stop_keep_records().
+ * @param[in] rtr_socket rtr_socket that will be used.
+ */
+void rtr_stop_wait(struct rtr_socket *rtr_socket);
+
+/**
+ * @brief Frees the resources that rtr_init() allocated, the rtr_socket must not be running.
+ * @param[in] rtr_socket rtr_socket that will be used.
+ */
+void rtr_free(struct rtr_socket *rtr_socket);
+
 #endif
@@ -39,7 +39,7 @@ static const char *const mgr_str_status[] = {
 
 static int rtr_mgr_config_cmp(const void *a, const void *b);
 static int rtr_mgr_config_cmp_tommy(const void *a, const void *b);
-static bool rtr_mgr_config_status_is_synced(const struct rtr_mgr_group *group);
+static bool rtr_mgr_config_status_is_synced(const struct rtr_mgr_config *config, const struct rtr_mgr_group *group);
 static void rtr_mgr_cb(const struct rtr_socket *sock, const enum rtr_socket_state state, void *data_config,
 		       void *data_group);
 
@@ -55,45 +55,191 @@ static void set_status(const struct rtr_mgr_config *conf, struct rtr_mgr_group *
 
 static int rtr_mgr_start_sockets(struct rtr_mgr_group *group)
 {
+	// all sockets of a group pass its node to rtr_mgr_cb(), see rtr_mgr_init_sockets()
+	struct rtr_mgr_group_node *group_node = group->sockets[0]->connection_state_fp_param_group;
+	int rtval = RTR_SUCCESS;
+
+	// a socket that synchronises before the last one is started must find the group connecting
+	pthread_mutex_lock(&group_node->start_mutex);
+	group->status = RTR_MGR_CONNECTING;
 	for (unsigned int i = 0; i < group->sockets_len; i++) {
 		if (rtr_start(group->sockets[i]) != 0) {
 			MGR_DBG1("rtr_mgr: Error starting rtr_socket pthread");
-			return RTR_ERROR;
+			rtval = RTR_ERROR;
+			break;
 		}
 	}
-	group->status = RTR_MGR_CONNECTING;
-	return RTR_SUCCESS;
+	pthread_mutex_unlock(&group_node->start_mutex);
+	return rtval;
 }
 
-static int rtr_mgr_init_sockets(struct rtr_mgr_group *group, struct rtr_mgr_config *config,
+static int rtr_mgr_init_sockets(struct rtr_mgr_group_node *group_node, struct rtr_mgr_config *config,
 				const unsigned int refresh_interval, const unsigned int expire_interval,
 				const unsigned int retry_interval, enum rtr_interval_mode iv_mode)
 {
+	struct rtr_mgr_group *group = group_node->group;
+
 	for (unsigned int i = 0; i < group->sockets_len; i++) {
 		enum rtr_rtvals err_code = rtr_init(group->sockets[i], NULL, config->pfx_table, config->spki_table,
 						    refresh_interval, expire_interval, retry_interval, iv_mode,
-						    rtr_mgr_cb, config, group);
+						    rtr_mgr_cb, config, group_node);
 		if (err_code)
 			return err_code;
 	}
 	return RTR_SUCCESS;
 }
 
-bool rtr_mgr_config_status_is_synced(const struct rtr_mgr_group *group)
+static bool rtr_mgr_socket_is_synced(const struct rtr_socket *socket)
 {
-	for (unsigned int i = 0; i < group->sockets_len; i++) {
-		enum rtr_socket_state state = group->sockets[i]->state;
+	enum rtr_socket_state state = socket->state;
+
+	if (socket->last_update == 0)
+		return false;
+	return (state == RTR_ESTABLISHED) || (state == RTR_RESET) || (state == RTR_SYNC);
+}
+
+/*
+ * Lower is better, the time the socket needed to connect and to synchronise. Sockets that never completed a
+ * synchronisation are ranked last.
+ */
+static uint64_t rtr_mgr_socket_score(const struct rtr_socket *socket)
+{
+	if (socket->metrics.syncs == 0)
+		return UINT64_MAX;
+	return (uint64_t)socket->metrics.connect_time + socket->metrics.sync_time;
+}
+
+/* With RTR_MGR_SELECT_FIRST_SYNCED a single synchronised socket is sufficient */
+bool rtr_mgr_config_status_is_synced(const struct rtr_mgr_config *config, const struct rtr_mgr_group *group)
+{
+	unsigned int synced = 0;
 
-		if ((group->sockets[i]->last_update == 0) ||
-		    ((state != RTR_ESTABLISHED) && (state != RTR_RESET) && (state != RTR_SYNC)))
+	for (unsigned int i = 0; i < group->sockets_len; i++) {
+		if (rtr_mgr_socket_is_synced(group->sockets[i]))
+			synced++;
+		else if (config->selection == RTR_MGR_SELECT_ALL)
 			return false;
 	}
-	return true;
+	return synced > 0;
+}
+
+/*
+ * Removes the records of stopped sockets in one pass over both tables. Validations do not observe a state in
+ * which the prefixes are removed and the router keys are not.
+ */
+static void rtr_mgr_remove_records(struct rtr_mgr_config *config, const struct rtr_socket **stopped,
+				   const unsigned int stopped_len)
+{
+	if (stopped_len == 0)
+		return;
+
+	pfx_table_sync_begin(config->pfx_table);
+	pfx_table_src_handover(config->pfx_table, stopped, stopped_len);
+	spki_table_src_handover(config->spki_table, stopped, stopped_len);
+	pfx_table_sync_end(config->pfx_table);
+}
+
+/* Starts the sockets of a group that were stopped by rtr_mgr_keep_first_synced_socket() */
+static void rtr_mgr_start_spare_sockets(struct rtr_mgr_group *group)
+{
+	for (unsigned int i = 0; i < group->sockets_len; i++) {
+		if (group->sockets[i]->thread_id == 0 && group->sockets[i]->state == RTR_CLOSED &&
+		    rtr_start(group->sockets[i]) != RTR_SUCCESS)
+			MGR_DBG1("rtr_mgr: Error starting rtr_socket pthread");
+	}
+}
+
+/*
+ * Releases the selection mutex of a group. A restart of the spares that was requested while the mutex was held
+ * is carried out by the thread that releases it, the requesting thread did not wait for it.
+ */
+static void rtr_mgr_selection_unlock(struct rtr_mgr_group_node *group_node)
+{
+	do {
+		if (__atomic_exchange_n(&group_node->restart_spares, false, __ATOMIC_SEQ_CST)) {
+			MGR_DBG("Group(%u) starting spare sockets", group_node->group->preference);
+			rtr_mgr_start_spare_sockets(group_node->group);
+		}
+		pthread_mutex_unlock(&group_node->selection_mutex);
+		// a request that arrived after the check is handled if no other thread holds the mutex by now
+	} while (__atomic_load_n(&group_node->restart_spares, __ATOMIC_SEQ_CST) &&
+		 pthread_mutex_trylock(&group_node->selection_mutex) == 0);
+}
+
+/**
+ * @brief Stops all sockets of an established group except the one that synchronised first.
+ * @details A thread can not stop itself, so only @p sock can stop the other sockets. If another synchronised
+ * socket has a lower score, nothing is stopped and that socket stops @p sock after its next synchronisation.
+ */
+static void rtr_mgr_keep_first_synced_socket(const struct rtr_socket *sock, struct rtr_mgr_group_node *group_node,
+					     struct rtr_mgr_config *config)
+{
+	struct rtr_mgr_group *group = group_node->group;
+	const struct rtr_socket **stopped;
+	unsigned int stopped_len = 0;
+
+	// the sockets that are not started yet could not be stopped, the starting thread does not wait for sock
+	pthread_mutex_lock(&group_node->start_mutex);
+	pthread_mutex_unlock(&group_node->start_mutex);
+
+	// two sockets that synchronise at the same time must not wait for each other to stop
+	if (pthread_mutex_trylock(&group_node->selection_mutex) != 0)
+		return;
+
+	for (unsigned int i = 0; i < group->sockets_len; i++) {
+		const struct rtr_socket *other = group->sockets[i];
+
+		if (other != sock && rtr_mgr_socket_is_synced(other) &&
+		    rtr_mgr_socket_score(other) < rtr_mgr_socket_score(sock)) {
+			rtr_mgr_selection_unlock(group_node);
+			return;
+		}
+	}
+
+	stopped = lrtr_malloc(sizeof(*stopped) * group->sockets_len);
+	if (!stopped) {
+		rtr_mgr_selection_unlock(group_node);
+		return;
+	}
+
+	for (unsigned int i = 0; i < group->sockets_len; i++) {
+		if (group->sockets[i] == sock || group->sockets[i]->thread_id == 0)
+			continue;
+
+		MGR_DBG("Group(%u) stopping socket %u, another one synchronised first", group->preference, i);
+		rtr_stop_request(group->sockets[i]);
+		stopped[stopped_len++] = group->sockets[i];
+	}
+	for (unsigned int i = 0; i < stopped_len; i++)
+		rtr_stop_wait((struct rtr_socket *)stopped[i]);
+
+	// only records that sock does not hold are reported as removed
+	rtr_mgr_remove_records(config, stopped, stopped_len);
+
+	// sock is synchronised, a restart requested by a socket that failed and was stopped above is obsolete
+	__atomic_store_n(&group_node->restart_spares, false, __ATOMIC_SEQ_CST);
+	rtr_mgr_selection_unlock(group_node);
+	lrtr_free(stopped);
+}
+
+/*
+ * Requests a restart of the spares of a group. It is carried out right away or, if a socket of the group is
+ * selecting at the moment, when that socket releases the selection mutex. Waiting for the mutex could deadlock,
+ * the selecting socket may wait for the thread of the caller to terminate.
+ */
+static void rtr_mgr_request_spare_sockets(struct rtr_mgr_group_node *group_node)
+{
+	__atomic_store_n(&group_node->restart_spares, true, __ATOMIC_SEQ_CST);
+	if (pthread_mutex_trylock(&group_node->selection_mutex) == 0)
+		rtr_mgr_selection_unlock(group_node);
 }
 
 static void rtr_mgr_close_less_preferable_groups(const struct rtr_socket *sock, struct rtr_mgr_config *config,
 						 struct rtr_mgr_group *group)
 {
+	const struct rtr_socket **stopped = NULL;
+	unsigned int stopped_len = 0;
+
 	pthread_rwlock_rdlock(&config->mutex);
 	tommy_node *node = tommy_list_head(&config->groups->list);
 
@@ -103,17 +249,54 @@ static void rtr_mgr_close_less_preferable_groups(const struct rtr_socket *sock,
 
 		if ((current_group->status != RTR_MGR_CLOSED) && (current_group != group) &&
 		    (current_group->preference > group->preference)) {
-			for (unsigned int j = 0; j < current_group->sockets_len; j++)
-				rtr_stop(current_group->sockets[j]);
+			const struct rtr_socket **tmp =
+				lrtr_realloc(stopped, sizeof(*stopped) * (stopped_len + current_group->sockets_len));
+
+			for (unsigned int j = 0; j < current_group->sockets_len; j++) {
+				if (tmp) {
+					rtr_stop_request(current_group->sockets[j]);
+					tmp[stopped_len++] = current_group->sockets[j];
+				} else {
+					rtr_stop(current_group->sockets[j]);
+				}
+			}
+			if (tmp)
+				stopped = tmp;
 			set_status(config, current_group, RTR_MGR_CLOSED, sock);
 		}
 		node = node->next;
 	}
+
+	// the threads of all closed groups were asked to terminate before the first one is joined
+	for (unsigned int i = 0; i < stopped_len; i++)
+		rtr_stop_wait((struct rtr_socket *)stopped[i]);
+
+	/* The records of the closed groups are replaced by the records of group, which are already part of the
+	 * tables. Removing them in one operation only notifies about records that group does not hold.
+	 */
+	rtr_mgr_remove_records(config, stopped, stopped_len);
 	pthread_rwlock_unlock(&config->mutex);
+	lrtr_free(stopped);
+}
+
+static uint64_t rtr_mgr_group_score(const struct rtr_mgr_group *group)
+{
+	uint64_t score = UINT64_MAX;
+
+	for (unsigned int i = 0; i < group->sockets_len; i++) {
+		uint64_t socket_score = rtr_mgr_socket_score(group->sockets[i]);
+
+		if (socket_score < score)
+			score = socket_score;
+	}
+	return score;
 }
 
 static struct rtr_mgr_group *get_best_inactive_rtr_mgr_group(struct rtr_mgr_config *config, struct rtr_mgr_group *group)
 {
+	struct rtr_mgr_group *best_group = NULL;
+	uint64_t best_score = UINT64_MAX;
+
 	pthread_rwlock_rdlock(&config->mutex);
 	tommy_node *node = tommy_list_head(&config->groups->list);
 
@@ -122,13 +305,23 @@ static struct rtr_mgr_group *get_best_inactive_rtr_mgr_group(struct rtr_mgr_conf
 		struct rtr_mgr_group *current_group = group_node->group;
 
 		if ((current_group != group) && (current_group->status == RTR_MGR_CLOSED)) {
-			pthread_rwlock_unlock(&config->mutex);
-			return current_group;
+			if (config->selection == RTR_MGR_SELECT_ALL) {
+				pthread_rwlock_unlock(&config->mutex);
+				return current_group;
+			}
+
+			// the list is sorted by preference, which decides between groups with the same score
+			uint64_t score = rtr_mgr_group_score(current_group);
+
+			if (!best_group || score < best_score) {
+				best_group = current_group;
+				best_score = score;
+			}
 		}
 		node = node->next;
 	}
 	pthread_rwlock_unlock(&config->mutex);
-	return NULL;
+	return best_group;
 }
 
 static bool is_some_rtr_mgr_group_established(struct rtr_mgr_config *config)
@@ -176,7 +369,7 @@ static inline void _rtr_mgr_cb_state_established(const struct rtr_socket *sock,
 		 * other sockets in the group also have a established
 		 * connection, if yes change group state to ESTABLISHED
 		 */
-		if (rtr_mgr_config_status_is_synced(group)) {
+		if (rtr_mgr_config_status_is_synced(config, group)) {
 			set_status(config, group, RTR_MGR_ESTABLISHED, sock);
 			rtr_mgr_close_less_preferable_groups(sock, config, group);
 		} else {
@@ -205,7 +398,7 @@ static inline void _rtr_mgr_cb_state_established(const struct rtr_socket *sock,
 		}
 		pthread_rwlock_unlock(&config->mutex);
 
-		if (all_error && rtr_mgr_config_status_is_synced(group)) {
+		if (all_error && rtr_mgr_config_status_is_synced(config, group)) {
 			set_status(config, group, RTR_MGR_ESTABLISHED, sock);
 			rtr_mgr_close_less_preferable_groups(sock, config, group);
 		} else {
@@ -224,10 +417,15 @@ static inline void _rtr_mgr_cb_state_connecting(const struct rtr_socket *sock, s
 }
 
 static inline void _rtr_mgr_cb_state_error(const struct rtr_socket *sock, struct rtr_mgr_config *config,
-					   struct rtr_mgr_group *group)
+					   struct rtr_mgr_group_node *group_node)
 {
+	struct rtr_mgr_group *group = group_node->group;
+
 	set_status(config, group, RTR_MGR_ERROR, sock);
 
+	if (config->selection == RTR_MGR_SELECT_FIRST_SYNCED)
+		rtr_mgr_request_spare_sockets(group_node);
+
 	if (!is_some_rtr_mgr_group_established(config)) {
 		struct rtr_mgr_group *next_group = get_best_inactive_rtr_mgr_group(config, group);
 
@@ -245,19 +443,23 @@ static void rtr_mgr_cb(const struct rtr_socket *sock, const enum rtr_socket_stat
 		MGR_DBG1("Received RTR_SHUTDOWN callback");
 
 	struct rtr_mgr_config *config = data_config;
-	struct rtr_mgr_group *group = data_group;
+	struct rtr_mgr_group_node *group_node = data_group;
 
-	if (!group) {
+	if (!group_node) {
 		MGR_DBG1("ERROR: Socket has no group");
 		return;
 	}
 
+	struct rtr_mgr_group *group = group_node->group;
+
 	switch (state) {
 	case RTR_SHUTDOWN:
 		_rtr_mgr_cb_state_shutdown(sock, config, group);
 		break;
 	case RTR_ESTABLISHED:
 		_rtr_mgr_cb_state_established(sock, config, group);
+		if (config->selection == RTR_MGR_SELECT_FIRST_SYNCED && group->status == RTR_MGR_ESTABLISHED)
+			rtr_mgr_keep_first_synced_socket(sock, group_node, config);
 		break;
 	case RTR_CONNECTING:
 		_rtr_mgr_cb_state_connecting(sock, config, group);
@@ -265,7 +467,7 @@ static void rtr_mgr_cb(const struct rtr_socket *sock, const enum rtr_socket_stat
 	case RTR_ERROR_FATAL:
 	case RTR_ERROR_TRANSPORT:
 	case RTR_ERROR_NO_DATA_AVAIL:
-		_rtr_mgr_cb_state_error(sock, config, group);
+		_rtr_mgr_cb_state_error(sock, config, group_node);
 		break;
 	default:
 		set_status(config, group, group->status, sock);
@@ -324,6 +526,7 @@ RTRLIB_EXPORT int rtr_mgr_init(struct rtr_mgr_config **config_out, struct rtr_mg
 		MGR_DBG1("Mutex initialization failed");
 		goto err;
 	}
+	config->selection = RTR_MGR_SELECT_ALL;
 	/* sort array in asc order, so we can check for dupl. pref */
 	qsort(groups, groups_len, sizeof(struct rtr_mgr_group), &rtr_mgr_config_cmp);
 
@@ -370,15 +573,34 @@ RTRLIB_EXPORT int rtr_mgr_init(struct rtr_mgr_config **config_out, struct rtr_mg
 		memcpy(cg, &groups[i], sizeof(struct rtr_mgr_group));
 
 		cg->status = RTR_MGR_CLOSED;
-		err_code = rtr_mgr_init_sockets(cg, config, refresh_interval, expire_interval, retry_interval, iv_mode);
-		if (err_code)
-			goto err;
 
+		// the sockets pass the node to rtr_mgr_cb(), it has to exist before they are initialized
 		group_node = lrtr_malloc(sizeof(struct rtr_mgr_group_node));
 		if (!group_node)
 			goto err;
 
 		group_node->group = cg;
+		group_node->restart_spares = false;
+		if (pthread_mutex_init(&group_node->selection_mutex, NULL) != 0) {
+			MGR_DBG1("Mutex initialization failed");
+			lrtr_free(group_node);
+			goto err;
+		}
+		if (pthread_mutex_init(&group_node->start_mutex, NULL) != 0) {
+			MGR_DBG1("Mutex initialization failed");
+			pthread_mutex_destroy(&group_node->selection_mutex);
+			lrtr_free(group_node);
+			goto err;
+		}
+		err_code = rtr_mgr_init_sockets(group_node, config, refresh_interval, expire_interval, retry_interval,
+						iv_mode);
+		if (err_code) {
+			pthread_mutex_destroy(&group_node->start_mutex);
+			pthread_mutex_destroy(&group_node->selection_mutex);
+			lrtr_free(group_node);
+			goto err;
+		}
+
 		tommy_list_insert_tail(&config->groups->list, &group_node->node, group_node);
 	}
 	/* Our linked list should be sorted already, since the groups array was
@@ -416,6 +638,55 @@ RTRLIB_EXPORT struct rtr_mgr_group *rtr_mgr_get_first_group(struct rtr_mgr_confi
 	return group_node->group;
 }
 
+static unsigned int rtr_mgr_sockets_len(const struct rtr_mgr_config *config)
+{
+	unsigned int sockets_len = 0;
+	tommy_node *node = tommy_list_head(&config->groups->list);
+
+	while (node) {
+		struct rtr_mgr_group_node *group_node = node->data;
+
+		sockets_len += group_node->group->sockets_len;
+		node = node->next;
+	}
+	return sockets_len;
+}
+
+/*
+ * Stops the sockets of all groups and leaves their records in the tables. All threads are asked to terminate
+ * before the first one is joined, so they shut down in parallel. The sockets that were running are stored in
+ * stopped if it is not NULL. If tearing_down is true, sockets that are not running are left untouched and don't
+ * report RTR_SHUTDOWN. The caller must hold the read lock of config.
+ */
+static void rtr_mgr_stop_sockets(struct rtr_mgr_config *config, const bool tearing_down,
+				 const struct rtr_socket **stopped, unsigned int *stopped_len)
+{
+	tommy_node *node = tommy_list_head(&config->groups->list);
+
+	while (node) {
+		struct rtr_mgr_group_node *group_node = node->data;
+
+		for (unsigned int j = 0; j < group_node->group->sockets_len; j++) {
+			struct rtr_socket *socket = group_node->group->sockets[j];
+
+			if (socket->thread_id != 0 && stopped)
+				stopped[(*stopped_len)++] = socket;
+			if (socket->thread_id != 0 || !tearing_down)
+				rtr_stop_request(socket);
+		}
+		node = node->next;
+	}
+
+	node = tommy_list_head(&config->groups->list);
+	while (node) {
+		struct rtr_mgr_group_node *group_node = node->data;
+
+		for (unsigned int j = 0; j < group_node->group->sockets_len; j++)
+			rtr_stop_wait(group_node->group->sockets[j]);
+		node = node->next;
+	}
+}
+
 RTRLIB_EXPORT int rtr_mgr_start(struct rtr_mgr_config *config)
 {
 	MGR_DBG("%s()", __func__);
@@ -431,13 +702,17 @@ RTRLIB_EXPORT bool rtr_mgr_conf_in_sync(struct rtr_mgr_config *config)
 
 	while (node) {
 		bool all_sync = true;
+		unsigned int synced = 0;
 		struct rtr_mgr_group_node *group_node = node->data;
 
-		for (unsigned int j = 0; all_sync && (j < group_node->group->sockets_len); j++) {
+		for (unsigned int j = 0; j < group_node->group->sockets_len; j++) {
 			if (group_node->group->sockets[j]->last_update == 0)
 				all_sync = false;
+			else
+				synced++;
 		}
-		if (all_sync) {
+		// the sockets that did not synchronise first were stopped and hold no records
+		if (all_sync || (config->selection == RTR_MGR_SELECT_FIRST_SYNCED && synced > 0)) {
 			pthread_rwlock_unlock(&config->mutex);
 			return true;
 		}
@@ -450,6 +725,14 @@ RTRLIB_EXPORT bool rtr_mgr_conf_in_sync(struct rtr_mgr_config *config)
 RTRLIB_EXPORT void rtr_mgr_free(struct rtr_mgr_config *config)
 {
 	MGR_DBG("%s()", __func__);
+
+	/* Sockets that are still running are torn down without removing their records first, the tables are
+	 * freed below anyway. The threads need the read lock to shut down.
+	 */
+	pthread_rwlock_rdlock(&config->mutex);
+	rtr_mgr_stop_sockets(config, true, NULL, NULL);
+	pthread_rwlock_unlock(&config->mutex);
+
 	pthread_rwlock_wrlock(&config->mutex);
 
 	pfx_table_free(config->pfx_table);
@@ -465,9 +748,13 @@ RTRLIB_EXPORT void rtr_mgr_free(struct rtr_mgr_config *config)
 		struct rtr_mgr_group_node *group_node = tmp->data;
 
 		head = head->next;
-		for (unsigned int j = 0; j < group_node->group->sockets_len; j++)
+		for (unsigned int j = 0; j < group_node->group->sockets_len; j++) {
+			rtr_free(group_node->group->sockets[j]);
 			tr_free(group_node->group->sockets[j]->tr_socket);
+		}
 
+		pthread_mutex_destroy(&group_node->start_mutex);
+		pthread_mutex_destroy(&group_node->selection_mutex);
 		lrtr_free(group_node->group);
 		lrtr_free(group_node);
 	}
@@ -487,6 +774,51 @@ RTRLIB_EXPORT inline int rtr_mgr_validate(struct rtr_mgr_config *config, const u
 	return pfx_table_validate(config->pfx_table, asn, prefix, mask_len, result);
 }
 
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_mgr_validate_route(struct rtr_mgr_config *config, const struct rtr_mgr_route *route,
+					 struct rtr_mgr_route_result *result)
+{
+	bool verify;
+#ifdef RTRLIB_BGPSEC_ENABLED
+	struct bgpsec_key_set key_set;
+	bool keys_resolved = false;
+#endif
+
+	result->bgpsec = 0; // RTR_BGPSEC_SUCCESS, also without BGPsec support
+	result->aspa = RTR_MGR_ASPA_NOT_CHECKED;
+
+	pfx_table_snapshot_begin(config->pfx_table);
+	if (pfx_table_validate(config->pfx_table, route->origin_asn, &route->prefix, route->mask_len,
+			       &result->origin) == PFX_ERROR) {
+		pfx_table_snapshot_end(config->pfx_table);
+		return RTR_ERROR;
+	}
+
+	// the other verdicts do not change anything for a route that is rejected because of its origin
+	verify = result->origin != BGP_PFXV_STATE_INVALID || (route->flags & RTR_MGR_ROUTE_VERIFY_INVALID);
+#ifdef RTRLIB_BGPSEC_ENABLED
+	if (verify && route->bgpsec) {
+		result->bgpsec = rtr_bgpsec_resolve_as_path(route->bgpsec, config->spki_table, &key_set);
+		keys_resolved = true;
+	}
+#endif
+	pfx_table_snapshot_end(config->pfx_table);
+
+	if (verify && route->as_path && route->aspa_fp)
+		result->aspa = route->aspa_fp(route->as_path, route->as_path_len, route->aspa_data);
+
+#ifdef RTRLIB_BGPSEC_ENABLED
+	// the resolved keys stay valid if the spki_table changes, synchronisations do not wait for the signatures
+	if (keys_resolved) {
+		if (result->bgpsec == RTR_BGPSEC_SUCCESS)
+			result->bgpsec = rtr_bgpsec_verify_as_path(route->bgpsec, config->spki_table, &key_set);
+		else
+			free_router_keys(&key_set);
+	}
+#endif
+	return RTR_SUCCESS;
+}
+
 /* cppcheck-suppress unusedFunction */
 RTRLIB_EXPORT inline int rtr_mgr_get_spki(struct rtr_mgr_config *config, const uint32_t asn, uint8_t *ski,
 					  struct spki_record **result, unsigned int *result_count)
@@ -496,18 +828,47 @@ RTRLIB_EXPORT inline int rtr_mgr_get_spki(struct rtr_mgr_config *config, const u
 
 RTRLIB_EXPORT void rtr_mgr_stop(struct rtr_mgr_config *config)
 {
-	pthread_rwlock_rdlock(&config->mutex);
-	tommy_node *node = tommy_list_head(&config->groups->list);
+	const struct rtr_socket **stopped;
+	unsigned int stopped_len = 0;
 
+	pthread_rwlock_rdlock(&config->mutex);
 	MGR_DBG("%s()", __func__);
-	while (node) {
-		struct rtr_mgr_group_node *group_node = node->data;
 
-		for (unsigned int j = 0; j < group_node->group->sockets_len; j++)
-			rtr_stop(group_node->group->sockets[j]);
-		node = node->next;
+	stopped = lrtr_malloc(sizeof(*stopped) * rtr_mgr_sockets_len(config));
+	if (!stopped) {
+		tommy_node *node = tommy_list_head(&config->groups->list);
+
+		while (node) {
+			struct rtr_mgr_group_node *group_node = node->data;
+
+			for (unsigned int j = 0; j < group_node->group->sockets_len; j++)
+				rtr_stop(group_node->group->sockets[j]);
+			node = node->next;
+		}
+		pthread_rwlock_unlock(&config->mutex);
+		return;
 	}
+
+	rtr_mgr_stop_sockets(config, false, stopped, &stopped_len);
+
+	// one pass over the tables removes the records of all sockets
+	rtr_mgr_remove_records(config, stopped, stopped_len);
 	pthread_rwlock_unlock(&config->mutex);
+	lrtr_free(stopped);
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_mgr_set_selection(struct rtr_mgr_config *config, enum rtr_mgr_selection selection)
+{
+	switch (selection) {
+	case RTR_MGR_SELECT_ALL:
+	case RTR_MGR_SELECT_FIRST_SYNCED:
+		config->selection = selection;
+		return RTR_SUCCESS;
+	default:
+		MGR_DBG1("Invalid selection strategy");
+		return RTR_INVALID_PARAM;
+	}
 }
 
 /* cppcheck-suppress unusedFunction */
@@ -553,15 +914,35 @@ RTRLIB_EXPORT int rtr_mgr_add_group(struct rtr_mgr_config *config, const struct
 	memcpy(new_group, group, sizeof(struct rtr_mgr_group));
 	new_group->status = RTR_MGR_CLOSED;
 
-	err_code = rtr_mgr_init_sockets(new_group, config, refresh_iv, expire_iv, retry_iv, iv_mode);
-	if (err_code)
-		goto err;
-
 	new_group_node = lrtr_malloc(sizeof(struct rtr_mgr_group_node));
 	if (!new_group_node)
 		goto err;
 
 	new_group_node->group = new_group;
+	new_group_node->restart_spares = false;
+	if (pthread_mutex_init(&new_group_node->selection_mutex, NULL) != 0) {
+		MGR_DBG1("Mutex initialization failed");
+		lrtr_free(new_group_node);
+		new_group_node = NULL;
+		goto err;
+	}
+	if (pthread_mutex_init(&new_group_node->start_mutex, NULL) != 0) {
+		MGR_DBG1("Mutex initialization failed");
+		pthread_mutex_destroy(&new_group_node->selection_mutex);
+		lrtr_free(new_group_node);
+		new_group_node = NULL;
+		goto err;
+	}
+
+	err_code = rtr_mgr_init_sockets(new_group_node, config, refresh_iv, expire_iv, retry_iv, iv_mode);
+	if (err_code) {
+		pthread_mutex_destroy(&new_group_node->start_mutex);
+		pthread_mutex_destroy(&new_group_node->selection_mutex);
+		lrtr_free(new_group_node);
+		new_group_node = NULL;
+		goto err;
+	}
+
 	tommy_list_insert_tail(&config->groups->list, &new_group_node->node, new_group_node);
 	config->len++;
 
@@ -625,18 +1006,41 @@ RTRLIB_EXPORT int rtr_mgr_remove_group(struct rtr_mgr_config *config, unsigned i
 
 	// If group isn't closed, make it so!
 	if (remove_group->status != RTR_MGR_CLOSED) {
+		const struct rtr_socket **stopped = lrtr_malloc(sizeof(*stopped) * remove_group->sockets_len);
+		unsigned int stopped_len = 0;
+
+		for (unsigned int j = 0; j < remove_group->sockets_len; j++) {
+			if (stopped && remove_group->sockets[j]->thread_id != 0)
+				stopped[stopped_len++] = remove_group->sockets[j];
+			rtr_stop_request(remove_group->sockets[j]);
+		}
 		for (unsigned int j = 0; j < remove_group->sockets_len; j++) {
-			rtr_stop(remove_group->sockets[j]);
-			tr_free(remove_group->sockets[j]->tr_socket);
+			rtr_stop_wait(remove_group->sockets[j]);
+			if (!stopped) {
+				pfx_table_sync_begin(config->pfx_table);
+				pfx_table_src_remove(config->pfx_table, remove_group->sockets[j]);
+				spki_table_src_remove(config->spki_table, remove_group->sockets[j]);
+				pfx_table_sync_end(config->pfx_table);
+			}
 		}
+		rtr_mgr_remove_records(config, stopped, stopped_len);
+		lrtr_free(stopped);
 		set_status(config, remove_group, RTR_MGR_CLOSED, NULL);
 	}
 
+	// the sockets of a group that was never started or closed before hold resources as well
+	for (unsigned int j = 0; j < remove_group->sockets_len; j++) {
+		rtr_free(remove_group->sockets[j]);
+		tr_free(remove_group->sockets[j]->tr_socket);
+	}
+
 	struct rtr_mgr_group *best_group = rtr_mgr_get_first_group(config);
 
 	if (best_group->status == RTR_MGR_CLOSED)
 		rtr_mgr_start_sockets(best_group);
 
+	pthread_mutex_destroy(&group_node->start_mutex);
+	pthread_mutex_destroy(&group_node->selection_mutex);
 	lrtr_free(group_node->group);
 	lrtr_free(group_node);
 	return RTR_SUCCESS;
@@ -696,6 +1100,30 @@ RTRLIB_EXPORT int rtr_mgr_bgpsec_generate_signature(const struct rtr_bgpsec *dat
 	return retval;
 }
 
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_mgr_bgpsec_generate_signatures(const struct rtr_bgpsec *data, uint8_t *private_key,
+						     const uint32_t *target_as, const unsigned int targets_len,
+						     unsigned int threads, struct rtr_signature_seg **new_signatures)
+{
+	return rtr_bgpsec_generate_signatures(data, private_key, target_as, targets_len, threads, new_signatures);
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_mgr_bgpsec_build_path(const struct rtr_bgpsec *data, const uint8_t *attr, const size_t attr_len,
+					    const struct rtr_secure_path_seg *own_seg, const uint8_t *ski,
+					    uint8_t *private_key, uint8_t *buffer, const size_t buffer_len,
+					    size_t *new_attr_len)
+{
+	return rtr_bgpsec_build_path(data, attr, attr_len, own_seg, ski, private_key, buffer, buffer_len,
+				     new_attr_len);
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT int rtr_mgr_bgpsec_set_key_cache_budget(struct rtr_mgr_config *config, size_t budget)
+{
+	return rtr_bgpsec_set_key_cache_budget(config->spki_table, budget);
+}
+
 /* cppcheck-suppress unusedFunction */
 RTRLIB_EXPORT int rtr_mgr_bgpsec_get_version(void)
 {
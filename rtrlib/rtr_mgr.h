@@ -24,7 +24,9 @@
  * draft-ietf-sidr-rpki-rtr-rfc6810-bis</a>).
  * If a more preferred group is online again, the RTR connection manager
  * will switch back and close connections to the caches of the less
- * preferred group.
+ * preferred group.\n
+ * With #RTR_MGR_SELECT_FIRST_SYNCED, only the cache of a group that
+ * synchronised first stays connected, see rtr_mgr_set_selection().
  *
  * @{
  * @example rtr_mgr.c
@@ -42,6 +44,7 @@
 #endif
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -58,6 +61,26 @@ enum rtr_mgr_status {
 	RTR_MGR_ERROR,
 };
 
+/**
+ * @brief Strategies that select the sockets of the active group that stay connected.
+ */
+enum rtr_mgr_selection {
+	/** All sockets of the active group stay connected, the default. */
+	RTR_MGR_SELECT_ALL = 0,
+
+	/** @brief Only the socket of the active group that synchronised first stays connected.
+	 * @details All sockets of the group are started, the first one that completes a synchronisation keeps its
+	 * connection and stops the other sockets. The selection is not revised while that socket works, a cache
+	 * that only becomes faster later is not switched to. If more than one socket is synchronised when the
+	 * selection is made, the one with the lowest sum of connect time and synchronisation time is kept.\n
+	 * The stopped sockets are cold spares: they are disconnected and hold no records. When the active socket
+	 * fails they are started again and need a full reset, until then the group has no synchronised cache.
+	 * When the manager falls back to another group, the inactive group whose caches synchronised fastest
+	 * before is started first, groups without measurements follow in the order of their preference.
+	 */
+	RTR_MGR_SELECT_FIRST_SYNCED
+};
+
 /**
  * @brief A set of RTR sockets.
  * @param sockets Array of rtr_socket pointer. The tr_socket element of
@@ -88,6 +111,78 @@ struct rtr_mgr_config {
 	void *status_fp_data;
 	struct pfx_table *pfx_table;
 	struct spki_table *spki_table;
+	enum rtr_mgr_selection selection;
+};
+
+/**
+ * @brief Result of the ASPA verification of an AS_PATH.
+ */
+enum rtr_mgr_aspa_state {
+	/** The AS_PATH was not verified. */
+	RTR_MGR_ASPA_NOT_CHECKED,
+	/** The AS_PATH is valid. */
+	RTR_MGR_ASPA_VALID,
+	/** ASPA records that are needed to verify the AS_PATH are missing. */
+	RTR_MGR_ASPA_UNKNOWN,
+	/** The AS_PATH is invalid. */
+	RTR_MGR_ASPA_INVALID,
+};
+
+/**
+ * @brief Verifies an AS_PATH with the ASPA records of the application.
+ * @param as_path ASes of the AS_PATH, the AS of the neighbor first and the origin AS last.
+ * @param as_path_len Number of elements in @p as_path.
+ * @param data Forwarded from rtr_mgr_route.aspa_data.
+ */
+typedef enum rtr_mgr_aspa_state (*rtr_mgr_aspa_fp)(const uint32_t *as_path, const unsigned int as_path_len,
+						   void *data);
+
+/**
+ * @brief Flags of a rtr_mgr_route.
+ */
+enum rtr_mgr_route_flags {
+	/** Verify the BGPsec_PATH and the AS_PATH even if the origin of the route is invalid. */
+	RTR_MGR_ROUTE_VERIFY_INVALID = 1 << 0,
+};
+
+struct rtr_bgpsec;
+
+/**
+ * @brief A route that is validated by rtr_mgr_validate_route().
+ * @param prefix Announced network prefix.
+ * @param mask_len Length of the network mask of the announced prefix.
+ * @param origin_asn Autonomous system number of the Origin-AS of the prefix.
+ * @param as_path AS_PATH of the route, the AS of the neighbor first. NULL to skip the ASPA verification.
+ * @param as_path_len Number of elements in @p as_path.
+ * @param aspa_fp Verifies @p as_path, NULL to skip the ASPA verification.
+ * @param aspa_data Forwarded to @p aspa_fp.
+ * @param bgpsec Data of the BGPsec_PATH of the route, NULL if it has none. Ignored if RTRlib was built without
+ *		 BGPsec support.
+ * @param flags Bitwise OR of rtr_mgr_route_flags.
+ */
+struct rtr_mgr_route {
+	struct lrtr_ip_addr prefix;
+	uint8_t mask_len;
+	uint32_t origin_asn;
+	const uint32_t *as_path;
+	unsigned int as_path_len;
+	rtr_mgr_aspa_fp aspa_fp;
+	void *aspa_data;
+	const struct rtr_bgpsec *bgpsec;
+	unsigned int flags;
+};
+
+/**
+ * @brief Verdicts of rtr_mgr_validate_route().
+ * @param origin Result of the origin validation.
+ * @param bgpsec Result of the BGPsec verification, RTR_BGPSEC_VALID, RTR_BGPSEC_NOT_VALID or one of the error
+ *		 codes of rtr_bgpsec_rtvals. RTR_BGPSEC_SUCCESS if the BGPsec_PATH was not verified.
+ * @param aspa Result of the ASPA verification.
+ */
+struct rtr_mgr_route_result {
+	enum pfxv_state origin;
+	int bgpsec;
+	enum rtr_mgr_aspa_state aspa;
 };
 
 /**
@@ -118,6 +213,9 @@ struct rtr_mgr_config {
 			every added and removed pfx_record.
  * @param[in] spki_update_fp Pointer to spki_update_fp callback, that is
 			     executed for every added and removed spki_record.
+			     Both update callbacks run while an update of the
+			     tables is in progress and must not call rtr_mgr_*
+			     functions.
  * @param[in] status_fp Pointer to a function that is called if the connection
  *			status from one of the socket groups is changed.
  * @param[in] status_fp_data Pointer to a memory area that is passed to the
@@ -165,9 +263,22 @@ int rtr_mgr_add_group(struct rtr_mgr_config *config, const struct rtr_mgr_group
  *
  */
 int rtr_mgr_remove_group(struct rtr_mgr_config *config, unsigned int preference);
+/**
+ * @brief Sets the strategy that selects the sockets of the active group that stay connected.
+ * @details Must be called before rtr_mgr_start(). The measurements the selection is based on can be read with
+ * rtr_get_metrics().
+ * @param config A rtr_mgr_config struct that has been initialized previously with rtr_mgr_init
+ * @param selection The selection strategy.
+ * @return RTR_INVALID_PARAM If @p selection is not a valid strategy.
+ * @return RTR_SUCCESS If the strategy was set.
+ */
+int rtr_mgr_set_selection(struct rtr_mgr_config *config, enum rtr_mgr_selection selection);
+
 /**
  * @brief Frees all resources that were allocated from the rtr_mgr.
- * @details rtr_mgr_stop must be called before, to shutdown all rtr_sockets.
+ * @details rtr_sockets that are still running are shut down in parallel. Their records are not removed one
+ * socket at a time, they are dropped together with the tables. Call rtr_mgr_stop() before to report the removal
+ * of the records of each socket separately.
  * @param[in] config rtr_mgr_config.
  */
 void rtr_mgr_free(struct rtr_mgr_config *config);
@@ -186,13 +297,15 @@ int rtr_mgr_start(struct rtr_mgr_config *config);
 /**
  * @brief Terminates rtr_socket connections
  * @details Terminates all rtr_socket connections defined in the config.
- * All pfx_records received from these sockets will be purged.
+ * All pfx_records received from these sockets will be purged. The sockets are shut down in parallel and their
+ * records are removed in a single pass over the tables.
  * @param[in] config The rtr_mgr_config struct
  */
 void rtr_mgr_stop(struct rtr_mgr_config *config);
 
 /**
  * @brief Check if rtr_mgr_group is fully synchronized with at least one group.
+ * @details With #RTR_MGR_SELECT_FIRST_SYNCED a group is synchronized once one of its sockets is.
  * @param[in] config The rtr_mgr_config.
  * @return true If pfx_table stores non-outdated pfx_records
  * @return false If pfx_table isn't fully synchronized with at least one group.
@@ -212,6 +325,22 @@ bool rtr_mgr_conf_in_sync(struct rtr_mgr_config *config);
 int rtr_mgr_validate(struct rtr_mgr_config *config, const uint32_t asn, const struct lrtr_ip_addr *prefix,
 		     const uint8_t mask_len, enum pfxv_state *result);
 
+/**
+ * @brief Validates the origin, the BGPsec_PATH and the AS_PATH of a BGP-Route in one call.
+ * @details The origin and the router keys of the BGPsec_PATH are looked up in a single state of the tables, a
+ * synchronisation of a socket is either seen completely or not at all. The signatures are verified afterwards,
+ * without blocking synchronisations. Unless RTR_MGR_ROUTE_VERIFY_INVALID is set, the BGPsec_PATH and the AS_PATH
+ * of a route with an invalid origin are not verified. RTRlib holds no ASPA records, the AS_PATH is verified by
+ * rtr_mgr_route.aspa_fp. Must not be called from the update callbacks of the tables.
+ * @param[in] config The rtr_mgr_config
+ * @param[in] route The route to validate.
+ * @param[out] result Verdicts of the route.
+ * @return RTR_SUCCESS On success, BGPsec errors are reported in @p result.
+ * @return RTR_ERROR If the origin validation failed.
+ */
+int rtr_mgr_validate_route(struct rtr_mgr_config *config, const struct rtr_mgr_route *route,
+			   struct rtr_mgr_route_result *result);
+
 /**
  * @brief Returns all SPKI records which match the given ASN and SKI.
  * @param[in] config
@@ -295,6 +424,68 @@ int rtr_mgr_bgpsec_validate_as_path(const struct rtr_bgpsec *data, struct rtr_mg
 int rtr_mgr_bgpsec_generate_signature(const struct rtr_bgpsec *data, uint8_t *private_key,
 				      struct rtr_signature_seg **new_signature);
 
+/**
+ * @brief Signing function for a BGPsec_PATH that is sent to several peers.
+ * @details The byte sequence is aligned and the private key is loaded only
+ * once, the signatures differ in the target AS only. The target_as field
+ * of @p data is ignored.
+ * @param[in] data Data required for AS path validation. See @ref rtr_bgpsec.
+ * @param[in] private_key The raw bytes of the private key that is used for signing.
+ * @param[in] target_as The ASes the update is sent to.
+ * @param[in] targets_len Number of elements in @p target_as.
+ * @param[in] threads Maximum number of threads that generate signatures,
+ *		      0 and 1 sign in the calling thread only.
+ * @param[out] new_signatures Array of @p targets_len elements that receives
+ *			      the signature for each target AS. All elements
+ *			      must be NULL. No signature is returned on error.
+ * @return RTR_BGPSEC_SUCCESS If all signatures were successfully generated.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			    more details.
+ */
+int rtr_mgr_bgpsec_generate_signatures(const struct rtr_bgpsec *data, uint8_t *private_key, const uint32_t *target_as,
+				       const unsigned int targets_len, unsigned int threads,
+				       struct rtr_signature_seg **new_signatures);
+
+/**
+ * @brief Signs a received BGPsec_PATH attribute and writes the attribute that is sent to a peer into a buffer.
+ * @details The Secure_Path Segment and the Signature Segment of this AS are prepended to the segments of the
+ * received attribute, which are copied without being decoded into segment lists. Signature_Blocks of other
+ * algorithm suites are removed. Nothing is allocated by RTRlib, so the function suits the generation of
+ * UPDATEs for many prefixes.
+ * @param[in] data Algorithm suite, AFI, SAFI, target AS and NLRI of the update. The Secure_Path and Signature
+ *		   Segments of @p data are ignored. See @ref rtr_bgpsec.
+ * @param[in] attr The received BGPsec_PATH attribute including its attribute header, NULL to originate a path.
+ * @param[in] attr_len Length of @p attr in bytes, 0 to originate a path.
+ * @param[in] own_seg The Secure_Path Segment of this AS.
+ * @param[in] ski The SKI of the router key that belongs to @p private_key.
+ * @param[in] private_key The raw bytes of the private key that is used for signing.
+ * @param[out] buffer Receives the new BGPsec_PATH attribute including its attribute header. Must not overlap
+ *		      @p attr.
+ * @param[in] buffer_len Size of @p buffer in bytes.
+ * @param[out] new_attr_len Length of the new attribute. If @p buffer is too small, the size that is required.
+ * @return RTR_BGPSEC_SUCCESS If the attribute was written to @p buffer.
+ * @return RTR_BGPSEC_BUFFER_TOO_SMALL If @p buffer can not hold the attribute with a signature of maximum size.
+ * @return RTR_BGPSEC_INVALID_ARGUMENTS If @p attr is malformed or an argument is missing.
+ * @return RTR_BGPSEC_ERROR If an error occurred. Refer to error codes for
+ *			    more details.
+ */
+int rtr_mgr_bgpsec_build_path(const struct rtr_bgpsec *data, const uint8_t *attr, const size_t attr_len,
+			      const struct rtr_secure_path_seg *own_seg, const uint8_t *ski, uint8_t *private_key,
+			      uint8_t *buffer, const size_t buffer_len, size_t *new_attr_len);
+
+/**
+ * @brief Sets the memory budget of the router key cache used for BGPsec validation.
+ * @details The cache keeps parsed router keys and, for frequently used keys,
+ * precomputed multiples of the public key that speed up the signature
+ * verification. The cache is disabled by default, a budget of 0 evicts all
+ * cached keys. Should be called before validation starts.
+ * @param[in] config The rtr_mgr_config containing a SPKI table.
+ * @param[in] budget Maximum memory in bytes used by the cache.
+ * @return RTR_BGPSEC_SUCCESS If the budget was set.
+ * @return RTR_BGPSEC_ERROR If the cache could not be allocated.
+ */
+int rtr_mgr_bgpsec_set_key_cache_budget(struct rtr_mgr_config *config, size_t budget);
+
 /**
  * @brief Returns the highest supported BGPsec version.
  * @return RTR_BGPSEC_VERSION The currently supported BGPsec version.
@@ -14,14 +14,28 @@
 
 #include "third-party/tommyds/tommylist.h"
 
+#include <pthread.h>
+#include <stdbool.h>
+
 struct tommy_list_wrapper {
 	tommy_list list;
 };
 
+/**
+ * @brief Entry of a group in the list of the manager, passed to the connection state callback of its sockets.
+ * @param group The copy of the group the manager owns
+ * @param selection_mutex Serialises the selection of the socket that stays connected with
+ *			  RTR_MGR_SELECT_FIRST_SYNCED
+ * @param restart_spares Set if the stopped sockets have to be started again once selection_mutex is released
+ * @param start_mutex Held while the sockets of the group are started
+ */
 // TODO Find a nicer way todo a linked list (without writing our own)
 struct rtr_mgr_group_node {
 	tommy_node node;
 	struct rtr_mgr_group *group;
+	pthread_mutex_t selection_mutex;
+	bool restart_spares;
+	pthread_mutex_t start_mutex;
 };
 
 #endif
@@ -21,6 +21,7 @@ extern "C" {
 
 #include "config.h"
 #include "lib/alloc_utils.h"
+#include "lib/executor.h"
 #include "lib/ip.h"
 #include "lib/ipv4.h"
 #include "lib/ipv6.h"
@@ -28,6 +29,7 @@ extern "C" {
 #include "rtr/rtr.h"
 #include "rtr_mgr.h"
 #include "spki/spkitable.h"
+#include "transport/file/file_transport.h"
 #include "transport/tcp/tcp_transport.h"
 #include "transport/transport.h"
 #ifdef RTRLIB_HAVE_LIBSSH
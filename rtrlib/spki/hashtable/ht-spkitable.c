@@ -9,17 +9,25 @@
 
 #include "ht-spkitable_private.h"
 
+#include "rtrlib/config.h"
 #include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/rtrlib_export_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
+
+#ifdef RTRLIB_BGPSEC_ENABLED
+#include "rtrlib/bgpsec/bgpsec_key_cache_private.h"
+#endif
 
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
+/* Entries refer to the interned SKI and SPKI, the digest of the record is kept to remove it from the partition */
 struct key_entry {
-	uint8_t ski[SKI_SIZE];
 	uint32_t asn;
-	uint8_t spki[SPKI_SIZE];
 	const struct rtr_socket *socket;
+	struct spki_key *key;
+	uint64_t digest;
 	tommy_node hash_node;
 	tommy_node list_node;
 };
@@ -38,11 +46,13 @@ static int key_entry_cmp(const void *arg, const void *obj)
 
 	if (param->asn != entry->asn)
 		return 1;
-	if (memcmp(param->ski, entry->ski, sizeof(entry->ski)))
+	if (param->socket != entry->socket)
 		return 1;
-	if (memcmp(param->spki, entry->spki, sizeof(entry->spki)))
+	if (param->key == entry->key)
+		return 0;
+	if (memcmp(param->key->ski, entry->key->ski, SKI_SIZE))
 		return 1;
-	if (param->socket != entry->socket)
+	if (memcmp(param->key->spki, entry->key->spki, SPKI_SIZE))
 		return 1;
 
 	return 0;
@@ -53,17 +63,25 @@ static void key_entry_to_spki_record(struct key_entry *key_e, struct spki_record
 {
 	spki_r->asn = key_e->asn;
 	spki_r->socket = key_e->socket;
-	memcpy(spki_r->ski, key_e->ski, sizeof(key_e->ski));
-	memcpy(spki_r->spki, key_e->spki, sizeof(key_e->spki));
+	memcpy(spki_r->ski, key_e->key->ski, SKI_SIZE);
+	memcpy(spki_r->spki, key_e->key->spki, SPKI_SIZE);
 }
 
-/* Copying the content, target struct must already be allocated */
-static void spki_record_to_key_entry(struct spki_record *spki_r, struct key_entry *key_e)
+/* Copying the content to a handle that takes its own reference to the key */
+static void key_entry_to_spki_key_ref(struct key_entry *key_e, struct spki_key_ref *ref)
 {
-	key_e->asn = spki_r->asn;
-	key_e->socket = spki_r->socket;
-	memcpy(key_e->ski, spki_r->ski, sizeof(spki_r->ski));
-	memcpy(key_e->spki, spki_r->spki, sizeof(spki_r->spki));
+	spki_key_acquire(key_e->key);
+	ref->key = key_e->key;
+	ref->asn = key_e->asn;
+	ref->socket = key_e->socket;
+}
+
+static void key_entry_free(void *obj)
+{
+	struct key_entry *entry = obj;
+
+	spki_key_release(entry->key);
+	lrtr_free(entry);
 }
 
 /**
@@ -78,21 +96,98 @@ static void spki_table_notify_clients(struct spki_table *spki_table, const struc
 		spki_table->update_fp(spki_table, *record, added);
 }
 
+/**
+ * @brief Allocates an empty partition for the given socket.
+ * @param[in] socket Origin socket of the partition.
+ * @return Pointer to the partition, NULL on error.
+ */
+static struct spki_partition *spki_partition_new(const struct rtr_socket *socket)
+{
+	struct spki_partition *partition = lrtr_malloc(sizeof(*partition));
+
+	if (!partition)
+		return NULL;
+
+	partition->socket = socket;
+	partition->digest = 0;
+	tommy_hashlin_init(&partition->hashtable);
+	tommy_list_init(&partition->list);
+	return partition;
+}
+
+/**
+ * @brief Frees a partition and all of its entries.
+ * @param[in] partition Partition to free, must not be part of a spki_table anymore.
+ */
+static void spki_partition_free(struct spki_partition *partition)
+{
+	tommy_list_foreach(&partition->list, key_entry_free);
+	tommy_hashlin_done(&partition->hashtable);
+	lrtr_free(partition);
+}
+
+/**
+ * @brief Returns the partition of a socket.
+ * @param[in] spki_table spki_table to search, the caller must hold the lock.
+ * @param[in] socket Origin socket of the partition.
+ * @return Pointer to the partition, NULL if the socket has no partition.
+ */
+static struct spki_partition *spki_table_get_partition(struct spki_table *spki_table,
+						       const struct rtr_socket *socket)
+{
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
+
+		if (partition->socket == socket)
+			return partition;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Searches an entry in a partition.
+ * @param[in] partition Partition to search, may be NULL.
+ * @param[in] cmp_fp Compare function of the spki_table.
+ * @param[in] entry Entry to search for.
+ * @return Pointer to the found entry, NULL if the partition does not contain it.
+ */
+static struct key_entry *spki_partition_search(struct spki_partition *partition, hash_cmp_fp cmp_fp,
+					       struct key_entry *entry)
+{
+	if (!partition)
+		return NULL;
+
+	return tommy_hashlin_search(&partition->hashtable, cmp_fp, entry, tommy_inthash_u32(entry->asn));
+}
+
 void spki_table_init(struct spki_table *spki_table, spki_update_fp update_fp)
 {
-	tommy_hashlin_init(&spki_table->hashtable);
-	tommy_list_init(&spki_table->list);
+	tommy_list_init(&spki_table->partitions);
 	pthread_rwlock_init(&spki_table->lock, NULL);
 	spki_table->cmp_fp = key_entry_cmp;
 	spki_table->update_fp = update_fp;
+	spki_table->key_cache = NULL;
+}
+
+/**
+ * @brief Frees the key cache of a spki_table.
+ * @param[in] spki_table spki_table to use, the caller must hold the write lock.
+ */
+static void spki_table_free_key_cache(struct spki_table *spki_table)
+{
+#ifdef RTRLIB_BGPSEC_ENABLED
+	bgpsec_key_cache_free(spki_table->key_cache);
+#endif
+	spki_table->key_cache = NULL;
 }
 
 void spki_table_free(struct spki_table *spki_table)
 {
 	pthread_rwlock_wrlock(&spki_table->lock);
 
-	tommy_list_foreach(&spki_table->list, free);
-	tommy_hashlin_done(&spki_table->hashtable);
+	tommy_list_foreach(&spki_table->partitions, (tommy_foreach_func *)spki_partition_free);
+	tommy_list_init(&spki_table->partitions);
+	spki_table_free_key_cache(spki_table);
 
 	pthread_rwlock_unlock(&spki_table->lock);
 	pthread_rwlock_destroy(&spki_table->lock);
@@ -103,36 +198,74 @@ void spki_table_free_without_notify(struct spki_table *spki_table)
 	pthread_rwlock_wrlock(&spki_table->lock);
 
 	spki_table->update_fp = NULL;
-	tommy_list_foreach(&spki_table->list, free);
-	tommy_hashlin_done(&spki_table->hashtable);
+	tommy_list_foreach(&spki_table->partitions, (tommy_foreach_func *)spki_partition_free);
+	tommy_list_init(&spki_table->partitions);
+	spki_table_free_key_cache(spki_table);
 
 	pthread_rwlock_unlock(&spki_table->lock);
 	pthread_rwlock_destroy(&spki_table->lock);
 }
 
+/**
+ * @brief Inserts an entry into the partition of its socket.
+ * @param[in] spki_table spki_table to use.
+ * @param[in] entry Entry to insert, owned by the spki_table on success.
+ * @return SPKI_SUCCESS On success.
+ * @return SPKI_DUPLICATE_RECORD If the spki_table already contains an equal entry.
+ * @return SPKI_ERROR On error.
+ */
+static int spki_table_insert_entry(struct spki_table *spki_table, struct key_entry *entry)
+{
+	const uint32_t hash = tommy_inthash_u32(entry->asn);
+	struct spki_partition *partition;
+
+	pthread_rwlock_wrlock(&spki_table->lock);
+	partition = spki_table_get_partition(spki_table, entry->socket);
+	if (!partition) {
+		partition = spki_partition_new(entry->socket);
+		if (!partition) {
+			pthread_rwlock_unlock(&spki_table->lock);
+			return SPKI_ERROR;
+		}
+		tommy_list_insert_tail(&spki_table->partitions, &partition->node, partition);
+	}
+
+	if (tommy_hashlin_search(&partition->hashtable, spki_table->cmp_fp, entry, hash)) {
+		pthread_rwlock_unlock(&spki_table->lock);
+		return SPKI_DUPLICATE_RECORD;
+	}
+
+	/* Insert into hashtable and list */
+	tommy_hashlin_insert(&partition->hashtable, &entry->hash_node, entry, hash);
+	tommy_list_insert_tail(&partition->list, &entry->list_node, entry);
+	partition->digest += entry->digest;
+	pthread_rwlock_unlock(&spki_table->lock);
+	return SPKI_SUCCESS;
+}
+
 int spki_table_add_entry(struct spki_table *spki_table, struct spki_record *spki_record)
 {
-	uint32_t hash;
 	struct key_entry *entry;
+	int rtval;
 
 	entry = lrtr_malloc(sizeof(*entry));
 	if (!entry)
 		return SPKI_ERROR;
 
-	spki_record_to_key_entry(spki_record, entry);
-	hash = tommy_inthash_u32(spki_record->asn);
-
-	pthread_rwlock_wrlock(&spki_table->lock);
-	if (tommy_hashlin_search(&spki_table->hashtable, spki_table->cmp_fp, entry, hash)) {
+	entry->key = spki_key_intern(spki_record->ski, spki_record->spki);
+	if (!entry->key) {
 		lrtr_free(entry);
-		pthread_rwlock_unlock(&spki_table->lock);
-		return SPKI_DUPLICATE_RECORD;
+		return SPKI_ERROR;
+	}
+	entry->asn = spki_record->asn;
+	entry->socket = spki_record->socket;
+	entry->digest = spki_record_digest(spki_record);
+
+	rtval = spki_table_insert_entry(spki_table, entry);
+	if (rtval != SPKI_SUCCESS) {
+		key_entry_free(entry);
+		return rtval;
 	}
-
-	/* Insert into hashtable and list */
-	tommy_hashlin_insert(&spki_table->hashtable, &entry->hash_node, entry, hash);
-	tommy_list_insert_tail(&spki_table->list, &entry->list_node, entry);
-	pthread_rwlock_unlock(&spki_table->lock);
 	spki_table_notify_clients(spki_table, spki_record, true);
 	return SPKI_SUCCESS;
 }
@@ -141,7 +274,6 @@ int spki_table_get_all(struct spki_table *spki_table, uint32_t asn, uint8_t *ski
 		       unsigned int *result_size)
 {
 	uint32_t hash = tommy_inthash_u32(asn);
-	tommy_node *result_bucket;
 	void *tmp;
 
 	*result = NULL;
@@ -149,36 +281,37 @@ int spki_table_get_all(struct spki_table *spki_table, uint32_t asn, uint8_t *ski
 
 	pthread_rwlock_rdlock(&spki_table->lock);
 
-	/**
-	 * A tommy node contains its storing key_entry (->data) as well as
-	 * next and prev pointer to accommodate multiple results.
-	 * The bucket is guaranteed to contain ALL the elements
-	 * with the specified hash, but it can contain also others.
-	 */
-	result_bucket = tommy_hashlin_bucket(&spki_table->hashtable, hash);
-
-	if (!result_bucket) {
-		pthread_rwlock_unlock(&spki_table->lock);
-		return SPKI_SUCCESS;
-	}
-
-	/* Build the result array */
-	while (result_bucket) {
-		struct key_entry *element;
-
-		element = result_bucket->data;
-		if (element->asn == asn && memcmp(element->ski, ski, sizeof(element->ski)) == 0) {
-			(*result_size)++;
-			tmp = lrtr_realloc(*result, *result_size * sizeof(**result));
-			if (!tmp) {
-				lrtr_free(*result);
-				pthread_rwlock_unlock(&spki_table->lock);
-				return SPKI_ERROR;
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
+
+		/**
+		 * A tommy node contains its storing key_entry (->data) as well as
+		 * next and prev pointer to accommodate multiple results.
+		 * The bucket is guaranteed to contain ALL the elements
+		 * with the specified hash, but it can contain also others.
+		 */
+		tommy_node *result_bucket = tommy_hashlin_bucket(&partition->hashtable, hash);
+
+		/* Build the result array */
+		while (result_bucket) {
+			struct key_entry *element;
+
+			element = result_bucket->data;
+			if (element->asn == asn && memcmp(element->key->ski, ski, SKI_SIZE) == 0) {
+				(*result_size)++;
+				tmp = lrtr_realloc(*result, *result_size * sizeof(**result));
+				if (!tmp) {
+					lrtr_free(*result);
+					*result = NULL;
+					*result_size = 0;
+					pthread_rwlock_unlock(&spki_table->lock);
+					return SPKI_ERROR;
+				}
+				*result = tmp;
+				key_entry_to_spki_record(element, *result + *result_size - 1);
 			}
-			*result = tmp;
-			key_entry_to_spki_record(element, *result + *result_size - 1);
+			result_bucket = result_bucket->next;
 		}
-		result_bucket = result_bucket->next;
 	}
 
 	pthread_rwlock_unlock(&spki_table->lock);
@@ -189,55 +322,129 @@ int spki_table_get_all(struct spki_table *spki_table, uint32_t asn, uint8_t *ski
 int spki_table_search_by_ski(struct spki_table *spki_table, uint8_t *ski, struct spki_record **result,
 			     unsigned int *result_size)
 {
-	tommy_node *current_node;
 	void *tmp;
 	*result = NULL;
 	*result_size = 0;
 
 	pthread_rwlock_rdlock(&spki_table->lock);
 
-	current_node = tommy_list_head(&spki_table->list);
-	while (current_node) {
-		struct key_entry *current_entry;
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
+		tommy_node *current_node = tommy_list_head(&partition->list);
+
+		while (current_node) {
+			struct key_entry *current_entry;
+
+			current_entry = (struct key_entry *)current_node->data;
+
+			if (memcmp(current_entry->key->ski, ski, SKI_SIZE) == 0) {
+				(*result_size)++;
+				tmp = lrtr_realloc(*result, sizeof(**result) * (*result_size));
+				if (!tmp) {
+					lrtr_free(*result);
+					*result = NULL;
+					*result_size = 0;
+					pthread_rwlock_unlock(&spki_table->lock);
+					return SPKI_ERROR;
+				}
+				*result = tmp;
+				key_entry_to_spki_record(current_entry, *result + (*result_size - 1));
+			}
+			current_node = current_node->next;
+		}
+	}
+	pthread_rwlock_unlock(&spki_table->lock);
+	return SPKI_SUCCESS;
+}
+
+int spki_table_search_by_skis(struct spki_table *spki_table, const uint8_t **skis, const unsigned int skis_len,
+			      struct spki_key_ref **result, unsigned int *result_size, unsigned int *ends)
+{
+	struct spki_key_ref *records = *result;
+	unsigned int records_len = 0;
+
+	memset(ends, 0, sizeof(*ends) * skis_len);
+
+	pthread_rwlock_rdlock(&spki_table->lock);
+
+	/* Count the records of every SKI, then turn the counts into the start index of every SKI */
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
 
-		current_entry = (struct key_entry *)current_node->data;
+		for (tommy_node *current = tommy_list_head(&partition->list); current; current = current->next) {
+			struct key_entry *entry = current->data;
 
-		if (memcmp(current_entry->ski, ski, sizeof(current_entry->ski)) == 0) {
-			(*result_size)++;
-			tmp = lrtr_realloc(*result, sizeof(**result) * (*result_size));
-			if (!tmp) {
-				lrtr_free(*result);
-				pthread_rwlock_unlock(&spki_table->lock);
-				return SPKI_ERROR;
+			for (unsigned int i = 0; i < skis_len; i++) {
+				if (memcmp(entry->key->ski, skis[i], SKI_SIZE) == 0)
+					ends[i]++;
 			}
-			*result = tmp;
-			key_entry_to_spki_record(current_entry, *result + (*result_size - 1));
 		}
-		current_node = current_node->next;
 	}
+
+	for (unsigned int i = 0; i < skis_len; i++) {
+		unsigned int count = ends[i];
+
+		ends[i] = records_len;
+		records_len += count;
+	}
+
+	if (records_len > *result_size) {
+		records = lrtr_malloc(sizeof(*records) * records_len);
+		if (!records) {
+			pthread_rwlock_unlock(&spki_table->lock);
+			return SPKI_ERROR;
+		}
+	}
+
+	/* Every copied record advances the index of its SKI, which ends at the end of the records of the SKI */
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
+
+		for (tommy_node *current = tommy_list_head(&partition->list); current; current = current->next) {
+			struct key_entry *entry = current->data;
+
+			for (unsigned int i = 0; i < skis_len; i++) {
+				if (memcmp(entry->key->ski, skis[i], SKI_SIZE) == 0)
+					key_entry_to_spki_key_ref(entry, &records[ends[i]++]);
+			}
+		}
+	}
+
 	pthread_rwlock_unlock(&spki_table->lock);
+
+	*result = records;
+	*result_size = records_len;
 	return SPKI_SUCCESS;
 }
 
 int spki_table_remove_entry(struct spki_table *spki_table, struct spki_record *spki_record)
 {
 	uint32_t hash;
+	struct spki_key key;
 	struct key_entry entry;
 	struct key_entry *rmv_elem;
+	struct spki_partition *partition;
 	int rtval = SPKI_ERROR;
 
-	spki_record_to_key_entry(spki_record, &entry);
+	/* The entry is only compared, so the key does not need to be interned */
+	memcpy(key.ski, spki_record->ski, SKI_SIZE);
+	memcpy(key.spki, spki_record->spki, SPKI_SIZE);
+	entry.key = &key;
+	entry.asn = spki_record->asn;
+	entry.socket = spki_record->socket;
 	hash = tommy_inthash_u32(spki_record->asn);
 
 	pthread_rwlock_wrlock(&spki_table->lock);
 
-	if (!tommy_hashlin_search(&spki_table->hashtable, spki_table->cmp_fp, &entry, hash)) {
+	partition = spki_table_get_partition(spki_table, spki_record->socket);
+	if (!spki_partition_search(partition, spki_table->cmp_fp, &entry)) {
 		rtval = SPKI_RECORD_NOT_FOUND;
 	} else {
 		/* Remove from hashtable and list */
-		rmv_elem = tommy_hashlin_remove(&spki_table->hashtable, spki_table->cmp_fp, &entry, hash);
-		if (rmv_elem && tommy_list_remove_existing(&spki_table->list, &rmv_elem->list_node)) {
-			lrtr_free(rmv_elem);
+		rmv_elem = tommy_hashlin_remove(&partition->hashtable, spki_table->cmp_fp, &entry, hash);
+		if (rmv_elem && tommy_list_remove_existing(&partition->list, &rmv_elem->list_node)) {
+			partition->digest -= rmv_elem->digest;
+			key_entry_free(rmv_elem);
 			spki_table_notify_clients(spki_table, spki_record, false);
 			rtval = SPKI_SUCCESS;
 		}
@@ -248,54 +455,83 @@ int spki_table_remove_entry(struct spki_table *spki_table, struct spki_record *s
 
 int spki_table_src_remove(struct spki_table *spki_table, const struct rtr_socket *socket)
 {
-	struct key_entry *entry;
-	tommy_node *current_node;
+	struct spki_partition *partition;
 
 	pthread_rwlock_wrlock(&spki_table->lock);
 
-	current_node = tommy_list_head(&spki_table->list);
-	while (current_node) {
-		entry = current_node->data;
-		if (entry->socket == socket) {
-			current_node = current_node->next;
-			if (!tommy_list_remove_existing(&spki_table->list, &entry->list_node)) {
-				pthread_rwlock_unlock(&spki_table->lock);
-				return SPKI_ERROR;
-			}
-			if (!tommy_hashlin_remove_existing(&spki_table->hashtable, &entry->hash_node)) {
-				pthread_rwlock_unlock(&spki_table->lock);
-				return SPKI_ERROR;
-			}
-			lrtr_free(entry);
-		} else {
-			current_node = current_node->next;
+	partition = spki_table_get_partition(spki_table, socket);
+	if (partition)
+		tommy_list_remove_existing(&spki_table->partitions, &partition->node);
+
+	pthread_rwlock_unlock(&spki_table->lock);
+
+	if (partition)
+		spki_partition_free(partition);
+
+	return SPKI_SUCCESS;
+}
+
+int spki_table_src_handover(struct spki_table *spki_table, const struct rtr_socket **sockets,
+			    const unsigned int sockets_len)
+{
+	tommy_list removed;
+
+	tommy_list_init(&removed);
+	pthread_rwlock_wrlock(&spki_table->lock);
+
+	for (unsigned int i = 0; i < sockets_len; i++) {
+		struct spki_partition *partition = spki_table_get_partition(spki_table, sockets[i]);
+
+		if (partition) {
+			tommy_list_remove_existing(&spki_table->partitions, &partition->node);
+			tommy_list_insert_tail(&removed, &partition->node, partition);
 		}
 	}
+
 	pthread_rwlock_unlock(&spki_table->lock);
+
+	tommy_list_foreach(&removed, (tommy_foreach_func *)spki_partition_free);
+
 	return SPKI_SUCCESS;
 }
 
 int spki_table_copy_except_socket(struct spki_table *src, struct spki_table *dst, struct rtr_socket *socket)
 {
-	tommy_node *current_node;
 	int ret = SPKI_SUCCESS;
 
 	pthread_rwlock_rdlock(&src->lock);
-	current_node = tommy_list_head(&src->list);
-	while (current_node) {
-		struct key_entry *entry;
-		struct spki_record record;
+	for (tommy_node *node = tommy_list_head(&src->partitions); node && ret == SPKI_SUCCESS; node = node->next) {
+		struct spki_partition *partition = node->data;
 
-		entry = (struct key_entry *)current_node->data;
-		key_entry_to_spki_record(entry, &record);
+		if (partition->socket == socket)
+			continue;
 
-		if (entry->socket != socket) {
-			if (spki_table_add_entry(dst, &record) != SPKI_SUCCESS) {
+		/* The copies share the interned keys of src */
+		for (tommy_node *current_node = tommy_list_head(&partition->list); current_node;
+		     current_node = current_node->next) {
+			struct key_entry *entry = current_node->data;
+			struct key_entry *copy = lrtr_malloc(sizeof(*copy));
+			struct spki_record record;
+
+			if (!copy) {
+				ret = SPKI_ERROR;
+				break;
+			}
+			spki_key_acquire(entry->key);
+			copy->key = entry->key;
+			copy->asn = entry->asn;
+			copy->socket = entry->socket;
+			copy->digest = entry->digest;
+			if (spki_table_insert_entry(dst, copy) != SPKI_SUCCESS) {
+				key_entry_free(copy);
 				ret = SPKI_ERROR;
 				break;
 			}
+			if (dst->update_fp) {
+				key_entry_to_spki_record(copy, &record);
+				spki_table_notify_clients(dst, &record, true);
+			}
 		}
-		current_node = current_node->next;
 	}
 
 	pthread_rwlock_unlock(&src->lock);
@@ -303,66 +539,133 @@ int spki_table_copy_except_socket(struct spki_table *src, struct spki_table *dst
 	return ret;
 }
 
-void spki_table_notify_diff(struct spki_table *new_table, struct spki_table *old_table, const struct rtr_socket *socket)
+/**
+ * @brief Calls the update callback of a spki_table for every entry of @p from that is not part of @p other.
+ * @param[in] spki_table spki_table whose update callback is used.
+ * @param[in] from Partition whose entries are reported, may be NULL.
+ * @param[in] other Partition to compare against, may be NULL.
+ * @param[in] added Passed to the update callback.
+ */
+static void spki_partition_notify_missing(struct spki_table *spki_table, struct spki_partition *from,
+					  struct spki_partition *other, const bool added)
 {
-	spki_update_fp old_table_fp;
-
-	// Disable update callback for old_table
-	old_table_fp = old_table->update_fp;
-	old_table->update_fp = NULL;
+	if (!from)
+		return;
 
-	// Iterate new_table and try to delete every entry from the given socket
-	// in old_table If the prefix could not be removed it was added in
-	// new_table and the update cb must be called
-	for (tommy_node *current_node = tommy_list_head(&new_table->list); current_node;
+	for (tommy_node *current_node = tommy_list_head(&from->list); current_node;
 	     current_node = current_node->next) {
-		struct key_entry *entry = (struct key_entry *)current_node->data;
+		struct key_entry *entry = current_node->data;
 
-		if (entry->socket == socket) {
+		if (!spki_partition_search(other, spki_table->cmp_fp, entry)) {
 			struct spki_record record;
 
 			key_entry_to_spki_record(entry, &record);
-
-			if (spki_table_remove_entry(old_table, &record) == SPKI_RECORD_NOT_FOUND)
-				spki_table_notify_clients(new_table, &record, true);
+			spki_table_notify_clients(spki_table, &record, added);
 		}
 	}
+}
 
-	// Iterate old_table and call cb for every remianing entry from the
-	// given socket with added false because it is not present in new_table
-	for (tommy_node *current_node = tommy_list_head(&old_table->list); current_node;
-	     current_node = current_node->next) {
-		struct key_entry *entry = (struct key_entry *)current_node->data;
+void spki_table_src_replace(struct spki_table *spki_table, struct spki_table *src, const struct rtr_socket *socket)
+{
+	struct spki_partition *old_partition;
+	struct spki_partition *new_partition;
 
-		if (entry->socket == socket) {
-			struct spki_record record;
+	pthread_rwlock_wrlock(&src->lock);
+	new_partition = spki_table_get_partition(src, socket);
+	if (new_partition)
+		tommy_list_remove_existing(&src->partitions, &new_partition->node);
+	pthread_rwlock_unlock(&src->lock);
 
-			key_entry_to_spki_record(entry, &record);
-			spki_table_notify_clients(new_table, &record, false);
-		}
+	pthread_rwlock_wrlock(&spki_table->lock);
+	old_partition = spki_table_get_partition(spki_table, socket);
+	if (old_partition)
+		tommy_list_remove_existing(&spki_table->partitions, &old_partition->node);
+	if (new_partition)
+		tommy_list_insert_tail(&spki_table->partitions, &new_partition->node, new_partition);
+	pthread_rwlock_unlock(&spki_table->lock);
+
+	/* Only the thread of socket modifies its partition, so it can be read without holding the lock */
+	if (spki_table->update_fp) {
+		spki_partition_notify_missing(spki_table, new_partition, old_partition, true);
+		spki_partition_notify_missing(spki_table, old_partition, new_partition, false);
 	}
 
-	// Restore original state of old_tables update_fp
-	old_table->update_fp = old_table_fp;
+	if (old_partition)
+		spki_partition_free(old_partition);
+}
+
+void spki_table_notify_diff(struct spki_table *new_table, struct spki_table *old_table, const struct rtr_socket *socket)
+{
+	struct spki_partition *new_partition;
+	struct spki_partition *old_partition;
+
+	new_partition = spki_table_get_partition(new_table, socket);
+	old_partition = spki_table_get_partition(old_table, socket);
+
+	// Every entry of the socket in new_table that is not part of old_table was added,
+	// every entry of the socket in old_table that is not part of new_table was removed
+	spki_partition_notify_missing(new_table, new_partition, old_partition, true);
+	spki_partition_notify_missing(new_table, old_partition, new_partition, false);
 }
 
 void spki_table_swap(struct spki_table *a, struct spki_table *b)
 {
-	tommy_hashlin tmp_hashtable;
-	tommy_list tmp_list;
+	tommy_list tmp_partitions;
 
 	pthread_rwlock_wrlock(&a->lock);
 	pthread_rwlock_wrlock(&b->lock);
 
-	memcpy(&tmp_hashtable, &a->hashtable, sizeof(tmp_hashtable));
-	memcpy(&tmp_list, &a->list, sizeof(tmp_list));
-
-	memcpy(&a->hashtable, &b->hashtable, sizeof(tmp_hashtable));
-	memcpy(&a->list, &b->list, sizeof(tmp_list));
-
-	memcpy(&b->hashtable, &tmp_hashtable, sizeof(tmp_hashtable));
-	memcpy(&b->list, &tmp_list, sizeof(tmp_list));
+	tmp_partitions = a->partitions;
+	a->partitions = b->partitions;
+	b->partitions = tmp_partitions;
 
 	pthread_rwlock_unlock(&a->lock);
 	pthread_rwlock_unlock(&b->lock);
 }
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT uint64_t spki_record_digest(const struct spki_record *spki_record)
+{
+	/* SKI, AS number in network byte order and SPKI */
+	uint8_t buf[SKI_SIZE + 4 + SPKI_SIZE];
+
+	memcpy(buf, spki_record->ski, SKI_SIZE);
+	buf[SKI_SIZE] = spki_record->asn >> 24;
+	buf[SKI_SIZE + 1] = spki_record->asn >> 16;
+	buf[SKI_SIZE + 2] = spki_record->asn >> 8;
+	buf[SKI_SIZE + 3] = spki_record->asn;
+	memcpy(buf + SKI_SIZE + 4, spki_record->spki, SPKI_SIZE);
+
+	return tommy_hash_u64(0, buf, sizeof(buf));
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT uint64_t spki_table_digest(struct spki_table *spki_table)
+{
+	uint64_t digest = 0;
+
+	pthread_rwlock_rdlock(&spki_table->lock);
+	for (tommy_node *node = tommy_list_head(&spki_table->partitions); node; node = node->next) {
+		struct spki_partition *partition = node->data;
+
+		digest += partition->digest;
+	}
+	pthread_rwlock_unlock(&spki_table->lock);
+
+	return digest;
+}
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT uint64_t spki_table_src_digest(struct spki_table *spki_table, const struct rtr_socket *socket)
+{
+	struct spki_partition *partition;
+	uint64_t digest = 0;
+
+	pthread_rwlock_rdlock(&spki_table->lock);
+	partition = spki_table_get_partition(spki_table, socket);
+	if (partition)
+		digest = partition->digest;
+	pthread_rwlock_unlock(&spki_table->lock);
+
+	return digest;
+}
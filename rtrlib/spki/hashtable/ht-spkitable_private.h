@@ -16,20 +16,42 @@
 
 typedef int (*hash_cmp_fp)(const void *arg, const void *obj);
 
+struct bgpsec_key_cache;
+
 /**
- * @brief spki_table.
+ * @brief All entries of a spki_table that were received from one rtr_socket.
+ * @param socket Origin socket of all entries in this partition
  * @param hashtable Linear hashtable
  * @param list List that holds the same entries as hashtable, used to iterate.
+ * @param node Node in the partition list of the spki_table
+ * @param digest Sum of spki_record_digest() over all entries
+ */
+struct spki_partition {
+	const struct rtr_socket *socket;
+	tommy_hashlin hashtable;
+	tommy_list list;
+	tommy_node node;
+	uint64_t digest;
+};
+
+/**
+ * @brief spki_table.
+ * @details The entries are partitioned by their origin socket. Lookups search all partitions, which keeps the
+ * number of probes bounded by the (small) number of sockets, while a reset of one socket only touches its own
+ * partition.
+ * @param partitions List of spki_partition, one for every socket with entries in the table
  * @param cmp_fp Compare function used to find entries in the hashtable
  * @param update_fp Update function, called when the hashtable changes
  * @param lock Read-Write lock to prevent data races
+ * @param key_cache Cache of parsed router keys for BGPsec validation, NULL if disabled. Set with the write lock
+ *		    held and __ATOMIC_RELEASE, validations read it with __ATOMIC_ACQUIRE and without the lock
  */
 struct spki_table {
-	tommy_hashlin hashtable;
-	tommy_list list;
+	tommy_list partitions;
 	hash_cmp_fp cmp_fp;
 	spki_update_fp update_fp;
 	pthread_rwlock_t lock;
+	struct bgpsec_key_cache *key_cache;
 };
 
 #endif
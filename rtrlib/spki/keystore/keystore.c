@@ -0,0 +1,115 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "keystore_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+
+#include "third-party/tommyds/tommyhash.h"
+
+#include <pthread.h>
+#include <string.h>
+
+static struct {
+	tommy_hashlin keys;
+	pthread_mutex_t mutex;
+	pthread_once_t once;
+} store = {.mutex = PTHREAD_MUTEX_INITIALIZER, .once = PTHREAD_ONCE_INIT};
+
+static void spki_key_store_init(void)
+{
+	tommy_hashlin_init(&store.keys);
+}
+
+// the SKI is a hash of the key itself, different keys with the same SKI are compared by their SPKI
+static tommy_uint32_t spki_key_hash(const uint8_t *ski)
+{
+	return tommy_hash_u32(0, ski, SKI_SIZE);
+}
+
+static int spki_key_cmp(const void *arg, const void *obj)
+{
+	const struct spki_key *param = arg;
+	const struct spki_key *key = obj;
+
+	return memcmp(param->ski, key->ski, SKI_SIZE) != 0 || memcmp(param->spki, key->spki, SPKI_SIZE) != 0;
+}
+
+struct spki_key *spki_key_intern(const uint8_t *ski, const uint8_t *spki)
+{
+	const tommy_uint32_t hash = spki_key_hash(ski);
+	struct spki_key param;
+	struct spki_key *key;
+
+	pthread_once(&store.once, spki_key_store_init);
+	memcpy(param.ski, ski, SKI_SIZE);
+	memcpy(param.spki, spki, SPKI_SIZE);
+
+	pthread_mutex_lock(&store.mutex);
+	key = tommy_hashlin_search(&store.keys, spki_key_cmp, &param, hash);
+	if (key) {
+		unsigned int refs = __atomic_load_n(&key->refs, __ATOMIC_RELAXED);
+
+		// a key whose last reference was released is freed by the releasing thread and must not be revived
+		while (refs > 0 && !__atomic_compare_exchange_n(&key->refs, &refs, refs + 1, false, __ATOMIC_ACQUIRE,
+								__ATOMIC_RELAXED))
+			;
+		if (refs > 0) {
+			pthread_mutex_unlock(&store.mutex);
+			return key;
+		}
+		tommy_hashlin_remove_existing(&store.keys, &key->hash_node);
+		key->linked = false;
+	}
+
+	key = lrtr_malloc(sizeof(*key));
+	if (key) {
+		memcpy(key->ski, ski, SKI_SIZE);
+		memcpy(key->spki, spki, SPKI_SIZE);
+		key->refs = 1;
+		key->linked = true;
+		tommy_hashlin_insert(&store.keys, &key->hash_node, key, hash);
+	}
+	pthread_mutex_unlock(&store.mutex);
+	return key;
+}
+
+void spki_key_acquire(struct spki_key *key)
+{
+	__atomic_add_fetch(&key->refs, 1, __ATOMIC_RELAXED);
+}
+
+void spki_key_release(struct spki_key *key)
+{
+	if (__atomic_sub_fetch(&key->refs, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	pthread_mutex_lock(&store.mutex);
+	if (key->linked)
+		tommy_hashlin_remove_existing(&store.keys, &key->hash_node);
+	pthread_mutex_unlock(&store.mutex);
+	lrtr_free(key);
+}
+
+void spki_key_refs_release(struct spki_key_ref *refs, const unsigned int refs_len)
+{
+	for (unsigned int i = 0; i < refs_len; i++)
+		spki_key_release(refs[i].key);
+}
+
+size_t spki_key_count(void)
+{
+	size_t count;
+
+	pthread_once(&store.once, spki_key_store_init);
+	pthread_mutex_lock(&store.mutex);
+	count = tommy_hashlin_count(&store.keys);
+	pthread_mutex_unlock(&store.mutex);
+	return count;
+}
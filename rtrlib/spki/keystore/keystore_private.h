@@ -0,0 +1,78 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_keystore_h Router key store
+ * @ingroup mod_spki_h
+ * @brief Process wide store that holds every router key once.
+ * @details The SKI and SPKI of a router key are interned when the first entry of a spki_table refers to it. All
+ * entries of all spki_tables with the same key, e.g. for several ASes or from several caches and their shadow
+ * tables, share the interned key and hold a reference to it. The key is freed when the last reference is
+ * released, its content never changes, so it can be read without a lock while a reference is held.
+ * @{
+ */
+
+#ifndef RTR_KEYSTORE_PRIVATE_H
+#define RTR_KEYSTORE_PRIVATE_H
+
+#include "rtrlib/spki/spkitable_private.h"
+
+#include "third-party/tommyds/tommyhashlin.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief An interned router key.
+ * @param ski Subject Key Identifier.
+ * @param spki Subject public key info.
+ * @param refs Number of references, updated atomically.
+ * @param linked True while the key can be found in the store, only accessed with the lock of the store held.
+ */
+struct spki_key {
+	uint8_t ski[SKI_SIZE];
+	uint8_t spki[SPKI_SIZE];
+	unsigned int refs;
+	bool linked;
+	tommy_node hash_node;
+};
+
+/**
+ * @brief Returns the interned key with the given SKI and SPKI and takes a reference to it.
+ * @param[in] ski Subject Key Identifier.
+ * @param[in] spki Subject public key info.
+ * @return Pointer to the key, NULL on error.
+ */
+struct spki_key *spki_key_intern(const uint8_t *ski, const uint8_t *spki);
+
+/**
+ * @brief Takes another reference to a key, the caller must already hold one.
+ */
+void spki_key_acquire(struct spki_key *key);
+
+/**
+ * @brief Releases a reference to a key, the key is freed with the last one.
+ */
+void spki_key_release(struct spki_key *key);
+
+/**
+ * @brief Releases the references of an array of key handles.
+ * @param[in] refs Key handles.
+ * @param[in] refs_len Number of elements in @p refs.
+ */
+void spki_key_refs_release(struct spki_key_ref *refs, const unsigned int refs_len);
+
+/**
+ * @brief Returns the number of keys in the store.
+ */
+size_t spki_key_count(void);
+
+#endif
+/** @} */
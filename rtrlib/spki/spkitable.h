@@ -50,5 +50,31 @@ struct spki_record {
  * @param added True if the record was added, false if the record was removed.
  */
 typedef void (*spki_update_fp)(struct spki_table *spki_table, const struct spki_record record, const bool added);
+
+/**
+ * @brief Returns the digest of a spki_record.
+ * @details The digest is computed over the SKI, the AS number and the SPKI of the record. The socket of the
+ * record is not part of it.
+ * @param[in] spki_record spki_record to use.
+ * @return Digest of the record.
+ */
+uint64_t spki_record_digest(const struct spki_record *spki_record);
+
+/**
+ * @brief Returns the order independent digest of all entries in the spki_table.
+ * @details The digest is the sum of spki_record_digest() over all entries modulo 2^64. Every partition keeps its
+ * own digest up to date on each change, so the digest costs O(number of sockets).
+ * @param[in] spki_table spki_table to use.
+ * @return Digest of the entries, 0 for an empty table.
+ */
+uint64_t spki_table_digest(struct spki_table *spki_table);
+
+/**
+ * @brief Returns the order independent digest of the entries of one socket in the spki_table.
+ * @param[in] spki_table spki_table to use.
+ * @param[in] socket origin socket of the entries.
+ * @return Digest of the entries, 0 if the socket has no entries.
+ */
+uint64_t spki_table_src_digest(struct spki_table *spki_table, const struct rtr_socket *socket);
 #endif
 /** @} */
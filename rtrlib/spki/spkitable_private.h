@@ -22,6 +22,20 @@
 
 #include <stdint.h>
 
+struct spki_key;
+
+/**
+ * @brief Compact handle of a spki_record whose SKI and SPKI are interned in the key store.
+ * @param key Interned SKI and SPKI, the handle holds a reference to it.
+ * @param asn Origin AS number
+ * @param socket Pointer to the rtr_socket the record was received in
+ */
+struct spki_key_ref {
+	struct spki_key *key;
+	uint32_t asn;
+	const struct rtr_socket *socket;
+};
+
 /**
  * @brief Possible return values for some spki_table_ functions.
  */
@@ -93,6 +107,24 @@ int spki_table_get_all(struct spki_table *spki_table, uint32_t asn, uint8_t *ski
 int spki_table_search_by_ski(struct spki_table *spki_table, uint8_t *ski, struct spki_record **result,
 			     unsigned int *result_size);
 
+/**
+ * @brief Returns handles of all spki_records of several SKIs from one state of the spki_table.
+ * @details The lock is taken once for all SKIs. The handles of skis[i] are stored in result, starting at index 0
+ * for the first SKI and at ends[i - 1] for the others, and ending before ends[i]. Every handle holds a reference
+ * to its key, which has to be released with spki_key_refs_release().
+ * @param[in] spki_table spki_table to use
+ * @param[in] skis Pointers to the 20 byte SKIs to search for
+ * @param[in] skis_len Number of elements in skis
+ * @param[in,out] result Array of *result_size handles that is used for the result. If the handles do not fit, a
+ * new array is allocated which has to be freed by the caller.
+ * @param[in,out] result_size Capacity of *result on call, number of found records on return
+ * @param[out] ends Array with skis_len elements
+ * @return SPKI_SUCCESS On success
+ * @return SPKI_ERROR On error, *result is not changed
+ */
+int spki_table_search_by_skis(struct spki_table *spki_table, const uint8_t **skis, const unsigned int skis_len,
+			      struct spki_key_ref **result, unsigned int *result_size, unsigned int *ends);
+
 /**
  * @brief Removes spki_record from spki_table
  * @param spki_table spki_table to use
@@ -112,6 +144,19 @@ int spki_table_remove_entry(struct spki_table *spki_table, struct spki_record *s
  */
 int spki_table_src_remove(struct spki_table *spki_table, const struct rtr_socket *socket);
 
+/**
+ * @brief Removes all entries of a set of sockets while holding the write lock only once.
+ * @details Like spki_table_src_remove(), but readers never observe a state where only a part of the sockets
+ * has been removed.
+ * @param[in] spki_table spki_table to use.
+ * @param[in] sockets Origin sockets whose entries are removed.
+ * @param[in] sockets_len Number of elements in @p sockets.
+ * @return SPKI_SUCCESS On success.
+ * @return SPKI_ERROR On error.
+ */
+int spki_table_src_handover(struct spki_table *spki_table, const struct rtr_socket **sockets,
+			    const unsigned int sockets_len);
+
 /**
  * @brief Copy spki table except entries from the given socket
  * @param[in] src source table
@@ -122,9 +167,19 @@ int spki_table_src_remove(struct spki_table *spki_table, const struct rtr_socket
  */
 int spki_table_copy_except_socket(struct spki_table *src, struct spki_table *dest, struct rtr_socket *socket);
 
+/**
+ * @brief Replaces all entries of a socket with the entries of the same socket in another table.
+ * @details The entries of @p socket in @p src are moved to @p spki_table in O(1) while holding the write lock
+ * of @p spki_table. Afterwards the update callback of @p spki_table is called for every entry that was added or
+ * removed by the replacement. @p src does not contain entries of @p socket anymore when this function returns.
+ * @param[in] spki_table spki_table whose entries are replaced.
+ * @param[in] src spki_table that holds the new entries of the socket.
+ * @param[in] socket socket whose entries are replaced.
+ */
+void spki_table_src_replace(struct spki_table *spki_table, struct spki_table *src, const struct rtr_socket *socket);
+
 /**
  * @brief Notify client about changes between two spki tables regarding one specific socket
- * @details old_table will be modified and should probebly be freed after calling this function
  * @param[in] new_table
  * @param[in] old_table
  * @param[in] socket socket which entries should be diffed
@@ -133,7 +188,7 @@ void spki_table_notify_diff(struct spki_table *new_table, struct spki_table *old
 			    const struct rtr_socket *socket);
 
 /**
- * @brief tommy_hashlin and tommy_list of the argument tables
+ * @brief Swaps the entries of the argument tables
  * @param[in] a
  * @param[in] b
  */
@@ -0,0 +1,1481 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "file_transport_private.h"
+
+#include "rtrlib/lib/alloc_utils_private.h"
+#include "rtrlib/lib/log_private.h"
+#include "rtrlib/lib/utils_private.h"
+#include "rtrlib/pfx/pfx.h"
+#include "rtrlib/rtr/rtr_private.h"
+#include "rtrlib/rtrlib_export_private.h"
+#include "rtrlib/spki/spkitable_private.h"
+#include "rtrlib/transport/transport_private.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#define FILE_DBG(fmt, sock, ...)                                                                \
+	do {                                                                                    \
+		const struct tr_file_socket *tmp = sock;                                        \
+		lrtr_dbg("File Transport(%s): " fmt, tmp->config.vrp_path, ##__VA_ARGS__); \
+	} while (0)
+#define FILE_DBG1(a, sock) FILE_DBG(a, sock)
+
+/* Number of files of a transport, the VRP file and the router key file */
+#define FILE_PATHS 2
+
+/* Interval in seconds in which the files are checked for changes if inotify is not available */
+#define FILE_POLL_INTERVAL 1
+
+/* The output buffer is freed after it was drained if it grew larger than this, e.g. for a reset */
+#define FILE_OUT_KEEP_SIZE (64 * 1024)
+
+#define FILE_CSV_FIELDS 3
+#define FILE_JSON_MAX_DEPTH 32
+
+#define FILE_PDU_HEADER_LEN 8
+#define FILE_PDU_SERIAL_LEN 12
+#define FILE_PDU_IPV4_LEN 20
+#define FILE_PDU_IPV6_LEN 32
+#define FILE_PDU_ROUTER_KEY_LEN (12 + SKI_SIZE + SPKI_SIZE)
+#define FILE_PDU_EOD_V1_LEN 24
+#define FILE_PDU_ERROR_LEN 16
+
+/* Error code of an Error Report PDU for an unsupported protocol version */
+#define FILE_UNSUPPORTED_PROTOCOL_VER 4
+
+enum file_pdu_type {
+	FILE_PDU_SERIAL_NOTIFY = 0,
+	FILE_PDU_SERIAL_QUERY = 1,
+	FILE_PDU_RESET_QUERY = 2,
+	FILE_PDU_CACHE_RESPONSE = 3,
+	FILE_PDU_IPV4_PREFIX = 4,
+	FILE_PDU_IPV6_PREFIX = 6,
+	FILE_PDU_EOD = 7,
+	FILE_PDU_CACHE_RESET = 8,
+	FILE_PDU_ROUTER_KEY = 9,
+	FILE_PDU_ERROR = 10,
+};
+
+/**
+ * @brief A validated ROA payload read from a file.
+ * @param prefix Prefix in network byte order, IPv4 prefixes use the first four bytes.
+ */
+struct file_vrp {
+	uint8_t prefix[16];
+	uint32_t asn;
+	uint8_t is_ipv6;
+	uint8_t prefix_len;
+	uint8_t max_len;
+};
+
+struct file_key {
+	uint8_t ski[SKI_SIZE];
+	uint32_t asn;
+	uint8_t spki[SPKI_SIZE];
+};
+
+/**
+ * @brief The records of the files at one point in time, sorted and without duplicates.
+ */
+struct file_data {
+	struct file_vrp *vrps;
+	unsigned int vrps_len;
+	unsigned int vrps_size;
+	struct file_key *keys;
+	unsigned int keys_len;
+	unsigned int keys_size;
+};
+
+/* Identifies the loaded version of a file, it changes when the file is written or replaced */
+struct file_stamp {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	long mtime_nsec;
+};
+
+struct file_span {
+	const char *start;
+	const char *end;
+};
+
+/* Values of the members of a JSON object that describes a VRP or a router key */
+struct file_json_entry {
+	struct file_span asn;
+	struct file_span prefix;
+	struct file_span max_len;
+	struct file_span ski;
+	struct file_span spki;
+};
+
+/**
+ * @brief State of a file transport.
+ * @param current Records of the last valid content of the files.
+ * @param synced Records that were sent to the rtr_socket, may be the same as current.
+ * @param synced_serial Serial number of synced.
+ * @param version Protocol version of the last query of the rtr_socket.
+ * @param query Query that is received from the rtr_socket.
+ * @param discard_len Number of bytes of an unexpected PDU that are still to be received.
+ * @param out PDUs that are not yet received by the rtr_socket.
+ */
+struct tr_file_socket {
+	struct tr_file_config config;
+	int notify_fd;
+	struct tr_wakeup wakeup;
+	struct file_stamp stamps[FILE_PATHS];
+	struct file_data *current;
+	struct file_data *synced;
+	uint32_t serial;
+	uint32_t synced_serial;
+	uint16_t session_id;
+	uint8_t version;
+	uint8_t query[FILE_PDU_SERIAL_LEN];
+	unsigned int query_len;
+	uint32_t discard_len;
+	uint8_t *out;
+	size_t out_len;
+	size_t out_pos;
+	size_t out_size;
+};
+
+typedef bool (*file_json_member_fp)(const char **p, const struct file_span *key, void *data, unsigned int depth);
+typedef bool (*file_json_element_fp)(const char **p, void *data, unsigned int depth);
+typedef int (*file_queue_fp)(struct tr_file_socket *socket, const void *record, const uint8_t flags);
+
+static int tr_file_open(void *tr_file_sock);
+static void tr_file_close(void *tr_file_sock);
+static void tr_file_free(struct tr_socket *tr_sock);
+static int tr_file_recv(const void *tr_file_sock, void *pdu, const size_t len, const time_t timeout);
+static int tr_file_send(const void *tr_file_sock, const void *pdu, const size_t len, const time_t timeout);
+static const char *tr_file_ident(void *socket);
+static void tr_file_interrupt(void *tr_file_sock);
+static int tr_file_load(void *tr_file_sock, struct pfx_table *pfx_table, struct spki_table *spki_table,
+			const struct rtr_socket *rtr_socket, uint16_t *session_id, uint32_t *serial);
+static bool file_json_value(const char **p, file_json_member_fp member_fp, void *data, unsigned int depth);
+
+static const char *file_path(const struct tr_file_socket *socket, const unsigned int i)
+{
+	return i == 0 ? socket->config.vrp_path : socket->config.key_path;
+}
+
+static void file_stamp_init(struct file_stamp *stamp, const struct stat *st)
+{
+	stamp->dev = st->st_dev;
+	stamp->ino = st->st_ino;
+	stamp->size = st->st_size;
+	stamp->mtime = st->st_mtime;
+#ifdef __linux__
+	stamp->mtime_nsec = st->st_mtim.tv_nsec;
+#else
+	stamp->mtime_nsec = 0;
+#endif
+}
+
+static bool file_stamp_equal(const struct file_stamp *a, const struct file_stamp *b)
+{
+	return a->dev == b->dev && a->ino == b->ino && a->size == b->size && a->mtime == b->mtime &&
+	       a->mtime_nsec == b->mtime_nsec;
+}
+
+/* Reads a whole file into a NUL terminated buffer */
+static char *file_read(const char *path, struct file_stamp *stamp)
+{
+	struct stat st;
+	char *buf = NULL;
+	size_t len = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+		goto end;
+
+	buf = lrtr_malloc(st.st_size + 1);
+	if (!buf)
+		goto end;
+
+	while (len < (size_t)st.st_size) {
+		ssize_t rtval = read(fd, buf + len, st.st_size - len);
+
+		if (rtval == -1 && errno == EINTR)
+			continue;
+		if (rtval <= 0)
+			break;
+		len += rtval;
+	}
+	buf[len] = '\0';
+	file_stamp_init(stamp, &st);
+
+end:
+	close(fd);
+	return buf;
+}
+
+static void file_data_free(struct file_data *data)
+{
+	if (!data)
+		return;
+	lrtr_free(data->vrps);
+	lrtr_free(data->keys);
+	lrtr_free(data);
+}
+
+static void *file_data_grow(void *array, unsigned int *size, const size_t elem_size)
+{
+	unsigned int new_size = *size > 0 ? *size * 2 : 1024;
+	void *new_array = lrtr_realloc(array, new_size * elem_size);
+
+	if (new_array)
+		*size = new_size;
+	return new_array;
+}
+
+static int file_data_add_vrp(struct file_data *data, const struct file_vrp *vrp)
+{
+	if (data->vrps_len == data->vrps_size) {
+		struct file_vrp *vrps = file_data_grow(data->vrps, &data->vrps_size, sizeof(*vrps));
+
+		if (!vrps)
+			return -1;
+		data->vrps = vrps;
+	}
+	data->vrps[data->vrps_len++] = *vrp;
+	return 0;
+}
+
+static int file_data_add_key(struct file_data *data, const struct file_key *key)
+{
+	if (data->keys_len == data->keys_size) {
+		struct file_key *keys = file_data_grow(data->keys, &data->keys_size, sizeof(*keys));
+
+		if (!keys)
+			return -1;
+		data->keys = keys;
+	}
+	data->keys[data->keys_len++] = *key;
+	return 0;
+}
+
+static int file_vrp_cmp(const void *a, const void *b)
+{
+	const struct file_vrp *x = a;
+	const struct file_vrp *y = b;
+	int cmp;
+
+	if (x->is_ipv6 != y->is_ipv6)
+		return x->is_ipv6 < y->is_ipv6 ? -1 : 1;
+	cmp = memcmp(x->prefix, y->prefix, sizeof(x->prefix));
+	if (cmp != 0)
+		return cmp;
+	if (x->prefix_len != y->prefix_len)
+		return x->prefix_len < y->prefix_len ? -1 : 1;
+	if (x->max_len != y->max_len)
+		return x->max_len < y->max_len ? -1 : 1;
+	if (x->asn != y->asn)
+		return x->asn < y->asn ? -1 : 1;
+	return 0;
+}
+
+static int file_key_cmp(const void *a, const void *b)
+{
+	const struct file_key *x = a;
+	const struct file_key *y = b;
+	int cmp = memcmp(x->ski, y->ski, sizeof(x->ski));
+
+	if (cmp != 0)
+		return cmp;
+	if (x->asn != y->asn)
+		return x->asn < y->asn ? -1 : 1;
+	return memcmp(x->spki, y->spki, sizeof(x->spki));
+}
+
+/* Sorts an array and removes duplicates, returns the new number of elements */
+static unsigned int file_sort_unique(void *array, const unsigned int len, const size_t size,
+				     int (*cmp)(const void *, const void *))
+{
+	char *elems = array;
+	unsigned int unique = 0;
+
+	if (len == 0)
+		return 0;
+
+	qsort(array, len, size, cmp);
+	for (unsigned int i = 1; i < len; i++) {
+		if (cmp(elems + unique * size, elems + i * size) == 0)
+			continue;
+		unique++;
+		if (unique != i)
+			memcpy(elems + unique * size, elems + i * size, size);
+	}
+	return unique + 1;
+}
+
+static bool file_data_equal(const struct file_data *a, const struct file_data *b)
+{
+	if (a->vrps_len != b->vrps_len || a->keys_len != b->keys_len)
+		return false;
+	for (unsigned int i = 0; i < a->vrps_len; i++) {
+		if (file_vrp_cmp(&a->vrps[i], &b->vrps[i]) != 0)
+			return false;
+	}
+	for (unsigned int i = 0; i < a->keys_len; i++) {
+		if (file_key_cmp(&a->keys[i], &b->keys[i]) != 0)
+			return false;
+	}
+	return true;
+}
+
+static bool file_is_space(const char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void file_skip_space(const char **p)
+{
+	while (file_is_space(**p))
+		(*p)++;
+}
+
+static bool file_span_equal(const struct file_span *span, const char *str)
+{
+	size_t len = strlen(str);
+
+	return (size_t)(span->end - span->start) == len && memcmp(span->start, str, len) == 0;
+}
+
+static bool file_parse_u32(const char *p, const char *end, uint32_t *value)
+{
+	uint64_t result = 0;
+
+	if (p == end)
+		return false;
+
+	for (; p < end; p++) {
+		if (*p < '0' || *p > '9')
+			return false;
+		result = result * 10 + (*p - '0');
+		if (result > UINT32_MAX)
+			return false;
+	}
+	*value = result;
+	return true;
+}
+
+/* ASNs are accepted with and without the "AS" prefix */
+static bool file_parse_asn(const struct file_span *span, uint32_t *asn)
+{
+	const char *p = span->start;
+
+	if (span->end - p > 2 && (p[0] == 'A' || p[0] == 'a') && (p[1] == 'S' || p[1] == 's'))
+		p += 2;
+	return file_parse_u32(p, span->end, asn);
+}
+
+static bool file_parse_prefix(const struct file_span *span, struct file_vrp *vrp)
+{
+	char addr[INET6_ADDRSTRLEN];
+	const char *slash = memchr(span->start, '/', span->end - span->start);
+	unsigned int max_bits;
+	uint32_t len;
+
+	if (!slash || slash - span->start >= (ptrdiff_t)sizeof(addr))
+		return false;
+
+	memcpy(addr, span->start, slash - span->start);
+	addr[slash - span->start] = '\0';
+	vrp->is_ipv6 = strchr(addr, ':') ? 1 : 0;
+	if (inet_pton(vrp->is_ipv6 ? AF_INET6 : AF_INET, addr, vrp->prefix) != 1)
+		return false;
+
+	max_bits = vrp->is_ipv6 ? 128 : 32;
+	if (!file_parse_u32(slash + 1, span->end, &len) || len > max_bits)
+		return false;
+	vrp->prefix_len = len;
+
+	// clear the host bits, so equal prefixes are always recognized as duplicates
+	for (unsigned int bit = len; bit < max_bits; bit++)
+		vrp->prefix[bit / 8] &= ~(0x80 >> (bit % 8));
+	return true;
+}
+
+static int file_hex_value(const char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* Parses exactly out_len bytes of hex digits, the bytes may be separated by colons */
+static bool file_parse_hex(const struct file_span *span, uint8_t *out, const size_t out_len)
+{
+	size_t len = 0;
+	int high = -1;
+
+	for (const char *p = span->start; p < span->end; p++) {
+		int value;
+
+		if (*p == ':' && high == -1)
+			continue;
+
+		value = file_hex_value(*p);
+		if (value < 0)
+			return false;
+		if (high == -1) {
+			high = value;
+			continue;
+		}
+		if (len == out_len)
+			return false;
+		out[len++] = (high << 4) | value;
+		high = -1;
+	}
+	return len == out_len && high == -1;
+}
+
+static int file_base64_value(const char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if (c >= 'a' && c <= 'z')
+		return c - 'a' + 26;
+	if (c >= '0' && c <= '9')
+		return c - '0' + 52;
+	if (c == '+' || c == '-')
+		return 62;
+	if (c == '/' || c == '_')
+		return 63;
+	return -1;
+}
+
+/* Parses exactly out_len bytes of base64 or base64url, with or without padding */
+static bool file_parse_base64(const struct file_span *span, uint8_t *out, const size_t out_len)
+{
+	uint32_t bits = 0;
+	unsigned int bits_len = 0;
+	size_t len = 0;
+
+	for (const char *p = span->start; p < span->end && *p != '='; p++) {
+		int value = file_base64_value(*p);
+
+		if (value < 0)
+			return false;
+		bits = (bits << 6) | value;
+		bits_len += 6;
+		if (bits_len >= 8) {
+			bits_len -= 8;
+			if (len == out_len)
+				return false;
+			out[len++] = bits >> bits_len;
+		}
+	}
+	return len == out_len;
+}
+
+static int file_add_vrp(struct file_data *data, const struct file_span *asn, const struct file_span *prefix,
+			const struct file_span *max_len)
+{
+	struct file_vrp vrp;
+	uint32_t max = 0;
+
+	memset(&vrp, 0, sizeof(vrp));
+	if (!file_parse_asn(asn, &vrp.asn) || !file_parse_prefix(prefix, &vrp))
+		return -1;
+
+	if (max_len->start != max_len->end) {
+		if (!file_parse_u32(max_len->start, max_len->end, &max))
+			return -1;
+	} else {
+		max = vrp.prefix_len;
+	}
+	if (max < vrp.prefix_len || max > (vrp.is_ipv6 ? 128U : 32U))
+		return -1;
+	vrp.max_len = max;
+
+	return file_data_add_vrp(data, &vrp);
+}
+
+/* SKIs are hex encoded in CSV files and most JSON files, SLURM files use base64url */
+static int file_add_key(struct file_data *data, const struct file_span *asn, const struct file_span *ski,
+			const struct file_span *spki)
+{
+	struct file_key key;
+
+	if (!file_parse_asn(asn, &key.asn))
+		return -1;
+	if (!file_parse_hex(ski, key.ski, sizeof(key.ski)) && !file_parse_base64(ski, key.ski, sizeof(key.ski)))
+		return -1;
+	if (!file_parse_base64(spki, key.spki, sizeof(key.spki)))
+		return -1;
+
+	return file_data_add_key(data, &key);
+}
+
+/* Splits the line at p into at most FILE_CSV_FIELDS trimmed fields, returns the start of the next line */
+static const char *file_csv_line(const char *p, struct file_span *fields, unsigned int *fields_len)
+{
+	*fields_len = 0;
+	while (true) {
+		const char *start = p;
+
+		while (*p != '\0' && *p != ',' && *p != '\n')
+			p++;
+
+		if (*fields_len < FILE_CSV_FIELDS) {
+			struct file_span *field = &fields[(*fields_len)++];
+
+			field->start = start;
+			field->end = p;
+			while (field->start < field->end && file_is_space(*field->start))
+				field->start++;
+			while (field->end > field->start && file_is_space(field->end[-1]))
+				field->end--;
+		}
+
+		if (*p != ',')
+			break;
+		p++;
+	}
+	return *p == '\n' ? p + 1 : p;
+}
+
+/*
+ * Parses CSV lines of the form "ASN,prefix,max length" or "ASN,SKI,SPKI", further fields are ignored. Empty
+ * lines and lines starting with # are skipped, the first line may be a header.
+ */
+static int file_parse_csv(struct file_data *data, const char *buf, const bool keys)
+{
+	bool first = true;
+	const char *p = buf;
+
+	while (*p != '\0') {
+		struct file_span fields[FILE_CSV_FIELDS];
+		const struct file_span empty = {NULL, NULL};
+		unsigned int fields_len;
+		bool header = first;
+		int rtval;
+
+		p = file_csv_line(p, fields, &fields_len);
+		if ((fields_len == 1 && fields[0].start == fields[0].end) ||
+		    (fields[0].start != fields[0].end && *fields[0].start == '#'))
+			continue;
+
+		first = false;
+		if (keys)
+			rtval = fields_len < 3 ? -1 : file_add_key(data, &fields[0], &fields[1], &fields[2]);
+		else
+			rtval = fields_len < 2 ? -1
+					       : file_add_vrp(data, &fields[0], &fields[1],
+							      fields_len > 2 ? &fields[2] : &empty);
+
+		if (rtval != 0 && !header)
+			return -1;
+	}
+	return 0;
+}
+
+static bool file_json_string(const char **p, struct file_span *span)
+{
+	const char *s = *p;
+
+	if (*s != '"')
+		return false;
+
+	span->start = ++s;
+	while (*s != '\0' && *s != '"') {
+		if (*s == '\\' && s[1] != '\0')
+			s++;
+		s++;
+	}
+	if (*s != '"')
+		return false;
+
+	span->end = s;
+	*p = s + 1;
+	return true;
+}
+
+/* Reads a string or the raw text of a number or literal */
+static bool file_json_scalar(const char **p, struct file_span *span)
+{
+	const char *s = *p;
+
+	if (*s == '"')
+		return file_json_string(p, span);
+
+	span->start = s;
+	while (*s != '\0' && *s != ',' && *s != '}' && *s != ']' && !file_is_space(*s))
+		s++;
+	if (s == span->start)
+		return false;
+
+	span->end = s;
+	*p = s;
+	return true;
+}
+
+static bool file_json_object(const char **p, file_json_member_fp member_fp, void *data, unsigned int depth)
+{
+	if (**p != '{' || depth >= FILE_JSON_MAX_DEPTH)
+		return false;
+	(*p)++;
+	file_skip_space(p);
+	if (**p == '}') {
+		(*p)++;
+		return true;
+	}
+
+	while (true) {
+		struct file_span key;
+
+		file_skip_space(p);
+		if (!file_json_string(p, &key))
+			return false;
+		file_skip_space(p);
+		if (**p != ':')
+			return false;
+		(*p)++;
+		file_skip_space(p);
+		if (!member_fp(p, &key, data, depth + 1))
+			return false;
+		file_skip_space(p);
+		if (**p == '}') {
+			(*p)++;
+			return true;
+		}
+		if (**p != ',')
+			return false;
+		(*p)++;
+	}
+}
+
+static bool file_json_array(const char **p, file_json_element_fp element_fp, void *data, unsigned int depth)
+{
+	if (**p != '[' || depth >= FILE_JSON_MAX_DEPTH)
+		return false;
+	(*p)++;
+	file_skip_space(p);
+	if (**p == ']') {
+		(*p)++;
+		return true;
+	}
+
+	while (true) {
+		file_skip_space(p);
+		if (!element_fp(p, data, depth + 1))
+			return false;
+		file_skip_space(p);
+		if (**p == ']') {
+			(*p)++;
+			return true;
+		}
+		if (**p != ',')
+			return false;
+		(*p)++;
+	}
+}
+
+static bool file_json_skip_member(const char **p, const struct file_span *key __attribute__((unused)), void *data,
+				  unsigned int depth)
+{
+	return file_json_value(p, file_json_skip_member, data, depth);
+}
+
+static bool file_json_skip_element(const char **p, void *data, unsigned int depth)
+{
+	return file_json_value(p, file_json_skip_member, data, depth);
+}
+
+/* Parses any value, the members of objects are passed to member_fp, arrays are skipped */
+static bool file_json_value(const char **p, file_json_member_fp member_fp, void *data, unsigned int depth)
+{
+	struct file_span span;
+
+	if (**p == '{')
+		return file_json_object(p, member_fp, data, depth);
+	if (**p == '[')
+		return file_json_array(p, file_json_skip_element, data, depth);
+	return file_json_scalar(p, &span);
+}
+
+static bool file_json_entry_member(const char **p, const struct file_span *key, void *data, unsigned int depth)
+{
+	struct file_json_entry *entry = data;
+	struct file_span *value = NULL;
+
+	if (file_span_equal(key, "asn"))
+		value = &entry->asn;
+	else if (file_span_equal(key, "prefix"))
+		value = &entry->prefix;
+	else if (file_span_equal(key, "maxLength") || file_span_equal(key, "maxPrefixLength") ||
+		 file_span_equal(key, "max_length"))
+		value = &entry->max_len;
+	else if (file_span_equal(key, "ski") || file_span_equal(key, "SKI"))
+		value = &entry->ski;
+	else if (file_span_equal(key, "pubkey") || file_span_equal(key, "routerPublicKey") ||
+		 file_span_equal(key, "spki"))
+		value = &entry->spki;
+
+	if (!value || **p == '{' || **p == '[')
+		return file_json_value(p, file_json_skip_member, NULL, depth);
+	return file_json_scalar(p, value);
+}
+
+static bool file_json_vrp(const char **p, void *data, unsigned int depth)
+{
+	struct file_json_entry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	if (!file_json_object(p, file_json_entry_member, &entry, depth))
+		return false;
+	return file_add_vrp(data, &entry.asn, &entry.prefix, &entry.max_len) == 0;
+}
+
+static bool file_json_key(const char **p, void *data, unsigned int depth)
+{
+	struct file_json_entry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	if (!file_json_object(p, file_json_entry_member, &entry, depth))
+		return false;
+	return file_add_key(data, &entry.asn, &entry.ski, &entry.spki) == 0;
+}
+
+/* Searches nested objects for the arrays of VRPs and router keys of the supported formats */
+static bool file_json_member(const char **p, const struct file_span *key, void *data, unsigned int depth)
+{
+	if (**p == '[') {
+		if (file_span_equal(key, "roas") || file_span_equal(key, "prefixAssertions"))
+			return file_json_array(p, file_json_vrp, data, depth);
+		if (file_span_equal(key, "bgpsec_keys") || file_span_equal(key, "routerKeys") ||
+		    file_span_equal(key, "router_keys") || file_span_equal(key, "bgpsecAssertions"))
+			return file_json_array(p, file_json_key, data, depth);
+	}
+	return file_json_value(p, file_json_member, data, depth);
+}
+
+static int file_parse_json(struct file_data *data, const char *buf)
+{
+	const char *p = buf;
+
+	file_skip_space(&p);
+	if (!file_json_object(&p, file_json_member, data, 0))
+		return -1;
+	file_skip_space(&p);
+	return *p == '\0' ? 0 : -1;
+}
+
+/* Loads the records of all files, the stamps of the read files are stored in stamps */
+static struct file_data *file_load(const struct tr_file_socket *socket, struct file_stamp *stamps)
+{
+	struct file_data *data = lrtr_calloc(1, sizeof(*data));
+
+	if (!data)
+		return NULL;
+
+	for (unsigned int i = 0; i < FILE_PATHS; i++) {
+		const char *path = file_path(socket, i);
+		const char *p;
+		char *buf;
+		int rtval;
+
+		if (!path)
+			continue;
+
+		buf = file_read(path, &stamps[i]);
+		if (!buf) {
+			FILE_DBG("Could not read %s, %s", socket, path, strerror(errno));
+			goto err;
+		}
+
+		p = buf;
+		file_skip_space(&p);
+		if (*p == '{')
+			rtval = file_parse_json(data, p);
+		else
+			rtval = file_parse_csv(data, p, i == 1);
+		lrtr_free(buf);
+
+		if (rtval != 0) {
+			FILE_DBG("Could not parse %s, keeping the previous records", socket, path);
+			goto err;
+		}
+	}
+
+	data->vrps_len = file_sort_unique(data->vrps, data->vrps_len, sizeof(*data->vrps), file_vrp_cmp);
+	data->keys_len = file_sort_unique(data->keys, data->keys_len, sizeof(*data->keys), file_key_cmp);
+	return data;
+
+err:
+	file_data_free(data);
+	return NULL;
+}
+
+/* Frees a record set unless it is still referenced by the socket */
+static void file_data_release(struct tr_file_socket *socket, struct file_data *data)
+{
+	if (data != socket->current && data != socket->synced)
+		file_data_free(data);
+}
+
+/* Checks with stat() whether a file was written or replaced, missing files are treated as unchanged */
+static bool file_changed(const struct tr_file_socket *socket)
+{
+	for (unsigned int i = 0; i < FILE_PATHS; i++) {
+		const char *path = file_path(socket, i);
+		struct file_stamp stamp;
+		struct stat st;
+
+		if (!path || stat(path, &st) == -1)
+			continue;
+
+		file_stamp_init(&stamp, &st);
+		if (!file_stamp_equal(&stamp, &socket->stamps[i]))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Reloads the files if they changed or if force is set. The serial number is incremented if the records differ
+ * from the current ones.
+ * @return true if the records changed.
+ */
+static bool file_refresh(struct tr_file_socket *socket, const bool force)
+{
+	struct file_data *old = socket->current;
+	struct file_data *data;
+
+	if (!force && !file_changed(socket))
+		return false;
+
+	// the stamps are updated even if the files are invalid, so they are only parsed again after the next change
+	data = file_load(socket, socket->stamps);
+	if (!data)
+		return false;
+
+	if (old && file_data_equal(old, data)) {
+		file_data_free(data);
+		return false;
+	}
+
+	if (old)
+		socket->serial++;
+	socket->current = data;
+	file_data_release(socket, old);
+
+	FILE_DBG("Loaded %u VRPs and %u router keys, serial %u", socket, data->vrps_len, data->keys_len,
+		 socket->serial);
+	return true;
+}
+
+static void file_put_u16(uint8_t *p, const uint16_t value)
+{
+	p[0] = value >> 8;
+	p[1] = value;
+}
+
+static void file_put_u32(uint8_t *p, const uint32_t value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+static uint32_t file_get_u32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Appends a zeroed PDU with the given header to the output, returns NULL on error */
+static uint8_t *file_queue_pdu(struct tr_file_socket *socket, const uint8_t type, const uint16_t field,
+			       const uint32_t len)
+{
+	uint8_t *pdu;
+
+	if (socket->out_len + len > socket->out_size) {
+		size_t size = socket->out_size > 0 ? socket->out_size : 4096;
+		uint8_t *out;
+
+		while (size < socket->out_len + len)
+			size *= 2;
+		out = lrtr_realloc(socket->out, size);
+		if (!out)
+			return NULL;
+		socket->out = out;
+		socket->out_size = size;
+	}
+
+	pdu = socket->out + socket->out_len;
+	socket->out_len += len;
+	memset(pdu, 0, len);
+	pdu[0] = socket->version;
+	pdu[1] = type;
+	file_put_u16(pdu + 2, field);
+	file_put_u32(pdu + 4, len);
+	return pdu;
+}
+
+static int file_queue_vrp(struct tr_file_socket *socket, const void *record, const uint8_t flags)
+{
+	const struct file_vrp *vrp = record;
+	const size_t prefix_size = vrp->is_ipv6 ? 16 : 4;
+	uint8_t *pdu = file_queue_pdu(socket, vrp->is_ipv6 ? FILE_PDU_IPV6_PREFIX : FILE_PDU_IPV4_PREFIX, 0,
+				      vrp->is_ipv6 ? FILE_PDU_IPV6_LEN : FILE_PDU_IPV4_LEN);
+
+	if (!pdu)
+		return TR_ERROR;
+
+	pdu[8] = flags;
+	pdu[9] = vrp->prefix_len;
+	pdu[10] = vrp->max_len;
+	memcpy(pdu + 12, vrp->prefix, prefix_size);
+	file_put_u32(pdu + 12 + prefix_size, vrp->asn);
+	return TR_SUCCESS;
+}
+
+/* The flags of a Router Key PDU are the first byte of the session id field */
+static int file_queue_key(struct tr_file_socket *socket, const void *record, const uint8_t flags)
+{
+	const struct file_key *key = record;
+	uint8_t *pdu = file_queue_pdu(socket, FILE_PDU_ROUTER_KEY, flags << 8, FILE_PDU_ROUTER_KEY_LEN);
+
+	if (!pdu)
+		return TR_ERROR;
+
+	memcpy(pdu + 8, key->ski, SKI_SIZE);
+	file_put_u32(pdu + 8 + SKI_SIZE, key->asn);
+	memcpy(pdu + 12 + SKI_SIZE, key->spki, SPKI_SIZE);
+	return TR_SUCCESS;
+}
+
+/* Queues a withdrawal for every record that is only in from and an announcement for every record only in to */
+static int file_queue_diff(struct tr_file_socket *socket, const void *from, const unsigned int from_len,
+			   const void *to, const unsigned int to_len, const size_t size,
+			   int (*cmp)(const void *, const void *), file_queue_fp queue_fp)
+{
+	const char *from_elems = from;
+	const char *to_elems = to;
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	while (i < from_len || j < to_len) {
+		int rtval;
+		int order;
+
+		if (i == from_len)
+			order = 1;
+		else if (j == to_len)
+			order = -1;
+		else
+			order = cmp(from_elems + i * size, to_elems + j * size);
+
+		if (order < 0) {
+			rtval = queue_fp(socket, from_elems + i++ * size, 0);
+		} else if (order > 0) {
+			rtval = queue_fp(socket, to_elems + j++ * size, 1);
+		} else {
+			i++;
+			j++;
+			continue;
+		}
+		if (rtval != TR_SUCCESS)
+			return rtval;
+	}
+	return TR_SUCCESS;
+}
+
+/*
+ * Answers a query with the difference between the records the rtr_socket holds and the current records. If
+ * from is NULL all current records are sent.
+ */
+static int file_queue_response(struct tr_file_socket *socket, const struct file_data *from)
+{
+	const struct file_data *to = socket->current;
+	struct file_data *old = socket->synced;
+	uint8_t *eod;
+	int rtval;
+
+	if (!file_queue_pdu(socket, FILE_PDU_CACHE_RESPONSE, socket->session_id, FILE_PDU_HEADER_LEN))
+		return TR_ERROR;
+
+	rtval = file_queue_diff(socket, from ? from->vrps : NULL, from ? from->vrps_len : 0, to->vrps, to->vrps_len,
+				sizeof(*to->vrps), file_vrp_cmp, file_queue_vrp);
+	if (rtval != TR_SUCCESS)
+		return rtval;
+
+	// router keys were introduced with version 1
+	if (socket->version > RTR_PROTOCOL_VERSION_0) {
+		rtval = file_queue_diff(socket, from ? from->keys : NULL, from ? from->keys_len : 0, to->keys,
+					to->keys_len, sizeof(*to->keys), file_key_cmp, file_queue_key);
+		if (rtval != TR_SUCCESS)
+			return rtval;
+	}
+
+	if (socket->version == RTR_PROTOCOL_VERSION_0) {
+		eod = file_queue_pdu(socket, FILE_PDU_EOD, socket->session_id, FILE_PDU_SERIAL_LEN);
+		if (!eod)
+			return TR_ERROR;
+	} else {
+		eod = file_queue_pdu(socket, FILE_PDU_EOD, socket->session_id, FILE_PDU_EOD_V1_LEN);
+		if (!eod)
+			return TR_ERROR;
+		file_put_u32(eod + 12, RTR_REFRESH_DEFAULT);
+		file_put_u32(eod + 16, RTR_RETRY_DEFAULT);
+		file_put_u32(eod + 20, RTR_EXPIRATION_DEFAULT);
+	}
+	file_put_u32(eod + 8, socket->serial);
+
+	socket->synced = socket->current;
+	socket->synced_serial = socket->serial;
+	file_data_release(socket, old);
+	return TR_SUCCESS;
+}
+
+static int file_handle_query(struct tr_file_socket *socket)
+{
+	const uint8_t version = socket->query[0];
+	const uint8_t type = socket->query[1];
+
+	if (version > RTR_PROTOCOL_MAX_SUPPORTED_VERSION) {
+		FILE_DBG("Query with unsupported protocol version %u received", socket, version);
+		if (!file_queue_pdu(socket, FILE_PDU_ERROR, FILE_UNSUPPORTED_PROTOCOL_VER, FILE_PDU_ERROR_LEN))
+			return TR_ERROR;
+		return TR_SUCCESS;
+	}
+	socket->version = version;
+
+	if (type == FILE_PDU_RESET_QUERY) {
+		file_refresh(socket, false);
+		return file_queue_response(socket, NULL);
+	}
+
+	if (type == FILE_PDU_SERIAL_QUERY) {
+		const uint16_t session_id = ((uint16_t)socket->query[2] << 8) | socket->query[3];
+		const uint32_t serial = file_get_u32(socket->query + 8);
+
+		file_refresh(socket, false);
+		if (session_id != socket->session_id || !socket->synced || serial != socket->synced_serial) {
+			FILE_DBG("No incremental update from serial %u available", socket, serial);
+			if (!file_queue_pdu(socket, FILE_PDU_CACHE_RESET, 0, FILE_PDU_HEADER_LEN))
+				return TR_ERROR;
+			return TR_SUCCESS;
+		}
+		return file_queue_response(socket, socket->synced);
+	}
+
+	FILE_DBG("Ignoring PDU (Type: %u)", socket, type);
+	return TR_SUCCESS;
+}
+
+static const char *file_basename(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+
+	return slash ? slash + 1 : path;
+}
+
+#ifdef __linux__
+/* Watches the directories of the files, so files that are atomically replaced are recognized as well */
+static void file_watch(struct tr_file_socket *socket)
+{
+	socket->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (socket->notify_fd == -1) {
+		FILE_DBG("inotify_init1 failed, polling the files instead, %s", socket, strerror(errno));
+		return;
+	}
+
+	for (unsigned int i = 0; i < FILE_PATHS; i++) {
+		const char *path = file_path(socket, i);
+		const char *name;
+		char *dir;
+
+		if (!path)
+			continue;
+
+		name = file_basename(path);
+		if (name == path) {
+			dir = lrtr_strdup(".");
+		} else {
+			size_t len = name - path > 1 ? (size_t)(name - path - 1) : 1;
+
+			dir = lrtr_malloc(len + 1);
+			if (dir) {
+				memcpy(dir, path, len);
+				dir[len] = '\0';
+			}
+		}
+
+		if (!dir || inotify_add_watch(socket->notify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+			FILE_DBG("Could not watch %s, polling the files instead, %s", socket, path, strerror(errno));
+			close(socket->notify_fd);
+			socket->notify_fd = -1;
+		}
+		lrtr_free(dir);
+		if (socket->notify_fd == -1)
+			return;
+	}
+}
+
+/* Reads all pending events, returns true if one of them concerns one of the files */
+static bool file_read_events(struct tr_file_socket *socket)
+{
+	union {
+		struct inotify_event event;
+		char buf[4096];
+	} events;
+	bool changed = false;
+	ssize_t len;
+
+	while ((len = read(socket->notify_fd, events.buf, sizeof(events.buf))) > 0) {
+		const struct inotify_event *event;
+
+		for (char *p = events.buf; p < events.buf + len; p += sizeof(*event) + event->len) {
+			event = (const struct inotify_event *)p;
+			if (event->mask & IN_Q_OVERFLOW)
+				changed = true;
+
+			for (unsigned int i = 0; i < FILE_PATHS && event->len > 0; i++) {
+				const char *path = file_path(socket, i);
+
+				if (path && strcmp(event->name, file_basename(path)) == 0)
+					changed = true;
+			}
+		}
+	}
+	return changed;
+}
+#else
+static void file_watch(struct tr_file_socket *socket)
+{
+	socket->notify_fd = -1;
+}
+
+static bool file_read_events(struct tr_file_socket *socket __attribute__((unused)))
+{
+	return false;
+}
+#endif
+
+/*
+ * Waits until the files change and queues a Serial Notify PDU if the rtr_socket holds older records.
+ * @return TR_SUCCESS if a PDU was queued.
+ * @return TR_WOULDBLOCK if nothing changed within timeout seconds.
+ * @return TR_INTR if the wait was interrupted by tr_file_interrupt().
+ */
+static int file_wait_for_change(struct tr_file_socket *socket, const time_t timeout)
+{
+	time_t end_time;
+
+	lrtr_get_monotonic_time(&end_time);
+	end_time += timeout;
+
+	while (true) {
+		struct pollfd fds[2];
+		bool force = false;
+		time_t cur_time;
+		time_t wait;
+		int rtval;
+
+		lrtr_get_monotonic_time(&cur_time);
+		wait = end_time > cur_time ? end_time - cur_time : 0;
+		if (socket->notify_fd == -1 && wait > FILE_POLL_INTERVAL)
+			wait = FILE_POLL_INTERVAL;
+
+		// poll() ignores the negative fd without inotify and only waits for tr_file_interrupt()
+		fds[0].fd = socket->notify_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = socket->wakeup.read_fd;
+		fds[1].events = POLLIN;
+		rtval = poll(fds, 2, wait * 1000);
+		if (rtval == -1) {
+			if (errno == EINTR)
+				return TR_INTR;
+			FILE_DBG("poll(..) error: %s", socket, strerror(errno));
+			return TR_ERROR;
+		}
+		if (fds[1].revents) {
+			FILE_DBG1("Waiting for changes interrupted", socket);
+			return TR_INTR;
+		}
+		if (fds[0].revents)
+			force = file_read_events(socket);
+
+		if ((force || socket->notify_fd == -1) && file_refresh(socket, force) && socket->synced) {
+			uint8_t *pdu = file_queue_pdu(socket, FILE_PDU_SERIAL_NOTIFY, socket->session_id,
+						      FILE_PDU_SERIAL_LEN);
+
+			if (!pdu)
+				return TR_ERROR;
+			FILE_DBG("Records changed, notifying serial %u", socket, socket->serial);
+			file_put_u32(pdu + 8, socket->serial);
+			return TR_SUCCESS;
+		}
+
+		lrtr_get_monotonic_time(&cur_time);
+		if (cur_time >= end_time)
+			return TR_WOULDBLOCK;
+	}
+}
+
+int tr_file_open(void *tr_file_sock)
+{
+	struct tr_file_socket *file_socket = tr_file_sock;
+
+	assert(file_socket->notify_fd == -1);
+
+	file_socket->query_len = 0;
+	file_socket->discard_len = 0;
+	file_socket->out_len = 0;
+	file_socket->out_pos = 0;
+
+	file_refresh(file_socket, false);
+	if (!file_socket->current) {
+		FILE_DBG1("No valid records available", file_socket);
+		return TR_ERROR;
+	}
+
+	file_watch(file_socket);
+	FILE_DBG("Serving %u VRPs and %u router keys", file_socket, file_socket->current->vrps_len,
+		 file_socket->current->keys_len);
+	return TR_SUCCESS;
+}
+
+void tr_file_close(void *tr_file_sock)
+{
+	struct tr_file_socket *file_socket = tr_file_sock;
+
+	if (file_socket->notify_fd != -1)
+		close(file_socket->notify_fd);
+	file_socket->notify_fd = -1;
+	file_socket->out_len = 0;
+	file_socket->out_pos = 0;
+	tr_wakeup_clear(&file_socket->wakeup);
+	FILE_DBG1("Socket closed", file_socket);
+}
+
+void tr_file_free(struct tr_socket *tr_sock)
+{
+	struct tr_file_socket *file_sock = tr_sock->socket;
+
+	assert(file_sock);
+	assert(file_sock->notify_fd == -1);
+
+	FILE_DBG1("Freeing socket", file_sock);
+
+	if (file_sock->synced != file_sock->current)
+		file_data_free(file_sock->synced);
+	file_data_free(file_sock->current);
+	lrtr_free(file_sock->out);
+	lrtr_free(file_sock->config.vrp_path);
+	lrtr_free(file_sock->config.key_path);
+	tr_wakeup_free(&file_sock->wakeup);
+
+	tr_sock->socket = NULL;
+	lrtr_free(file_sock);
+}
+
+int tr_file_recv(const void *tr_file_sock, void *pdu, const size_t len, const time_t timeout)
+{
+	struct tr_file_socket *file_socket = (struct tr_file_socket *)tr_file_sock;
+	size_t count;
+
+	if (file_socket->out_pos == file_socket->out_len) {
+		int rtval = file_wait_for_change(file_socket, timeout);
+
+		if (rtval != TR_SUCCESS)
+			return rtval;
+	}
+
+	count = file_socket->out_len - file_socket->out_pos;
+	if (count > len)
+		count = len;
+	memcpy(pdu, file_socket->out + file_socket->out_pos, count);
+	file_socket->out_pos += count;
+
+	if (file_socket->out_pos == file_socket->out_len) {
+		file_socket->out_pos = 0;
+		file_socket->out_len = 0;
+		if (file_socket->out_size > FILE_OUT_KEEP_SIZE) {
+			lrtr_free(file_socket->out);
+			file_socket->out = NULL;
+			file_socket->out_size = 0;
+		}
+	}
+	return count;
+}
+
+/* Collects the queries of the rtr_socket and queues the answers, all other PDUs are discarded */
+int tr_file_send(const void *tr_file_sock, const void *pdu, const size_t len,
+		 const time_t timeout __attribute__((unused)))
+{
+	struct tr_file_socket *file_socket = (struct tr_file_socket *)tr_file_sock;
+	const uint8_t *data = pdu;
+
+	for (size_t i = 0; i < len; i++) {
+		uint32_t pdu_len;
+
+		if (file_socket->discard_len > 0) {
+			file_socket->discard_len--;
+			continue;
+		}
+
+		file_socket->query[file_socket->query_len++] = data[i];
+		if (file_socket->query_len < FILE_PDU_HEADER_LEN)
+			continue;
+
+		pdu_len = file_get_u32(file_socket->query + 4);
+		if (pdu_len < FILE_PDU_HEADER_LEN || pdu_len > sizeof(file_socket->query)) {
+			FILE_DBG("Discarding PDU (Type: %u)", file_socket, file_socket->query[1]);
+			file_socket->discard_len = pdu_len > FILE_PDU_HEADER_LEN ? pdu_len - FILE_PDU_HEADER_LEN : 0;
+			file_socket->query_len = 0;
+			continue;
+		}
+		if (file_socket->query_len < pdu_len)
+			continue;
+
+		file_socket->query_len = 0;
+		if (file_handle_query(file_socket) != TR_SUCCESS)
+			return TR_ERROR;
+	}
+	return len;
+}
+
+/*
+ * Adds the current records to the tables of a reset. Afterwards the rtr_socket holds the same records as after
+ * a Reset Query and the following Serial Queries are answered with the difference.
+ */
+int tr_file_load(void *tr_file_sock, struct pfx_table *pfx_table, struct spki_table *spki_table,
+		 const struct rtr_socket *rtr_socket, uint16_t *session_id, uint32_t *serial)
+{
+	struct tr_file_socket *file_socket = tr_file_sock;
+	const struct file_data *data;
+	struct file_data *old = file_socket->synced;
+
+	file_refresh(file_socket, false);
+	data = file_socket->current;
+	if (!data)
+		return TR_ERROR;
+
+	for (unsigned int i = 0; i < data->vrps_len; i++) {
+		const struct file_vrp *vrp = &data->vrps[i];
+		struct pfx_record record = {.asn = vrp->asn,
+					    .min_len = vrp->prefix_len,
+					    .max_len = vrp->max_len,
+					    .socket = rtr_socket};
+
+		if (vrp->is_ipv6) {
+			record.prefix.ver = LRTR_IPV6;
+			for (unsigned int j = 0; j < 4; j++)
+				record.prefix.u.addr6.addr[j] = file_get_u32(vrp->prefix + j * 4);
+		} else {
+			record.prefix.ver = LRTR_IPV4;
+			record.prefix.u.addr4.addr = file_get_u32(vrp->prefix);
+		}
+		if (pfx_table_add(pfx_table, &record) != PFX_SUCCESS)
+			return TR_ERROR;
+	}
+
+	for (unsigned int i = 0; i < data->keys_len; i++) {
+		struct spki_record record = {.asn = data->keys[i].asn, .socket = rtr_socket};
+
+		memcpy(record.ski, data->keys[i].ski, SKI_SIZE);
+		memcpy(record.spki, data->keys[i].spki, SPKI_SIZE);
+		if (spki_table_add_entry(spki_table, &record) != SPKI_SUCCESS)
+			return TR_ERROR;
+	}
+
+	file_socket->synced = file_socket->current;
+	file_socket->synced_serial = file_socket->serial;
+	file_data_release(file_socket, old);
+	*session_id = file_socket->session_id;
+	*serial = file_socket->serial;
+	FILE_DBG("Loaded %u VRPs and %u router keys into the tables", file_socket, data->vrps_len, data->keys_len);
+	return data->vrps_len + data->keys_len;
+}
+
+/* The wakeup pipe stays readable until the socket is closed */
+void tr_file_interrupt(void *tr_file_sock)
+{
+	const struct tr_file_socket *file_socket = tr_file_sock;
+
+	tr_wakeup_signal(&file_socket->wakeup);
+}
+
+const char *tr_file_ident(void *socket)
+{
+	struct tr_file_socket *sock = socket;
+
+	assert(sock);
+	return sock->config.vrp_path;
+}
+
+RTRLIB_EXPORT int tr_file_init(const struct tr_file_config *config, struct tr_socket *socket)
+{
+	struct tr_file_socket *file_socket;
+
+	if (!config->vrp_path)
+		return TR_ERROR;
+
+	tr_socket_init(socket);
+	socket->close_fp = &tr_file_close;
+	socket->free_fp = &tr_file_free;
+	socket->open_fp = &tr_file_open;
+	socket->recv_fp = &tr_file_recv;
+	socket->send_fp = &tr_file_send;
+	socket->ident_fp = &tr_file_ident;
+	socket->interrupt_fp = &tr_file_interrupt;
+	socket->load_fp = &tr_file_load;
+
+	socket->socket = lrtr_calloc(1, sizeof(struct tr_file_socket));
+	file_socket = socket->socket;
+	if (!file_socket)
+		return TR_ERROR;
+
+	if (tr_wakeup_init(&file_socket->wakeup) == TR_ERROR) {
+		lrtr_free(file_socket);
+		socket->socket = NULL;
+		return TR_ERROR;
+	}
+
+	file_socket->notify_fd = -1;
+	file_socket->config.vrp_path = lrtr_strdup(config->vrp_path);
+	if (config->key_path)
+		file_socket->config.key_path = lrtr_strdup(config->key_path);
+	else
+		file_socket->config.key_path = NULL;
+
+	// a new session id lets an rtr_socket that was synced by a previous instance reset its records
+	file_socket->session_id = time(NULL) ^ getpid();
+	file_socket->version = RTR_PROTOCOL_MAX_SUPPORTED_VERSION;
+
+	return TR_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_file_transport_h File transport socket
+ * @ingroup mod_transport_h
+ * @brief A transport that serves validated ROA payloads and router keys from local files.
+ * @details The transport serves the records of a VRP file and an optional router key file. A reset of the
+ * rtr_socket does not send a PDU per record: the transport adds all records directly to the shadow tables of
+ * the reset, which are then swapped in at once. The incremental updates that follow are answered like an RTR
+ * cache would answer Serial Queries. An rtr_socket that uses it can be part of an rtr_mgr_group like any
+ * other socket, e.g. as a less preferred fallback for bootstrapping or as an override during an emergency.\n
+ * Supported are CSV exports with the columns ASN, prefix and maximum length (further columns are ignored)
+ * and the JSON exports of common relying party software that contain a "roas" array. Router keys are read
+ * from CSV files with the columns ASN, SKI (hex) and SPKI (base64) or from "bgpsec_keys" or "routerKeys"
+ * arrays of a JSON file. Local assertions of SLURM (RFC 8416) files are understood as well.\n
+ * The files are watched with inotify on Linux and polled otherwise. When a file was changed the transport
+ * notifies the rtr_socket, which then receives only the records that were added or removed as an
+ * incremental update. A file that can not be parsed is ignored and the last valid content is kept.\n
+ * See @ref mod_transport_h "transport interface" for a list of supported operations.
+ *
+ * @{
+ */
+
+#ifndef RTR_FILE_TRANSPORT_H
+#define RTR_FILE_TRANSPORT_H
+
+#include "rtrlib/transport/transport.h"
+
+/**
+ * @brief A tr_file_config struct holds the configuration of a file transport.
+ * @param vrp_path Path of the CSV or JSON file with the validated ROA payloads.
+ * @param key_path Path of the CSV or JSON file with the router keys, NULL if router keys are only read from
+ *		   the JSON file at vrp_path.
+ */
+struct tr_file_config {
+	char *vrp_path;
+	char *key_path;
+};
+
+/**
+ * @brief Initializes the tr_socket struct for a file transport.
+ * @param[in] config Configuration of the transport.
+ * @param[out] socket Initialized transport socket.
+ * @returns TR_SUCCESS On success.
+ * @returns TR_ERROR On error.
+ */
+int tr_file_init(const struct tr_file_config *config, struct tr_socket *socket);
+#endif
+/** @} */
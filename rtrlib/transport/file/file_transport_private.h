@@ -0,0 +1,23 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+/**
+ * @defgroup mod_file_transport_h File transport socket
+ * @ingroup mod_transport_h
+ * @brief A transport that serves validated ROA payloads and router keys from local files.
+ * See @ref mod_transport_h "transport interface" for a list of supported operations.
+ *
+ * @{
+ */
+
+#ifndef RTR_FILE_TRANSPORT_PRIVATE_H
+#define RTR_FILE_TRANSPORT_PRIVATE_H
+#include "file_transport.h"
+#endif
+/** @} */
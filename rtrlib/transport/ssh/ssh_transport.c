@@ -295,6 +295,7 @@ const char *tr_ssh_ident(void *tr_ssh_sock)
 
 RTRLIB_EXPORT int tr_ssh_init(const struct tr_ssh_config *config, struct tr_socket *socket)
 {
+	tr_socket_init(socket);
 	socket->close_fp = &tr_ssh_close;
 	socket->free_fp = &tr_ssh_free;
 	socket->open_fp = &tr_ssh_open;
@@ -18,6 +18,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +41,7 @@ struct tr_tcp_socket {
 	int socket;
 	struct tr_tcp_config config;
 	char *ident;
+	struct tr_wakeup wakeup;
 };
 
 static int tr_tcp_open(void *tr_tcp_sock);
@@ -46,6 +50,7 @@ static void tr_tcp_free(struct tr_socket *tr_sock);
 static int tr_tcp_recv(const void *tr_tcp_sock, void *pdu, const size_t len, const time_t timeout);
 static int tr_tcp_send(const void *tr_tcp_sock, const void *pdu, const size_t len, const time_t timeout);
 static const char *tr_tcp_ident(void *socket);
+static void tr_tcp_interrupt(void *tr_tcp_sock);
 
 static int set_socket_blocking(int socket)
 {
@@ -88,6 +93,54 @@ static int get_socket_error(int socket)
 	return result;
 }
 
+static int set_socket_option(int socket, int level, int name, unsigned int value)
+{
+	int optval = value;
+
+	if (setsockopt(socket, level, name, &optval, sizeof(optval)) == -1)
+		return TR_ERROR;
+
+	return TR_SUCCESS;
+}
+
+/* Applies the keepalive and user timeout settings, options the platform does not know are skipped */
+static int set_socket_liveness(const struct tr_tcp_socket *tcp_socket)
+{
+	const struct tr_tcp_config *config = &tcp_socket->config;
+
+	if (config->keepalive_idle > 0) {
+		if (set_socket_option(tcp_socket->socket, SOL_SOCKET, SO_KEEPALIVE, 1) == TR_ERROR)
+			return TR_ERROR;
+#if defined(TCP_KEEPIDLE)
+		if (set_socket_option(tcp_socket->socket, IPPROTO_TCP, TCP_KEEPIDLE, config->keepalive_idle) ==
+		    TR_ERROR)
+			return TR_ERROR;
+#elif defined(TCP_KEEPALIVE)
+		if (set_socket_option(tcp_socket->socket, IPPROTO_TCP, TCP_KEEPALIVE, config->keepalive_idle) ==
+		    TR_ERROR)
+			return TR_ERROR;
+#endif
+#ifdef TCP_KEEPINTVL
+		if (config->keepalive_interval > 0 &&
+		    set_socket_option(tcp_socket->socket, IPPROTO_TCP, TCP_KEEPINTVL, config->keepalive_interval) ==
+			    TR_ERROR)
+			return TR_ERROR;
+#endif
+#ifdef TCP_KEEPCNT
+		if (config->keepalive_count > 0 &&
+		    set_socket_option(tcp_socket->socket, IPPROTO_TCP, TCP_KEEPCNT, config->keepalive_count) ==
+			    TR_ERROR)
+			return TR_ERROR;
+#endif
+	}
+#ifdef TCP_USER_TIMEOUT
+	if (config->user_timeout > 0 &&
+	    set_socket_option(tcp_socket->socket, IPPROTO_TCP, TCP_USER_TIMEOUT, config->user_timeout) == TR_ERROR)
+		return TR_ERROR;
+#endif
+	return TR_SUCCESS;
+}
+
 /* WARNING: This function has cancelable sections! */
 int tr_tcp_open(void *tr_socket)
 {
@@ -169,8 +222,14 @@ int tr_tcp_open(void *tr_socket)
 		freeaddrinfo(res);
 		res = NULL;
 
+		fd_set rfds;
 		fd_set wfds;
+		int nfds = tcp_socket->socket > tcp_socket->wakeup.read_fd ? tcp_socket->socket
+									     : tcp_socket->wakeup.read_fd;
 
+		// tr_tcp_interrupt() makes the wakeup pipe readable
+		FD_ZERO(&rfds);
+		FD_SET(tcp_socket->wakeup.read_fd, &rfds);
 		FD_ZERO(&wfds);
 		FD_SET(tcp_socket->socket, &wfds);
 
@@ -183,7 +242,7 @@ int tr_tcp_open(void *tr_socket)
 		 * Since local resources have all been freed this should be safe.
 		 */
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldcancelstate);
-		int ret = select(tcp_socket->socket + 1, NULL, &wfds, NULL, &timeout);
+		int ret = select(nfds + 1, &rfds, &wfds, NULL, &timeout);
 
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldcancelstate);
 
@@ -194,6 +253,10 @@ int tr_tcp_open(void *tr_socket)
 		} else if (ret == 0) {
 			TCP_DBG("Could not establish TCP connection in time", tcp_socket);
 			goto end;
+
+		} else if (FD_ISSET(tcp_socket->wakeup.read_fd, &rfds)) {
+			TCP_DBG1("Connection attempt interrupted", tcp_socket);
+			goto end;
 		}
 
 		int socket_error = get_socket_error(tcp_socket->socket);
@@ -213,6 +276,11 @@ int tr_tcp_open(void *tr_socket)
 		}
 	}
 
+	if (set_socket_liveness(tcp_socket) == TR_ERROR) {
+		TCP_DBG("Could not set keepalive options, %s", tcp_socket, strerror(errno));
+		goto end;
+	}
+
 	TCP_DBG1("Connection established", tcp_socket);
 	rtval = TR_SUCCESS;
 
@@ -233,6 +301,7 @@ void tr_tcp_close(void *tr_tcp_sock)
 
 	if (tcp_socket->socket != -1)
 		close(tcp_socket->socket);
+	tr_wakeup_clear(&tcp_socket->wakeup);
 	TCP_DBG1("Socket closed", tcp_socket);
 	tcp_socket->socket = -1;
 }
@@ -249,6 +318,7 @@ void tr_tcp_free(struct tr_socket *tr_sock)
 	lrtr_free(tcp_sock->config.host);
 	lrtr_free(tcp_sock->config.port);
 	lrtr_free(tcp_sock->config.bindaddr);
+	tr_wakeup_free(&tcp_sock->wakeup);
 
 	if (tcp_sock->ident)
 		lrtr_free(tcp_sock->ident);
@@ -261,17 +331,28 @@ int tr_tcp_recv(const void *tr_tcp_sock, void *pdu, const size_t len, const time
 	const struct tr_tcp_socket *tcp_socket = tr_tcp_sock;
 	int rtval;
 
-	if (timeout == 0) {
-		rtval = recv(tcp_socket->socket, pdu, len, MSG_DONTWAIT);
-	} else {
-		struct timeval t = {timeout, 0};
-
-		if (setsockopt(tcp_socket->socket, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t)) == -1) {
-			TCP_DBG("setting SO_RCVTIMEO failed, %s", tcp_socket, strerror(errno));
+	if (timeout > 0) {
+		struct pollfd fds[2];
+
+		fds[0].fd = tcp_socket->socket;
+		fds[0].events = POLLIN;
+		fds[1].fd = tcp_socket->wakeup.read_fd;
+		fds[1].events = POLLIN;
+		rtval = poll(fds, 2, timeout * 1000);
+		if (rtval == -1) {
+			if (errno == EINTR)
+				return TR_INTR;
+			TCP_DBG("poll(..) error: %s", tcp_socket, strerror(errno));
 			return TR_ERROR;
 		}
-		rtval = recv(tcp_socket->socket, pdu, len, 0);
+		if (rtval == 0)
+			return TR_WOULDBLOCK;
+		if (fds[1].revents) {
+			TCP_DBG1("recv(..) interrupted", tcp_socket);
+			return TR_INTR;
+		}
 	}
+	rtval = recv(tcp_socket->socket, pdu, len, MSG_DONTWAIT);
 
 	if (rtval == -1) {
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -316,6 +397,14 @@ int tr_tcp_send(const void *tr_tcp_sock, const void *pdu, const size_t len, cons
 	return rtval;
 }
 
+/* The wakeup pipe stays readable until the socket is closed, later blocking calls return immediately as well */
+void tr_tcp_interrupt(void *tr_tcp_sock)
+{
+	const struct tr_tcp_socket *tcp_socket = tr_tcp_sock;
+
+	tr_wakeup_signal(&tcp_socket->wakeup);
+}
+
 const char *tr_tcp_ident(void *socket)
 {
 	size_t len;
@@ -337,16 +426,27 @@ const char *tr_tcp_ident(void *socket)
 
 RTRLIB_EXPORT int tr_tcp_init(const struct tr_tcp_config *config, struct tr_socket *socket)
 {
+	tr_socket_init(socket);
 	socket->close_fp = &tr_tcp_close;
 	socket->free_fp = &tr_tcp_free;
 	socket->open_fp = &tr_tcp_open;
 	socket->recv_fp = &tr_tcp_recv;
 	socket->send_fp = &tr_tcp_send;
 	socket->ident_fp = &tr_tcp_ident;
+	socket->interrupt_fp = &tr_tcp_interrupt;
 
 	socket->socket = lrtr_malloc(sizeof(struct tr_tcp_socket));
 	struct tr_tcp_socket *tcp_socket = socket->socket;
 
+	if (!tcp_socket)
+		return TR_ERROR;
+
+	if (tr_wakeup_init(&tcp_socket->wakeup) == TR_ERROR) {
+		lrtr_free(tcp_socket);
+		socket->socket = NULL;
+		return TR_ERROR;
+	}
+
 	tcp_socket->socket = -1;
 	tcp_socket->config.host = lrtr_strdup(config->host);
 	tcp_socket->config.port = lrtr_strdup(config->port);
@@ -363,6 +463,10 @@ RTRLIB_EXPORT int tr_tcp_init(const struct tr_tcp_config *config, struct tr_sock
 	tcp_socket->ident = NULL;
 	tcp_socket->config.data = config->data;
 	tcp_socket->config.new_socket = config->new_socket;
+	tcp_socket->config.keepalive_idle = config->keepalive_idle;
+	tcp_socket->config.keepalive_interval = config->keepalive_interval;
+	tcp_socket->config.keepalive_count = config->keepalive_count;
+	tcp_socket->config.user_timeout = config->user_timeout;
 
 	return TR_SUCCESS;
 }
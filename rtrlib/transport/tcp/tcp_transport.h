@@ -37,6 +37,14 @@
  *	  When new_socket() is used, host, port, and bindaddr are not used.
  * @param connect_timeout Time in seconds to wait for a successful connection.
  *	  Defaults to #RTRLIB_TRANSPORT_CONNECT_TIMEOUT_DEFAULT
+ * @param keepalive_idle Time in seconds without traffic after which TCP keepalive probes are sent.
+ *	  0 disables TCP keepalive.
+ * @param keepalive_interval Time in seconds between two keepalive probes, 0 for the system default.
+ * @param keepalive_count Number of unanswered keepalive probes after which the connection is dropped,
+ *	  0 for the system default.
+ * @param user_timeout Time in milliseconds that sent data may stay unacknowledged before the connection
+ *	  is dropped (TCP_USER_TIMEOUT, Linux only), 0 for the system default. A dropped connection is detected
+ *	  by the rtr_socket in seconds instead of waiting for the next Serial Query.
  */
 struct tr_tcp_config {
 	char *host;
@@ -45,6 +53,10 @@ struct tr_tcp_config {
 	void *data;
 	int (*new_socket)(void *data);
 	unsigned int connect_timeout;
+	unsigned int keepalive_idle;
+	unsigned int keepalive_interval;
+	unsigned int keepalive_count;
+	unsigned int user_timeout;
 };
 
 /**
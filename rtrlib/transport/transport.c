@@ -10,6 +10,17 @@
 #include "transport_private.h"
 
 #include "rtrlib/lib/utils_private.h"
+#include "rtrlib/rtrlib_export_private.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/* cppcheck-suppress unusedFunction */
+RTRLIB_EXPORT void tr_socket_init(struct tr_socket *socket)
+{
+	memset(socket, 0, sizeof(*socket));
+}
 
 inline int tr_open(struct tr_socket *socket)
 {
@@ -36,6 +47,22 @@ inline int tr_recv(const struct tr_socket *socket, void *buf, const size_t len,
 	return socket->recv_fp(socket->socket, buf, len, timeout);
 }
 
+int tr_interrupt(const struct tr_socket *socket)
+{
+	if (!socket->interrupt_fp)
+		return TR_ERROR;
+	socket->interrupt_fp(socket->socket);
+	return TR_SUCCESS;
+}
+
+int tr_load(const struct tr_socket *socket, struct pfx_table *pfx_table, struct spki_table *spki_table,
+	    const struct rtr_socket *rtr_socket, uint16_t *session_id, uint32_t *serial)
+{
+	if (!socket->load_fp)
+		return TR_ERROR;
+	return socket->load_fp(socket->socket, pfx_table, spki_table, rtr_socket, session_id, serial);
+}
+
 /* cppcheck-suppress unusedFunction */
 inline const char *tr_ident(struct tr_socket *sock)
 {
@@ -85,3 +112,60 @@ int tr_recv_all(const struct tr_socket *socket, const void *pdu, const size_t le
 	}
 	return total_recv;
 }
+
+static int tr_wakeup_set_flags(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+		return TR_ERROR;
+	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+		return TR_ERROR;
+	return TR_SUCCESS;
+}
+
+int tr_wakeup_init(struct tr_wakeup *wakeup)
+{
+	int fds[2];
+
+	wakeup->read_fd = -1;
+	wakeup->write_fd = -1;
+	if (pipe(fds) == -1)
+		return TR_ERROR;
+
+	if (tr_wakeup_set_flags(fds[0]) == TR_ERROR || tr_wakeup_set_flags(fds[1]) == TR_ERROR) {
+		close(fds[0]);
+		close(fds[1]);
+		return TR_ERROR;
+	}
+	wakeup->read_fd = fds[0];
+	wakeup->write_fd = fds[1];
+	return TR_SUCCESS;
+}
+
+void tr_wakeup_free(struct tr_wakeup *wakeup)
+{
+	if (wakeup->read_fd != -1)
+		close(wakeup->read_fd);
+	if (wakeup->write_fd != -1)
+		close(wakeup->write_fd);
+	wakeup->read_fd = -1;
+	wakeup->write_fd = -1;
+}
+
+void tr_wakeup_signal(const struct tr_wakeup *wakeup)
+{
+	const char byte = 0;
+
+	// a full pipe is readable already
+	if (write(wakeup->write_fd, &byte, sizeof(byte)) == -1)
+		return;
+}
+
+void tr_wakeup_clear(const struct tr_wakeup *wakeup)
+{
+	char buf[64];
+
+	while (read(wakeup->read_fd, buf, sizeof(buf)) > 0)
+		;
+}
@@ -14,6 +14,9 @@
  * @details Before using the transport socket, a tr_socket must be
  * initialized based on a protocol-dependent init function (e.g.,
  * tr_tcp_init()).\n
+ * Transports that are implemented outside of RTRlib must call
+ * tr_socket_init() before they set their function pointers, optional
+ * members like interrupt_fp are then left NULL.\n
  * The tr_* functions call the corresponding function pointers, which are
  * passed in the tr_socket struct, and forward the remaining arguments.
  *
@@ -23,6 +26,7 @@
 #ifndef RTR_TRANSPORT_H
 #define RTR_TRANSPORT_H
 
+#include <stdint.h>
 #include <time.h>
 
 /**
@@ -51,6 +55,9 @@ enum tr_rtvals {
 };
 
 struct tr_socket;
+struct pfx_table;
+struct spki_table;
+struct rtr_socket;
 
 /**
  * @brief A function pointer to a technology specific close function.
@@ -89,6 +96,21 @@ typedef int (*tr_send_fp)(const void *socket, const void *pdu, const size_t len,
  */
 typedef const char *(*tr_ident_fp)(void *socket);
 
+/**
+ * @brief A function pointer to a technology specific interrupt function.
+ * \sa tr_interrupt
+ */
+typedef void (*tr_interrupt_fp)(void *socket);
+
+/**
+ * @brief A function pointer to a technology specific bulk load function.
+ * @details Transports that hold all records locally add them directly to the tables instead of answering a
+ * Reset Query with one PDU per record. Returns the number of added records or TR_ERROR.
+ * \sa tr_load
+ */
+typedef int (*tr_load_fp)(void *socket, struct pfx_table *pfx_table, struct spki_table *spki_table,
+			  const struct rtr_socket *rtr_socket, uint16_t *session_id, uint32_t *serial);
+
 /**
  * @brief A transport socket datastructure.
  *
@@ -98,6 +120,11 @@ typedef const char *(*tr_ident_fp)(void *socket);
  * @param free_fp Pointer to a function that frees all memory allocated with this socket.
  * @param send_fp Pointer to a function that sends data through this socket.
  * @param recv_fp Pointer to a function that receives data from this socket.
+ * @param ident_fp Pointer to a function that returns an identifier for the socket endpoint.
+ * @param interrupt_fp Pointer to a function that wakes up a blocking open or receive call, NULL if the
+ * transport does not support it.
+ * @param load_fp Pointer to a function that adds all records of the transport to the tables of a reset, NULL if
+ * the records are only sent as PDUs.
  */
 struct tr_socket {
 	void *socket;
@@ -107,7 +134,17 @@ struct tr_socket {
 	tr_send_fp send_fp;
 	tr_recv_fp recv_fp;
 	tr_ident_fp ident_fp;
+	tr_interrupt_fp interrupt_fp;
+	tr_load_fp load_fp;
 };
 
+/**
+ * @brief Resets all members of a tr_socket to NULL.
+ * @details Every transport init function must call this before it sets its function pointers. Members that are
+ * added to struct tr_socket later are optional and a transport that does not know about them leaves them NULL.
+ * @param[out] socket tr_socket that will be reset.
+ */
+void tr_socket_init(struct tr_socket *socket);
+
 #endif
 /** @} */
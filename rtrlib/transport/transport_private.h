@@ -41,6 +41,32 @@ int tr_open(struct tr_socket *socket);
  */
 void tr_close(struct tr_socket *socket);
 
+/**
+ * @brief Wakes up a blocking tr_open() or tr_recv() call of another thread.
+ * @details The interrupted call returns with an error, as does every following call until the socket is
+ * closed. The function is safe to call while another thread uses the socket.
+ * @param[in] socket Socket that will be interrupted.
+ * @return TR_SUCCESS On success.
+ * @return TR_ERROR If the transport does not support interrupts.
+ */
+int tr_interrupt(const struct tr_socket *socket);
+
+/**
+ * @brief Adds all records of the transport to the passed tables, with rtr_socket as their source.
+ * @details The tables are expected to be shadow tables of a reset, records that can not be added leave them
+ * partially filled. The incremental updates that follow start at the returned serial number.
+ * @param[in] socket Socket whose records are loaded.
+ * @param[in] pfx_table Table that the prefix records are added to.
+ * @param[in] spki_table Table that the router keys are added to.
+ * @param[in] rtr_socket Socket that is set as source of the records.
+ * @param[out] session_id Session id of the loaded records.
+ * @param[out] serial Serial number of the loaded records.
+ * @return Number of loaded prefix records and router keys on success.
+ * @return TR_ERROR On error or if the transport does not support bulk loads.
+ */
+int tr_load(const struct tr_socket *socket, struct pfx_table *pfx_table, struct spki_table *spki_table,
+	    const struct rtr_socket *rtr_socket, uint16_t *session_id, uint32_t *serial);
+
 /**
  * @brief Deallocates all memory that the passed socket uses.
  * Socket have to be closed before.
@@ -103,5 +129,41 @@ int tr_recv_all(const struct tr_socket *socket, const void *buf, const size_t le
  */
 const char *tr_ident(struct tr_socket *socket);
 
+/**
+ * @brief A pipe that transports poll together with their file descriptor to implement tr_interrupt().
+ * @param read_fd End that is polled for POLLIN, -1 if the tr_wakeup is not initialized.
+ * @param write_fd End that tr_wakeup_signal() writes to.
+ */
+struct tr_wakeup {
+	int read_fd;
+	int write_fd;
+};
+
+/**
+ * @brief Creates the pipe of a tr_wakeup.
+ * @param[out] wakeup The tr_wakeup that will be initialized.
+ * @return TR_SUCCESS On success.
+ * @return TR_ERROR On error.
+ */
+int tr_wakeup_init(struct tr_wakeup *wakeup);
+
+/**
+ * @brief Closes the pipe of a tr_wakeup.
+ * @param[in] wakeup The tr_wakeup that will be freed.
+ */
+void tr_wakeup_free(struct tr_wakeup *wakeup);
+
+/**
+ * @brief Makes read_fd readable until tr_wakeup_clear() is called.
+ * @param[in] wakeup The tr_wakeup that will be signalled.
+ */
+void tr_wakeup_signal(const struct tr_wakeup *wakeup);
+
+/**
+ * @brief Discards all pending signals of a tr_wakeup.
+ * @param[in] wakeup The tr_wakeup that will be cleared.
+ */
+void tr_wakeup_clear(const struct tr_wakeup *wakeup);
+
 #endif
 /** @} */
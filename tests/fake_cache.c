@@ -0,0 +1,167 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "fake_cache.h"
+
+#include "rtrlib/rtr/rtr_private.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static char cache_host[] = "127.0.0.1";
+static char cache_port[] = "0";
+
+void fake_cache_listen(struct fake_cache *cache)
+{
+	socklen_t addr_len = sizeof(cache->addr);
+
+	memset(cache, 0, sizeof(*cache));
+	cache->fd = -1;
+	cache->client_fd = -1;
+	cache->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	assert(cache->listen_fd >= 0);
+	cache->addr.sin_family = AF_INET;
+	cache->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	assert(bind(cache->listen_fd, (struct sockaddr *)&cache->addr, sizeof(cache->addr)) == 0);
+	assert(getsockname(cache->listen_fd, (struct sockaddr *)&cache->addr, &addr_len) == 0);
+	assert(listen(cache->listen_fd, 4) == 0);
+}
+
+void fake_cache_close(struct fake_cache *cache)
+{
+	if (cache->fd >= 0)
+		close(cache->fd);
+	cache->fd = -1;
+	close(cache->listen_fd);
+}
+
+void fake_cache_tcp_config(struct fake_cache *cache, struct tr_tcp_config *config)
+{
+	memset(config, 0, sizeof(*config));
+	config->host = cache_host;
+	config->port = cache_port;
+	config->data = cache;
+	config->new_socket = fake_cache_connect;
+}
+
+int fake_cache_connect(void *data)
+{
+	struct fake_cache *cache = data;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	assert(fd >= 0);
+	assert(connect(fd, (struct sockaddr *)&cache->addr, sizeof(cache->addr)) == 0);
+	cache->client_fd = fd;
+	return fd;
+}
+
+void fake_cache_accept(struct fake_cache *cache)
+{
+	if (cache->fd >= 0)
+		close(cache->fd);
+	cache->fd = accept(cache->listen_fd, NULL, NULL);
+	assert(cache->fd >= 0);
+}
+
+void fake_cache_read_full(int fd, uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t rtval = read(fd, buf, len);
+
+		assert(rtval > 0);
+		buf += rtval;
+		len -= rtval;
+	}
+}
+
+void fake_cache_write_full(int fd, const uint8_t *buf, size_t len)
+{
+	assert(write(fd, buf, len) == (ssize_t)len);
+}
+
+uint8_t fake_cache_read_query(struct fake_cache *cache)
+{
+	uint8_t query[12];
+	uint32_t query_len;
+
+	fake_cache_read_full(cache->fd, query, 8);
+	memcpy(&query_len, query + 4, sizeof(query_len));
+	assert(ntohl(query_len) >= 8 && ntohl(query_len) <= sizeof(query));
+	fake_cache_read_full(cache->fd, query + 8, ntohl(query_len) - 8);
+	return query[1];
+}
+
+void fake_cache_send_serial_notify(struct fake_cache *cache, const uint16_t session_id, const uint32_t serial)
+{
+	uint8_t notify[12] = {RTR_PROTOCOL_VERSION_1, 0};
+	const uint16_t session_id_n = htons(session_id);
+	const uint32_t notify_fields[2] = {htonl(sizeof(notify)), htonl(serial)};
+
+	memcpy(notify + 2, &session_id_n, sizeof(session_id_n));
+	memcpy(notify + 4, notify_fields, sizeof(notify_fields));
+	fake_cache_write_full(cache->fd, notify, sizeof(notify));
+}
+
+void fake_cache_send_response(struct fake_cache *cache, const uint16_t session_id)
+{
+	uint8_t response[8] = {RTR_PROTOCOL_VERSION_1, 3};
+	const uint16_t session_id_n = htons(session_id);
+	const uint32_t response_len = htonl(sizeof(response));
+
+	memcpy(response + 2, &session_id_n, sizeof(session_id_n));
+	memcpy(response + 4, &response_len, sizeof(response_len));
+	fake_cache_write_full(cache->fd, response, sizeof(response));
+}
+
+void fake_cache_send_ipv4(struct fake_cache *cache, const uint8_t flags, const uint32_t prefix,
+			  const uint8_t prefix_len, const uint8_t max_prefix_len, const uint32_t asn)
+{
+	uint8_t pdu[20] = {RTR_PROTOCOL_VERSION_1, 4, 0, 0, 0, 0, 0, 20, flags, prefix_len, max_prefix_len, 0};
+	const uint32_t prefix_n = htonl(prefix);
+	const uint32_t asn_n = htonl(asn);
+
+	memcpy(pdu + 12, &prefix_n, sizeof(prefix_n));
+	memcpy(pdu + 16, &asn_n, sizeof(asn_n));
+	fake_cache_write_full(cache->fd, pdu, sizeof(pdu));
+}
+
+void fake_cache_send_router_key(struct fake_cache *cache, const uint8_t flags, const uint8_t *ski, const uint32_t asn,
+				const uint8_t *spki)
+{
+	uint8_t pdu[8 + SKI_SIZE + 4 + SPKI_SIZE] = {RTR_PROTOCOL_VERSION_1, 9, flags};
+	const uint32_t pdu_len = htonl(sizeof(pdu));
+	const uint32_t asn_n = htonl(asn);
+
+	memcpy(pdu + 4, &pdu_len, sizeof(pdu_len));
+	memcpy(pdu + 8, ski, SKI_SIZE);
+	memcpy(pdu + 8 + SKI_SIZE, &asn_n, sizeof(asn_n));
+	memcpy(pdu + 12 + SKI_SIZE, spki, SPKI_SIZE);
+	fake_cache_write_full(cache->fd, pdu, sizeof(pdu));
+}
+
+void fake_cache_send_eod(struct fake_cache *cache, const uint16_t session_id, const uint32_t serial)
+{
+	uint8_t eod[24] = {RTR_PROTOCOL_VERSION_1, 7};
+	const uint16_t session_id_n = htons(session_id);
+	const uint32_t eod_fields[5] = {htonl(sizeof(eod)), htonl(serial), htonl(3600), htonl(600), htonl(7200)};
+
+	memcpy(eod + 2, &session_id_n, sizeof(session_id_n));
+	memcpy(eod + 4, eod_fields, sizeof(eod_fields));
+	fake_cache_write_full(cache->fd, eod, sizeof(eod));
+}
+
+void fake_cache_send_reset(struct fake_cache *cache)
+{
+	const uint8_t reset[8] = {RTR_PROTOCOL_VERSION_1, 8, 0, 0, 0, 0, 0, 8};
+
+	fake_cache_write_full(cache->fd, reset, sizeof(reset));
+}
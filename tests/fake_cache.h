@@ -0,0 +1,86 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#ifndef RTR_TESTS_FAKE_CACHE_H
+#define RTR_TESTS_FAKE_CACHE_H
+
+#include "rtrlib/rtrlib.h"
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief An RTR cache on a loopback port whose PDUs are written by the test.
+ * @param listen_fd Listening socket
+ * @param fd Connection accepted by fake_cache_accept(), -1 if there is none
+ * @param client_fd Socket that fake_cache_connect() created last, -1 if there is none
+ * @param addr Address of listen_fd
+ * @param data Test specific data
+ */
+struct fake_cache {
+	int listen_fd;
+	int fd;
+	int client_fd;
+	struct sockaddr_in addr;
+	void *data;
+};
+
+/**
+ * @brief Binds the cache to a free loopback port and listens on it.
+ */
+void fake_cache_listen(struct fake_cache *cache);
+
+/**
+ * @brief Closes the listening socket and the accepted connection.
+ */
+void fake_cache_close(struct fake_cache *cache);
+
+/**
+ * @brief Sets up a TCP transport config that connects to the cache.
+ */
+void fake_cache_tcp_config(struct fake_cache *cache, struct tr_tcp_config *config);
+
+/**
+ * @brief Connects a transport to the cache, used as new_socket() callback.
+ * @param[in] data The fake_cache.
+ * @return The connected socket.
+ */
+int fake_cache_connect(void *data);
+
+/**
+ * @brief Accepts the next connection, a previous connection is closed.
+ */
+void fake_cache_accept(struct fake_cache *cache);
+
+void fake_cache_read_full(int fd, uint8_t *buf, size_t len);
+
+void fake_cache_write_full(int fd, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Reads the next query of the client.
+ * @return The PDU type of the query.
+ */
+uint8_t fake_cache_read_query(struct fake_cache *cache);
+
+void fake_cache_send_serial_notify(struct fake_cache *cache, const uint16_t session_id, const uint32_t serial);
+
+void fake_cache_send_response(struct fake_cache *cache, const uint16_t session_id);
+
+void fake_cache_send_ipv4(struct fake_cache *cache, const uint8_t flags, const uint32_t prefix,
+			  const uint8_t prefix_len, const uint8_t max_prefix_len, const uint32_t asn);
+
+void fake_cache_send_router_key(struct fake_cache *cache, const uint8_t flags, const uint8_t *ski, const uint32_t asn,
+				const uint8_t *spki);
+
+void fake_cache_send_eod(struct fake_cache *cache, const uint16_t session_id, const uint32_t serial);
+
+void fake_cache_send_reset(struct fake_cache *cache);
+
+#endif
@@ -1,15 +1,27 @@
+#include "fake_cache.h"
+
 #include "rtrlib/bgpsec/bgpsec.h"
+#include "rtrlib/bgpsec/bgpsec_key_cache_private.h"
 #include "rtrlib/bgpsec/bgpsec_private.h"
+#include "rtrlib/bgpsec/bgpsec_sha256_private.h"
 #include "rtrlib/bgpsec/bgpsec_utils_private.h"
+#include "rtrlib/pfx/pfx_private.h"
 #include "rtrlib/rtr_mgr.h"
 #include "rtrlib/rtrlib.h"
 #include "rtrlib/spki/hashtable/ht-spkitable_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/sha.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* Below are the SKIs, signatures, public keys and the private key that
  * are required to build a valid BGPsec path of length two. They all are
@@ -210,6 +222,165 @@ static void validate_bgpsec_path_test(void)
 	rtr_mgr_bgpsec_free(bgpsec);
 }
 
+/* Test function for the router key cache. The same path is validated until
+ * the keys are hot and the precomputed tables are used.
+ */
+static void key_cache_test(void)
+{
+	struct rtr_bgpsec *bgpsec = NULL;
+	struct rtr_bgpsec_nlri *pfx = NULL;
+	int pfx_int = 0;
+	struct spki_table table;
+	struct spki_record *record1;
+	struct spki_record *record2;
+	enum rtr_bgpsec_rtvals result;
+
+	pfx = rtr_mgr_bgpsec_nlri_new(3);
+	pfx->nlri_len = 24;
+	pfx->afi = 1; /* LRTR_IPV4 */
+	pfx_int = htonl(3221225984); /* 192.0.2.0 */
+	memcpy(pfx->nlri, &pfx_int, 3);
+
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 65537, 65537, pfx);
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 64496));
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 65536));
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski2, 72, sig2)) ==
+	       RTR_BGPSEC_SUCCESS);
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski1, 72, sig1)) ==
+	       RTR_BGPSEC_SUCCESS);
+
+	spki_table_init(&table, NULL);
+	record1 = create_record(65536, ski1, spki1);
+	record2 = create_record(64496, ski2, spki2);
+	spki_table_add_entry(&table, record1);
+	spki_table_add_entry(&table, record2);
+
+	assert(rtr_bgpsec_set_key_cache_budget(&table, 2 * (BGPSEC_KEY_CACHE_KEY_SIZE + BGPSEC_KEY_CACHE_TABLE_SIZE)) ==
+	       RTR_BGPSEC_SUCCESS);
+
+	/* Validate until both keys are hot */
+	for (int i = 0; i <= BGPSEC_KEY_CACHE_HOT_THRESHOLD; i++) {
+		result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+		assert(result == RTR_BGPSEC_VALID);
+	}
+	assert(bgpsec_key_cache_get_usage(table.key_cache) ==
+	       2 * (BGPSEC_KEY_CACHE_KEY_SIZE + BGPSEC_KEY_CACHE_TABLE_SIZE));
+
+	/* The precomputed tables must detect wrong signatures */
+	memcpy(bgpsec->sigs->next->signature, wrong_sig, sizeof(wrong_sig));
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_NOT_VALID);
+	memcpy(bgpsec->sigs->next->signature, sig2, sizeof(sig2));
+
+	/* A smaller budget evicts keys, validation still works */
+	assert(rtr_bgpsec_set_key_cache_budget(&table, BGPSEC_KEY_CACHE_KEY_SIZE) == RTR_BGPSEC_SUCCESS);
+	assert(bgpsec_key_cache_get_usage(table.key_cache) <= BGPSEC_KEY_CACHE_KEY_SIZE);
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_VALID);
+
+	/* Without a budget the cache is bypassed */
+	assert(rtr_bgpsec_set_key_cache_budget(&table, 0) == RTR_BGPSEC_SUCCESS);
+	assert(bgpsec_key_cache_get_usage(table.key_cache) == 0);
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_VALID);
+	assert(bgpsec_key_cache_get_usage(table.key_cache) == 0);
+	assert(bgpsec_key_cache_get_budget(table.key_cache) == 0);
+
+	spki_table_free(&table);
+	free(record1);
+	free(record2);
+	rtr_mgr_bgpsec_free(bgpsec);
+}
+
+/* Compares the verification of hot keys, which uses the precomputed multiples
+ * of the public key, with ECDSA_do_verify() for random keys, digests and
+ * signatures.
+ */
+static void key_cache_precomp_test(void)
+{
+	uint8_t ski[SKI_SIZE] = {0};
+
+	srand(1);
+	for (int k = 0; k < 4; k++) {
+		const BIGNUM *order;
+		EC_KEY *ec_key;
+		struct bgpsec_key_cache *cache;
+		uint8_t spki[SPKI_SIZE];
+		uint8_t *spki_pos = spki;
+		struct spki_key *key;
+
+		cache = bgpsec_key_cache_new(BGPSEC_KEY_CACHE_KEY_SIZE + BGPSEC_KEY_CACHE_TABLE_SIZE);
+		assert(cache);
+		ec_key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+		order = EC_GROUP_get0_order(EC_KEY_get0_group(ec_key));
+		assert(EC_KEY_generate_key(ec_key) == 1);
+		assert(i2d_EC_PUBKEY(ec_key, &spki_pos) == SPKI_SIZE);
+		ski[0] = k;
+		key = spki_key_intern(ski, spki);
+		assert(key);
+
+		for (int i = 0; i < BGPSEC_KEY_CACHE_HOT_THRESHOLD + 512; i++) {
+			unsigned char hash[SHA256_DIGEST_LENGTH];
+			struct rtr_signature_seg sig = {0};
+			ECDSA_SIG *ecdsa_sig;
+			unsigned char *der = NULL;
+			int der_len;
+			int expected;
+
+			for (unsigned int j = 0; j < sizeof(hash); j++)
+				hash[j] = rand();
+
+			if (i % 4 == 2) {
+				/* random r and s */
+				BIGNUM *r = BN_new();
+				BIGNUM *s = BN_new();
+
+				assert(BN_rand_range(r, order) == 1 && BN_rand_range(s, order) == 1);
+				ecdsa_sig = ECDSA_SIG_new();
+				assert(ECDSA_SIG_set0(ecdsa_sig, r, s) == 1);
+			} else {
+				ecdsa_sig = ECDSA_do_sign(hash, sizeof(hash), ec_key);
+				assert(ecdsa_sig);
+			}
+
+			/* a signature of another digest */
+			if (i % 4 == 1)
+				hash[rand() % sizeof(hash)] ^= 1 << (rand() % 8);
+
+			/* n - s is a valid signature as well */
+			if (i % 4 == 3) {
+				const BIGNUM *r;
+				const BIGNUM *s;
+				BIGNUM *neg_s = BN_new();
+
+				ECDSA_SIG_get0(ecdsa_sig, &r, &s);
+				assert(BN_sub(neg_s, order, s) == 1);
+				assert(ECDSA_SIG_set0(ecdsa_sig, BN_dup(r), neg_s) == 1);
+			}
+
+			der_len = i2d_ECDSA_SIG(ecdsa_sig, &der);
+			assert(der_len > 0);
+			sig.sig_len = der_len;
+			sig.signature = der;
+
+			expected = ECDSA_do_verify(hash, sizeof(hash), ecdsa_sig, ec_key);
+			assert(expected == 0 || expected == 1);
+			assert(bgpsec_key_cache_verify(cache, hash, &sig, key) ==
+			       (expected == 1 ? RTR_BGPSEC_VALID : RTR_BGPSEC_NOT_VALID));
+
+			OPENSSL_free(der);
+			ECDSA_SIG_free(ecdsa_sig);
+		}
+
+		/* the key became hot, so most of the signatures were verified with the precomputed multiples */
+		assert(bgpsec_key_cache_get_usage(cache) == BGPSEC_KEY_CACHE_KEY_SIZE + BGPSEC_KEY_CACHE_TABLE_SIZE);
+
+		bgpsec_key_cache_free(cache);
+		spki_key_release(key);
+		EC_KEY_free(ec_key);
+	}
+}
+
 /* Test function for generating signatures. Since signing does not depend
  * on the SPKI table, all error sources regarding public keys can be
  * disregarded.
@@ -381,6 +552,510 @@ static void originate_and_validate_test(void)
 	rtr_mgr_bgpsec_free(bgpsec);
 }
 
+/* Sign an originated path for several peers at once and validate every
+ * signature against its own target AS.
+ */
+static void generate_signatures_test(void)
+{
+	/* AS(64496)--->AS(65536..65540) */
+	struct rtr_bgpsec *bgpsec = NULL;
+	struct rtr_bgpsec_nlri *pfx = NULL;
+	int pfx_int = 0;
+
+	struct spki_table table;
+	struct spki_record *record1;
+
+	struct rtr_signature_seg *new_sigs[5] = {NULL};
+	struct rtr_secure_path_seg *new_sec = NULL;
+
+	enum rtr_bgpsec_rtvals result;
+
+	uint32_t target_as[5] = {65536, 65537, 65538, 65539, 65540};
+
+	pfx = rtr_mgr_bgpsec_nlri_new(3);
+	pfx->nlri_len = 24;
+	pfx->afi = 1; /* LRTR_IPV4 */
+	pfx_int = htonl(3221225984); /* 192.0.2.0 */
+
+	memcpy(pfx->nlri, &pfx_int, 3);
+
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 64496, 0, pfx);
+
+	new_sec = rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 64496);
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, new_sec);
+
+	spki_table_init(&table, NULL);
+	record1 = create_record(64496, ski2, spki2);
+	spki_table_add_entry(&table, record1);
+
+	result = rtr_mgr_bgpsec_generate_signatures(bgpsec, wrong_private_key, target_as, 5, 2, new_sigs);
+	assert(result == RTR_BGPSEC_LOAD_PRIV_KEY_ERROR);
+	for (unsigned int i = 0; i < 5; i++)
+		assert(!new_sigs[i]);
+
+	/* More targets than threads, every thread signs several targets. */
+	result = rtr_mgr_bgpsec_generate_signatures(bgpsec, private_key, target_as, 5, 3, new_sigs);
+	assert(result == RTR_BGPSEC_SUCCESS);
+
+	for (unsigned int i = 0; i < 5; i++) {
+		assert(new_sigs[i]->sig_len > 0);
+		memcpy(new_sigs[i]->ski, ski2, SKI_SIZE);
+
+		result = rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, new_sigs[i]);
+		assert(result == RTR_BGPSEC_SUCCESS);
+
+		bgpsec->target_as = target_as[i];
+		result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+		assert(result == RTR_BGPSEC_VALID);
+
+		/* The signature is bound to its target AS. */
+		bgpsec->target_as = target_as[(i + 1) % 5];
+		result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+		assert(result == RTR_BGPSEC_NOT_VALID);
+
+		bgpsec->sigs = NULL;
+		bgpsec->sigs_len = 0;
+		rtr_mgr_bgpsec_free_signatures(new_sigs[i]);
+		new_sigs[i] = NULL;
+	}
+
+	/* Signatures must not be allocated yet. */
+	result = rtr_mgr_bgpsec_generate_signatures(bgpsec, private_key, target_as, 1, 0, new_sigs);
+	assert(result == RTR_BGPSEC_SUCCESS);
+	result = rtr_mgr_bgpsec_generate_signatures(bgpsec, private_key, target_as, 1, 0, new_sigs);
+	assert(result == RTR_BGPSEC_INVALID_ARGUMENTS);
+	rtr_mgr_bgpsec_free_signatures(new_sigs[0]);
+
+	/* Free all allocated memory. */
+	spki_table_free(&table);
+	free(record1);
+	rtr_mgr_bgpsec_free(bgpsec);
+}
+
+/* Helper function that decodes the segments of a BGPsec_PATH attribute with
+ * extended length and a single Signature_Block into bgpsec.
+ */
+static void decode_path_attr(const uint8_t *attr, size_t attr_len, struct rtr_bgpsec *bgpsec)
+{
+	size_t path_size = (attr[4] << 8) | attr[5];
+	const uint8_t *sig = attr + 4 + path_size + 3;
+
+	assert(attr[0] == 0x90 && attr[1] == 33);
+	assert((size_t)((attr[2] << 8) | attr[3]) == attr_len - 4);
+	assert((size_t)((attr[4 + path_size] << 8) | attr[5 + path_size]) == attr_len - 4 - path_size);
+	assert(attr[6 + path_size] == bgpsec->alg);
+
+	for (size_t pos = 6; pos < 4 + path_size; pos += 6) {
+		uint32_t asn = (attr[pos + 2] << 24) | (attr[pos + 3] << 16) | (attr[pos + 4] << 8) | attr[pos + 5];
+
+		rtr_mgr_bgpsec_append_sec_path_seg(bgpsec,
+						   rtr_mgr_bgpsec_new_secure_path_seg(attr[pos], attr[pos + 1], asn));
+	}
+
+	while (sig < attr + attr_len) {
+		uint16_t sig_len = (sig[SKI_SIZE] << 8) | sig[SKI_SIZE + 1];
+
+		assert(rtr_mgr_bgpsec_append_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(
+								     (uint8_t *)sig, sig_len,
+								     (uint8_t *)sig + SKI_SIZE + 2)) ==
+		       RTR_BGPSEC_SUCCESS);
+		sig += SKI_SIZE + 2 + sig_len;
+	}
+	assert(sig == attr + attr_len);
+}
+
+/* Build the BGPsec_PATH attribute of a path of two ASes into a buffer and
+ * validate the decoded attribute.
+ */
+static void build_path_test(void)
+{
+	/* AS(64496)--->AS(65536)--->AS(65537) */
+	struct rtr_bgpsec *bgpsec = NULL;
+	struct rtr_bgpsec_nlri *pfx = NULL;
+	int pfx_int = 0;
+
+	struct spki_table table;
+	struct spki_record *record1;
+	struct spki_record *record2;
+
+	struct rtr_secure_path_seg origin_seg = {NULL, 1, 0, 64496};
+	struct rtr_secure_path_seg transit_seg = {NULL, 1, 0, 65536};
+
+	uint8_t originated[256];
+	uint8_t attr[512];
+	size_t originated_len = 0;
+	size_t attr_len = 0;
+
+	enum rtr_bgpsec_rtvals result;
+
+	pfx = rtr_mgr_bgpsec_nlri_new(3);
+	pfx->nlri_len = 24;
+	pfx->afi = 1; /* LRTR_IPV4 */
+	pfx_int = htonl(3221225984); /* 192.0.2.0 */
+
+	memcpy(pfx->nlri, &pfx_int, 3);
+
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 64496, 65536, pfx);
+
+	/* Both ASes use the same router key. */
+	spki_table_init(&table, NULL);
+	record1 = create_record(64496, ski2, spki2);
+	record2 = create_record(65536, ski2, spki2);
+	spki_table_add_entry(&table, record1);
+	spki_table_add_entry(&table, record2);
+
+	/* The buffer must hold a signature of maximum size. */
+	result = rtr_mgr_bgpsec_build_path(bgpsec, NULL, 0, &origin_seg, ski2, private_key, originated, 16,
+					   &originated_len);
+	assert(result == RTR_BGPSEC_BUFFER_TOO_SMALL);
+	assert(originated_len > 16 && originated_len <= sizeof(originated));
+
+	result = rtr_mgr_bgpsec_build_path(bgpsec, NULL, 0, &origin_seg, ski2, wrong_private_key, originated,
+					   sizeof(originated), &originated_len);
+	assert(result == RTR_BGPSEC_LOAD_PRIV_KEY_ERROR);
+
+	result = rtr_mgr_bgpsec_build_path(bgpsec, NULL, 0, &origin_seg, ski2, private_key, originated,
+					   sizeof(originated), &originated_len);
+	assert(result == RTR_BGPSEC_SUCCESS);
+
+	decode_path_attr(originated, originated_len, bgpsec);
+	assert(bgpsec->path_len == 1 && bgpsec->sigs_len == 1);
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_VALID);
+
+	/* AS 65536 signs the received attribute for AS 65537. */
+	rtr_mgr_bgpsec_free(bgpsec);
+	pfx = rtr_mgr_bgpsec_nlri_new(3);
+	pfx->nlri_len = 24;
+	pfx->afi = 1; /* LRTR_IPV4 */
+	memcpy(pfx->nlri, &pfx_int, 3);
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 65536, 65537, pfx);
+
+	result = rtr_mgr_bgpsec_build_path(bgpsec, originated, originated_len, &transit_seg, ski2, private_key, attr,
+					   sizeof(attr), &attr_len);
+	assert(result == RTR_BGPSEC_SUCCESS);
+
+	/* The received segments are copied behind the new ones. */
+	assert(memcmp(attr + 4 + 2 + 6, originated + 4 + 2, 6) == 0);
+	assert(memcmp(attr + attr_len - (originated_len - 4 - 8 - 3), originated + 4 + 8 + 3,
+		      originated_len - 4 - 8 - 3) == 0);
+
+	decode_path_attr(attr, attr_len, bgpsec);
+	assert(bgpsec->path_len == 2 && bgpsec->sigs_len == 2);
+	assert(bgpsec->path->asn == 65536 && bgpsec->path->next->asn == 64496);
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_VALID);
+
+	/* The signature is bound to its target AS. */
+	bgpsec->target_as = 65538;
+	result = rtr_bgpsec_validate_as_path(bgpsec, &table);
+	assert(result == RTR_BGPSEC_NOT_VALID);
+
+	/* Truncated attributes are rejected. */
+	result = rtr_mgr_bgpsec_build_path(bgpsec, originated, originated_len - 1, &transit_seg, ski2, private_key,
+					   attr, sizeof(attr), &attr_len);
+	assert(result == RTR_BGPSEC_INVALID_ARGUMENTS);
+
+	/* Free all allocated memory. */
+	spki_table_free(&table);
+	free(record1);
+	free(record2);
+	rtr_mgr_bgpsec_free(bgpsec);
+}
+
+static unsigned int aspa_calls;
+
+/* Accepts the AS_PATH of the routes of validate_route_test(), used as rtr_mgr_aspa_fp */
+static enum rtr_mgr_aspa_state verify_aspa(const uint32_t *as_path, const unsigned int as_path_len, void *data)
+{
+	assert(data == &aspa_calls);
+	assert(as_path_len == 2 && as_path[0] == 65536 && as_path[1] == 64496);
+	aspa_calls++;
+	return RTR_MGR_ASPA_VALID;
+}
+
+struct route_validation {
+	struct rtr_mgr_config *config;
+	struct rtr_mgr_route *route;
+	struct rtr_mgr_route_result result;
+	bool done;
+};
+
+static void *validate_route_thread(void *arg)
+{
+	struct route_validation *validation = arg;
+
+	assert(rtr_mgr_validate_route(validation->config, validation->route, &validation->result) == RTR_SUCCESS);
+	__atomic_store_n(&validation->done, true, __ATOMIC_SEQ_CST);
+	return NULL;
+}
+
+/* Test function for the validation of a route in one call. The
+ * BGPsec_PATH and the AS_PATH are not verified for an invalid origin
+ * and an update of the tables is seen completely or not at all.
+ */
+static void validate_route_test(void)
+{
+	struct rtr_bgpsec *bgpsec = NULL;
+	struct rtr_bgpsec_nlri *nlri = NULL;
+	int pfx_int = 0;
+	const uint32_t as_path[] = {65536, 64496};
+	struct spki_table table;
+	struct pfx_table pfxt;
+	struct rtr_mgr_config config;
+	struct spki_record *record1;
+	struct spki_record *record2;
+	struct pfx_record pfx_record;
+	struct rtr_mgr_route route;
+	struct rtr_mgr_route_result result;
+	struct route_validation validation;
+	pthread_t thread;
+
+	nlri = rtr_mgr_bgpsec_nlri_new(3);
+	nlri->nlri_len = 24;
+	nlri->afi = 1; /* LRTR_IPV4 */
+	pfx_int = htonl(3221225984); /* 192.0.2.0 */
+	memcpy(nlri->nlri, &pfx_int, 3);
+
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 65537, 65537, nlri);
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 64496));
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 65536));
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski2, 72, sig2)) ==
+	       RTR_BGPSEC_SUCCESS);
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski1, 72, sig1)) ==
+	       RTR_BGPSEC_SUCCESS);
+
+	pfx_table_init(&pfxt, NULL);
+	spki_table_init(&table, NULL);
+	memset(&config, 0, sizeof(config));
+	config.pfx_table = &pfxt;
+	config.spki_table = &table;
+
+	memset(&pfx_record, 0, sizeof(pfx_record));
+	pfx_record.asn = 64496;
+	pfx_record.min_len = 24;
+	pfx_record.max_len = 24;
+	assert(lrtr_ip_str_to_addr("192.0.2.0", &pfx_record.prefix) == 0);
+	assert(pfx_table_add(&pfxt, &pfx_record) == PFX_SUCCESS);
+	record1 = create_record(65536, ski1, spki1);
+	record2 = create_record(64496, ski2, spki2);
+	assert(spki_table_add_entry(&table, record1) == SPKI_SUCCESS);
+	assert(spki_table_add_entry(&table, record2) == SPKI_SUCCESS);
+
+	memset(&route, 0, sizeof(route));
+	route.prefix = pfx_record.prefix;
+	route.mask_len = 24;
+	route.origin_asn = 64496;
+	route.as_path = as_path;
+	route.as_path_len = 2;
+	route.aspa_fp = verify_aspa;
+	route.aspa_data = &aspa_calls;
+	route.bgpsec = bgpsec;
+
+	/* All verdicts of a valid route */
+	assert(rtr_mgr_validate_route(&config, &route, &result) == RTR_SUCCESS);
+	assert(result.origin == BGP_PFXV_STATE_VALID);
+	assert(result.bgpsec == RTR_BGPSEC_VALID);
+	assert(result.aspa == RTR_MGR_ASPA_VALID);
+	assert(aspa_calls == 1);
+
+	/* The wrong signature is not verified for an invalid origin */
+	memcpy(bgpsec->sigs->next->signature, wrong_sig, sizeof(wrong_sig));
+	route.origin_asn = 64497;
+	assert(rtr_mgr_validate_route(&config, &route, &result) == RTR_SUCCESS);
+	assert(result.origin == BGP_PFXV_STATE_INVALID);
+	assert(result.bgpsec == RTR_BGPSEC_SUCCESS);
+	assert(result.aspa == RTR_MGR_ASPA_NOT_CHECKED);
+	assert(aspa_calls == 1);
+
+	route.flags = RTR_MGR_ROUTE_VERIFY_INVALID;
+	assert(rtr_mgr_validate_route(&config, &route, &result) == RTR_SUCCESS);
+	assert(result.origin == BGP_PFXV_STATE_INVALID);
+	assert(result.bgpsec == RTR_BGPSEC_NOT_VALID);
+	assert(result.aspa == RTR_MGR_ASPA_VALID);
+	assert(aspa_calls == 2);
+	memcpy(bgpsec->sigs->next->signature, sig2, sizeof(sig2));
+
+	/* Routes without a BGPsec_PATH or AS_PATH are only validated by their origin */
+	route.origin_asn = 64496;
+	route.flags = 0;
+	route.bgpsec = NULL;
+	route.aspa_fp = NULL;
+	assert(rtr_mgr_validate_route(&config, &route, &result) == RTR_SUCCESS);
+	assert(result.origin == BGP_PFXV_STATE_VALID);
+	assert(result.bgpsec == RTR_BGPSEC_SUCCESS);
+	assert(result.aspa == RTR_MGR_ASPA_NOT_CHECKED);
+	route.bgpsec = bgpsec;
+	route.aspa_fp = verify_aspa;
+
+	/* A validation waits for an update of both tables that is in progress */
+	memset(&validation, 0, sizeof(validation));
+	validation.config = &config;
+	validation.route = &route;
+	pfx_table_sync_begin(&pfxt);
+	assert(pthread_create(&thread, NULL, validate_route_thread, &validation) == 0);
+	assert(pfx_table_remove(&pfxt, &pfx_record) == PFX_SUCCESS);
+	usleep(100 * 1000);
+	assert(!__atomic_load_n(&validation.done, __ATOMIC_SEQ_CST));
+	assert(spki_table_remove_entry(&table, record2) == SPKI_SUCCESS);
+	pfx_table_sync_end(&pfxt);
+	assert(pthread_join(thread, NULL) == 0);
+	assert(validation.result.origin == BGP_PFXV_STATE_NOT_FOUND);
+	assert(validation.result.bgpsec == RTR_BGPSEC_ROUTER_KEY_NOT_FOUND);
+	assert(validation.result.aspa == RTR_MGR_ASPA_VALID);
+
+	pfx_table_free(&pfxt);
+	spki_table_free(&table);
+	free(record1);
+	free(record2);
+	rtr_mgr_bgpsec_free(bgpsec);
+}
+
+#define SYNC_SESSION_ID 7
+/* odd, so the records are announced by the last serial */
+#define SYNC_SERIALS 201
+
+struct sync_validation {
+	struct rtr_mgr_config *config;
+	struct rtr_mgr_route *route;
+	bool stop;
+	unsigned int seen_valid;
+	unsigned int seen_not_found;
+};
+
+/* Sends the prefix and both router keys of the route */
+static void send_route_records(struct fake_cache *cache, const uint8_t flags)
+{
+	fake_cache_send_ipv4(cache, flags, 0xC0000200, 24, 24, 64496); /* 192.0.2.0/24 */
+	fake_cache_send_router_key(cache, flags, ski1, 65536, spki1);
+	fake_cache_send_router_key(cache, flags, ski2, 64496, spki2);
+}
+
+/* Announces the records of the route with the reset and withdraws and announces them again with every serial */
+static void *run_sync_cache(void *arg)
+{
+	struct fake_cache *cache = arg;
+
+	fake_cache_accept(cache);
+	assert(fake_cache_read_query(cache) == 2);
+	fake_cache_send_response(cache, SYNC_SESSION_ID);
+	send_route_records(cache, 1);
+	fake_cache_send_eod(cache, SYNC_SESSION_ID, 1);
+
+	for (uint32_t serial = 2; serial <= SYNC_SERIALS; serial++) {
+		fake_cache_send_serial_notify(cache, SYNC_SESSION_ID, serial);
+		assert(fake_cache_read_query(cache) == 1);
+		fake_cache_send_response(cache, SYNC_SESSION_ID);
+		send_route_records(cache, serial % 2);
+		fake_cache_send_eod(cache, SYNC_SESSION_ID, serial);
+	}
+	return NULL;
+}
+
+/* Validates the route until it is stopped, the origin and the router keys must come from the same state */
+static void *validate_during_sync_thread(void *arg)
+{
+	struct sync_validation *validation = arg;
+	struct rtr_mgr_route_result result;
+
+	while (!__atomic_load_n(&validation->stop, __ATOMIC_SEQ_CST)) {
+		assert(rtr_mgr_validate_route(validation->config, validation->route, &result) == RTR_SUCCESS);
+		if (result.origin == BGP_PFXV_STATE_VALID) {
+			assert(result.bgpsec == RTR_BGPSEC_VALID);
+			validation->seen_valid++;
+		} else {
+			assert(result.origin == BGP_PFXV_STATE_NOT_FOUND);
+			assert(result.bgpsec == RTR_BGPSEC_ROUTER_KEY_NOT_FOUND);
+			validation->seen_not_found++;
+		}
+	}
+	return NULL;
+}
+
+/* Test function for routes that are validated while a socket
+ * synchronises with a cache and while the manager removes the records
+ * of the stopped socket.
+ */
+static void sync_validate_route_test(void)
+{
+	struct rtr_bgpsec *bgpsec = NULL;
+	struct rtr_bgpsec_nlri *nlri = NULL;
+	int pfx_int = 0;
+	struct fake_cache cache;
+	pthread_t cache_thread;
+	pthread_t validator;
+	struct tr_tcp_config tcp_config;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1] = {&rtr_tcp};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+	struct rtr_socket_metrics metrics;
+	struct rtr_mgr_route route;
+	struct rtr_mgr_route_result result;
+	struct sync_validation validation;
+
+	nlri = rtr_mgr_bgpsec_nlri_new(3);
+	nlri->nlri_len = 24;
+	nlri->afi = 1; /* LRTR_IPV4 */
+	pfx_int = htonl(3221225984); /* 192.0.2.0 */
+	memcpy(nlri->nlri, &pfx_int, 3);
+
+	bgpsec = rtr_mgr_bgpsec_new(1, 1, 1, 65537, 65537, nlri);
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 64496));
+	rtr_mgr_bgpsec_prepend_sec_path_seg(bgpsec, rtr_mgr_bgpsec_new_secure_path_seg(1, 0, 65536));
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski2, 72, sig2)) ==
+	       RTR_BGPSEC_SUCCESS);
+	assert(rtr_mgr_bgpsec_prepend_sig_seg(bgpsec, rtr_mgr_bgpsec_new_signature_seg(ski1, 72, sig1)) ==
+	       RTR_BGPSEC_SUCCESS);
+
+	memset(&route, 0, sizeof(route));
+	assert(lrtr_ip_str_to_addr("192.0.2.0", &route.prefix) == 0);
+	route.mask_len = 24;
+	route.origin_asn = 64496;
+	route.bgpsec = bgpsec;
+
+	fake_cache_listen(&cache);
+	assert(pthread_create(&cache_thread, NULL, run_sync_cache, &cache) == 0);
+	fake_cache_tcp_config(&cache, &tcp_config);
+	assert(tr_tcp_init(&tcp_config, &tr_tcp) == TR_SUCCESS);
+	rtr_tcp.tr_socket = &tr_tcp;
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 1;
+	groups[0].preference = 1;
+	assert(rtr_mgr_init(&conf, groups, 1, 3600, 7200, 600, NULL, NULL, NULL, NULL) == RTR_SUCCESS);
+
+	memset(&validation, 0, sizeof(validation));
+	validation.config = conf;
+	validation.route = &route;
+	assert(pthread_create(&validator, NULL, validate_during_sync_thread, &validation) == 0);
+
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+	assert(pthread_join(cache_thread, NULL) == 0);
+	for (unsigned int i = 0; i < 100; i++) {
+		rtr_get_metrics(&rtr_tcp, &metrics);
+		if (metrics.syncs == SYNC_SERIALS)
+			break;
+		usleep(100 * 1000);
+	}
+	assert(metrics.syncs == SYNC_SERIALS);
+
+	/* The manager removes the prefix and the router keys of the stopped socket in one update */
+	rtr_mgr_stop(conf);
+	__atomic_store_n(&validation.stop, true, __ATOMIC_SEQ_CST);
+	assert(pthread_join(validator, NULL) == 0);
+	assert(validation.seen_valid > 0);
+	assert(validation.seen_not_found > 0);
+
+	assert(rtr_mgr_validate_route(conf, &route, &result) == RTR_SUCCESS);
+	assert(result.origin == BGP_PFXV_STATE_NOT_FOUND);
+	assert(result.bgpsec == RTR_BGPSEC_ROUTER_KEY_NOT_FOUND);
+
+	rtr_mgr_free(conf);
+	fake_cache_close(&cache);
+	rtr_mgr_bgpsec_free(bgpsec);
+}
+
 /* Test function for version and algorithm suites. Basic tests to
  * cover the rest of the public API.
  */
@@ -405,12 +1080,53 @@ static void bgpsec_version_and_algorithms_test(void)
 		assert(suites[i] == 1);
 }
 
+/* Compares the multi-buffer SHA-256 kernel with OpenSSL for all padding
+ * cases and for groups that fill the lanes partially and completely.
+ */
+static void sha256_lanes_test(void)
+{
+	uint8_t bytes[300];
+	const uint8_t *msgs[20];
+	size_t lens[20];
+	unsigned char digests[20 * SHA256_DIGEST_LENGTH];
+	unsigned char expected[SHA256_DIGEST_LENGTH];
+
+	for (unsigned int i = 0; i < sizeof(bytes); i++)
+		bytes[i] = i * 7 + 3;
+
+	for (unsigned int len = 0; len < sizeof(bytes) - 20; len++) {
+		for (unsigned int i = 0; i < 20; i++) {
+			msgs[i] = bytes + i;
+			lens[i] = (len + 13 * i) % (sizeof(bytes) - 20);
+		}
+
+		bgpsec_sha256_lanes(msgs, lens, 1 + len % 20, digests);
+		for (unsigned int i = 0; i < 1 + len % 20; i++) {
+			SHA256(msgs[i], lens[i], expected);
+			assert(memcmp(&digests[i * SHA256_DIGEST_LENGTH], expected, SHA256_DIGEST_LENGTH) == 0);
+		}
+
+		bgpsec_sha256_multi(msgs, lens, 20, digests);
+		for (unsigned int i = 0; i < 20; i++) {
+			SHA256(msgs[i], lens[i], expected);
+			assert(memcmp(&digests[i * SHA256_DIGEST_LENGTH], expected, SHA256_DIGEST_LENGTH) == 0);
+		}
+	}
+}
+
 int main(void)
 {
 	validate_bgpsec_path_test();
+	key_cache_test();
+	key_cache_precomp_test();
 	generate_signature_test();
 	originate_and_validate_test();
+	generate_signatures_test();
+	build_path_test();
+	validate_route_test();
+	sync_validate_route_test();
 	bgpsec_version_and_algorithms_test();
+	sha256_lanes_test();
 	printf("Test Sucessful!\n");
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,212 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "fake_cache.h"
+
+#include "rtrlib/rtrlib.h"
+
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SESSION_ID 42
+
+/* Milliseconds the slow cache needs to answer a Reset Query */
+#define SLOW_CACHE_DELAY 500
+
+/**
+ * @brief Test state of a fake cache.
+ * @param cache The fake cache
+ * @param subnet Third octet of the prefix 10.0.x.0/24 the cache serves besides 10.0.0.0/24
+ * @param delay Milliseconds the cache waits before it answers the first Reset Query
+ * @param abandoned Set if the client disconnected before the cache answered
+ * @param close Set by the test to let the cache close its connection
+ */
+struct cache {
+	struct fake_cache cache;
+	uint32_t subnet;
+	int delay;
+	bool abandoned;
+	bool close;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static void answer_reset(struct cache *cache)
+{
+	fake_cache_send_response(&cache->cache, SESSION_ID);
+	fake_cache_send_ipv4(&cache->cache, 1, 10U << 24, 24, 24, 65000);
+	fake_cache_send_ipv4(&cache->cache, 1, (10U << 24) | (cache->subnet << 8), 24, 24, 65000);
+	fake_cache_send_eod(&cache->cache, SESSION_ID, 1);
+}
+
+static void wait_for_close(struct cache *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	while (!cache->close)
+		pthread_cond_wait(&cache->cond, &cache->mutex);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+static void request_close(struct cache *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	cache->close = true;
+	pthread_cond_signal(&cache->cond);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/*
+ * Answers the first Reset Query after the delay of the cache, unless the client disconnects before. A cache
+ * that was abandoned accepts the next connection and answers right away. The connection is closed once the
+ * test requests it.
+ */
+static void *run_cache(void *arg)
+{
+	struct cache *cache = arg;
+	struct pollfd fds;
+	uint8_t byte;
+	bool abandoned;
+
+	fake_cache_accept(&cache->cache);
+	// the client may be stopped right after it connected, before it sent its Reset Query
+	abandoned = recv(cache->cache.fd, &byte, sizeof(byte), MSG_PEEK) <= 0;
+	if (!abandoned) {
+		assert(fake_cache_read_query(&cache->cache) == 2);
+		fds.fd = cache->cache.fd;
+		fds.events = POLLIN;
+		abandoned = poll(&fds, 1, cache->delay) == 1;
+	}
+	if (abandoned) {
+		__atomic_store_n(&cache->abandoned, true, __ATOMIC_SEQ_CST);
+		fake_cache_accept(&cache->cache);
+		assert(fake_cache_read_query(&cache->cache) == 2);
+	}
+	answer_reset(cache);
+
+	wait_for_close(cache);
+	close(cache->cache.fd);
+	cache->cache.fd = -1;
+	return NULL;
+}
+
+static void start_cache(struct cache *cache, pthread_t *thread, const uint32_t subnet, const int delay)
+{
+	memset(cache, 0, sizeof(*cache));
+	pthread_mutex_init(&cache->mutex, NULL);
+	pthread_cond_init(&cache->cond, NULL);
+	fake_cache_listen(&cache->cache);
+	cache->subnet = subnet;
+	cache->delay = delay;
+	assert(pthread_create(thread, NULL, run_cache, cache) == 0);
+}
+
+static void free_cache(struct cache *cache, pthread_t thread)
+{
+	request_close(cache);
+	assert(pthread_join(thread, NULL) == 0);
+	fake_cache_close(&cache->cache);
+	pthread_mutex_destroy(&cache->mutex);
+	pthread_cond_destroy(&cache->cond);
+}
+
+static enum pfxv_state validate(struct rtr_mgr_config *conf, const uint32_t subnet)
+{
+	struct lrtr_ip_addr addr = {.ver = LRTR_IPV4, .u.addr4.addr = (10U << 24) | (subnet << 8)};
+	enum pfxv_state result;
+
+	assert(rtr_mgr_validate(conf, 65000, &addr, 24, &result) == PFX_SUCCESS);
+	return result;
+}
+
+/* Waits up to ten seconds until only socket is running and the records of its cache are valid */
+static bool wait_for_selection(struct rtr_mgr_config *conf, const struct rtr_socket *socket,
+			       const struct rtr_socket *spare, const uint32_t subnet)
+{
+	for (unsigned int i = 0; i < 100; i++) {
+		if (__atomic_load_n(&socket->state, __ATOMIC_SEQ_CST) == RTR_ESTABLISHED && spare->thread_id == 0 &&
+		    validate(conf, subnet) == BGP_PFXV_STATE_VALID)
+			return true;
+		usleep(100 * 1000);
+	}
+	return false;
+}
+
+/*
+ * @brief The socket whose cache answers first stays connected and stops the
+ * socket of the slow cache. When the connection of the selected socket fails,
+ * the stopped socket is started again and replaces it.
+ */
+static void test_first_synced_selection(void)
+{
+	struct cache fast;
+	struct cache slow;
+	pthread_t fast_thread;
+	pthread_t slow_thread;
+	struct tr_tcp_config tcp_configs[2];
+	struct tr_socket tr_tcps[2];
+	struct rtr_socket rtr_tcps[2];
+	struct rtr_socket *sockets[2] = {&rtr_tcps[0], &rtr_tcps[1]};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+	struct rtr_socket_metrics metrics;
+
+	start_cache(&fast, &fast_thread, 1, 0);
+	start_cache(&slow, &slow_thread, 2, SLOW_CACHE_DELAY);
+
+	fake_cache_tcp_config(&fast.cache, &tcp_configs[0]);
+	fake_cache_tcp_config(&slow.cache, &tcp_configs[1]);
+	for (unsigned int i = 0; i < 2; i++) {
+		assert(tr_tcp_init(&tcp_configs[i], &tr_tcps[i]) == TR_SUCCESS);
+		rtr_tcps[i].tr_socket = &tr_tcps[i];
+	}
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 2;
+	groups[0].preference = 1;
+
+	assert(rtr_mgr_init(&conf, groups, 1, 3600, 7200, 600, NULL, NULL, NULL, NULL) == RTR_SUCCESS);
+	assert(rtr_mgr_set_selection(conf, RTR_MGR_SELECT_FIRST_SYNCED) == RTR_SUCCESS);
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+
+	// the socket of the slow cache is stopped before its cache answers
+	assert(wait_for_selection(conf, &rtr_tcps[0], &rtr_tcps[1], 1));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, 2) == BGP_PFXV_STATE_NOT_FOUND);
+	for (unsigned int i = 0; i < 100 && !__atomic_load_n(&slow.abandoned, __ATOMIC_SEQ_CST); i++)
+		usleep(100 * 1000);
+	assert(__atomic_load_n(&slow.abandoned, __ATOMIC_SEQ_CST));
+	rtr_get_metrics(&rtr_tcps[0], &metrics);
+	assert(metrics.syncs == 1);
+	assert(metrics.sync_time < SLOW_CACHE_DELAY);
+
+	// the spare takes over and stops the failed socket, which waits for the retry interval
+	request_close(&fast);
+	assert(wait_for_selection(conf, &rtr_tcps[1], &rtr_tcps[0], 2));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, 1) == BGP_PFXV_STATE_NOT_FOUND);
+	assert(rtr_mgr_conf_in_sync(conf));
+
+	rtr_mgr_stop(conf);
+	rtr_mgr_free(conf);
+	free_cache(&fast, fast_thread);
+	free_cache(&slow, slow_thread);
+}
+
+int main(void)
+{
+	test_first_synced_selection();
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
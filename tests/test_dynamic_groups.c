@@ -34,6 +34,10 @@ int main(void)
 		NULL, //data
 		NULL, //new_socket()
 		0, // connect timeout
+		0, // keepalive idle time
+		0, // keepalive interval
+		0, // keepalive probes
+		0, // user timeout
 	};
 	struct rtr_socket rtr_tcp;
 	struct rtr_mgr_group groups[1];
@@ -0,0 +1,229 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "rtrlib/lib/executor_private.h"
+#include "rtrlib/pfx/pfx_private.h"
+#include "rtrlib/rtrlib.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAN_OUT 4
+
+struct sum_task {
+	unsigned int depth;
+	unsigned int *sum;
+};
+
+static void add_one(void *arg)
+{
+	__atomic_add_fetch((unsigned int *)arg, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Adds one for every leaf of a tree of tasks, every inner task waits for its children */
+static void sum_leaves(void *arg)
+{
+	struct sum_task *task = arg;
+	struct sum_task children[FAN_OUT];
+	struct lrtr_wait_group group;
+
+	if (task->depth == 0) {
+		add_one(task->sum);
+		return;
+	}
+
+	lrtr_wait_group_init(&group);
+	for (unsigned int i = 0; i < FAN_OUT; i++) {
+		children[i].depth = task->depth - 1;
+		children[i].sum = task->sum;
+		lrtr_executor_submit(&group, sum_leaves, &children[i]);
+	}
+	lrtr_wait_group_wait(&group);
+	lrtr_wait_group_destroy(&group);
+}
+
+struct thread_task {
+	lrtr_task_fp task;
+	void *arg;
+};
+
+static unsigned int submitted;
+
+static void *run_thread_task(void *arg)
+{
+	struct thread_task task = *(struct thread_task *)arg;
+
+	free(arg);
+	task.task(task.arg);
+	return NULL;
+}
+
+/* Runs every task in a new thread, like an application that grows its pool on demand */
+static int submit_thread(void *data __attribute__((unused)), lrtr_task_fp task, void *arg)
+{
+	struct thread_task *thread_task = malloc(sizeof(*thread_task));
+	pthread_attr_t attr;
+	pthread_t thread;
+	int rtval;
+
+	assert(thread_task);
+	thread_task->task = task;
+	thread_task->arg = arg;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rtval = pthread_create(&thread, &attr, run_thread_task, thread_task);
+	pthread_attr_destroy(&attr);
+	if (rtval != 0) {
+		free(thread_task);
+		return -1;
+	}
+	__atomic_add_fetch(&submitted, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+/* Refuses every task, so they are run by the submitting thread */
+static int submit_refuse(void *data, lrtr_task_fp task __attribute__((unused)), void *arg __attribute__((unused)))
+{
+	__atomic_add_fetch((unsigned int *)data, 1, __ATOMIC_SEQ_CST);
+	return -1;
+}
+
+/* Fills a table with enough trie nodes to be traversed in parallel */
+static void fill_table(struct pfx_table *pfxt)
+{
+	for (uint32_t i = 0; i < 100000; i++) {
+		struct pfx_record record;
+
+		memset(&record, 0, sizeof(record));
+		record.asn = i % 7;
+		record.min_len = 24;
+		record.max_len = 24 + i % 4;
+		record.prefix.ver = LRTR_IPV4;
+		record.prefix.u.addr4.addr = i << 8;
+		assert(pfx_table_add(pfxt, &record) == PFX_SUCCESS);
+	}
+}
+
+static void assert_records(struct pfx_table *pfxt)
+{
+	struct pfx_record *records = NULL;
+	unsigned int records_len = 0;
+
+	assert(pfx_table_get_records(pfxt, LRTR_IPV4, &records, &records_len) == PFX_SUCCESS);
+	assert(records_len == 100000);
+	for (unsigned int i = 0; i < records_len; i++)
+		assert(records[i].asn == (records[i].prefix.u.addr4.addr >> 8) % 7);
+	free(records);
+}
+
+/*
+ * @brief Runs independent and nested tasks on the built-in thread pool.
+ */
+static void test_builtin_pool(void)
+{
+	struct lrtr_wait_group group;
+	struct sum_task root = {4, NULL};
+	unsigned int sum = 0;
+
+	assert(lrtr_executor_parallelism() >= 1);
+
+	lrtr_wait_group_init(&group);
+	for (unsigned int i = 0; i < 1000; i++)
+		lrtr_executor_submit(&group, add_one, &sum);
+	lrtr_wait_group_wait(&group);
+	assert(sum == 1000);
+
+	// inner tasks wait for their children, the threads that wait run them if the pool is busy
+	sum = 0;
+	root.sum = &sum;
+	lrtr_executor_submit(&group, sum_leaves, &root);
+	lrtr_wait_group_wait(&group);
+	lrtr_wait_group_destroy(&group);
+	assert(sum == FAN_OUT * FAN_OUT * FAN_OUT * FAN_OUT);
+}
+
+/*
+ * @brief Installs an executor of the application and checks that the
+ * traversal and the frozen index schedule their tasks through it.
+ */
+static void test_application_executor(void)
+{
+	struct lrtr_executor executor = {submit_thread, NULL, 4};
+	struct pfx_table pfxt;
+	struct sum_task root = {3, NULL};
+	struct lrtr_wait_group group;
+	unsigned int sum = 0;
+
+	lrtr_set_executor(&executor);
+	assert(lrtr_executor_parallelism() == 4);
+
+	pfx_table_init(&pfxt, NULL);
+	// the tasks that are counted are submitted by the trie storage
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	assert(pfx_table_enable_frozen_index(&pfxt) == PFX_SUCCESS);
+	fill_table(&pfxt);
+
+	assert_records(&pfxt);
+	// the calling thread is one of the workers
+	assert(__atomic_load_n(&submitted, __ATOMIC_SEQ_CST) == 3);
+
+	pfx_table_frozen_refresh(&pfxt, 100000);
+	pfx_table_free(&pfxt);
+	assert(__atomic_load_n(&submitted, __ATOMIC_SEQ_CST) == 4);
+
+	root.sum = &sum;
+	lrtr_wait_group_init(&group);
+	lrtr_executor_submit(&group, sum_leaves, &root);
+	lrtr_wait_group_wait(&group);
+	lrtr_wait_group_destroy(&group);
+	assert(sum == FAN_OUT * FAN_OUT * FAN_OUT);
+
+	lrtr_set_executor(NULL);
+}
+
+/*
+ * @brief Operations are run by the calling thread if the executor refuses
+ * their tasks or allows no parallelism.
+ */
+static void test_refusing_executor(void)
+{
+	unsigned int refused = 0;
+	struct lrtr_executor executor = {submit_refuse, &refused, 8};
+	struct pfx_table pfxt;
+
+	lrtr_set_executor(&executor);
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	fill_table(&pfxt);
+	assert_records(&pfxt);
+	assert(refused == 7);
+
+	// without parallelism, no task is submitted at all
+	executor.parallelism = 1;
+	lrtr_set_executor(&executor);
+	assert(lrtr_executor_parallelism() == 1);
+	assert_records(&pfxt);
+	assert(refused == 7);
+
+	pfx_table_free(&pfxt);
+	lrtr_set_executor(NULL);
+}
+
+int main(void)
+{
+	test_builtin_pool();
+	test_application_executor();
+	test_refusing_executor();
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
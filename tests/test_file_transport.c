@@ -0,0 +1,307 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "rtrlib/lib/utils_private.h"
+#include "rtrlib/rtrlib.h"
+#include "rtrlib/spki/hashtable/ht-spkitable_private.h"
+#include "rtrlib/transport/transport_private.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SPKI_BASE64                                                                                     \
+	"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+P0BBQkNERUZH" \
+	"SElKS0xNTk9QUVJTVFVWV1hZWg=="
+
+static unsigned int pfx_added;
+static unsigned int pfx_removed;
+
+static void update_cb(struct pfx_table *pfx_table __attribute__((unused)),
+		      const struct pfx_record record __attribute__((unused)), const bool added)
+{
+	if (added)
+		__atomic_add_fetch(&pfx_added, 1, __ATOMIC_SEQ_CST);
+	else
+		__atomic_add_fetch(&pfx_removed, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Replaces the file atomically, like relying party software does */
+static void write_file(const char *dir, const char *path, const char *content)
+{
+	char tmp_path[256];
+	FILE *file;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s/tmp", dir);
+	file = fopen(tmp_path, "w");
+	assert(file);
+	assert(fputs(content, file) >= 0);
+	assert(fclose(file) == 0);
+	assert(rename(tmp_path, path) == 0);
+}
+
+static enum pfxv_state validate(struct rtr_mgr_config *conf, const uint32_t asn, const char *prefix,
+				const uint8_t len)
+{
+	struct lrtr_ip_addr addr;
+	enum pfxv_state result;
+
+	assert(lrtr_ip_str_to_addr(prefix, &addr) == 0);
+	assert(rtr_mgr_validate(conf, asn, &addr, len, &result) == PFX_SUCCESS);
+	return result;
+}
+
+/* Waits up to ten seconds until the route has the expected state */
+static bool wait_for_state(struct rtr_mgr_config *conf, const uint32_t asn, const char *prefix, const uint8_t len,
+			   const enum pfxv_state state)
+{
+	for (unsigned int i = 0; i < 100; i++) {
+		if (rtr_mgr_conf_in_sync(conf) && validate(conf, asn, prefix, len) == state)
+			return true;
+		usleep(100 * 1000);
+	}
+	return false;
+}
+
+/*
+ * @brief Syncs an rtr_socket from CSV files, replaces the VRP file by a JSON
+ * file and checks that only the changed records are updated.
+ */
+static void test_file_transport(void)
+{
+	char dir[] = "/tmp/rtrlib_file_XXXXXX";
+	char vrp_path[256];
+	char key_path[256];
+	uint8_t ski[SKI_SIZE];
+	struct spki_record *keys;
+	unsigned int keys_len;
+
+	assert(mkdtemp(dir));
+	snprintf(vrp_path, sizeof(vrp_path), "%s/vrps", dir);
+	snprintf(key_path, sizeof(key_path), "%s/keys.csv", dir);
+
+	write_file(dir, vrp_path,
+		   "ASN,IP Prefix,Max Length,Trust Anchor\n"
+		   "# comment\n"
+		   "AS65000,10.0.0.0/24,24,ta\n"
+		   "AS65001,10.1.0.0/16,24,ta\n"
+		   "\n"
+		   "65002, 2001:db8::/32, 48\n"
+		   "AS65000,10.0.0.0/24,24,duplicate\n");
+	write_file(dir, key_path, "ASN,SKI,SPKI\nAS65003,101112131415161718191A1B1C1D1E1F20212223," SPKI_BASE64 "\n");
+
+	struct tr_file_config file_config = {vrp_path, key_path};
+	struct tr_socket tr_file;
+	struct rtr_socket rtr_file;
+	struct rtr_socket *sockets[1] = {&rtr_file};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+
+	assert(tr_file_init(&file_config, &tr_file) == TR_SUCCESS);
+	rtr_file.tr_socket = &tr_file;
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 1;
+	groups[0].preference = 1;
+
+	assert(rtr_mgr_init(&conf, groups, 1, 30, 600, 600, update_cb, NULL, NULL, NULL) == RTR_SUCCESS);
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+
+	assert(wait_for_state(conf, 65000, "10.0.0.0", 24, BGP_PFXV_STATE_VALID));
+	assert(validate(conf, 65001, "10.1.2.0", 24) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, 65001, "10.1.2.0", 25) == BGP_PFXV_STATE_INVALID);
+	assert(validate(conf, 65002, "2001:db8:1::", 48) == BGP_PFXV_STATE_VALID);
+	assert(__atomic_load_n(&pfx_added, __ATOMIC_SEQ_CST) == 3);
+
+	for (unsigned int i = 0; i < SKI_SIZE; i++)
+		ski[i] = 0x10 + i;
+	assert(rtr_mgr_get_spki(conf, 65003, ski, &keys, &keys_len) == SPKI_SUCCESS);
+	assert(keys_len == 1);
+	for (unsigned int i = 0; i < SPKI_SIZE; i++)
+		assert(keys[0].spki[i] == i);
+	free(keys);
+
+	// one VRP is removed and one added, the others must not be withdrawn and announced again
+	write_file(dir, vrp_path,
+		   "{\"metadata\": {\"roas\": 3}, \"roas\": [\n"
+		   "{\"asn\": \"AS65000\", \"prefix\": \"10.0.0.0/24\", \"maxLength\": 24, \"ta\": \"ta\"},\n"
+		   "{\"asn\": 65002, \"prefix\": \"2001:db8::/32\", \"maxLength\": 48, \"ta\": \"ta\"},\n"
+		   "{\"asn\": 65004, \"prefix\": \"192.168.0.0/16\", \"maxLength\": 24, \"ta\": \"ta\"}\n"
+		   "]}\n");
+	assert(wait_for_state(conf, 65004, "192.168.1.0", 24, BGP_PFXV_STATE_VALID));
+	assert(wait_for_state(conf, 65001, "10.1.2.0", 24, BGP_PFXV_STATE_NOT_FOUND));
+	assert(validate(conf, 65000, "10.0.0.0", 24) == BGP_PFXV_STATE_VALID);
+	assert(__atomic_load_n(&pfx_added, __ATOMIC_SEQ_CST) == 4);
+	assert(__atomic_load_n(&pfx_removed, __ATOMIC_SEQ_CST) == 1);
+
+	// an invalid file is ignored
+	write_file(dir, vrp_path, "AS65000,10.0.0.0/24,24\nAS65001,not a prefix,24\n");
+	sleep(2);
+	assert(validate(conf, 65004, "192.168.1.0", 24) == BGP_PFXV_STATE_VALID);
+	assert(__atomic_load_n(&pfx_added, __ATOMIC_SEQ_CST) == 4);
+	assert(__atomic_load_n(&pfx_removed, __ATOMIC_SEQ_CST) == 1);
+
+	rtr_mgr_stop(conf);
+	rtr_mgr_free(conf);
+
+	unlink(vrp_path);
+	unlink(key_path);
+	rmdir(dir);
+}
+
+/*
+ * @brief Loads the records of the files directly into the tables of a reset,
+ * without a Reset Query and a PDU per record.
+ */
+static void test_bulk_load(void)
+{
+	char dir[] = "/tmp/rtrlib_file_XXXXXX";
+	char vrp_path[256];
+	struct tr_file_config file_config = {vrp_path, NULL};
+	struct tr_socket tr_file;
+	struct rtr_socket rtr_file;
+	struct pfx_table pfx_table;
+	struct spki_table spki_table;
+	struct lrtr_ip_addr addr;
+	enum pfxv_state result;
+	uint16_t session_id;
+	uint32_t serial;
+
+	assert(mkdtemp(dir));
+	snprintf(vrp_path, sizeof(vrp_path), "%s/vrps.csv", dir);
+	write_file(dir, vrp_path, "AS65000,10.0.0.0/24,24\nAS65001,10.1.0.0/16,24\nAS65002,2001:db8::/32,48\n");
+
+	assert(tr_file_init(&file_config, &tr_file) == TR_SUCCESS);
+	assert(tr_file.load_fp);
+	assert(tr_open(&tr_file) == TR_SUCCESS);
+	pfx_table_init(&pfx_table, NULL);
+	spki_table_init(&spki_table, NULL);
+
+	assert(tr_load(&tr_file, &pfx_table, &spki_table, &rtr_file, &session_id, &serial) == 3);
+	assert(serial == 0);
+	assert(lrtr_ip_str_to_addr("10.1.2.0", &addr) == 0);
+	assert(pfx_table_validate(&pfx_table, 65001, &addr, 24, &result) == PFX_SUCCESS);
+	assert(result == BGP_PFXV_STATE_VALID);
+	assert(lrtr_ip_str_to_addr("2001:db8:1::", &addr) == 0);
+	assert(pfx_table_validate(&pfx_table, 65002, &addr, 48, &result) == PFX_SUCCESS);
+	assert(result == BGP_PFXV_STATE_VALID);
+	assert(pfx_table_validate(&pfx_table, 65000, &addr, 48, &result) == PFX_SUCCESS);
+	assert(result == BGP_PFXV_STATE_INVALID);
+
+	// the records are attributed to the rtr_socket
+	assert(pfx_table_src_remove(&pfx_table, &rtr_file) == PFX_SUCCESS);
+	assert(pfx_table_validate(&pfx_table, 65002, &addr, 48, &result) == PFX_SUCCESS);
+	assert(result == BGP_PFXV_STATE_NOT_FOUND);
+	pfx_table_free(&pfx_table);
+
+	// a changed file is loaded with the next serial
+	write_file(dir, vrp_path, "AS65000,10.0.0.0/24,24\n");
+	pfx_table_init(&pfx_table, NULL);
+	assert(tr_load(&tr_file, &pfx_table, &spki_table, &rtr_file, &session_id, &serial) == 1);
+	assert(serial == 1);
+
+	pfx_table_free(&pfx_table);
+	spki_table_free(&spki_table);
+	tr_close(&tr_file);
+	tr_free(&tr_file);
+	unlink(vrp_path);
+	rmdir(dir);
+}
+
+/* Milliseconds since the given monotonic time */
+static uint64_t elapsed_ms(const uint64_t start)
+{
+	uint64_t now;
+
+	assert(lrtr_get_monotonic_time_ms(&now) == 0);
+	return now - start;
+}
+
+/*
+ * @brief Stops a manager whose sockets block in tr_recv, starts it again and
+ * frees it while the sockets are running. Neither may wait for the timeouts.
+ */
+static void test_fast_stop(void)
+{
+	char dir[] = "/tmp/rtrlib_file_XXXXXX";
+	char vrp_path[256];
+	struct tr_file_config file_config = {vrp_path, NULL};
+	struct tr_socket tr_files[2];
+	struct rtr_socket rtr_files[2];
+	struct rtr_socket *sockets[2] = {&rtr_files[0], &rtr_files[1]};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+	uint64_t start;
+
+	assert(mkdtemp(dir));
+	snprintf(vrp_path, sizeof(vrp_path), "%s/vrps.csv", dir);
+	write_file(dir, vrp_path, "AS65000,10.0.0.0/24,24\nAS65001,10.1.0.0/16,24\n");
+
+	for (unsigned int i = 0; i < 2; i++) {
+		assert(tr_file_init(&file_config, &tr_files[i]) == TR_SUCCESS);
+		rtr_files[i].tr_socket = &tr_files[i];
+	}
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 2;
+	groups[0].preference = 1;
+
+	__atomic_store_n(&pfx_added, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&pfx_removed, 0, __ATOMIC_SEQ_CST);
+	assert(rtr_mgr_init(&conf, groups, 1, 3600, 7200, 600, update_cb, NULL, NULL, NULL) == RTR_SUCCESS);
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+	assert(wait_for_state(conf, 65000, "10.0.0.0", 24, BGP_PFXV_STATE_VALID));
+
+	// both sockets wait for a Serial Notify for up to an hour
+	assert(lrtr_get_monotonic_time_ms(&start) == 0);
+	rtr_mgr_stop(conf);
+	assert(elapsed_ms(start) < 1000);
+	assert(validate(conf, 65000, "10.0.0.0", 24) == BGP_PFXV_STATE_NOT_FOUND);
+	// like with rtr_stop(), the records of each socket are reported as removed
+	assert(__atomic_load_n(&pfx_removed, __ATOMIC_SEQ_CST) == 4);
+
+	// the stopped sockets can be started again
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+	assert(wait_for_state(conf, 65001, "10.1.2.0", 24, BGP_PFXV_STATE_VALID));
+
+	assert(lrtr_get_monotonic_time_ms(&start) == 0);
+	rtr_mgr_free(conf);
+	assert(elapsed_ms(start) < 1000);
+
+	unlink(vrp_path);
+	rmdir(dir);
+}
+
+/*
+ * @brief A transport that only sets the function pointers it knows about
+ * after tr_socket_init() must not be interrupted through a stale pointer.
+ */
+static void test_socket_init(void)
+{
+	struct tr_socket sock;
+
+	memset(&sock, 0xff, sizeof(sock));
+	tr_socket_init(&sock);
+	assert(!sock.socket);
+	assert(!sock.open_fp);
+	assert(!sock.interrupt_fp);
+	assert(!sock.load_fp);
+	assert(tr_interrupt(&sock) == TR_ERROR);
+}
+
+int main(void)
+{
+	test_socket_init();
+	test_file_transport();
+	test_bulk_load();
+	test_fast_stop();
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
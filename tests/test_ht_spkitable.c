@@ -9,6 +9,7 @@
 
 #include "rtrlib/rtr/rtr_private.h"
 #include "rtrlib/spki/hashtable/ht-spkitable_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
 
 #include <assert.h>
 #include <stdint.h>
@@ -46,6 +47,25 @@ static bool spki_records_are_equal(struct spki_record *r1, struct spki_record *r
 	return true;
 }
 
+/**
+ * @brief Compare a key handle with a SPKI record
+ *
+ * @return true if the handle refers to the content of record, false otherwise
+ */
+static bool spki_key_ref_matches(struct spki_key_ref *ref, struct spki_record *record)
+{
+	if (ref->asn != record->asn)
+		return false;
+	if (ref->socket != record->socket)
+		return false;
+	if (memcmp(ref->key->ski, record->ski, SKI_SIZE) != 0)
+		return false;
+	if (memcmp(ref->key->spki, record->spki, SPKI_SIZE) != 0)
+		return false;
+
+	return true;
+}
+
 /**
  * @brief Create a SPKI record
  *
@@ -634,6 +654,286 @@ static void test_table_diff(void)
 	printf("%s() complete\n", __func__);
 }
 
+static unsigned int replace_added;
+static unsigned int replace_removed;
+
+static void update_spki_replace(struct spki_table *s __attribute__((unused)), const struct spki_record record,
+				const bool added)
+{
+	/* Only records of the replaced socket are reported */
+	assert(record.socket == (struct rtr_socket *)1);
+	if (added) {
+		assert(record.asn == 3);
+		replace_added++;
+	} else {
+		assert(record.asn == 1);
+		replace_removed++;
+	}
+}
+
+/**
+ * @brief Test of spki_table_src_replace function
+ * The entries of one socket are replaced by the entries of a shadow table.
+ * Only the difference must be notified and entries of other sockets must
+ * not be touched.
+ */
+static void test_table_src_replace(void)
+{
+	struct spki_table table;
+	struct spki_table shadow;
+	struct rtr_socket *socket = (struct rtr_socket *)1;
+	struct rtr_socket *other_socket = (struct rtr_socket *)2;
+	struct spki_record *result;
+	unsigned int result_len;
+
+	struct spki_record *test_record1 = create_record(1, 10, 100, socket);
+	struct spki_record *test_record2 = create_record(2, 20, 200, socket);
+	struct spki_record *test_record3 = create_record(3, 30, 300, socket);
+	struct spki_record *other_record = create_record(1, 10, 100, other_socket);
+
+	spki_table_init(&table, NULL);
+	spki_table_init(&shadow, NULL);
+
+	_spki_table_add_assert(&table, test_record1);
+	_spki_table_add_assert(&table, test_record2);
+	_spki_table_add_assert(&table, other_record);
+
+	_spki_table_add_assert(&shadow, test_record2);
+	_spki_table_add_assert(&shadow, test_record3);
+
+	table.update_fp = update_spki_replace;
+	spki_table_src_replace(&table, &shadow, socket);
+	table.update_fp = NULL;
+
+	assert(replace_added == 1);
+	assert(replace_removed == 1);
+
+	/* record1 is only left from the other socket */
+	assert(spki_table_search_by_ski(&table, test_record1->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 1);
+	assert(spki_records_are_equal(result, other_record));
+	free(result);
+
+	assert(spki_table_get_all(&table, 3, test_record3->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 1);
+	assert(spki_records_are_equal(result, test_record3));
+	free(result);
+
+	/* The shadow table does not hold the moved entries anymore */
+	assert(spki_table_search_by_ski(&shadow, test_record2->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 0);
+
+	/* Replacing with an empty partition removes all entries of the socket */
+	spki_table_src_replace(&table, &shadow, socket);
+	assert(spki_table_search_by_ski(&table, test_record2->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 0);
+	assert(spki_table_remove_entry(&table, other_record) == SPKI_SUCCESS);
+
+	spki_table_free(&table);
+	spki_table_free(&shadow);
+	free(test_record1);
+	free(test_record2);
+	free(test_record3);
+	free(other_record);
+
+	printf("%s() complete\n", __func__);
+}
+
+/**
+ * @brief Test of the spki_table_src_handover function.
+ * Entries of all given sockets are removed, entries of other sockets remain.
+ */
+static void test_table_src_handover(void)
+{
+	struct spki_table table;
+	const struct rtr_socket *sockets[2] = {(struct rtr_socket *)1, (struct rtr_socket *)2};
+	struct spki_record *result;
+	unsigned int result_len;
+
+	struct spki_record *test_record1 = create_record(1, 10, 100, (struct rtr_socket *)1);
+	struct spki_record *test_record2 = create_record(2, 20, 200, (struct rtr_socket *)2);
+	struct spki_record *test_record3 = create_record(1, 10, 100, (struct rtr_socket *)3);
+
+	spki_table_init(&table, NULL);
+	_spki_table_add_assert(&table, test_record1);
+	_spki_table_add_assert(&table, test_record2);
+	_spki_table_add_assert(&table, test_record3);
+
+	assert(spki_table_src_handover(&table, sockets, 2) == SPKI_SUCCESS);
+
+	assert(spki_table_search_by_ski(&table, test_record1->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 1);
+	assert(spki_records_are_equal(result, test_record3));
+	free(result);
+
+	assert(spki_table_search_by_ski(&table, test_record2->ski, &result, &result_len) == SPKI_SUCCESS);
+	assert(result_len == 0);
+
+	spki_table_free(&table);
+	free(test_record1);
+	free(test_record2);
+	free(test_record3);
+
+	printf("%s() complete\n", __func__);
+}
+
+/**
+ * @brief Verifies that the table digest does not depend on the insertion
+ * order or the origin socket, and follows adds, removes and handovers.
+ */
+static void test_table_digest(void)
+{
+	struct spki_table a;
+	struct spki_table b;
+	const struct rtr_socket *sockets[1] = {(struct rtr_socket *)2};
+
+	struct spki_record *test_record1 = create_record(1, 10, 100, (struct rtr_socket *)1);
+	struct spki_record *test_record2 = create_record(2, 20, 200, (struct rtr_socket *)2);
+	struct spki_record *test_record3 = create_record(3, 30, 300, (struct rtr_socket *)1);
+	struct spki_record *test_record4 = create_record(2, 20, 200, (struct rtr_socket *)3);
+
+	spki_table_init(&a, NULL);
+	spki_table_init(&b, NULL);
+	assert(spki_table_digest(&a) == 0);
+
+	_spki_table_add_assert(&a, test_record1);
+	_spki_table_add_assert(&a, test_record2);
+	_spki_table_add_assert(&a, test_record3);
+
+	_spki_table_add_assert(&b, test_record3);
+	_spki_table_add_assert(&b, test_record4);
+	assert(spki_table_digest(&a) != spki_table_digest(&b));
+	_spki_table_add_assert(&b, test_record1);
+	assert(spki_table_digest(&a) == spki_table_digest(&b));
+	assert(spki_table_src_digest(&a, test_record1->socket) ==
+	       spki_record_digest(test_record1) + spki_record_digest(test_record3));
+	assert(spki_table_src_digest(&a, (struct rtr_socket *)4) == 0);
+
+	assert(spki_table_remove_entry(&a, test_record2) == SPKI_SUCCESS);
+	assert(spki_table_digest(&a) == spki_record_digest(test_record1) + spki_record_digest(test_record3));
+
+	_spki_table_add_assert(&a, test_record2);
+	assert(spki_table_src_handover(&a, sockets, 1) == SPKI_SUCCESS);
+	assert(spki_table_remove_entry(&b, test_record4) == SPKI_SUCCESS);
+	assert(spki_table_digest(&a) == spki_table_digest(&b));
+
+	spki_table_free(&a);
+	spki_table_free(&b);
+	free(test_record1);
+	free(test_record2);
+	free(test_record3);
+	free(test_record4);
+
+	printf("%s() complete\n", __func__);
+}
+
+/**
+ * @brief Test spki_table_search_by_skis
+ * Test if the records of several SKIs are returned grouped by SKI, in the
+ * caller's buffer if they fit into it and in a new array otherwise.
+ */
+static void test_table_search_by_skis(void)
+{
+	struct spki_table table;
+	struct spki_key_ref buffer[8];
+	struct spki_key_ref *result = buffer;
+	unsigned int result_len = 2;
+	unsigned int ends[4];
+
+	struct spki_record *test_record1 = create_record(1, 10, 100, (struct rtr_socket *)1);
+	struct spki_record *test_record2 = create_record(2, 10, 200, (struct rtr_socket *)2);
+	struct spki_record *test_record3 = create_record(3, 20, 300, (struct rtr_socket *)1);
+	struct spki_record *missing = create_record(4, 30, 400, NULL);
+	const uint8_t *skis[4] = {test_record1->ski, test_record3->ski, missing->ski, test_record1->ski};
+
+	spki_table_init(&table, NULL);
+	_spki_table_add_assert(&table, test_record1);
+	_spki_table_add_assert(&table, test_record3);
+	_spki_table_add_assert(&table, test_record2);
+
+	assert(spki_table_search_by_skis(&table, skis, 4, &result, &result_len, ends) == SPKI_SUCCESS);
+	assert(result != buffer);
+	assert(result_len == 5);
+	assert(ends[0] == 2 && ends[1] == 3 && ends[2] == 3 && ends[3] == 5);
+	for (unsigned int i = 0; i < 2; i++) {
+		assert(spki_key_ref_matches(&result[i], test_record1) ||
+		       spki_key_ref_matches(&result[i], test_record2));
+		assert(result[i + 3].key == result[i].key && result[i + 3].asn == result[i].asn);
+	}
+	assert(result[0].asn != result[1].asn);
+	assert(spki_key_ref_matches(&result[2], test_record3));
+	spki_key_refs_release(result, result_len);
+	free(result);
+
+	result = buffer;
+	result_len = 8;
+	assert(spki_table_search_by_skis(&table, skis, 3, &result, &result_len, ends) == SPKI_SUCCESS);
+	assert(result == buffer);
+	assert(result_len == 3);
+	assert(ends[0] == 2 && ends[1] == 3 && ends[2] == 3);
+	spki_key_refs_release(result, result_len);
+
+	spki_table_free(&table);
+	free(test_record1);
+	free(test_record2);
+	free(test_record3);
+	free(missing);
+
+	printf("%s() complete\n", __func__);
+}
+
+/**
+ * @brief Test the interning of router keys
+ * Test if a key that is announced for several ASes by several sockets and
+ * copied into a shadow table is stored once, and freed with the last entry.
+ */
+static void test_key_interning(void)
+{
+	struct spki_table table;
+	struct spki_table shadow;
+	struct spki_key_ref buffer[8];
+	struct spki_key_ref *result = buffer;
+	unsigned int result_len = 8;
+	unsigned int ends[1];
+	const size_t keys = spki_key_count();
+
+	struct spki_record *test_record1 = create_record(1, 10, 100, (struct rtr_socket *)1);
+	struct spki_record *test_record2 = create_record(2, 10, 100, (struct rtr_socket *)1);
+	struct spki_record *test_record3 = create_record(1, 10, 100, (struct rtr_socket *)2);
+	const uint8_t *skis[1] = {test_record1->ski};
+
+	spki_table_init(&table, NULL);
+	spki_table_init(&shadow, NULL);
+	_spki_table_add_assert(&table, test_record1);
+	_spki_table_add_assert(&table, test_record2);
+	_spki_table_add_assert(&table, test_record3);
+	assert(spki_table_add_entry(&table, test_record3) == SPKI_DUPLICATE_RECORD);
+	assert(spki_key_count() == keys + 1);
+
+	assert(spki_table_copy_except_socket(&table, &shadow, (struct rtr_socket *)2) == SPKI_SUCCESS);
+	assert(spki_table_digest(&shadow) == spki_table_src_digest(&table, (struct rtr_socket *)1));
+	assert(spki_key_count() == keys + 1);
+
+	assert(spki_table_search_by_skis(&shadow, skis, 1, &result, &result_len, ends) == SPKI_SUCCESS);
+	assert(result_len == 2);
+	assert(result[0].key == result[1].key);
+
+	// the key outlives the tables while a handle refers to it
+	assert(spki_table_remove_entry(&table, test_record1) == SPKI_SUCCESS);
+	spki_table_free(&table);
+	spki_table_free(&shadow);
+	assert(spki_key_count() == keys + 1);
+	assert(spki_key_ref_matches(&result[0], test_record1) || spki_key_ref_matches(&result[0], test_record2));
+	spki_key_refs_release(result, result_len);
+	assert(spki_key_count() == keys);
+
+	free(test_record1);
+	free(test_record2);
+	free(test_record3);
+
+	printf("%s() complete\n", __func__);
+}
+
 int main(void)
 {
 	test_ht_1();
@@ -645,5 +945,10 @@ int main(void)
 	test_ht_7();
 	test_table_swap();
 	test_table_diff();
+	test_table_src_replace();
+	test_table_src_handover();
+	test_table_digest();
+	test_table_search_by_skis();
+	test_key_interning();
 	return EXIT_SUCCESS;
 }
@@ -69,6 +69,10 @@ int main(void)
 		NULL, //data
 		NULL, //new_socket()
 		0, //connection timeout
+		0, //keepalive idle time
+		0, //keepalive interval
+		0, //keepalive probes
+		0, //user timeout
 	};
 	struct rtr_socket rtr_tcp;
 	struct rtr_mgr_group groups[1];
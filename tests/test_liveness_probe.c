@@ -0,0 +1,149 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "fake_cache.h"
+
+#include "rtrlib/lib/utils_private.h"
+#include "rtrlib/rtrlib.h"
+
+#include <assert.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SESSION_ID 42
+
+static unsigned int answered_queries;
+
+/* Receives a query and answers it with an empty Cache Response */
+static void answer_query(struct fake_cache *cache)
+{
+	fake_cache_read_query(cache);
+	fake_cache_send_response(cache, SESSION_ID);
+	fake_cache_send_eod(cache, SESSION_ID, 1);
+	answered_queries++;
+}
+
+/* Answers the Reset Query and the first probe, then stops responding without closing the connection */
+static void *run_cache(void *arg)
+{
+	struct fake_cache *cache = arg;
+
+	fake_cache_accept(cache);
+	answer_query(cache);
+	answer_query(cache);
+	return NULL;
+}
+
+static unsigned int failures(const struct rtr_socket *rtr_socket)
+{
+	struct rtr_socket_metrics metrics;
+
+	rtr_get_metrics(rtr_socket, &metrics);
+	return metrics.failures;
+}
+
+/* Waits up to ten seconds until the socket finished the given number of synchronisations */
+static bool wait_for_syncs(const struct rtr_socket *rtr_socket, const unsigned int syncs)
+{
+	struct rtr_socket_metrics metrics;
+
+	for (unsigned int i = 0; i < 100; i++) {
+		rtr_get_metrics(rtr_socket, &metrics);
+		if (metrics.syncs >= syncs)
+			return true;
+		usleep(100 * 1000);
+	}
+	return false;
+}
+
+/* Milliseconds since the given monotonic time */
+static uint64_t elapsed_ms(const uint64_t start)
+{
+	uint64_t now;
+
+	assert(lrtr_get_monotonic_time_ms(&now) == 0);
+	return now - start;
+}
+
+/*
+ * @brief Connects to a cache that stops answering after the first probe and
+ * checks that the session is considered dead within seconds, although the
+ * refresh_interval is one hour. The keepalive options have to be applied.
+ */
+static void test_liveness_probe(void)
+{
+	struct fake_cache cache;
+	pthread_t cache_thread;
+	struct tr_tcp_config tcp_config;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1] = {&rtr_tcp};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+	struct rtr_socket_metrics metrics;
+	uint64_t start;
+	int optval;
+	socklen_t optlen = sizeof(optval);
+
+	fake_cache_listen(&cache);
+	assert(pthread_create(&cache_thread, NULL, run_cache, &cache) == 0);
+
+	fake_cache_tcp_config(&cache, &tcp_config);
+	tcp_config.keepalive_idle = 5;
+	tcp_config.keepalive_interval = 1;
+	tcp_config.keepalive_count = 3;
+	tcp_config.user_timeout = 8000;
+	assert(tr_tcp_init(&tcp_config, &tr_tcp) == TR_SUCCESS);
+	rtr_tcp.tr_socket = &tr_tcp;
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 1;
+	groups[0].preference = 1;
+
+	assert(rtr_mgr_init(&conf, groups, 1, 3600, 7200, 600, NULL, NULL, NULL, NULL) == RTR_SUCCESS);
+	assert(rtr_set_liveness_probe(&rtr_tcp, 1, 0) == RTR_INVALID_PARAM);
+	assert(rtr_set_liveness_probe(&rtr_tcp, 1, 1) == RTR_SUCCESS);
+	assert(lrtr_get_monotonic_time_ms(&start) == 0);
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+
+	assert(wait_for_syncs(&rtr_tcp, 1));
+	assert(getsockopt(cache.client_fd, SOL_SOCKET, SO_KEEPALIVE, &optval, &optlen) == 0 && optval == 1);
+#ifdef TCP_KEEPIDLE
+	assert(getsockopt(cache.client_fd, IPPROTO_TCP, TCP_KEEPIDLE, &optval, &optlen) == 0 && optval == 5);
+#endif
+#ifdef TCP_USER_TIMEOUT
+	assert(getsockopt(cache.client_fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &optval, &optlen) == 0 && optval == 8000);
+#endif
+
+	for (unsigned int i = 0; i < 100 && failures(&rtr_tcp) == 0; i++)
+		usleep(100 * 1000);
+	assert(failures(&rtr_tcp) == 1);
+	assert(elapsed_ms(start) < 10000);
+
+	// the reset and the answered probe synchronised the socket
+	rtr_get_metrics(&rtr_tcp, &metrics);
+	assert(metrics.syncs == 2);
+	assert(answered_queries == 2);
+
+	rtr_mgr_stop(conf);
+	rtr_mgr_free(conf);
+	assert(pthread_join(cache_thread, NULL) == 0);
+	fake_cache_close(&cache);
+}
+
+int main(void)
+{
+	test_liveness_probe();
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
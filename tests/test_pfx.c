@@ -11,6 +11,7 @@
 #include "rtrlib/lib/utils_private.h"
 #include "rtrlib/pfx/pfx.h"
 #include "rtrlib/pfx/pfx_private.h"
+#include "rtrlib/pfx/succinct/succinct_private.h"
 #include "rtrlib/pfx/trie/trie_private.h"
 #include "rtrlib/rtr/rtr.h"
 
@@ -48,6 +49,8 @@ static void remove_src_test(void)
 	struct pfx_record pfx;
 	/* TEST1: init prefix table ----------------------------------------- */
 	pfx_table_init(&pfxt, NULL);
+	// the test inspects the trie
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
 	pfx.min_len = 32;
 	pfx.max_len = 32;
 	/* TEST2: add and verify different prefixes -------------------------- */
@@ -382,6 +385,7 @@ static void test_issue152(void)
 	for (size_t i = 0; i < 6; i++)
 		assert(pfx_table_remove(&pfxt, &records[i]) == PFX_SUCCESS);
 
+	pfx_table_free(&pfxt);
 	free(records);
 }
 
@@ -437,6 +441,1000 @@ static void test_pfx_merge(void)
 	pfx_table_free(&pfxt2);
 }
 
+/**
+ * @brief Verifies that records stay reachable by exact match after the trie
+ * moved them between nodes, e.g. when a shorter prefix is inserted above
+ * them or when their parent node is removed.
+ */
+static void test_pfx_exact_index(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_table shadow;
+	struct pfx_record records[4];
+
+	pfx_table_init(&pfxt, NULL);
+	pfx_table_init(&shadow, NULL);
+
+	create_ip4_pfx_record(&records[0], 1, "10.10.0.0", 16, 16);
+	create_ip4_pfx_record(&records[1], 2, "10.10.128.0", 17, 24);
+	create_ip4_pfx_record(&records[2], 3, "10.0.0.0", 8, 8);
+	create_ip4_pfx_record(&records[3], 4, "10.10.0.0", 16, 24);
+
+	for (size_t i = 0; i < 4; i++)
+		assert(pfx_table_add(&pfxt, &records[i]) == PFX_SUCCESS);
+	for (size_t i = 0; i < 4; i++)
+		assert(pfx_table_add(&pfxt, &records[i]) == PFX_DUPLICATE_RECORD);
+
+	/* the root node holding 10.0.0.0/8 is removed, its child takes its place */
+	assert(pfx_table_remove(&pfxt, &records[2]) == PFX_SUCCESS);
+	assert(pfx_table_remove(&pfxt, &records[2]) == PFX_RECORD_NOT_FOUND);
+	validate(&pfxt, 2, "10.10.128.0", 24, BGP_PFXV_STATE_VALID);
+
+	/* the index is swapped along with the tries */
+	pfx_table_swap(&pfxt, &shadow);
+	assert(pfx_table_remove(&pfxt, &records[0]) == PFX_RECORD_NOT_FOUND);
+	assert(pfx_table_remove(&shadow, &records[0]) == PFX_SUCCESS);
+	assert(pfx_table_remove(&shadow, &records[3]) == PFX_SUCCESS);
+	validate(&shadow, 4, "10.10.0.0", 16, BGP_PFXV_STATE_NOT_FOUND);
+	assert(pfx_table_remove(&shadow, &records[1]) == PFX_SUCCESS);
+	assert(!shadow.ipv4);
+
+	assert(pfx_table_add(&shadow, &records[2]) == PFX_SUCCESS);
+	validate(&shadow, 3, "10.0.0.0", 8, BGP_PFXV_STATE_VALID);
+
+	pfx_table_free(&pfxt);
+	pfx_table_free(&shadow);
+	printf("%s() successful\n", __func__);
+}
+
+static void random_pfx_record(struct pfx_record *pfx, bool ipv6)
+{
+	uint8_t max_len = ipv6 ? 128 : 32;
+
+	memset(pfx, 0, sizeof(*pfx));
+	pfx->asn = rand() % 8;
+	pfx->min_len = rand() % (max_len / 2 + 1) + (ipv6 ? 24 : 12);
+	pfx->max_len = pfx->min_len + rand() % (max_len - pfx->min_len + 1);
+	pfx->socket = (struct rtr_socket *)1;
+	pfx->prefix.ver = ipv6 ? LRTR_IPV6 : LRTR_IPV4;
+	/* few distinct values in the leading bits produce many covering prefixes */
+	if (ipv6) {
+		pfx->prefix.u.addr6.addr[0] = (uint32_t)(0x2000 + rand() % 64) << 16 | (rand() % 4) << 8;
+		pfx->prefix.u.addr6.addr[1] = rand() % 4;
+		pfx->prefix = lrtr_ip_addr_get_bits(&pfx->prefix, 0, pfx->min_len);
+	} else {
+		pfx->prefix.u.addr4.addr = (uint32_t)(rand() % 64) << 24 | (rand() % 4) << 20 | (rand() % 16) << 8;
+		pfx->prefix = lrtr_ip_addr_get_bits(&pfx->prefix, 0, pfx->min_len);
+	}
+}
+
+static void compare_validation(struct pfx_table *trie, struct pfx_table *bspl, const struct pfx_record *route)
+{
+	struct pfx_record *trie_reason = NULL;
+	struct pfx_record *bspl_reason = NULL;
+	unsigned int trie_reason_len = 0;
+	unsigned int bspl_reason_len = 0;
+	enum pfxv_state trie_res;
+	enum pfxv_state bspl_res;
+
+	assert(pfx_table_validate_r(trie, &trie_reason, &trie_reason_len, route->asn, &route->prefix, route->max_len,
+				    &trie_res) == PFX_SUCCESS);
+	assert(pfx_table_validate_r(bspl, &bspl_reason, &bspl_reason_len, route->asn, &route->prefix, route->max_len,
+				    &bspl_res) == PFX_SUCCESS);
+	assert(trie_res == bspl_res);
+	assert(trie_reason_len == bspl_reason_len);
+	for (unsigned int i = 0; i < trie_reason_len; i++) {
+		assert(trie_reason[i].asn == bspl_reason[i].asn);
+		assert(lrtr_ip_addr_equal(trie_reason[i].prefix, bspl_reason[i].prefix));
+		assert(trie_reason[i].min_len == bspl_reason[i].min_len);
+		assert(trie_reason[i].max_len == bspl_reason[i].max_len);
+	}
+	free(trie_reason);
+	free(bspl_reason);
+}
+
+/**
+ * @brief Validates random routes against a table with the trie engine and
+ * one with the bspl engine, and verifies that result and reason are equal,
+ * also after records were added and removed.
+ */
+static void test_pfx_bspl_engine(void)
+{
+	struct pfx_table trie;
+	struct pfx_table bspl;
+	struct pfx_record records[2000];
+	struct pfx_record route;
+
+	srand(42);
+	pfx_table_init(&trie, NULL);
+	pfx_table_init(&bspl, NULL);
+	assert(pfx_table_set_engine(&bspl, PFX_ENGINE_BSPL) == PFX_SUCCESS);
+
+	for (unsigned int round = 0; round < 2; round++) {
+		for (unsigned int i = 0; i < 2000; i++) {
+			random_pfx_record(&records[i], i % 2);
+			int rtval = pfx_table_add(&trie, &records[i]);
+
+			assert(pfx_table_add(&bspl, &records[i]) == rtval);
+		}
+
+		for (unsigned int i = 0; i < 20000; i++) {
+			random_pfx_record(&route, i % 2);
+			route.max_len = route.min_len + rand() % ((i % 2 ? 128 : 32) - route.min_len + 1);
+			compare_validation(&trie, &bspl, &route);
+		}
+
+		/* removing records invalidates the bspl structures */
+		for (unsigned int i = 0; i < 2000; i += 3) {
+			int rtval = pfx_table_remove(&trie, &records[i]);
+
+			assert(pfx_table_remove(&bspl, &records[i]) == rtval);
+		}
+	}
+
+	for (unsigned int i = 0; i < 2000; i++) {
+		random_pfx_record(&route, i % 2);
+		compare_validation(&trie, &bspl, &route);
+	}
+
+	pfx_table_free(&trie);
+	pfx_table_free(&bspl);
+	printf("%s() successful\n", __func__);
+}
+
+/**
+ * @brief Validates random routes against a table with the trie engine and
+ * one with a frozen index, and verifies that result and reason are equal.
+ * Modifications after the last freeze must not be missed.
+ */
+static void test_pfx_frozen_index(void)
+{
+	struct pfx_table trie;
+	struct pfx_table frozen;
+	struct pfx_record records[2000];
+	struct pfx_record route;
+
+	srand(43);
+	pfx_table_init(&trie, NULL);
+	pfx_table_init(&frozen, NULL);
+	assert(pfx_table_freeze(&frozen) == PFX_ERROR);
+	assert(pfx_table_enable_frozen_index(&frozen) == PFX_SUCCESS);
+
+	/* an empty index answers NOT_FOUND */
+	assert(pfx_table_freeze(&frozen) == PFX_SUCCESS);
+	validate(&frozen, 1, "10.0.0.0", 8, BGP_PFXV_STATE_NOT_FOUND);
+
+	/* prefixes at the bounds of the address space */
+	add_ip4_pfx_record(&trie, 1, "0.0.0.0", 1, 8);
+	add_ip4_pfx_record(&frozen, 1, "0.0.0.0", 1, 8);
+	add_ip4_pfx_record(&trie, 2, "255.255.255.255", 32, 32);
+	add_ip4_pfx_record(&frozen, 2, "255.255.255.255", 32, 32);
+	assert(pfx_table_freeze(&frozen) == PFX_SUCCESS);
+	validate(&frozen, 1, "10.0.0.0", 8, BGP_PFXV_STATE_VALID);
+	validate(&frozen, 1, "10.0.0.0", 9, BGP_PFXV_STATE_INVALID);
+	validate(&frozen, 2, "255.255.255.255", 32, BGP_PFXV_STATE_VALID);
+	validate(&frozen, 2, "255.255.255.254", 32, BGP_PFXV_STATE_NOT_FOUND);
+
+	for (unsigned int round = 0; round < 2; round++) {
+		for (unsigned int i = 0; i < 2000; i++) {
+			random_pfx_record(&records[i], i % 2);
+			int rtval = pfx_table_add(&trie, &records[i]);
+
+			assert(pfx_table_add(&frozen, &records[i]) == rtval);
+		}
+		assert(pfx_table_freeze(&frozen) == PFX_SUCCESS);
+
+		for (unsigned int i = 0; i < 20000; i++) {
+			random_pfx_record(&route, i % 2);
+			route.max_len = route.min_len + rand() % ((i % 2 ? 128 : 32) - route.min_len + 1);
+			compare_validation(&trie, &frozen, &route);
+		}
+
+		/* removed records must not be reported by the outdated index */
+		for (unsigned int i = 0; i < 2000; i += 3) {
+			int rtval = pfx_table_remove(&trie, &records[i]);
+
+			assert(pfx_table_remove(&frozen, &records[i]) == rtval);
+		}
+		for (unsigned int i = 0; i < 2000; i++) {
+			random_pfx_record(&route, i % 2);
+			compare_validation(&trie, &frozen, &route);
+		}
+	}
+
+	/* large changes are rebuilt by the builder thread while validations run */
+	pfx_table_frozen_refresh(&frozen, 100000);
+	for (unsigned int i = 0; i < 2000; i++) {
+		random_pfx_record(&route, i % 2);
+		compare_validation(&trie, &frozen, &route);
+	}
+
+	pfx_table_frozen_refresh(&frozen, 0);
+	for (unsigned int i = 0; i < 2000; i++) {
+		random_pfx_record(&route, i % 2);
+		compare_validation(&trie, &frozen, &route);
+	}
+
+	pfx_table_free(&trie);
+	pfx_table_free(&frozen);
+	printf("%s() successful\n", __func__);
+}
+
+static unsigned int handover_removed;
+
+static void update_cb_handover(struct pfx_table *p __attribute__((unused)), const struct pfx_record rec,
+			       const bool added)
+{
+	assert(!added);
+	assert(rec.asn == 2);
+	handover_removed++;
+}
+
+/**
+ * @brief Verifies that pfx_table_src_handover removes the records of all
+ * given sockets, but only notifies about VRPs that no other socket holds.
+ */
+static void test_pfx_src_handover(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_record records[5];
+	const struct rtr_socket *sockets[2] = {(struct rtr_socket *)1, (struct rtr_socket *)2};
+
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+
+	/* VRP of AS1 is held by an old and the new socket, AS2 only by the old sockets */
+	create_ip4_pfx_record(&records[0], 1, "10.0.0.0", 8, 16);
+	create_ip4_pfx_record(&records[1], 2, "10.10.0.0", 16, 24);
+	create_ip4_pfx_record(&records[2], 2, "10.10.0.0", 16, 24);
+	records[2].socket = (struct rtr_socket *)2;
+	create_ip4_pfx_record(&records[3], 1, "10.0.0.0", 8, 16);
+	records[3].socket = (struct rtr_socket *)3;
+	create_ip4_pfx_record(&records[4], 3, "10.20.0.0", 16, 16);
+	records[4].socket = (struct rtr_socket *)3;
+
+	for (size_t i = 0; i < 5; i++)
+		assert(pfx_table_add(&pfxt, &records[i]) == PFX_SUCCESS);
+
+	pfxt.update_fp = update_cb_handover;
+	assert(pfx_table_src_handover(&pfxt, sockets, 2) == PFX_SUCCESS);
+	pfxt.update_fp = NULL;
+
+	/* both records of AS2 disappear, the VRP of AS1 is still held by socket 3 */
+	assert(handover_removed == 2);
+	validate(&pfxt, 1, "10.0.0.0", 16, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 2, "10.10.0.0", 24, BGP_PFXV_STATE_INVALID);
+	validate(&pfxt, 3, "10.20.0.0", 16, BGP_PFXV_STATE_VALID);
+
+	assert(pfx_table_remove(&pfxt, &records[0]) == PFX_RECORD_NOT_FOUND);
+	assert(pfx_table_remove(&pfxt, &records[3]) == PFX_SUCCESS);
+	assert(pfx_table_remove(&pfxt, &records[4]) == PFX_SUCCESS);
+	assert(!pfxt.ipv4);
+
+	pfx_table_free(&pfxt);
+	printf("%s() successful\n", __func__);
+}
+
+/**
+ * @brief Verifies that the table digest does not depend on the insertion
+ * order, the origin socket or the bits behind the prefix length, and that
+ * it follows adds, removes, source removals and swaps.
+ */
+static void test_pfx_digest(void)
+{
+	struct pfx_table a;
+	struct pfx_table b;
+	struct pfx_record records[4];
+	struct pfx_record unmasked;
+
+	pfx_table_init(&a, NULL);
+	pfx_table_init(&b, NULL);
+	assert(pfx_table_digest(&a, LRTR_IPV4) == 0);
+	assert(pfx_table_digest(&a, LRTR_IPV6) == 0);
+
+	create_ip4_pfx_record(&records[0], 1, "10.0.0.0", 8, 16);
+	create_ip4_pfx_record(&records[1], 2, "10.10.0.0", 16, 24);
+	create_ip4_pfx_record(&records[2], 3, "10.10.0.0", 16, 24);
+	create_ip4_pfx_record(&records[3], 1, "10.0.0.0", 8, 16);
+	records[3].socket = (struct rtr_socket *)2;
+
+	create_ip4_pfx_record(&unmasked, 1, "10.1.2.3", 8, 16);
+	assert(pfx_record_digest(&unmasked) == pfx_record_digest(&records[0]));
+	assert(pfx_record_digest(&records[1]) != pfx_record_digest(&records[2]));
+
+	for (unsigned int i = 0; i < 3; i++)
+		assert(pfx_table_add(&a, &records[i]) == PFX_SUCCESS);
+	assert(pfx_table_add(&b, &records[2]) == PFX_SUCCESS);
+	assert(pfx_table_add(&b, &records[1]) == PFX_SUCCESS);
+	assert(pfx_table_add(&b, &records[3]) == PFX_SUCCESS);
+	assert(pfx_table_digest(&a, LRTR_IPV4) == pfx_table_digest(&b, LRTR_IPV4));
+	assert(pfx_table_digest(&a, LRTR_IPV6) == 0);
+
+	/* a duplicate add does not change the digest */
+	assert(pfx_table_add(&a, &records[0]) == PFX_DUPLICATE_RECORD);
+	assert(pfx_table_digest(&a, LRTR_IPV4) == pfx_table_digest(&b, LRTR_IPV4));
+
+	assert(pfx_table_remove(&a, &records[1]) == PFX_SUCCESS);
+	assert(pfx_table_digest(&a, LRTR_IPV4) ==
+	       pfx_record_digest(&records[0]) + pfx_record_digest(&records[2]));
+
+	assert(pfx_table_src_remove(&b, records[3].socket) == PFX_SUCCESS);
+	assert(pfx_table_remove(&a, &records[0]) == PFX_SUCCESS);
+	assert(pfx_table_remove(&b, &records[1]) == PFX_SUCCESS);
+	assert(pfx_table_digest(&a, LRTR_IPV4) == pfx_table_digest(&b, LRTR_IPV4));
+
+	assert(pfx_table_add(&a, &records[0]) == PFX_SUCCESS);
+	pfx_table_swap(&a, &b);
+	assert(pfx_table_digest(&b, LRTR_IPV4) ==
+	       pfx_record_digest(&records[0]) + pfx_record_digest(&records[2]));
+	assert(pfx_table_digest(&a, LRTR_IPV4) == pfx_record_digest(&records[2]));
+
+	pfx_table_free(&a);
+	pfx_table_free(&b);
+	printf("%s() successful\n", __func__);
+}
+
+struct traversal_records {
+	struct pfx_record *records;
+	unsigned int len;
+	unsigned int size;
+};
+
+static void traversal_collect_cb(const struct pfx_record *record, void *data)
+{
+	struct traversal_records *args = data;
+
+	if (args->len == args->size) {
+		args->size = args->size ? 2 * args->size : 1024;
+		args->records = realloc(args->records, sizeof(*args->records) * args->size);
+		assert(args->records);
+	}
+	args->records[args->len++] = *record;
+}
+
+static unsigned int traversal_notified[2];
+static uint64_t traversal_notified_digest[2];
+
+static void update_cb_traversal(struct pfx_table *p __attribute__((unused)), const struct pfx_record rec,
+				const bool added)
+{
+	traversal_notified[added]++;
+	traversal_notified_digest[added] += pfx_record_digest(&rec);
+}
+
+/**
+ * @brief Verifies that the traversal of a table that is large enough to be
+ * split into subtrees returns the records in the order of the sequential
+ * iteration, and that copy, diff and source removal use the same records.
+ */
+static void test_pfx_parallel_traversal(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_table copy;
+	struct rtr_socket *socket = (struct rtr_socket *)2;
+	uint64_t socket_digest[2] = {0, 0};
+	unsigned int socket_records = 0;
+
+	pfx_table_init(&pfxt, NULL);
+	pfx_table_init(&copy, NULL);
+
+	for (uint32_t i = 0; i < 100000; i++) {
+		struct pfx_record record;
+
+		memset(&record, 0, sizeof(record));
+		record.asn = i % 5;
+		record.min_len = 20 + i % 5;
+		record.max_len = record.min_len + i % 3;
+		record.socket = (struct rtr_socket *)(uintptr_t)(1 + (i % 3 == 0));
+		if (i % 10 == 0) {
+			record.prefix.ver = LRTR_IPV6;
+			record.prefix.u.addr6.addr[0] = i * 2654435761U;
+			record.min_len += 12;
+			record.max_len += 12;
+		} else {
+			record.prefix.ver = LRTR_IPV4;
+			record.prefix.u.addr4.addr = i * 2654435761U;
+		}
+		record.prefix = lrtr_ip_addr_get_bits(&record.prefix, 0, record.min_len);
+
+		if (pfx_table_add(&pfxt, &record) == PFX_SUCCESS && record.socket == socket) {
+			socket_digest[record.prefix.ver == LRTR_IPV6] += pfx_record_digest(&record);
+			socket_records++;
+		}
+	}
+
+	for (unsigned int i = 0; i < 2; i++) {
+		struct traversal_records expected = {NULL, 0, 0};
+		struct pfx_record *records;
+		unsigned int records_len;
+
+		if (i == 0)
+			pfx_table_for_each_ipv4_record(&pfxt, traversal_collect_cb, &expected);
+		else
+			pfx_table_for_each_ipv6_record(&pfxt, traversal_collect_cb, &expected);
+
+		assert(pfx_table_get_records(&pfxt, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &records, &records_len) ==
+		       PFX_SUCCESS);
+		assert(records_len == expected.len);
+		for (unsigned int j = 0; j < records_len; j++) {
+			assert(records[j].asn == expected.records[j].asn);
+			assert(lrtr_ip_addr_equal(records[j].prefix, expected.records[j].prefix));
+			assert(records[j].min_len == expected.records[j].min_len);
+			assert(records[j].max_len == expected.records[j].max_len);
+			assert(records[j].socket == expected.records[j].socket);
+		}
+		free(records);
+		free(expected.records);
+	}
+
+	assert(pfx_table_copy_except_socket(&pfxt, &copy, socket) == PFX_SUCCESS);
+	assert(pfx_table_digest(&copy, LRTR_IPV4) == pfx_table_digest(&pfxt, LRTR_IPV4) - socket_digest[0]);
+	assert(pfx_table_digest(&copy, LRTR_IPV6) == pfx_table_digest(&pfxt, LRTR_IPV6) - socket_digest[1]);
+
+	/* the copy lacks the records of the socket, the diff reports all of them as removed */
+	copy.update_fp = update_cb_traversal;
+	pfx_table_notify_diff(&copy, &pfxt, socket);
+	assert(traversal_notified[true] == 0);
+	assert(traversal_notified[false] == socket_records);
+	assert(traversal_notified_digest[false] == socket_digest[0] + socket_digest[1]);
+	copy.update_fp = NULL;
+
+	traversal_notified[false] = 0;
+	traversal_notified_digest[false] = 0;
+	pfxt.update_fp = update_cb_traversal;
+	assert(pfx_table_src_remove(&pfxt, socket) == PFX_SUCCESS);
+	pfxt.update_fp = NULL;
+	assert(traversal_notified[false] == socket_records);
+	assert(traversal_notified_digest[false] == socket_digest[0] + socket_digest[1]);
+	assert(pfx_table_digest(&pfxt, LRTR_IPV4) == pfx_table_digest(&copy, LRTR_IPV4));
+	assert(pfx_table_digest(&pfxt, LRTR_IPV6) == pfx_table_digest(&copy, LRTR_IPV6));
+
+	pfx_table_free(&pfxt);
+	pfx_table_free(&copy);
+	printf("%s() successful\n", __func__);
+}
+
+static unsigned int count_trie_nodes(struct trie_node *root)
+{
+	struct trie_node **array = NULL;
+	unsigned int len = 0;
+
+	if (!root)
+		return 0;
+	assert(trie_get_children(root, &array, &len) != -1);
+	free(array);
+	return len + 1;
+}
+
+/**
+ * @brief Removes records from tables with the PFX_REMOVAL_DEFERRED strategy
+ * and verifies that the emptied nodes stay in the trie without affecting
+ * validation results, until they are compacted.
+ */
+static void test_pfx_tombstones(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_table trie;
+	struct pfx_table bspl;
+	struct pfx_record pfx;
+	struct pfx_record records[2000];
+	struct pfx_record route;
+	struct pfx_record *reason = NULL;
+	unsigned int reason_len = 0;
+	enum pfxv_state res;
+	char ip[16];
+
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	assert(pfx_table_set_removal(&pfxt, PFX_REMOVAL_DEFERRED) == PFX_SUCCESS);
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 8, 24);
+	add_ip4_pfx_record(&pfxt, 2, "10.1.0.0", 16, 24);
+	for (unsigned int i = 0; i < 8; i++) {
+		snprintf(ip, sizeof(ip), "%u.0.0.0", 20 + i);
+		add_ip4_pfx_record(&pfxt, 3, ip, 8, 8);
+	}
+	assert(count_trie_nodes(pfxt.ipv4) == 10);
+
+	/* the emptied node stays in the trie, but does not cover routes anymore */
+	create_ip4_pfx_record(&pfx, 1, "10.0.0.0", 8, 24);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_RECORD_NOT_FOUND);
+	assert(pfxt.tombstones == 1);
+	assert(count_trie_nodes(pfxt.ipv4) == 10);
+	validate(&pfxt, 1, "10.0.0.0", 8, BGP_PFXV_STATE_NOT_FOUND);
+	validate(&pfxt, 2, "10.1.0.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 1, "10.1.0.0", 16, BGP_PFXV_STATE_INVALID);
+	assert(pfx_table_validate_r(&pfxt, &reason, &reason_len, 1, &pfx.prefix, 16, &res) == PFX_SUCCESS);
+	assert(res == BGP_PFXV_STATE_NOT_FOUND);
+	assert(!reason && reason_len == 0);
+
+	/* adding the record again reuses the node */
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 8, 24);
+	assert(pfxt.tombstones == 0);
+	assert(count_trie_nodes(pfxt.ipv4) == 10);
+
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(pfx_table_compact(&pfxt) == PFX_SUCCESS);
+	assert(pfxt.tombstones == 0);
+	assert(count_trie_nodes(pfxt.ipv4) == 9);
+	validate(&pfxt, 2, "10.1.0.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 3, "27.0.0.0", 8, BGP_PFXV_STATE_VALID);
+
+	/* switching back removes the tombstones */
+	create_ip4_pfx_record(&pfx, 2, "10.1.0.0", 16, 24);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(count_trie_nodes(pfxt.ipv4) == 9);
+	assert(pfx_table_set_removal(&pfxt, PFX_REMOVAL_IMMEDIATE) == PFX_SUCCESS);
+	assert(count_trie_nodes(pfxt.ipv4) == 8);
+	pfx_table_free(&pfxt);
+
+	/* the results equal the ones of the immediate removal, for both engines */
+	srand(92);
+	pfx_table_init(&trie, NULL);
+	pfx_table_init(&pfxt, NULL);
+	pfx_table_init(&bspl, NULL);
+	assert(pfx_table_set_removal(&pfxt, PFX_REMOVAL_DEFERRED) == PFX_SUCCESS);
+	assert(pfx_table_set_removal(&bspl, PFX_REMOVAL_DEFERRED) == PFX_SUCCESS);
+	assert(pfx_table_set_engine(&bspl, PFX_ENGINE_BSPL) == PFX_SUCCESS);
+
+	for (unsigned int round = 0; round < 3; round++) {
+		for (unsigned int i = 0; i < 2000; i++) {
+			if (round == 0)
+				random_pfx_record(&records[i], i % 2);
+			int rtval = pfx_table_add(&trie, &records[i]);
+
+			assert(pfx_table_add(&pfxt, &records[i]) == rtval);
+			assert(pfx_table_add(&bspl, &records[i]) == rtval);
+		}
+
+		for (unsigned int i = round; i < 2000; i += 2) {
+			int rtval = pfx_table_remove(&trie, &records[i]);
+
+			assert(pfx_table_remove(&pfxt, &records[i]) == rtval);
+			assert(pfx_table_remove(&bspl, &records[i]) == rtval);
+		}
+		assert(pfxt.tombstones > 0);
+
+		for (unsigned int i = 0; i < 20000; i++) {
+			random_pfx_record(&route, i % 2);
+			route.max_len = route.min_len + rand() % ((i % 2 ? 128 : 32) - route.min_len + 1);
+			compare_validation(&trie, &pfxt, &route);
+			compare_validation(&trie, &bspl, &route);
+		}
+	}
+
+	/* removing all records compacts the tombstones before they outnumber the records */
+	for (unsigned int i = 0; i < 2000; i++) {
+		int rtval = pfx_table_remove(&trie, &records[i]);
+
+		assert(pfx_table_remove(&pfxt, &records[i]) == rtval);
+	}
+	assert(!trie.ipv4 && !trie.ipv6);
+	assert(!pfxt.ipv4 && !pfxt.ipv6);
+	assert(pfxt.tombstones == 0);
+
+	pfx_table_free(&trie);
+	pfx_table_free(&pfxt);
+	pfx_table_free(&bspl);
+	printf("%s() successful\n", __func__);
+}
+
+static int record_cmp(const void *a, const void *b)
+{
+	const struct pfx_record *ra = a;
+	const struct pfx_record *rb = b;
+
+	if (ra->prefix.ver != rb->prefix.ver)
+		return ra->prefix.ver < rb->prefix.ver ? -1 : 1;
+	if (ra->min_len != rb->min_len)
+		return ra->min_len < rb->min_len ? -1 : 1;
+	if (ra->prefix.ver == LRTR_IPV4 && ra->prefix.u.addr4.addr != rb->prefix.u.addr4.addr)
+		return ra->prefix.u.addr4.addr < rb->prefix.u.addr4.addr ? -1 : 1;
+	if (ra->prefix.ver == LRTR_IPV6 && !lrtr_ip_addr_equal(ra->prefix, rb->prefix))
+		return memcmp(ra->prefix.u.addr6.addr, rb->prefix.u.addr6.addr, sizeof(ra->prefix.u.addr6.addr));
+	if (ra->asn != rb->asn)
+		return ra->asn < rb->asn ? -1 : 1;
+	if (ra->max_len != rb->max_len)
+		return ra->max_len < rb->max_len ? -1 : 1;
+	if (ra->socket != rb->socket)
+		return ra->socket < rb->socket ? -1 : 1;
+	return 0;
+}
+
+static void assert_same_records(struct pfx_record *a, const unsigned int a_len, struct pfx_record *b,
+				const unsigned int b_len)
+{
+	assert(a_len == b_len);
+	if (a_len == 0)
+		return;
+	qsort(a, a_len, sizeof(*a), record_cmp);
+	qsort(b, b_len, sizeof(*b), record_cmp);
+	for (unsigned int i = 0; i < a_len; i++)
+		assert(record_cmp(&a[i], &b[i]) == 0);
+}
+
+/* Like compare_validation(), but the records of a reason may be ordered differently within a prefix */
+static void compare_validation_unordered(struct pfx_table *trie, struct pfx_table *succinct,
+					 const struct pfx_record *route)
+{
+	struct pfx_record *trie_reason = NULL;
+	struct pfx_record *succinct_reason = NULL;
+	unsigned int trie_reason_len = 0;
+	unsigned int succinct_reason_len = 0;
+	enum pfxv_state trie_res;
+	enum pfxv_state succinct_res;
+
+	assert(pfx_table_validate_r(trie, &trie_reason, &trie_reason_len, route->asn, &route->prefix, route->max_len,
+				    &trie_res) == PFX_SUCCESS);
+	assert(pfx_table_validate_r(succinct, &succinct_reason, &succinct_reason_len, route->asn, &route->prefix,
+				    route->max_len, &succinct_res) == PFX_SUCCESS);
+	assert(trie_res == succinct_res);
+	assert_same_records(trie_reason, trie_reason_len, succinct_reason, succinct_reason_len);
+	free(trie_reason);
+	free(succinct_reason);
+}
+
+static void compare_records(struct pfx_table *trie, struct pfx_table *succinct)
+{
+	for (unsigned int i = 0; i < 2; i++) {
+		struct traversal_records iterated = {NULL, 0, 0};
+		struct pfx_record *trie_records;
+		struct pfx_record *succinct_records;
+		unsigned int trie_len;
+		unsigned int succinct_len;
+
+		assert(pfx_table_get_records(trie, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &trie_records, &trie_len) ==
+		       PFX_SUCCESS);
+		assert(pfx_table_get_records(succinct, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &succinct_records,
+					     &succinct_len) == PFX_SUCCESS);
+		if (i == 0)
+			pfx_table_for_each_ipv4_record(succinct, traversal_collect_cb, &iterated);
+		else
+			pfx_table_for_each_ipv6_record(succinct, traversal_collect_cb, &iterated);
+
+		assert_same_records(trie_records, trie_len, iterated.records, iterated.len);
+		assert_same_records(trie_records, trie_len, succinct_records, succinct_len);
+		free(trie_records);
+		free(succinct_records);
+		free(iterated.records);
+	}
+	assert(pfx_table_digest(trie, LRTR_IPV4) == pfx_table_digest(succinct, LRTR_IPV4));
+	assert(pfx_table_digest(trie, LRTR_IPV6) == pfx_table_digest(succinct, LRTR_IPV6));
+}
+
+/**
+ * @brief Stores records in the succinct encoding and verifies that all
+ * operations give the same results as with the trie storage, while the
+ * encoding takes a few bytes per record.
+ */
+static void test_pfx_succinct_storage(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_table trie;
+	struct pfx_table copy;
+	struct pfx_record pfx;
+	struct pfx_record records[6000];
+	struct pfx_record route;
+	struct rtr_socket *sockets[2] = {(struct rtr_socket *)1, (struct rtr_socket *)2};
+	struct pfx_record *reason = NULL;
+	unsigned int reason_len = 0;
+	enum pfxv_state res;
+	size_t size;
+
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_SUCCINCT) == PFX_SUCCESS);
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 8, 24);
+	add_ip4_pfx_record(&pfxt, 2, "10.1.0.0", 16, 24);
+	add_ip4_pfx_record(&pfxt, 3, "10.1.0.0", 16, 16);
+	create_ip4_pfx_record(&pfx, 0, "192.168.0.0", 16, 16);
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_SUCCESS);
+	pfx.socket = NULL;
+	pfx.asn = 4;
+	assert(!lrtr_ip_str_to_addr("2001:db8::", &pfx.prefix));
+	pfx.min_len = 32;
+	pfx.max_len = 48;
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_SUCCESS);
+
+	/* the records are merged into the encoding after a synchronisation */
+	assert(pfxt.ipv4 && pfxt.ipv6);
+	pfx_table_compact_after_sync(&pfxt);
+	assert(!pfxt.ipv4 && !pfxt.ipv6);
+	assert(pfx_succinct_count(pfxt.succinct) == 5);
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_DUPLICATE_RECORD);
+
+	validate(&pfxt, 1, "10.0.0.0", 8, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 2, "10.1.5.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 3, "10.1.5.0", 24, BGP_PFXV_STATE_INVALID);
+	validate(&pfxt, 1, "11.0.0.0", 8, BGP_PFXV_STATE_NOT_FOUND);
+	validate(&pfxt, 0, "192.168.0.0", 16, BGP_PFXV_STATE_INVALID);
+	validate(&pfxt, 4, "2001:db8:1::", 48, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 4, "2001:db8:1::", 49, BGP_PFXV_STATE_INVALID);
+	assert(!lrtr_ip_str_to_addr("10.1.5.0", &route.prefix));
+	assert(pfx_table_validate_r(&pfxt, &reason, &reason_len, 3, &route.prefix, 24, &res) == PFX_SUCCESS);
+	assert(res == BGP_PFXV_STATE_INVALID);
+	assert(reason_len == 3);
+	free(reason);
+	reason = NULL;
+	reason_len = 0;
+
+	/* encoded records are marked as removed and restored when they are added again */
+	create_ip4_pfx_record(&pfx, 2, "10.1.0.0", 16, 24);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_RECORD_NOT_FOUND);
+	assert(pfx_succinct_removed(pfxt.succinct) == 1);
+	validate(&pfxt, 2, "10.1.5.0", 24, BGP_PFXV_STATE_INVALID);
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(!pfxt.ipv4);
+	assert(pfx_succinct_removed(pfxt.succinct) == 0);
+	validate(&pfxt, 2, "10.1.5.0", 24, BGP_PFXV_STATE_VALID);
+
+	/* records of the trie and the encoding are combined */
+	add_ip4_pfx_record(&pfxt, 5, "10.1.0.0", 16, 20);
+	add_ip4_pfx_record(&pfxt, 6, "10.1.4.0", 22, 24);
+	assert(pfxt.ipv4);
+	validate(&pfxt, 5, "10.1.0.0", 20, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 6, "10.1.5.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 6, "10.1.8.0", 24, BGP_PFXV_STATE_INVALID);
+	assert(pfx_table_validate_r(&pfxt, &reason, &reason_len, 7, &route.prefix, 24, &res) == PFX_SUCCESS);
+	assert(res == BGP_PFXV_STATE_INVALID);
+	assert(reason_len == 5);
+	free(reason);
+
+	/* the storage can not be combined with the other lookup structures */
+	assert(pfx_table_set_engine(&pfxt, PFX_ENGINE_BSPL) == PFX_ERROR);
+	assert(pfx_table_enable_frozen_index(&pfxt) == PFX_ERROR);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_ERROR);
+	assert(pfx_table_src_remove(&pfxt, sockets[0]) == PFX_SUCCESS);
+	assert(pfx_table_src_remove(&pfxt, NULL) == PFX_SUCCESS);
+	validate(&pfxt, 1, "10.0.0.0", 8, BGP_PFXV_STATE_NOT_FOUND);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	assert(!pfxt.succinct);
+	pfx_table_free(&pfxt);
+
+	/* the results equal the ones of the trie storage while records are added, removed and merged */
+	srand(94);
+	pfx_table_init(&trie, NULL);
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_SUCCINCT) == PFX_SUCCESS);
+	trie.update_fp = update_cb_traversal;
+	pfxt.update_fp = update_cb_traversal;
+
+	for (unsigned int round = 0; round < 3; round++) {
+		memset(traversal_notified, 0, sizeof(traversal_notified));
+		for (unsigned int i = 0; i < 6000; i++) {
+			if (round == 0) {
+				random_pfx_record(&records[i], i % 2);
+				records[i].asn = rand() % 64;
+				records[i].socket = sockets[i % 3 == 0];
+			}
+			int rtval = pfx_table_add(&trie, &records[i]);
+
+			assert(pfx_table_add(&pfxt, &records[i]) == rtval);
+		}
+		if (round == 1)
+			pfx_table_compact_after_sync(&pfxt);
+
+		for (unsigned int i = round; i < 6000; i += 2) {
+			int rtval = pfx_table_remove(&trie, &records[i]);
+
+			assert(pfx_table_remove(&pfxt, &records[i]) == rtval);
+		}
+		assert(traversal_notified[true] % 2 == 0 && traversal_notified[false] % 2 == 0);
+
+		for (unsigned int i = 0; i < 20000; i++) {
+			random_pfx_record(&route, i % 2);
+			route.asn = rand() % 64;
+			route.max_len = route.min_len + rand() % ((i % 2 ? 128 : 32) - route.min_len + 1);
+			compare_validation_unordered(&trie, &pfxt, &route);
+		}
+		compare_records(&trie, &pfxt);
+	}
+
+	/* the copy of the shadow table and the removal of a socket see the encoded records */
+	pfx_table_init(&copy, NULL);
+	assert(pfx_table_set_storage(&copy, PFX_STORAGE_SUCCINCT) == PFX_SUCCESS);
+	assert(pfx_table_copy_except_socket(&pfxt, &copy, sockets[0]) == PFX_SUCCESS);
+	assert(pfx_table_src_remove(&trie, sockets[0]) == PFX_SUCCESS);
+	compare_records(&trie, &copy);
+	memset(traversal_notified, 0, sizeof(traversal_notified));
+	assert(pfx_table_src_remove(&pfxt, sockets[0]) == PFX_SUCCESS);
+	compare_records(&trie, &pfxt);
+	pfx_table_free(&copy);
+
+	pfxt.update_fp = NULL;
+	trie.update_fp = NULL;
+	pfx_table_free(&trie);
+	pfx_table_free(&pfxt);
+
+	/* a table with the size of the global VRP set takes a few bytes per record */
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_SUCCINCT) == PFX_SUCCESS);
+	for (unsigned int i = 0; i < 400000; i++) {
+		memset(&pfx, 0, sizeof(pfx));
+		pfx.prefix.ver = i % 8 == 0 ? LRTR_IPV6 : LRTR_IPV4;
+		pfx.asn = rand() % 80000;
+		if (pfx.prefix.ver == LRTR_IPV4) {
+			pfx.min_len = 12 + rand() % 13;
+			pfx.prefix.u.addr4.addr = (uint32_t)rand() << 1;
+		} else {
+			pfx.min_len = 24 + rand() % 25;
+			pfx.prefix.u.addr6.addr[0] = 0x20000000 | (rand() & 0x0fffffff);
+			pfx.prefix.u.addr6.addr[1] = rand();
+		}
+		pfx.prefix = lrtr_ip_addr_get_bits(&pfx.prefix, 0, pfx.min_len);
+		pfx.max_len = pfx.min_len + (rand() % 4 == 0 ? rand() % 8 : 0);
+		pfx_table_add(&pfxt, &pfx);
+	}
+	pfx_table_compact_after_sync(&pfxt);
+	assert(!pfxt.ipv4 && !pfxt.ipv6);
+	size = pfx_succinct_size(pfxt.succinct);
+	printf("%s() %u records take %zu bytes\n", __func__, pfx_succinct_count(pfxt.succinct), size);
+	assert(size < 8 * pfx_succinct_count(pfxt.succinct));
+	pfx_table_free(&pfxt);
+
+	printf("%s() successful\n", __func__);
+}
+
+/* A random record in 10.0.0.0/16 with few origin ASes, so that many records subsume or complement each other */
+static void random_dense_pfx_record(struct pfx_record *pfx, const uint8_t min_len, const uint8_t max_len)
+{
+	memset(pfx, 0, sizeof(*pfx));
+	pfx->asn = rand() % 4;
+	pfx->min_len = min_len + rand() % (max_len - min_len + 1);
+	pfx->max_len = pfx->min_len + rand() % 4;
+	pfx->prefix.ver = LRTR_IPV4;
+	pfx->prefix.u.addr4.addr = 10U << 24 | (rand() & 0xffff);
+	pfx->prefix = lrtr_ip_addr_get_bits(&pfx->prefix, 0, pfx->min_len);
+}
+
+/**
+ * @brief Stores records with PFX_STORAGE_COMPRESSED and verifies that the
+ * trie holds fewer nodes, while validations, iterations and socket removals
+ * give the same results as with the trie storage.
+ */
+static void test_pfx_compressed_storage(void)
+{
+	struct pfx_table pfxt;
+	struct pfx_table trie;
+	struct pfx_table copy;
+	struct pfx_record pfx;
+	struct pfx_record records[3000];
+	struct pfx_record route;
+	struct rtr_socket *sockets[2] = {(struct rtr_socket *)1, (struct rtr_socket *)2};
+	struct pfx_record *reason = NULL;
+	unsigned int reason_len = 0;
+	enum pfxv_state trie_res;
+	enum pfxv_state res;
+	unsigned int removed;
+
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_COMPRESSED) == PFX_SUCCESS);
+
+	/* two sibling prefixes and their parent are merged into one node */
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 24, 24);
+	add_ip4_pfx_record(&pfxt, 1, "10.0.1.0", 24, 24);
+	assert(count_trie_nodes(pfxt.ipv4) == 2);
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 23, 23);
+	assert(count_trie_nodes(pfxt.ipv4) == 1);
+	validate(&pfxt, 1, "10.0.1.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 1, "10.0.0.0", 25, BGP_PFXV_STATE_INVALID);
+
+	/* the reason lists the original records that cover the route */
+	assert(!lrtr_ip_str_to_addr("10.0.1.0", &route.prefix));
+	assert(pfx_table_validate_r(&pfxt, &reason, &reason_len, 2, &route.prefix, 24, &res) == PFX_SUCCESS);
+	assert(res == BGP_PFXV_STATE_INVALID);
+	assert(reason_len == 2);
+	free(reason);
+	reason = NULL;
+	reason_len = 0;
+
+	/* records that a less specific record covers do not add nodes */
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 8, 24);
+	add_ip4_pfx_record(&pfxt, 1, "10.5.0.0", 16, 20);
+	create_ip4_pfx_record(&pfx, 0, "10.6.0.0", 16, 16);
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_SUCCESS);
+	create_ip4_pfx_record(&pfx, 1, "10.5.0.0", 16, 20);
+	pfx.socket = sockets[1];
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(pfx_table_add(&pfxt, &pfx) == PFX_DUPLICATE_RECORD);
+	assert(count_trie_nodes(pfxt.ipv4) == 1);
+	validate(&pfxt, 0, "10.6.0.0", 16, BGP_PFXV_STATE_INVALID);
+
+	/* removing the covering record restores the covered ones */
+	create_ip4_pfx_record(&pfx, 1, "10.0.0.0", 8, 24);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_RECORD_NOT_FOUND);
+	assert(count_trie_nodes(pfxt.ipv4) == 3);
+	validate(&pfxt, 1, "10.0.1.0", 24, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 1, "10.1.0.0", 16, BGP_PFXV_STATE_NOT_FOUND);
+	validate(&pfxt, 1, "10.5.0.0", 20, BGP_PFXV_STATE_VALID);
+	validate(&pfxt, 1, "10.6.0.0", 16, BGP_PFXV_STATE_INVALID);
+
+	/* the record stays valid until it is removed for both sockets */
+	create_ip4_pfx_record(&pfx, 1, "10.5.0.0", 16, 20);
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	validate(&pfxt, 1, "10.5.0.0", 20, BGP_PFXV_STATE_VALID);
+	pfx.socket = sockets[1];
+	assert(pfx_table_remove(&pfxt, &pfx) == PFX_SUCCESS);
+	validate(&pfxt, 1, "10.5.0.0", 20, BGP_PFXV_STATE_NOT_FOUND);
+
+	/* the storage can not be combined with the other lookup structures and is only switched while empty */
+	assert(pfx_table_set_engine(&pfxt, PFX_ENGINE_BSPL) == PFX_ERROR);
+	assert(pfx_table_enable_frozen_index(&pfxt) == PFX_ERROR);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_ERROR);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_SUCCINCT) == PFX_ERROR);
+	assert(pfx_table_src_remove(&pfxt, sockets[0]) == PFX_SUCCESS);
+	assert(!pfxt.ipv4);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	assert(!pfxt.compressed);
+	add_ip4_pfx_record(&pfxt, 1, "10.0.0.0", 8, 24);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_COMPRESSED) == PFX_ERROR);
+	pfx_table_free(&pfxt);
+
+	/* the results equal the ones of the trie storage while records are added and removed */
+	srand(97);
+	pfx_table_init(&trie, NULL);
+	pfx_table_init(&pfxt, NULL);
+	assert(pfx_table_set_storage(&trie, PFX_STORAGE_TRIE) == PFX_SUCCESS);
+	assert(pfx_table_set_storage(&pfxt, PFX_STORAGE_COMPRESSED) == PFX_SUCCESS);
+	trie.update_fp = update_cb_traversal;
+	pfxt.update_fp = update_cb_traversal;
+
+	for (unsigned int round = 0; round < 3; round++) {
+		if (round == 2)
+			assert(pfx_table_set_removal(&pfxt, PFX_REMOVAL_DEFERRED) == PFX_SUCCESS);
+		for (unsigned int i = 0; i < 3000; i++) {
+			if (round == 0) {
+				random_dense_pfx_record(&records[i], 16, 22);
+				records[i].socket = sockets[i % 3 == 0];
+			}
+			int rtval = pfx_table_add(&trie, &records[i]);
+
+			assert(pfx_table_add(&pfxt, &records[i]) == rtval);
+		}
+		assert(count_trie_nodes(pfxt.ipv4) < count_trie_nodes(trie.ipv4));
+
+		for (unsigned int i = round; i < 3000; i += 2) {
+			int rtval = pfx_table_remove(&trie, &records[i]);
+
+			assert(pfx_table_remove(&pfxt, &records[i]) == rtval);
+		}
+
+		for (unsigned int i = 0; i < 20000; i++) {
+			random_dense_pfx_record(&route, 15, 24);
+			route.asn = rand() % 5;
+			assert(pfx_table_validate(&trie, route.asn, &route.prefix, route.min_len, &trie_res) ==
+			       PFX_SUCCESS);
+			assert(pfx_table_validate(&pfxt, route.asn, &route.prefix, route.min_len, &res) == PFX_SUCCESS);
+			assert(res == trie_res);
+		}
+		compare_records(&trie, &pfxt);
+	}
+
+	/* the copy of the shadow table and the removal of a socket see the original records */
+	pfx_table_init(&copy, NULL);
+	assert(pfx_table_set_storage(&copy, PFX_STORAGE_COMPRESSED) == PFX_SUCCESS);
+	assert(pfx_table_copy_except_socket(&pfxt, &copy, sockets[0]) == PFX_SUCCESS);
+	assert(pfx_table_src_remove(&trie, sockets[0]) == PFX_SUCCESS);
+	compare_records(&trie, &copy);
+	memset(traversal_notified, 0, sizeof(traversal_notified));
+	assert(pfx_table_src_remove(&pfxt, sockets[0]) == PFX_SUCCESS);
+	compare_records(&trie, &pfxt);
+	assert(traversal_notified[true] == 0 && traversal_notified[false] > 0);
+	pfx_table_free(&copy);
+
+	/* the clients are notified about the original records when the table is freed */
+	memset(traversal_notified, 0, sizeof(traversal_notified));
+	pfx_table_free(&trie);
+	removed = traversal_notified[false];
+	assert(removed > 0);
+	traversal_notified[false] = 0;
+	pfx_table_free(&pfxt);
+	assert(traversal_notified[false] == removed);
+
+	printf("%s() successful\n", __func__);
+}
+
 int main(void)
 {
 	pfx_table_test();
@@ -445,6 +1443,15 @@ int main(void)
 	test_issue99();
 	test_issue152();
 	test_pfx_merge();
+	test_pfx_exact_index();
+	test_pfx_bspl_engine();
+	test_pfx_frozen_index();
+	test_pfx_src_handover();
+	test_pfx_digest();
+	test_pfx_parallel_traversal();
+	test_pfx_tombstones();
+	test_pfx_succinct_storage();
+	test_pfx_compressed_storage();
 
 	return EXIT_SUCCESS;
 }
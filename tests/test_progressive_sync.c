@@ -0,0 +1,300 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "fake_cache.h"
+
+#include "rtrlib/rtrlib.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SESSION_ID 42
+#define RECORDS 3000
+// the socket adds the records in batches of 1024 PDUs, the last batch is added at EOD
+#define VISIBLE_BEFORE_EOD 2048
+
+/**
+ * @brief Test state of the fake cache.
+ * @param cache The fake cache
+ * @param send_eod Whether EOD is sent or the connection is closed once released
+ * @param duplicate Whether the first prefix is announced a second time before EOD
+ * @param released Set by release_cache()
+ */
+struct cache {
+	struct fake_cache cache;
+	bool send_eod;
+	bool duplicate;
+	bool released;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static unsigned int pfx_added;
+static unsigned int pfx_removed;
+static unsigned int status_errors;
+static struct rtr_mgr_config *status_conf;
+
+static void update_cb(struct pfx_table *pfx_table __attribute__((unused)),
+		      const struct pfx_record record __attribute__((unused)), const bool added)
+{
+	if (added)
+		__atomic_add_fetch(&pfx_added, 1, __ATOMIC_SEQ_CST);
+	else
+		__atomic_add_fetch(&pfx_removed, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Answers the Reset Query with RECORDS IPv4 prefixes, EOD is sent or the connection is closed once released */
+static void *run_cache(void *arg)
+{
+	struct cache *cache = arg;
+
+	fake_cache_accept(&cache->cache);
+	fake_cache_read_query(&cache->cache);
+	fake_cache_send_response(&cache->cache, SESSION_ID);
+
+	for (uint32_t i = 0; i < RECORDS; i++)
+		fake_cache_send_ipv4(&cache->cache, 1, (10U << 24) | (i << 8), 24, 24, 65000);
+
+	pthread_mutex_lock(&cache->mutex);
+	while (!cache->released)
+		pthread_cond_wait(&cache->cond, &cache->mutex);
+	pthread_mutex_unlock(&cache->mutex);
+
+	if (cache->duplicate)
+		fake_cache_send_ipv4(&cache->cache, 1, 10U << 24, 24, 24, 65000);
+
+	if (cache->send_eod) {
+		fake_cache_send_eod(&cache->cache, SESSION_ID, 1);
+	} else {
+		close(cache->cache.fd);
+		cache->cache.fd = -1;
+	}
+	return NULL;
+}
+
+static void release_cache(struct cache *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	cache->released = true;
+	pthread_cond_signal(&cache->cond);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+static enum pfxv_state validate(struct rtr_mgr_config *conf, const uint32_t i)
+{
+	struct lrtr_ip_addr addr = {.ver = LRTR_IPV4, .u.addr4.addr = (10U << 24) | (i << 8)};
+	enum pfxv_state result;
+
+	assert(rtr_mgr_validate(conf, 65000, &addr, 24, &result) == PFX_SUCCESS);
+	return result;
+}
+
+static void *validate_route(void *arg __attribute__((unused)))
+{
+	struct rtr_mgr_route route = {.prefix = {.ver = LRTR_IPV4, .u.addr4.addr = 10U << 24},
+				      .mask_len = 24,
+				      .origin_asn = 65000};
+	struct rtr_mgr_route_result result;
+
+	assert(rtr_mgr_validate_route(status_conf, &route, &result) == RTR_SUCCESS);
+	return NULL;
+}
+
+/*
+ * Validates a route like an application that looks at its routes again once a socket failed. The validation runs
+ * on another thread, which waits as long as the socket thread holds the lock of the tables.
+ */
+static void status_cb(const struct rtr_mgr_group *group __attribute__((unused)), enum rtr_mgr_status status,
+		      const struct rtr_socket *socket __attribute__((unused)), void *data __attribute__((unused)))
+{
+	pthread_t thread;
+
+	if (status != RTR_MGR_ERROR)
+		return;
+
+	assert(pthread_create(&thread, NULL, validate_route, NULL) == 0);
+	assert(pthread_join(thread, NULL) == 0);
+	__atomic_add_fetch(&status_errors, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Waits up to ten seconds until the counter reaches the expected value */
+static bool wait_for_count(const unsigned int *counter, const unsigned int count)
+{
+	for (unsigned int i = 0; i < 100; i++) {
+		if (__atomic_load_n(counter, __ATOMIC_SEQ_CST) == count)
+			return true;
+		usleep(100 * 1000);
+	}
+	return false;
+}
+
+/* Starts a manager with one socket that synchronises with a cache thread */
+static void start_sync(struct cache *cache, pthread_t *cache_thread, struct tr_socket *tr_tcp,
+		       struct rtr_socket *rtr_tcp, struct rtr_socket **sockets, struct rtr_mgr_config **conf,
+		       const bool progressive, const bool send_eod, const bool duplicate)
+{
+	struct tr_tcp_config tcp_config;
+	struct rtr_mgr_group groups[1];
+
+	memset(cache, 0, sizeof(*cache));
+	cache->send_eod = send_eod;
+	cache->duplicate = duplicate;
+	pthread_mutex_init(&cache->mutex, NULL);
+	pthread_cond_init(&cache->cond, NULL);
+	fake_cache_listen(&cache->cache);
+	assert(pthread_create(cache_thread, NULL, run_cache, cache) == 0);
+
+	fake_cache_tcp_config(&cache->cache, &tcp_config);
+	assert(tr_tcp_init(&tcp_config, tr_tcp) == TR_SUCCESS);
+	rtr_tcp->tr_socket = tr_tcp;
+	sockets[0] = rtr_tcp;
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 1;
+	groups[0].preference = 1;
+
+	__atomic_store_n(&pfx_added, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&pfx_removed, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&status_errors, 0, __ATOMIC_SEQ_CST);
+	assert(rtr_mgr_init(conf, groups, 1, 3600, 7200, 600, update_cb, NULL, status_cb, NULL) == RTR_SUCCESS);
+	status_conf = *conf;
+	rtr_set_progressive_sync(rtr_tcp, progressive);
+	assert(rtr_mgr_start(*conf) == RTR_SUCCESS);
+}
+
+static void stop_sync(struct cache *cache, pthread_t cache_thread, struct rtr_mgr_config *conf)
+{
+	rtr_mgr_stop(conf);
+	rtr_mgr_free(conf);
+	assert(pthread_join(cache_thread, NULL) == 0);
+	fake_cache_close(&cache->cache);
+	pthread_mutex_destroy(&cache->mutex);
+	pthread_cond_destroy(&cache->cond);
+}
+
+/*
+ * @brief The records of the initial synchronisation are visible before EOD
+ * arrives, EOD only marks the socket as in sync.
+ */
+static void test_progressive_sync(void)
+{
+	struct cache cache;
+	pthread_t cache_thread;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1];
+	struct rtr_mgr_config *conf;
+
+	start_sync(&cache, &cache_thread, &tr_tcp, &rtr_tcp, sockets, &conf, true, true, false);
+
+	assert(wait_for_count(&pfx_added, VISIBLE_BEFORE_EOD));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, VISIBLE_BEFORE_EOD - 1) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, RECORDS - 1) == BGP_PFXV_STATE_NOT_FOUND);
+	assert(!rtr_mgr_conf_in_sync(conf));
+
+	release_cache(&cache);
+	assert(wait_for_count(&pfx_added, RECORDS));
+	for (unsigned int i = 0; i < 100 && !rtr_mgr_conf_in_sync(conf); i++)
+		usleep(100 * 1000);
+	assert(rtr_mgr_conf_in_sync(conf));
+	assert(validate(conf, RECORDS - 1) == BGP_PFXV_STATE_VALID);
+
+	stop_sync(&cache, cache_thread, conf);
+}
+
+/*
+ * @brief Without the option, the records become visible at EOD at once.
+ */
+static void test_atomic_sync(void)
+{
+	struct cache cache;
+	pthread_t cache_thread;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1];
+	struct rtr_mgr_config *conf;
+
+	start_sync(&cache, &cache_thread, &tr_tcp, &rtr_tcp, sockets, &conf, false, true, false);
+
+	sleep(1);
+	assert(__atomic_load_n(&pfx_added, __ATOMIC_SEQ_CST) == 0);
+	assert(validate(conf, 0) == BGP_PFXV_STATE_NOT_FOUND);
+
+	release_cache(&cache);
+	assert(wait_for_count(&pfx_added, RECORDS));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+
+	stop_sync(&cache, cache_thread, conf);
+}
+
+/*
+ * @brief The records of a progressive synchronisation that fails before EOD
+ * are removed again.
+ */
+static void test_aborted_progressive_sync(void)
+{
+	struct cache cache;
+	pthread_t cache_thread;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1];
+	struct rtr_mgr_config *conf;
+
+	start_sync(&cache, &cache_thread, &tr_tcp, &rtr_tcp, sockets, &conf, true, false, false);
+
+	assert(wait_for_count(&pfx_added, VISIBLE_BEFORE_EOD));
+	release_cache(&cache);
+	assert(wait_for_count(&pfx_removed, VISIBLE_BEFORE_EOD));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_NOT_FOUND);
+	assert(!rtr_mgr_conf_in_sync(conf));
+
+	stop_sync(&cache, cache_thread, conf);
+}
+
+/*
+ * @brief A duplicate announcement fails the synchronisation. The status
+ * callback of the failed socket can validate routes, the tables are unlocked
+ * before the state of the socket changes.
+ */
+static void test_failed_sync_status(const bool progressive)
+{
+	struct cache cache;
+	pthread_t cache_thread;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1];
+	struct rtr_mgr_config *conf;
+
+	start_sync(&cache, &cache_thread, &tr_tcp, &rtr_tcp, sockets, &conf, progressive, true, true);
+
+	release_cache(&cache);
+	for (unsigned int i = 0; i < 100 && !__atomic_load_n(&status_errors, __ATOMIC_SEQ_CST); i++)
+		usleep(100 * 1000);
+	assert(__atomic_load_n(&status_errors, __ATOMIC_SEQ_CST) > 0);
+	assert(validate(conf, 0) == BGP_PFXV_STATE_NOT_FOUND);
+	assert(!rtr_mgr_conf_in_sync(conf));
+
+	stop_sync(&cache, cache_thread, conf);
+}
+
+int main(void)
+{
+	test_progressive_sync();
+	test_atomic_sync();
+	test_aborted_progressive_sync();
+	test_failed_sync_status(false);
+	test_failed_sync_status(true);
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
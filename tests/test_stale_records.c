@@ -0,0 +1,193 @@
+/*
+ * This file is part of RTRlib.
+ *
+ * This file is subject to the terms and conditions of the MIT license.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * Website: http://rtrlib.realmv6.org/
+ */
+
+#include "fake_cache.h"
+
+#include "rtrlib/rtrlib.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SESSION_ID 42
+
+/**
+ * @brief Test state of the fake cache.
+ * @param cache The fake cache
+ * @param step Incremented by the test to let the cache continue
+ */
+struct cache {
+	struct fake_cache cache;
+	unsigned int step;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static unsigned int pfx_added;
+static unsigned int pfx_removed;
+
+static void update_cb(struct pfx_table *pfx_table __attribute__((unused)),
+		      const struct pfx_record record __attribute__((unused)), const bool added)
+{
+	if (added)
+		__atomic_add_fetch(&pfx_added, 1, __ATOMIC_SEQ_CST);
+	else
+		__atomic_add_fetch(&pfx_removed, 1, __ATOMIC_SEQ_CST);
+}
+
+static void wait_for_step(struct cache *cache, const unsigned int step)
+{
+	pthread_mutex_lock(&cache->mutex);
+	while (cache->step < step)
+		pthread_cond_wait(&cache->cond, &cache->mutex);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+static void next_step(struct cache *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	cache->step++;
+	pthread_cond_signal(&cache->cond);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/* Answers a Reset Query with the prefixes 10.0.i.0/24 of the given indexes */
+static void answer_reset(struct cache *cache, const unsigned int *indexes, const unsigned int indexes_len,
+			 const uint32_t serial)
+{
+	assert(fake_cache_read_query(&cache->cache) == 2);
+	fake_cache_send_response(&cache->cache, SESSION_ID);
+	for (unsigned int i = 0; i < indexes_len; i++)
+		fake_cache_send_ipv4(&cache->cache, 1, (10U << 24) | (indexes[i] << 8), 24, 24, 65000);
+	fake_cache_send_eod(&cache->cache, SESSION_ID, serial);
+}
+
+/*
+ * Serves 10.0.0.0/24 to 10.0.2.0/24 and closes the connection once the test expired the records. The reset of
+ * the next connection replaces 10.0.2.0/24 by 10.0.3.0/24.
+ */
+static void *run_cache(void *arg)
+{
+	struct cache *cache = arg;
+	const unsigned int first[] = {0, 1, 2};
+	const unsigned int second[] = {0, 1, 3};
+
+	fake_cache_accept(&cache->cache);
+	answer_reset(cache, first, 3, 1);
+
+	wait_for_step(cache, 1);
+	close(cache->cache.fd);
+	cache->cache.fd = -1;
+
+	wait_for_step(cache, 2);
+	fake_cache_accept(&cache->cache);
+	answer_reset(cache, second, 3, 2);
+	return NULL;
+}
+
+static enum pfxv_state validate(struct rtr_mgr_config *conf, const uint32_t i)
+{
+	struct lrtr_ip_addr addr = {.ver = LRTR_IPV4, .u.addr4.addr = (10U << 24) | (i << 8)};
+	enum pfxv_state result;
+
+	assert(rtr_mgr_validate(conf, 65000, &addr, 24, &result) == PFX_SUCCESS);
+	return result;
+}
+
+/* Waits up to ten seconds until the counter reaches the expected value */
+static bool wait_for_count(const unsigned int *counter, const unsigned int count)
+{
+	for (unsigned int i = 0; i < 100; i++) {
+		if (__atomic_load_n(counter, __ATOMIC_SEQ_CST) == count)
+			return true;
+		usleep(100 * 1000);
+	}
+	return false;
+}
+
+/*
+ * @brief Expired records of a socket that retains them stay visible and are
+ * marked as stale. The reset after the reconnect only reports the records
+ * that changed.
+ */
+static void test_retain_stale_records(void)
+{
+	struct cache cache;
+	pthread_t cache_thread;
+	struct tr_tcp_config tcp_config;
+	struct tr_socket tr_tcp;
+	struct rtr_socket rtr_tcp;
+	struct rtr_socket *sockets[1] = {&rtr_tcp};
+	struct rtr_mgr_group groups[1];
+	struct rtr_mgr_config *conf;
+	bool stale = false;
+
+	memset(&cache, 0, sizeof(cache));
+	pthread_mutex_init(&cache.mutex, NULL);
+	pthread_cond_init(&cache.cond, NULL);
+	fake_cache_listen(&cache.cache);
+	assert(pthread_create(&cache_thread, NULL, run_cache, &cache) == 0);
+
+	fake_cache_tcp_config(&cache.cache, &tcp_config);
+	assert(tr_tcp_init(&tcp_config, &tr_tcp) == TR_SUCCESS);
+	rtr_tcp.tr_socket = &tr_tcp;
+	groups[0].sockets = sockets;
+	groups[0].sockets_len = 1;
+	groups[0].preference = 1;
+
+	assert(rtr_mgr_init(&conf, groups, 1, 3600, 7200, 1, update_cb, NULL, NULL, NULL) == RTR_SUCCESS);
+	rtr_set_retain_stale_records(&rtr_tcp, true);
+	assert(rtr_mgr_start(conf) == RTR_SUCCESS);
+	assert(wait_for_count(&pfx_added, 3));
+	assert(!rtr_has_stale_records(&rtr_tcp));
+
+	// EOD set the intervals, the records expire as soon as the socket reconnects a second later
+	rtr_tcp.expire_interval = 0;
+	rtr_tcp.retry_interval = 1;
+	sleep(1);
+	next_step(&cache);
+	for (unsigned int i = 0; i < 100 && !stale; i++) {
+		stale = rtr_has_stale_records(&rtr_tcp);
+		usleep(100 * 1000);
+	}
+	assert(stale);
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, 2) == BGP_PFXV_STATE_VALID);
+	assert(__atomic_load_n(&pfx_removed, __ATOMIC_SEQ_CST) == 0);
+
+	// the reset only reports the replaced prefix
+	next_step(&cache);
+	assert(wait_for_count(&pfx_added, 4));
+	assert(wait_for_count(&pfx_removed, 1));
+	for (unsigned int i = 0; i < 100 && rtr_has_stale_records(&rtr_tcp); i++)
+		usleep(100 * 1000);
+	assert(!rtr_has_stale_records(&rtr_tcp));
+	assert(validate(conf, 0) == BGP_PFXV_STATE_VALID);
+	assert(validate(conf, 2) == BGP_PFXV_STATE_NOT_FOUND);
+	assert(validate(conf, 3) == BGP_PFXV_STATE_VALID);
+	assert(__atomic_load_n(&pfx_added, __ATOMIC_SEQ_CST) == 4);
+
+	rtr_mgr_stop(conf);
+	rtr_mgr_free(conf);
+	assert(pthread_join(cache_thread, NULL) == 0);
+	fake_cache_close(&cache.cache);
+	pthread_mutex_destroy(&cache.mutex);
+	pthread_cond_destroy(&cache.cond);
+}
+
+int main(void)
+{
+	test_retain_stale_records();
+	printf("All tests successful\n");
+	return EXIT_SUCCESS;
+}
@@ -12,6 +12,8 @@
 
 #include "rtrlib/bgpsec/bgpsec_private.h"
 #include "rtrlib/bgpsec/bgpsec_utils.c"
+#include "rtrlib/spki/hashtable/ht-spkitable_private.h"
+#include "rtrlib/spki/keystore/keystore_private.h"
 
 #include <assert.h>
 
@@ -42,10 +44,21 @@ struct rtr_bgpsec *setup_bgpsec(void)
 	return bgpsec;
 }
 
-int __wrap_check_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table)
+int __wrap_resolve_router_keys(const struct rtr_signature_seg *sig_segs, struct spki_table *table,
+			       struct bgpsec_key_set *key_set)
 {
+	static const uint8_t ski[SKI_SIZE];
+	static const uint8_t spki[SPKI_SIZE];
+
 	UNUSED(sig_segs);
 	UNUSED(table);
+	key_set->keys = key_set->inline_keys;
+	key_set->ends = key_set->inline_ends;
+	key_set->skis = key_set->inline_skis;
+	key_set->segs_len = 1;
+	key_set->ends[0] = 1;
+	/* free_router_keys() releases the key */
+	key_set->keys[0].key = spki_key_intern(ski, spki);
 	return (int)mock();
 }
 
@@ -64,38 +77,30 @@ unsigned int __wrap_req_stream_size(const struct rtr_bgpsec *data, enum align_ty
 	return (int)mock();
 }
 
-int __wrap_hash_byte_sequence(uint8_t *bytes, unsigned int bytes_len, uint8_t alg_suite_id, unsigned char **hash_result)
+int __wrap_hash_signed_sequences(const struct rtr_signature_seg *sig_segs, struct stream *s, uint8_t alg_suite_id,
+				 unsigned char *hash_results, unsigned int *hash_results_len)
 {
-	UNUSED(bytes);
-	UNUSED(bytes_len);
+	UNUSED(sig_segs);
+	UNUSED(s);
 	UNUSED(alg_suite_id);
-	UNUSED(hash_result);
+	UNUSED(hash_results);
+	*hash_results_len = 1;
 	return (int)mock();
 }
 
 int __wrap_validate_signature(const unsigned char *hash, const struct rtr_signature_seg *sig,
-			      struct spki_record *record)
+			      const struct spki_key *key)
 {
 	UNUSED(hash);
 	UNUSED(sig);
-	UNUSED(record);
-	return (int)mock();
-}
-
-int __wrap_spki_table_search_by_ski(struct spki_table *spki_table, uint8_t *ski, struct spki_record **result,
-				    unsigned int *result_size)
-{
-	UNUSED(spki_table);
-	UNUSED(ski);
-	UNUSED(result);
-	*result_size = 1;
+	UNUSED(key);
 	return (int)mock();
 }
 
 static void test_sanity_checks(void **state)
 {
 	struct rtr_bgpsec *bgpsec = setup_bgpsec();
-	struct spki_table *table = lrtr_malloc(16);
+	struct spki_table *table = lrtr_calloc(1, sizeof(struct spki_table));
 	enum rtr_bgpsec_rtvals result = RTR_BGPSEC_SUCCESS;
 
 	UNUSED(state);
@@ -143,15 +148,15 @@ static void test_sanity_checks(void **state)
 	lrtr_free(bgpsec);
 }
 
-static void test_check_router_keys(void **state)
+static void test_resolve_router_keys(void **state)
 {
 	struct rtr_bgpsec *bgpsec = setup_bgpsec();
-	struct spki_table *table = lrtr_malloc(16);
+	struct spki_table *table = lrtr_calloc(1, sizeof(struct spki_table));
 	enum rtr_bgpsec_rtvals result = RTR_BGPSEC_SUCCESS;
 
 	UNUSED(state);
 
-	will_return(__wrap_check_router_keys, RTR_BGPSEC_ROUTER_KEY_NOT_FOUND);
+	will_return(__wrap_resolve_router_keys, RTR_BGPSEC_ROUTER_KEY_NOT_FOUND);
 	result = rtr_bgpsec_validate_as_path(bgpsec, table);
 
 	assert_int_equal(RTR_BGPSEC_ROUTER_KEY_NOT_FOUND, result);
@@ -167,14 +172,14 @@ static void test_check_router_keys(void **state)
 static void test_align_byte_sequence(void **state)
 {
 	struct rtr_bgpsec *bgpsec = setup_bgpsec();
-	struct spki_table *table = lrtr_malloc(16);
+	struct spki_table *table = lrtr_calloc(1, sizeof(struct spki_table));
 	enum rtr_bgpsec_rtvals result = RTR_BGPSEC_SUCCESS;
 
 	UNUSED(state);
 
 	will_return(__wrap_align_byte_sequence, RTR_BGPSEC_ERROR);
 	will_return(__wrap_req_stream_size, 12);
-	will_return(__wrap_check_router_keys, RTR_BGPSEC_SUCCESS);
+	will_return(__wrap_resolve_router_keys, RTR_BGPSEC_SUCCESS);
 	result = rtr_bgpsec_validate_as_path(bgpsec, table);
 
 	assert_int_equal(RTR_BGPSEC_ERROR, result);
@@ -187,18 +192,18 @@ static void test_align_byte_sequence(void **state)
 	lrtr_free(bgpsec);
 }
 
-static void test_hash_byte_sequence(void **state)
+static void test_hash_signed_sequences(void **state)
 {
 	struct rtr_bgpsec *bgpsec = setup_bgpsec();
-	struct spki_table *table = lrtr_malloc(16);
+	struct spki_table *table = lrtr_calloc(1, sizeof(struct spki_table));
 	enum rtr_bgpsec_rtvals result = RTR_BGPSEC_SUCCESS;
 
 	UNUSED(state);
 
-	will_return(__wrap_hash_byte_sequence, RTR_BGPSEC_ERROR);
+	will_return(__wrap_hash_signed_sequences, RTR_BGPSEC_ERROR);
 	will_return(__wrap_align_byte_sequence, RTR_BGPSEC_SUCCESS);
 	will_return(__wrap_req_stream_size, 12);
-	will_return(__wrap_check_router_keys, RTR_BGPSEC_SUCCESS);
+	will_return(__wrap_resolve_router_keys, RTR_BGPSEC_SUCCESS);
 	result = rtr_bgpsec_validate_as_path(bgpsec, table);
 
 	assert_int_equal(RTR_BGPSEC_ERROR, result);
@@ -214,17 +219,16 @@ static void test_hash_byte_sequence(void **state)
 static void test_validate_signature(void **state)
 {
 	struct rtr_bgpsec *bgpsec = setup_bgpsec();
-	struct spki_table *table = lrtr_malloc(16);
+	struct spki_table *table = lrtr_calloc(1, sizeof(struct spki_table));
 	enum rtr_bgpsec_rtvals result = RTR_BGPSEC_SUCCESS;
 
 	UNUSED(state);
 
 	will_return(__wrap_validate_signature, RTR_BGPSEC_ERROR);
-	will_return(__wrap_spki_table_search_by_ski, SPKI_SUCCESS);
-	will_return(__wrap_hash_byte_sequence, RTR_BGPSEC_SUCCESS);
+	will_return(__wrap_hash_signed_sequences, RTR_BGPSEC_SUCCESS);
 	will_return(__wrap_align_byte_sequence, RTR_BGPSEC_SUCCESS);
 	will_return(__wrap_req_stream_size, 12);
-	will_return(__wrap_check_router_keys, RTR_BGPSEC_SUCCESS);
+	will_return(__wrap_resolve_router_keys, RTR_BGPSEC_SUCCESS);
 	result = rtr_bgpsec_validate_as_path(bgpsec, table);
 
 	assert_int_equal(RTR_BGPSEC_ERROR, result);
@@ -240,8 +244,8 @@ static void test_validate_signature(void **state)
 int main(void)
 {
 	const struct CMUnitTest tests[] = {
-		cmocka_unit_test(test_sanity_checks),	    cmocka_unit_test(test_check_router_keys),
-		cmocka_unit_test(test_align_byte_sequence), cmocka_unit_test(test_hash_byte_sequence),
+		cmocka_unit_test(test_sanity_checks),	    cmocka_unit_test(test_resolve_router_keys),
+		cmocka_unit_test(test_align_byte_sequence), cmocka_unit_test(test_hash_signed_sequences),
 		cmocka_unit_test(test_validate_signature),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
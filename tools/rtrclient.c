@@ -27,6 +27,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifdef RTRLIB_HAVE_LIBSSH
@@ -47,8 +48,39 @@ __attribute__((format(printf, 1, 2), noreturn)) static void print_error_exit(con
 
 static bool is_readable_file(const char *str);
 
+/* size of the per socket buffer of the streaming output formats */
+#define OUTPUT_BUFFER_SIZE 65536
+/* maximum delay in microseconds before buffered updates are written to stdout */
+#define OUTPUT_FLUSH_INTERVAL 100000
+
+#define OUTPUT_BINARY_PFX_SIZE 28
+#define OUTPUT_BINARY_SPKI_SIZE (8 + SKI_SIZE + SPKI_SIZE)
+
+enum output_format {
+	OUTPUT_FORMAT_TEXT,
+	OUTPUT_FORMAT_NDJSON,
+	OUTPUT_FORMAT_BINARY,
+};
+
+enum output_record_type {
+	OUTPUT_RECORD_PFX = 1,
+	OUTPUT_RECORD_SPKI = 2,
+};
+
+/**
+ * @brief Updates of one socket that were formatted but not yet written to stdout.
+ * @details Updates of a socket are almost always reported by the thread of the socket, so the mutex is
+ * uncontended. stdout_mutex is only taken once per written batch.
+ */
+struct output_buffer {
+	pthread_mutex_t mutex;
+	size_t len;
+	char data[OUTPUT_BUFFER_SIZE];
+};
+
 enum socket_type {
 	SOCKET_TYPE_TCP,
+	SOCKET_TYPE_FILE,
 #ifdef RTRLIB_HAVE_LIBSSH
 	SOCKET_TYPE_SSH,
 #endif
@@ -63,6 +95,12 @@ struct socket_config {
 	char *bindaddr;
 	char *host;
 	char *port;
+	char *vrp_path;
+	char *key_path;
+	uint16_t index;
+	unsigned long updates;
+	unsigned long reported_updates;
+	struct output_buffer output;
 #ifdef RTRLIB_HAVE_LIBSSH
 	char *ssh_username;
 	char *ssh_private_key;
@@ -87,6 +125,10 @@ bool export_pfx = false;
 char *export_file_path = NULL;
 const char *template_name = NULL;
 
+enum output_format output_format = OUTPUT_FORMAT_TEXT;
+/* interval in seconds of the update rate and latency report, 0 disables it */
+unsigned int counter_interval = 0;
+
 struct socket_config **socket_config = NULL;
 size_t socket_count = 0;
 
@@ -126,6 +168,8 @@ static struct socket_config *extend_socket_config()
 	struct socket_config *config = socket_config[socket_count] = checked_malloc(sizeof(struct socket_config));
 
 	memset(config, 0, sizeof(*config));
+	pthread_mutex_init(&config->output.mutex, NULL);
+	config->index = socket_count;
 	++socket_count;
 
 	return config;
@@ -209,6 +253,14 @@ static bool is_valid_port_number(const char *str)
 	return true;
 }
 
+static bool is_valid_counter_interval(const char *str)
+{
+	if (!is_numeric(str) || strlen(str) > 6)
+		return false;
+
+	return atoi(str) > 0;
+}
+
 static bool is_resolveable_host(const char *str)
 {
 	struct addrinfo hints;
@@ -410,9 +462,10 @@ struct mustach_itf template_itf = {.start = NULL,
 static void print_usage(char **argv)
 {
 	printf("Usage:\n");
-	printf(" %s [-hpkels] [-o file] [-t template] <socket>...\n", argv[0]);
+	printf(" %s [-hpkels] [-f format] [-c interval] [-o file] [-t template] <socket>...\n", argv[0]);
 	printf("\nSocket:\n");
 	printf(" tcp [-hpkb bindaddr] <host> <port>\n");
+	printf(" file [-hpk] <vrp_file> [<key_file>]\n");
 #ifdef RTRLIB_HAVE_LIBSSH
 	printf(" ssh [-hpkb bindaddr] <host> <port> <username> (<private_key> | <password>) [<host_key>]\n");
 #endif
@@ -426,7 +479,10 @@ static void print_usage(char **argv)
 
 	printf("-k  Print information about SPKI updates.\n");
 	printf("-p  Print information about PFX updates.\n");
-	printf("-s  Print information about connection status updates.\n\n");
+	printf("-s  Print information about connection status updates.\n");
+	printf("-f  Output format of updates: text (default), ndjson or binary.\n");
+	printf("    ndjson and binary buffer the updates and write them in batches.\n");
+	printf("-c  Print update rate and latency of every socket to stderr each interval seconds.\n\n");
 
 	printf("-e  export pfx table and exit\n");
 	printf("-o  output file for export\n");
@@ -440,6 +496,7 @@ static void print_usage(char **argv)
 	printf(" %s tcp -k -p rpki-validator.realmv6.org 8283\n", argv[0]);
 	printf(" %s tcp -k rpki-validator.realmv6.org 8283 tcp -s example.com 323\n", argv[0]);
 	printf(" %s -kp tcp rpki-validator.realmv6.org 8283 tcp example.com 323\n", argv[0]);
+	printf(" %s -p -f ndjson -c 10 tcp rpki-validator.realmv6.org 8283\n", argv[0]);
 #ifdef RTRLIB_HAVE_LIBSSH
 	printf(" %s ssh rpki-validator.realmv6.org 22 rtr-ssh", argv[0]);
 	printf(" ~/.ssh/id_rsa ~/.ssh/known_hosts\n");
@@ -458,22 +515,278 @@ static void status_fp(const struct rtr_mgr_group *group __attribute__((unused)),
 		      const struct rtr_socket *rtr_sock, void *data __attribute__((unused)))
 {
 	if (print_status_updates) {
+		/* stdout only carries the update records in the streaming formats */
+		FILE *stream = output_format == OUTPUT_FORMAT_TEXT ? stdout : stderr;
+
 		pthread_mutex_lock(&stdout_mutex);
-		printf("RTR-Socket changed connection status to: %s, Mgr Status: %s\n",
-		       rtr_state_to_str(rtr_sock->state), rtr_mgr_status_to_str(mgr_status));
+		fprintf(stream, "RTR-Socket changed connection status to: %s, Mgr Status: %s\n",
+			rtr_state_to_str(rtr_sock->state), rtr_mgr_status_to_str(mgr_status));
 		pthread_mutex_unlock(&stdout_mutex);
 	}
 }
 
+/**
+ * @brief Write the buffered updates of a socket to stdout.
+ * @details The caller must hold the mutex of the buffer.
+ */
+static void output_flush(struct output_buffer *output)
+{
+	size_t written = 0;
+
+	if (output->len == 0)
+		return;
+
+	pthread_mutex_lock(&stdout_mutex);
+	while (written < output->len) {
+		ssize_t ret = write(STDOUT_FILENO, output->data + written, output->len - written);
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			break;
+		written += ret;
+	}
+	pthread_mutex_unlock(&stdout_mutex);
+
+	output->len = 0;
+}
+
+static void output_flush_all(void)
+{
+	for (size_t i = 0; i < socket_count; ++i) {
+		struct output_buffer *output = &socket_config[i]->output;
+
+		pthread_mutex_lock(&output->mutex);
+		output_flush(output);
+		pthread_mutex_unlock(&output->mutex);
+	}
+}
+
+/**
+ * @brief Return a pointer to at least @p len free bytes of the buffer, flushes the buffer if necessary.
+ * @details The caller must hold the mutex of the buffer.
+ */
+static char *output_reserve(struct output_buffer *output, size_t len)
+{
+	if (OUTPUT_BUFFER_SIZE - output->len < len)
+		output_flush(output);
+
+	return output->data + output->len;
+}
+
+static char *output_put_hex(char *dst, const uint8_t *src, size_t len)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	for (size_t i = 0; i < len; i++) {
+		*dst++ = digits[src[i] >> 4];
+		*dst++ = digits[src[i] & 0xf];
+	}
+
+	return dst;
+}
+
+static char *output_put_u16(char *dst, uint16_t val)
+{
+	*dst++ = val >> 8;
+	*dst++ = val;
+
+	return dst;
+}
+
+static char *output_put_u32(char *dst, uint32_t val)
+{
+	*dst++ = val >> 24;
+	*dst++ = val >> 16;
+	*dst++ = val >> 8;
+	*dst++ = val;
+
+	return dst;
+}
+
+/**
+ * @brief Append a printf formatted string to the buffer, flushes the buffer first if the string does not fit.
+ * @details The caller must hold the mutex of the buffer.
+ */
+__attribute__((format(printf, 2, 3))) static void output_printf(struct output_buffer *output, const char *fmt, ...)
+{
+	va_list args;
+	size_t avail = OUTPUT_BUFFER_SIZE - output->len;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(output->data + output->len, avail, fmt, args);
+	va_end(args);
+
+	if (len < 0)
+		return;
+
+	if ((size_t)len >= avail) {
+		output_flush(output);
+
+		va_start(args, fmt);
+		len = vsnprintf(output->data, OUTPUT_BUFFER_SIZE, fmt, args);
+		va_end(args);
+
+		if (len < 0 || len >= OUTPUT_BUFFER_SIZE)
+			return;
+	}
+
+	output->len += len;
+}
+
+static void output_pfx(struct socket_config *config, const struct pfx_record *rec, const bool added)
+{
+	struct output_buffer *output = &config->output;
+
+	pthread_mutex_lock(&output->mutex);
+
+	if (output_format == OUTPUT_FORMAT_NDJSON) {
+		char ip[INET6_ADDRSTRLEN];
+
+		lrtr_ip_addr_to_str(&rec->prefix, ip, sizeof(ip));
+		output_printf(output,
+			      "{\"type\":\"pfx\",\"op\":\"%s\",\"cache\":\"%s:%s\",\"prefix\":\"%s\",\"min_len\":%u,\"max_len\":%u,\"asn\":%u}\n",
+			      added ? "add" : "remove", config->host, config->port, ip, rec->min_len, rec->max_len,
+			      rec->asn);
+	} else {
+		char *dst = output_reserve(output, OUTPUT_BINARY_PFX_SIZE);
+
+		*dst++ = OUTPUT_RECORD_PFX;
+		*dst++ = added;
+		dst = output_put_u16(dst, config->index);
+		dst = output_put_u32(dst, rec->asn);
+		*dst++ = rec->prefix.ver == LRTR_IPV4 ? 4 : 6;
+		*dst++ = rec->min_len;
+		*dst++ = rec->max_len;
+		*dst++ = 0;
+
+		if (rec->prefix.ver == LRTR_IPV4) {
+			dst = output_put_u32(dst, rec->prefix.u.addr4.addr);
+			memset(dst, 0, 12);
+		} else {
+			for (unsigned int i = 0; i < 4; i++)
+				dst = output_put_u32(dst, rec->prefix.u.addr6.addr[i]);
+		}
+
+		output->len += OUTPUT_BINARY_PFX_SIZE;
+	}
+
+	pthread_mutex_unlock(&output->mutex);
+}
+
+static void output_spki(struct socket_config *config, const struct spki_record *record, const bool added)
+{
+	struct output_buffer *output = &config->output;
+
+	pthread_mutex_lock(&output->mutex);
+
+	if (output_format == OUTPUT_FORMAT_NDJSON) {
+		/* the variable part is written with output_put_hex, the fixed part fits into 128 bytes */
+		size_t len = strlen(config->host) + strlen(config->port) + 2 * (SKI_SIZE + SPKI_SIZE) + 128;
+		char *dst;
+		char *start;
+
+		if (len > OUTPUT_BUFFER_SIZE) {
+			pthread_mutex_unlock(&output->mutex);
+			return;
+		}
+
+		dst = output_reserve(output, len);
+		start = dst;
+		dst += sprintf(dst, "{\"type\":\"spki\",\"op\":\"%s\",\"cache\":\"%s:%s\",\"asn\":%u,\"ski\":\"",
+			       added ? "add" : "remove", config->host, config->port, record->asn);
+		dst = output_put_hex(dst, record->ski, SKI_SIZE);
+		dst += sprintf(dst, "\",\"spki\":\"");
+		dst = output_put_hex(dst, record->spki, SPKI_SIZE);
+		dst += sprintf(dst, "\"}\n");
+
+		output->len += dst - start;
+	} else {
+		char *dst = output_reserve(output, OUTPUT_BINARY_SPKI_SIZE);
+
+		*dst++ = OUTPUT_RECORD_SPKI;
+		*dst++ = added;
+		dst = output_put_u16(dst, config->index);
+		dst = output_put_u32(dst, record->asn);
+		memcpy(dst, record->ski, SKI_SIZE);
+		memcpy(dst + SKI_SIZE, record->spki, SPKI_SIZE);
+
+		output->len += OUTPUT_BINARY_SPKI_SIZE;
+	}
+
+	pthread_mutex_unlock(&output->mutex);
+}
+
+static uint64_t get_monotonic_time_ms(void)
+{
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (uint64_t)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+static void print_counters(uint64_t elapsed)
+{
+	for (size_t i = 0; i < socket_count; ++i) {
+		struct socket_config *config = socket_config[i];
+		unsigned long updates = __atomic_load_n(&config->updates, __ATOMIC_RELAXED);
+		struct rtr_socket_metrics metrics;
+
+		rtr_get_metrics(&config->socket, &metrics);
+
+		fprintf(stderr,
+			"%s:%s updates: %lu/s, connect: %u ms, query rtt: %u ms, sync: %u ms (%u pdus), syncs: %u, failures: %u\n",
+			config->host, config->port,
+			elapsed > 0 ? (unsigned long)((updates - config->reported_updates) * 1000 / elapsed) : 0,
+			metrics.connect_time, metrics.query_rtt, metrics.sync_time, metrics.sync_pdus, metrics.syncs,
+			metrics.failures);
+
+		config->reported_updates = updates;
+	}
+}
+
+/**
+ * @brief Periodically write the buffered updates and report the counters, never returns.
+ */
+static void output_loop(void)
+{
+	uint64_t last_report = get_monotonic_time_ms();
+
+	while (true) {
+		usleep(OUTPUT_FLUSH_INTERVAL);
+
+		if (output_format != OUTPUT_FORMAT_TEXT)
+			output_flush_all();
+
+		if (counter_interval > 0) {
+			uint64_t now = get_monotonic_time_ms();
+
+			if (now - last_report >= counter_interval * 1000ULL) {
+				print_counters(now - last_report);
+				last_report = now;
+			}
+		}
+	}
+}
+
 static void update_cb(struct pfx_table *p __attribute__((unused)), const struct pfx_record rec, const bool added)
 {
 	char ip[INET6_ADDRSTRLEN];
 
-	const struct socket_config *config = (const struct socket_config *)rec.socket;
+	struct socket_config *config = (struct socket_config *)rec.socket;
 
 	if (!print_all_pfx_updates && !config->print_pfx_updates)
 		return;
 
+	__atomic_add_fetch(&config->updates, 1, __ATOMIC_RELAXED);
+
+	if (output_format != OUTPUT_FORMAT_TEXT) {
+		output_pfx(config, &rec, added);
+		return;
+	}
+
 	pthread_mutex_lock(&stdout_mutex);
 	if (added)
 		printf("+ ");
@@ -491,11 +804,18 @@ static void update_cb(struct pfx_table *p __attribute__((unused)), const struct
 
 static void update_spki(struct spki_table *s __attribute__((unused)), const struct spki_record record, const bool added)
 {
-	const struct socket_config *config = (const struct socket_config *)record.socket;
+	struct socket_config *config = (struct socket_config *)record.socket;
 
 	if (!print_all_spki_updates && !config->print_spki_updates)
 		return;
 
+	__atomic_add_fetch(&config->updates, 1, __ATOMIC_RELAXED);
+
+	if (output_format != OUTPUT_FORMAT_TEXT) {
+		output_spki(config, &record, added);
+		return;
+	}
+
 	pthread_mutex_lock(&stdout_mutex);
 
 	char c;
@@ -542,7 +862,7 @@ static void parse_global_opts(int argc, char **argv)
 
 	bool print_template = false;
 
-	while ((opt = getopt(argc, argv, "+kphelo:t:s")) != -1) {
+	while ((opt = getopt(argc, argv, "+kphelo:t:sf:c:")) != -1) {
 		switch (opt) {
 		case 'k':
 			activate_spki_update_cb = true;
@@ -577,6 +897,24 @@ static void parse_global_opts(int argc, char **argv)
 			print_status_updates = true;
 			break;
 
+		case 'f':
+			if (strcasecmp(optarg, "text") == 0)
+				output_format = OUTPUT_FORMAT_TEXT;
+			else if (strcasecmp(optarg, "ndjson") == 0)
+				output_format = OUTPUT_FORMAT_NDJSON;
+			else if (strcasecmp(optarg, "binary") == 0)
+				output_format = OUTPUT_FORMAT_BINARY;
+			else
+				print_error_exit("\"%s\" is not a valid output format", optarg);
+			break;
+
+		case 'c':
+			if (!is_valid_counter_interval(optarg))
+				print_error_exit("\"%s\" is not a valid interval", optarg);
+
+			counter_interval = atoi(optarg);
+			break;
+
 		default:
 			print_usage(argv);
 			exit(EXIT_FAILURE);
@@ -661,6 +999,9 @@ static int parse_cli(int argc, char **argv)
 		CLI_PARSE_STATE_SOCKET_TCP_OPTIONS,
 		CLI_PARSE_STATE_SOCKET_TCP_HOST,
 		CLI_PARSE_STATE_SOCKET_TCP_PORT,
+		CLI_PARSE_STATE_SOCKET_FILE_OPTIONS,
+		CLI_PARSE_STATE_SOCKET_FILE_VRP_PATH,
+		CLI_PARSE_STATE_SOCKET_FILE_KEY_PATH,
 #ifdef RTRLIB_HAVE_LIBSSH
 		CLI_PARSE_STATE_SOCKET_SSH_OPTIONS,
 		CLI_PARSE_STATE_SOCKET_SSH_HOST,
@@ -703,6 +1044,13 @@ static int parse_cli(int argc, char **argv)
 				if ((argc - optind) < 2)
 					print_error_exit("Not enough arguments for tcp socket");
 
+			} else if (strncasecmp(argv[optind], "file", strlen(argv[optind])) == 0) {
+				state = CLI_PARSE_STATE_SOCKET_FILE_OPTIONS;
+				current_config->type = SOCKET_TYPE_FILE;
+
+				if ((argc - optind) < 2)
+					print_error_exit("Not enough arguments for file socket");
+
 			} else if (strncasecmp(argv[optind], "ssh", strlen(argv[optind])) == 0) {
 #ifdef RTRLIB_HAVE_LIBSSH
 				state = CLI_PARSE_STATE_SOCKET_SSH_OPTIONS;
@@ -756,6 +1104,40 @@ static int parse_cli(int argc, char **argv)
 			state = CLI_PARSE_STATE_SOCKET_BEGIN;
 			break;
 
+		case CLI_PARSE_STATE_SOCKET_FILE_OPTIONS:
+			parse_socket_opts(argc, argv, current_config);
+
+			if ((argc - optind) < 1)
+				print_error_exit("Not enough arguments for file socket");
+
+			state = CLI_PARSE_STATE_SOCKET_FILE_VRP_PATH;
+			break;
+
+		case CLI_PARSE_STATE_SOCKET_FILE_VRP_PATH:
+			if (!is_readable_file(argv[optind]))
+				print_error_exit("\"%s\" is not a readable file\n", argv[optind]);
+
+			current_config->vrp_path = argv[optind++];
+
+			state = CLI_PARSE_STATE_SOCKET_FILE_KEY_PATH;
+			break;
+
+		case CLI_PARSE_STATE_SOCKET_FILE_KEY_PATH:
+			if (strncasecmp(argv[optind], "tcp", strlen(argv[optind])) == 0 ||
+			    strncasecmp(argv[optind], "ssh", strlen(argv[optind])) == 0 ||
+			    strncasecmp(argv[optind], "file", strlen(argv[optind])) == 0) {
+				state = CLI_PARSE_STATE_SOCKET_BEGIN;
+				break;
+			}
+
+			if (!is_readable_file(argv[optind]))
+				print_error_exit("\"%s\" is not a readable file\n", argv[optind]);
+
+			current_config->key_path = argv[optind++];
+
+			state = CLI_PARSE_STATE_SOCKET_BEGIN;
+			break;
+
 #ifdef RTRLIB_HAVE_LIBSSH
 		case CLI_PARSE_STATE_SOCKET_SSH_OPTIONS:
 			parse_socket_opts(argc, argv, current_config);
@@ -825,7 +1207,8 @@ static int parse_cli(int argc, char **argv)
 
 		case CLI_PARSE_STATE_SOCKET_SSH_HOST_KEY:
 			if (strncasecmp(argv[optind], "tcp", strlen(argv[optind])) == 0 ||
-			    strncasecmp(argv[optind], "ssh", strlen(argv[optind])) == 0) {
+			    strncasecmp(argv[optind], "ssh", strlen(argv[optind])) == 0 ||
+			    strncasecmp(argv[optind], "file", strlen(argv[optind])) == 0) {
 				state = CLI_PARSE_STATE_SOCKET_BEGIN;
 				break;
 			}
@@ -853,6 +1236,7 @@ static void init_sockets(void)
 	for (size_t i = 0; i < socket_count; ++i) {
 		struct socket_config *config = socket_config[i];
 		struct tr_tcp_config tcp_config = {};
+		struct tr_file_config file_config = {};
 #ifdef RTRLIB_HAVE_LIBSSH
 		struct tr_ssh_config ssh_config = {};
 #endif
@@ -867,6 +1251,14 @@ static void init_sockets(void)
 			config->socket.tr_socket = &config->tr_socket;
 			break;
 
+		case SOCKET_TYPE_FILE:
+			file_config.vrp_path = config->vrp_path;
+			file_config.key_path = config->key_path;
+
+			tr_file_init(&file_config, &config->tr_socket);
+			config->socket.tr_socket = &config->tr_socket;
+			break;
+
 #ifdef RTRLIB_HAVE_LIBSSH
 		case SOCKET_TYPE_SSH:
 			ssh_config.host = config->host;
@@ -916,9 +1308,11 @@ int main(int argc, char **argv)
 	if (!conf)
 		return EXIT_FAILURE;
 
-	if (!export_pfx && activate_pfx_update_cb && socket_count > 1)
+	bool print_header = !export_pfx && activate_pfx_update_cb && output_format == OUTPUT_FORMAT_TEXT;
+
+	if (print_header && socket_count > 1)
 		printf("%-40s %-40s   %3s   %3s   %3s\n", "host", "Prefix", "Prefix Length", "", "ASN");
-	else if (!export_pfx && activate_pfx_update_cb)
+	else if (print_header)
 		printf("%-40s   %3s   %3s   %3s\n", "Prefix", "Prefix Length", "", "ASN");
 
 	if (export_pfx) {
@@ -955,8 +1349,18 @@ int main(int argc, char **argv)
 		tommy_array_init(&prefixes);
 		tommy_hashlin_init(&prefix_hash);
 
-		pfx_table_for_each_ipv4_record(conf->pfx_table, pfx_export_cb, &arg);
-		pfx_table_for_each_ipv6_record(conf->pfx_table, pfx_export_cb, &arg);
+		for (unsigned int i = 0; i < 2; i++) {
+			struct pfx_record *records;
+			unsigned int records_len;
+
+			if (pfx_table_get_records(conf->pfx_table, i == 0 ? LRTR_IPV4 : LRTR_IPV6, &records,
+						  &records_len) != PFX_SUCCESS)
+				print_error_exit("Could not copy the records for the export");
+
+			for (unsigned int j = 0; j < records_len; j++)
+				pfx_export_cb(&records[j], &arg);
+			free(records);
+		}
 
 		struct exporter_state state = {
 			.roa_section = false,
@@ -978,7 +1382,11 @@ int main(int argc, char **argv)
 
 	} else {
 		rtr_mgr_start(conf);
-		pause();
+
+		if (output_format == OUTPUT_FORMAT_TEXT && counter_interval == 0)
+			pause();
+		else
+			output_loop();
 	}
 
 	rtr_mgr_stop(conf);